@@ -46,10 +46,10 @@ class OneEmbeddingHandler final {
 #endif
   }
 
-  void SaveSnapshot(const std::string& snapshot_name) {
+  void SaveSnapshot(const std::string& snapshot_name, bool incremental) {
 #ifdef WITH_CUDA
     Global<embedding::EmbeddingManager>::Get()->SaveSnapshot(embedding_name_, local_rank_id_,
-                                                             rank_id_, snapshot_name);
+                                                             rank_id_, snapshot_name, incremental);
 #else
     UNIMPLEMENTED() << "Only Support with CUDA";
 #endif
@@ -319,7 +319,8 @@ ONEFLOW_API_PYBIND11_MODULE("", m) {
         return std::make_shared<OneEmbeddingHandler>(key_value_store_option_str, local_rank_id,
                                                      rank_id, world_size);
       }))
-      .def("SaveSnapshot", &OneEmbeddingHandler::SaveSnapshot)
+      .def("SaveSnapshot", &OneEmbeddingHandler::SaveSnapshot, py::arg("snapshot_name"),
+           py::arg("incremental") = false)
       .def("LoadSnapshot", &OneEmbeddingHandler::LoadSnapshot);
 
   py::class_<embedding::PersistentTableWriter, std::shared_ptr<embedding::PersistentTableWriter>>(
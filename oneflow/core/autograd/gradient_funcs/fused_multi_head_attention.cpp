@@ -0,0 +1,108 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_expr_grad_function.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow {
+namespace one {
+
+struct FusedMultiHeadAttentionCaptureState : public AutoGradCaptureState {
+  bool query_requires_grad = false;
+  bool key_requires_grad = false;
+  bool value_requires_grad = false;
+  bool causal = false;
+  float scale = 1.0;
+  float dropout_scale = 1.0;
+};
+
+class FusedMultiHeadAttention : public OpExprGradFunction<FusedMultiHeadAttentionCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override;
+  Maybe<void> Capture(FusedMultiHeadAttentionCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override;
+  Maybe<void> Apply(const FusedMultiHeadAttentionCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override;
+
+ private:
+  AttrMap base_attrs_;
+  // The masks are optional inputs, each op expr is built with a fixed set of them.
+  bool has_key_padding_mask_ = false;
+  bool has_dropout_mask_ = false;
+};
+
+Maybe<void> FusedMultiHeadAttention::Init(const OpExpr& op) {
+  const UserOpExpr* fw_op_expr = dynamic_cast<const UserOpExpr*>(&op);
+  CHECK_NOTNULL_OR_RETURN(fw_op_expr);
+  base_attrs_ = MakeAttrMapFromUserOpConf(fw_op_expr->proto());
+  for (const auto& pair : fw_op_expr->indexed_input_pairs()) {
+    if (pair.first == "key_padding_mask") { has_key_padding_mask_ = true; }
+    if (pair.first == "dropout_mask") { has_dropout_mask_ = true; }
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FusedMultiHeadAttention::Capture(FusedMultiHeadAttentionCaptureState* ctx,
+                                             const TensorTuple& inputs, const TensorTuple& outputs,
+                                             const AttrMap& attrs) const {
+  // query, key, value, key_padding_mask (optional), dropout_mask (optional)
+  CHECK_EQ_OR_RETURN(inputs.size(), 3 + has_key_padding_mask_ + has_dropout_mask_);
+  CHECK_EQ_OR_RETURN(outputs.size(), 2);  // out, softmax_lse
+  ctx->query_requires_grad = inputs.at(0)->requires_grad();
+  ctx->key_requires_grad = inputs.at(1)->requires_grad();
+  ctx->value_requires_grad = inputs.at(2)->requires_grad();
+  if (!ctx->query_requires_grad && !ctx->key_requires_grad && !ctx->value_requires_grad) {
+    return Maybe<void>::Ok();
+  }
+  ComposedAttrMap composed_attrs(attrs, base_attrs_);
+  ctx->causal = JUST(composed_attrs.GetAttr<bool>("causal"));
+  ctx->scale = JUST(composed_attrs.GetAttr<float>("scale"));
+  ctx->dropout_scale = JUST(composed_attrs.GetAttr<float>("dropout_scale"));
+  for (const auto& input : inputs) { ctx->SaveTensorForBackward(input); }
+  ctx->SaveTensorForBackward(outputs.at(0));  // out
+  ctx->SaveTensorForBackward(outputs.at(1));  // softmax_lse
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FusedMultiHeadAttention::Apply(const FusedMultiHeadAttentionCaptureState* ctx,
+                                           const TensorTuple& out_grads,
+                                           TensorTuple* in_grads) const {
+  CHECK_EQ_OR_RETURN(out_grads.size(), 2);  // d_out, d_softmax_lse
+  const size_t num_inputs = 3 + has_key_padding_mask_ + has_dropout_mask_;
+  in_grads->resize(num_inputs);
+  if (!ctx->query_requires_grad && !ctx->key_requires_grad && !ctx->value_requires_grad) {
+    return Maybe<void>::Ok();
+  }
+  const auto& saved_tensors = ctx->SavedTensors();
+  Optional<one::Tensor> key_padding_mask;
+  Optional<one::Tensor> dropout_mask;
+  size_t mask_index = 3;
+  if (has_key_padding_mask_) { key_padding_mask = saved_tensors.at(mask_index++); }
+  if (has_dropout_mask_) { dropout_mask = saved_tensors.at(mask_index++); }
+  const auto& grads = JUST(functional::FusedMultiHeadAttentionGrad(
+      saved_tensors.at(0), saved_tensors.at(1), saved_tensors.at(2),
+      saved_tensors.at(num_inputs), saved_tensors.at(num_inputs + 1), out_grads.at(0),
+      key_padding_mask, dropout_mask, ctx->causal, ctx->scale, ctx->dropout_scale));
+  if (ctx->query_requires_grad) { in_grads->at(0) = grads->at(0); }
+  if (ctx->key_requires_grad) { in_grads->at(1) = grads->at(1); }
+  if (ctx->value_requires_grad) { in_grads->at(2) = grads->at(2); }
+  return Maybe<void>::Ok();
+}
+
+REGISTER_OP_EXPR_GRAD_FUNCTION("fused_multi_head_attention", FusedMultiHeadAttention);
+
+}  // namespace one
+}  // namespace oneflow
@@ -51,8 +51,19 @@ int64_t RingDecrease(int64_t n, int64_t size) { return (n - 1 + size) % size; }
 
 int64_t RingIncrease(int64_t n, int64_t size) { return (n + 1 + size) % size; }
 
+// Below this many elements the reduction is done by the calling thread, a chunk of a pipelined
+// collective is usually too small to be worth waking up the thread pool.
+constexpr size_t kVecAddSerialSize = 32768;
+// Caps the number of messages of a partition, small ONEFLOW_CCL_CPU_CHUNK_BYTES on big buffers
+// would otherwise flood the transport.
+constexpr int64_t kMaxNumChunksPerPart = 64;
+
 template<typename T>
 void VecAdd(size_t size, T* out, const T* in0, const T* in1) {
+  if (size <= kVecAddSerialSize) {
+    for (size_t i = 0; i < size; ++i) { out[i] = in0[i] + in1[i]; }
+    return;
+  }
   size_t thread_num = Global<ThreadPool>::Get()->thread_num();
   BalancedSplitter bs(size, thread_num);
   MultiThreadLoop(thread_num, [&](size_t thread_idx) {
@@ -61,6 +72,314 @@ void VecAdd(size_t size, T* out, const T* in0, const T* in1) {
   });
 }
 
+// The ranks a collective runs on, in ring order, and the position of the current rank among them.
+struct CclGroup {
+  std::vector<int64_t> ranks;
+  int64_t index = -1;
+
+  int64_t size() const { return ranks.size(); }
+  int64_t NextRank() const { return ranks.at(RingIncrease(index, size())); }
+  int64_t PrevRank() const { return ranks.at(RingDecrease(index, size())); }
+};
+
+// `flat` holds all ranks of a placement ordered by parallel id. If every node holds the same
+// number (> 1) of those ranks and there is more than one node, `local` holds the ranks on the
+// node of the current rank and `cross` holds the ranks with the same local index on every node.
+struct CclTopology {
+  CclGroup flat;
+  bool hierarchical = false;
+  CclGroup local;
+  CclGroup cross;
+};
+
+Maybe<CclTopology> GetCclTopology(Symbol<ParallelDesc> parallel_desc) {
+  CclTopology topo;
+  const int64_t parallel_num = parallel_desc->parallel_num();
+  const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
+  CHECK_OR_RETURN(opt_parallel_id->has_value());
+  topo.flat.index = JUST(*opt_parallel_id);
+  std::map<int64_t, std::vector<int64_t>> node_id2ranks;
+  for (int64_t parallel_id = 0; parallel_id < parallel_num; ++parallel_id) {
+    int64_t rank = JUST(parallel_desc->MachineId4ParallelId(parallel_id));
+    topo.flat.ranks.emplace_back(rank);
+    node_id2ranks[GlobalProcessCtx::NodeId(rank)].emplace_back(rank);
+  }
+  if (!EnvBool<ONEFLOW_CCL_CPU_ENABLE_HIERARCHICAL_ALL_REDUCE>() || node_id2ranks.size() == 1) {
+    return topo;
+  }
+  const int64_t num_local_ranks = node_id2ranks.begin()->second.size();
+  if (num_local_ranks == 1) { return topo; }
+  for (const auto& pair : node_id2ranks) {
+    if (pair.second.size() != num_local_ranks) { return topo; }
+  }
+  const int64_t rank = topo.flat.ranks.at(topo.flat.index);
+  topo.local.ranks = node_id2ranks.at(GlobalProcessCtx::NodeId(rank));
+  topo.local.index = std::find(topo.local.ranks.cbegin(), topo.local.ranks.cend(), rank)
+                     - topo.local.ranks.cbegin();
+  for (const auto& pair : node_id2ranks) {
+    if (pair.second.at(topo.local.index) == rank) { topo.cross.index = topo.cross.ranks.size(); }
+    topo.cross.ranks.emplace_back(pair.second.at(topo.local.index));
+  }
+  topo.hierarchical = true;
+  return topo;
+}
+
+// Point-to-point transfers of a collective that are posted without waiting for them. Transfers
+// between the same pair of ranks are matched in posting order, so a sequence of chunk sends on one
+// rank lines up with the same sequence of chunk receives on its peer. Empty transfers are not
+// posted at all and get the handle -1, peers agree on them since they agree on the sizes.
+class AsyncTransferQueue final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AsyncTransferQueue);
+  explicit AsyncTransferQueue(const TransportToken& transport_token)
+      : transport_token_(transport_token) {}
+  ~AsyncTransferQueue() = default;
+
+  Maybe<int64_t> PostSend(int64_t rank, const void* buffer, std::size_t size) {
+    if (size == 0) { return -1; }
+    auto ctx = std::make_unique<NaiveAsyncTransportCtx>(
+        transport_token_,
+        [buffer, size](void** send_buffer, std::size_t* send_size,
+                       std::function<void()>* Cb) -> Maybe<void> {
+          *send_buffer = const_cast<void*>(buffer);
+          *send_size = size;
+          *Cb = [] {};
+          return Maybe<void>::Ok();
+        },
+        [](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+          UNIMPLEMENTED_THEN_RETURN();
+        });
+    JUST(TransportUtil::SendDataToRank(rank, transport_token_, ctx.get()));
+    transfers_.emplace_back(std::move(ctx));
+    return transfers_.size() - 1;
+  }
+
+  Maybe<int64_t> PostRecv(int64_t rank, void* buffer, std::size_t size) {
+    if (size == 0) { return -1; }
+    auto ctx = std::make_unique<NaiveAsyncTransportCtx>(
+        transport_token_,
+        [](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+          UNIMPLEMENTED_THEN_RETURN();
+        },
+        [buffer, size](void** recv_buffer, std::size_t* recv_size,
+                       std::function<void()>* Cb) -> Maybe<void> {
+          *recv_buffer = buffer;
+          *recv_size = size;
+          *Cb = [] {};
+          return Maybe<void>::Ok();
+        });
+    JUST(TransportUtil::ReceiveDataFromRank(rank, transport_token_, ctx.get()));
+    transfers_.emplace_back(std::move(ctx));
+    return transfers_.size() - 1;
+  }
+
+  Maybe<void> Wait(int64_t handle) {
+    if (handle < 0) { return Maybe<void>::Ok(); }
+    auto& ctx = transfers_.at(handle);
+    if (ctx) {
+      JUST(ctx->WaitDone());
+      ctx.reset();
+    }
+    return Maybe<void>::Ok();
+  }
+
+  Maybe<void> WaitAll() {
+    for (int64_t handle = 0; handle < transfers_.size(); ++handle) { JUST(Wait(handle)); }
+    return Maybe<void>::Ok();
+  }
+
+ private:
+  TransportToken transport_token_;
+  std::vector<std::unique_ptr<NaiveAsyncTransportCtx>> transfers_;
+};
+
+// Splits every partition of at most `max_part_size` elements at the same offsets, chunk i of a
+// partition is therefore known to both of its peers without exchanging sizes.
+class ChunkLayout final {
+ public:
+  ChunkLayout(int64_t max_part_size, size_t elem_size) {
+    chunk_size_ = std::max<int64_t>(EnvInteger<ONEFLOW_CCL_CPU_CHUNK_BYTES>() / elem_size, 1);
+    chunk_size_ = std::max<int64_t>(
+        chunk_size_, (max_part_size + kMaxNumChunksPerPart - 1) / kMaxNumChunksPerPart);
+    num_chunks_ = (max_part_size + chunk_size_ - 1) / chunk_size_;
+  }
+
+  int64_t num_chunks() const { return num_chunks_; }
+
+  Range At(int64_t chunk_id, int64_t part_size) const {
+    const int64_t begin = std::min(chunk_id * chunk_size_, part_size);
+    return Range(begin, std::min(begin + chunk_size_, part_size));
+  }
+
+ private:
+  int64_t chunk_size_;
+  int64_t num_chunks_;
+};
+
+// Pipelined ring reduce-scatter. `in` holds group.size() partitions split by `bs`, on return `out`
+// holds the sum of partition group.index over the group. Step i sends partition (index - 1 - i)
+// and receives partition (index - 2 - i). Every chunk is forwarded to the next rank as soon as it
+// is reduced, so the reduction of one chunk overlaps with the transfer of the others.
+template<typename T>
+Maybe<void> RingReduceScatter(const CclGroup& group, const T* in, const BalancedSplitter& bs,
+                              T* out, const TransportToken& transport_token) {
+  const int64_t num_ranks = group.size();
+  const int64_t num_steps = num_ranks - 1;
+  const int64_t max_part_size = bs.At(0).size();
+  const ChunkLayout layout(max_part_size, sizeof(T));
+  const int64_t num_chunks = layout.num_chunks();
+  const auto PartId = [&](int64_t step) -> int64_t {
+    return (group.index - 1 - step + 2 * num_ranks) % num_ranks;
+  };
+  auto recv_buffer = std::make_unique<T[]>(max_part_size);
+  // the partial sums of two consecutive steps, the one of step i is sent in step i + 1
+  std::unique_ptr<T[]> partial[2];
+  std::vector<int64_t> partial_send_handles[2];
+  for (int64_t i = 0; i < 2; ++i) {
+    partial[i] = std::make_unique<T[]>(num_steps > 1 ? max_part_size : 0);
+    partial_send_handles[i].resize(num_chunks, -1);
+  }
+  std::vector<int64_t> recv_handles(num_chunks, -1);
+  AsyncTransferQueue queue(transport_token);
+  const auto PostSendChunk = [&](int64_t step, int64_t chunk_id) -> Maybe<void> {
+    const int64_t part_id = PartId(step);
+    const Range range = layout.At(chunk_id, bs.At(part_id).size());
+    const T* send_ptr = step == 0 ? &in[bs.At(part_id).begin()] : partial[(step - 1) % 2].get();
+    int64_t handle = JUST(queue.PostSend(group.NextRank(), send_ptr + range.begin(),
+                                         range.size() * sizeof(T)));
+    if (step > 0) { partial_send_handles[(step - 1) % 2][chunk_id] = handle; }
+    return Maybe<void>::Ok();
+  };
+  const auto PostRecvChunk = [&](int64_t step, int64_t chunk_id) -> Maybe<void> {
+    const Range range = layout.At(chunk_id, bs.At(PartId(step + 1)).size());
+    recv_handles[chunk_id] = JUST(queue.PostRecv(
+        group.PrevRank(), recv_buffer.get() + range.begin(), range.size() * sizeof(T)));
+    return Maybe<void>::Ok();
+  };
+  for (int64_t chunk_id = 0; chunk_id < num_chunks; ++chunk_id) {
+    JUST(PostRecvChunk(0, chunk_id));
+    JUST(PostSendChunk(0, chunk_id));
+  }
+  for (int64_t step = 0; step < num_steps; ++step) {
+    const bool is_last_step = step == num_steps - 1;
+    const int64_t part_id = PartId(step + 1);
+    const T* cur_in = &in[bs.At(part_id).begin()];
+    T* cur_out = is_last_step ? out : partial[step % 2].get();
+    for (int64_t chunk_id = 0; chunk_id < num_chunks; ++chunk_id) {
+      const Range range = layout.At(chunk_id, bs.At(part_id).size());
+      JUST(queue.Wait(recv_handles[chunk_id]));
+      // the chunk is still being sent from the partial sum of step - 2
+      if (!is_last_step) { JUST(queue.Wait(partial_send_handles[step % 2][chunk_id])); }
+      if (range.size() > 0) {
+        VecAdd(range.size(), cur_out + range.begin(), cur_in + range.begin(),
+               recv_buffer.get() + range.begin());
+      }
+      if (!is_last_step) {
+        JUST(PostRecvChunk(step + 1, chunk_id));
+        JUST(PostSendChunk(step + 1, chunk_id));
+      }
+    }
+  }
+  JUST(queue.WaitAll());
+  return Maybe<void>::Ok();
+}
+
+// Pipelined ring all-gather. `buffer` holds group.size() partitions split by `bs`, partition
+// group.index is filled on entry and all of them are filled on return. Step i sends partition
+// (index - i) and receives partition (index - 1 - i), every received chunk is forwarded at once.
+template<typename T>
+Maybe<void> RingAllGather(const CclGroup& group, T* buffer, const BalancedSplitter& bs,
+                          const TransportToken& transport_token) {
+  const int64_t num_ranks = group.size();
+  const int64_t num_steps = num_ranks - 1;
+  const ChunkLayout layout(bs.At(0).size(), sizeof(T));
+  const int64_t num_chunks = layout.num_chunks();
+  const auto PartId = [&](int64_t step) -> int64_t {
+    return (group.index - step + 2 * num_ranks) % num_ranks;
+  };
+  std::vector<int64_t> recv_handles(num_chunks, -1);
+  AsyncTransferQueue queue(transport_token);
+  const auto PostSendChunk = [&](int64_t step, int64_t chunk_id) -> Maybe<void> {
+    const Range part = bs.At(PartId(step));
+    const Range range = layout.At(chunk_id, part.size());
+    JUST(queue.PostSend(group.NextRank(), buffer + part.begin() + range.begin(),
+                        range.size() * sizeof(T)));
+    return Maybe<void>::Ok();
+  };
+  const auto PostRecvChunk = [&](int64_t step, int64_t chunk_id) -> Maybe<void> {
+    const Range part = bs.At(PartId(step + 1));
+    const Range range = layout.At(chunk_id, part.size());
+    recv_handles[chunk_id] = JUST(queue.PostRecv(
+        group.PrevRank(), buffer + part.begin() + range.begin(), range.size() * sizeof(T)));
+    return Maybe<void>::Ok();
+  };
+  for (int64_t chunk_id = 0; chunk_id < num_chunks; ++chunk_id) {
+    JUST(PostRecvChunk(0, chunk_id));
+    JUST(PostSendChunk(0, chunk_id));
+  }
+  for (int64_t step = 0; step < num_steps - 1; ++step) {
+    for (int64_t chunk_id = 0; chunk_id < num_chunks; ++chunk_id) {
+      JUST(queue.Wait(recv_handles[chunk_id]));
+      JUST(PostRecvChunk(step + 1, chunk_id));
+      JUST(PostSendChunk(step + 1, chunk_id));
+    }
+  }
+  JUST(queue.WaitAll());
+  return Maybe<void>::Ok();
+}
+
+// log(n) exchanges of the whole buffer with the rank whose index differs in one bit, for small
+// buffers where latency rather than bandwidth dominates. Requires a power-of-two group.
+template<typename T>
+Maybe<void> RecursiveDoublingAllReduce(const CclGroup& group, const T* in, T* out,
+                                       size_t elem_cnt, const TransportToken& transport_token) {
+  CHECK_EQ_OR_RETURN(group.size() & (group.size() - 1), 0);
+  if (in != out) { std::memcpy(out, in, elem_cnt * sizeof(T)); }
+  auto recv_buffer = std::make_unique<T[]>(elem_cnt);
+  for (int64_t mask = 1; mask < group.size(); mask <<= 1) {
+    const int64_t peer = group.ranks.at(group.index ^ mask);
+    AsyncTransferQueue queue(transport_token);
+    JUST(queue.PostRecv(peer, recv_buffer.get(), elem_cnt * sizeof(T)));
+    JUST(queue.PostSend(peer, out, elem_cnt * sizeof(T)));
+    JUST(queue.WaitAll());
+    // addition is commutative, both peers end up with bitwise identical sums
+    VecAdd(elem_cnt, out, out, recv_buffer.get());
+  }
+  return Maybe<void>::Ok();
+}
+
+template<typename T>
+Maybe<void> FlatAllReduce(const CclGroup& group, const T* in, T* out, size_t elem_cnt,
+                          const TransportToken& transport_token) {
+  const int64_t num_ranks = group.size();
+  if (num_ranks == 1) {
+    if (in != out) { std::memcpy(out, in, elem_cnt * sizeof(T)); }
+    return Maybe<void>::Ok();
+  }
+  if ((num_ranks & (num_ranks - 1)) == 0
+      && elem_cnt * sizeof(T) <= EnvInteger<ONEFLOW_CCL_CPU_RECURSIVE_DOUBLING_THRESHOLD>()) {
+    return RecursiveDoublingAllReduce(group, in, out, elem_cnt, transport_token);
+  }
+  BalancedSplitter bs(elem_cnt, num_ranks);
+  JUST(RingReduceScatter(group, in, bs, &out[bs.At(group.index).begin()], transport_token));
+  JUST(RingAllGather(group, out, bs, transport_token));
+  return Maybe<void>::Ok();
+}
+
+// Reduce-scatter inside every node, all-reduce the shard across nodes, all-gather inside every
+// node. Only 1 / num_local_ranks of the buffer crosses the node boundary per rank.
+template<typename T>
+Maybe<void> HierarchicalAllReduce(const CclTopology& topo, const T* in, T* out, size_t elem_cnt,
+                                  const TransportToken& transport_token) {
+  BalancedSplitter bs(elem_cnt, topo.local.size());
+  const Range shard = bs.At(topo.local.index);
+  JUST(RingReduceScatter(topo.local, in, bs, &out[shard.begin()], transport_token));
+  JUST(FlatAllReduce(topo.cross, &out[shard.begin()], &out[shard.begin()], shard.size(),
+                     transport_token));
+  JUST(RingAllGather(topo.local, out, bs, transport_token));
+  return Maybe<void>::Ok();
+}
+
 }  // namespace
 
 template<typename T, ReduceType reduce_type>
@@ -77,82 +396,16 @@ struct DtypeAllReduce<T, kSum> {
     }
     const T* in = reinterpret_cast<const T*>(void_in);
     T* out = reinterpret_cast<T*>(void_out);
-    BalancedSplitter bs(elem_cnt, parallel_num);
-    auto recv_buffer = std::make_unique<T[]>(bs.At(0).size());
-    Optional<int64_t> parallel_id;
-    JUST(GetTensorDevice4CurrentProcessCtx(parallel_desc, &parallel_id));
-    const auto& rank_group = JUST(RankGroup::New(parallel_desc));
+    const auto& topo = JUST(GetCclTopology(parallel_desc));
     TransportToken transport_token =
         JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-    for (int64_t i = 0, part_id = JUST(parallel_id); i < parallel_num - 1;
-         ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = nullptr;
-      if (i == 0) {
-        send_ptr = &in[bs.At(send_part_id).begin()];
-      } else {
-        send_ptr = &out[bs.At(send_part_id).begin()];
-      }
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = recv_buffer.get();
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(ctx.WaitDone());
-      const T* cur_in = &in[bs.At(recv_part_id).begin()];
-      T* cur_out = &out[bs.At(recv_part_id).begin()];
-      if (recv_size > 0) { VecAdd(recv_size, cur_out, cur_in, recv_ptr); }
+    const bool use_recursive_doubling =
+        (parallel_num & (parallel_num - 1)) == 0
+        && elem_cnt * sizeof(T) <= EnvInteger<ONEFLOW_CCL_CPU_RECURSIVE_DOUBLING_THRESHOLD>();
+    if (topo.hierarchical && !use_recursive_doubling) {
+      return HierarchicalAllReduce(topo, in, out, elem_cnt, transport_token);
     }
-    for (int64_t i = 0, part_id = RingIncrease(JUST(parallel_id), parallel_num);
-         i < parallel_num - 1; ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = &out[bs.At(send_part_id).begin()];
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = &out[bs.At(recv_part_id).begin()];
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(ctx.WaitDone());
-    }
-    return Maybe<void>::Ok();
+    return FlatAllReduce(topo.flat, in, out, elem_cnt, transport_token);
   }
 };
 
@@ -187,53 +440,10 @@ struct DtypeReduceScatter<T, kSum> {
     T* out = reinterpret_cast<T*>(void_out);
 
     BalancedSplitter bs(elem_cnt * parallel_num, parallel_num);
-    const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
-    CHECK_OR_RETURN(opt_parallel_id->has_value());
-    int64_t parallel_id = JUST(*opt_parallel_id);
-
-    auto recv_buffer = std::make_unique<T[]>(bs.At(0).size());
-    const auto& rank_group = JUST(RankGroup::New(parallel_desc));
-
+    const auto& topo = JUST(GetCclTopology(parallel_desc));
     TransportToken transport_token =
         JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-    for (int64_t i = 0, part_id = RingDecrease(parallel_id, parallel_num); i < parallel_num - 1;
-         ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = nullptr;
-      if (i == 0) {
-        send_ptr = &in[bs.At(send_part_id).begin()];
-      } else {
-        send_ptr = out;
-      }
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = recv_buffer.get();
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(ctx.WaitDone());
-      const T* cur_in = &in[bs.At(recv_part_id).begin()];
-      if (recv_size > 0) { VecAdd(recv_size, out, cur_in, recv_ptr); }
-    }
-    return Maybe<void>::Ok();
+    return RingReduceScatter(topo.flat, in, bs, out, transport_token);
   }
 };
 
@@ -263,46 +473,14 @@ Maybe<void> AllGather<DeviceType::kCPU>(const void* in, void* out, size_t elem_c
   char* char_out = reinterpret_cast<char*>(out);
   size_t chunk_size = elem_cnt * GetSizeOfDataType(dtype);
   BalancedSplitter bs(chunk_size * parallel_num, parallel_num);
-  const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
-  CHECK_OR_RETURN(opt_parallel_id->has_value());
-  const auto& rank_group = JUST(RankGroup::New(parallel_desc));
+  const auto& topo = JUST(GetCclTopology(parallel_desc));
   TransportToken transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-  int64_t parallel_id = JUST(*opt_parallel_id);
+  int64_t parallel_id = topo.flat.index;
   // In-place operation will happen if in == out + parallel_id * chunk_size
   if (in != &char_out[parallel_id * chunk_size]) {
     memcpy(&char_out[parallel_id * chunk_size], in, chunk_size);
   }
-  for (int64_t i = 0, part_id = parallel_id; i < parallel_num - 1;
-       ++i, part_id = RingDecrease(part_id, parallel_num)) {
-    int64_t send_part_id = part_id;
-    const void* send_ptr = &char_out[bs.At(send_part_id).begin()];
-    size_t send_size = bs.At(send_part_id).size();
-    int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-    void* recv_ptr = &char_out[bs.At(recv_part_id).begin()];
-    size_t recv_size = bs.At(recv_part_id).size();
-    NaiveAsyncTransportCtx ctx(
-        transport_token,
-        [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-          *buffer = const_cast<void*>(send_ptr);
-          *size = send_size;
-          *Cb = [] {};
-          return Maybe<void>::Ok();
-        },
-        [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-          *buffer = recv_ptr;
-          *size = recv_size;
-          *Cb = [] {};
-          return Maybe<void>::Ok();
-        });
-    if (send_size > 0) {
-      JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-    }
-    if (recv_size > 0) {
-      JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-    }
-    JUST(ctx.WaitDone());
-  }
-  return Maybe<void>::Ok();
+  return RingAllGather(topo.flat, char_out, bs, transport_token);
 }
 
 template<>
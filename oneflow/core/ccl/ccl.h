@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/common/data_type.pb.h"
 #include "oneflow/core/common/device_type.h"
+#include "oneflow/core/common/env_var/env_var.h"
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/common/switch_func.h"
 #include "oneflow/core/ep/include/stream.h"
@@ -28,6 +29,16 @@ class DeviceCtx;
 class ParallelDesc;
 class TransportToken;
 
+// CPU collectives send every partition in chunks of about this many bytes so that the reduction of
+// one chunk overlaps with the transfer of the next ones. Must be the same on all ranks.
+DEFINE_ENV_INTEGER(ONEFLOW_CCL_CPU_CHUNK_BYTES, 1 << 20);
+// CPU all-reduce of at most this many bytes over a power-of-two number of ranks uses recursive
+// doubling (log(n) full-buffer exchanges) instead of a ring (2 * (n - 1) partition exchanges).
+DEFINE_ENV_INTEGER(ONEFLOW_CCL_CPU_RECURSIVE_DOUBLING_THRESHOLD, 64 * 1024);
+// CPU all-reduce over several nodes with the same number of ranks each first reduces inside every
+// node, then all-reduces across nodes and finally all-gathers inside every node.
+DEFINE_ENV_BOOL(ONEFLOW_CCL_CPU_ENABLE_HIERARCHICAL_ALL_REDUCE, true);
+
 // collective communication library
 namespace ccl {
 
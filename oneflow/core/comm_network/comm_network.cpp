@@ -18,9 +18,19 @@ limitations under the License.
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/job/env_desc.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/profiler/metrics.h"
 
 namespace oneflow {
 
+profiler::Counter* CommNetBytesCounter(bool received) {
+  static profiler::Counter* received_counter =
+      profiler::MetricsRegistry::Get()->GetOrCreateCounter(
+          "oneflow_comm_net_bytes_total", "Bytes moved by the CommNet.", "direction=\"received\"");
+  static profiler::Counter* sent_counter = profiler::MetricsRegistry::Get()->GetOrCreateCounter(
+      "oneflow_comm_net_bytes_total", "Bytes moved by the CommNet.", "direction=\"sent\"");
+  return received ? received_counter : sent_counter;
+}
+
 CommNet::~CommNet() {
   ready_cbs_.Close();
   ready_cb_poller_.join();
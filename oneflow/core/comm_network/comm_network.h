@@ -24,6 +24,15 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace profiler {
+
+class Counter;
+
+}  // namespace profiler
+
+// The bytes moved by the CommNet backends, counted by the direction seen from this process.
+profiler::Counter* CommNetBytesCounter(bool received);
+
 struct CommNetItem {
   bool is_read;
   std::function<void()> callback;
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/lazy/actor/actor_message_bus.h"
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
 #include "oneflow/core/transport/transport.h"
+#include "oneflow/core/profiler/metrics.h"
 
 #include <netinet/tcp.h>
 
@@ -57,6 +58,7 @@ bool SocketReadHelper::DoCurRead(void (SocketReadHelper::*set_cur_read_done)())
   ssize_t n = read(sockfd_, read_ptr_, read_size_);
   const int val = 1;
   PCHECK(setsockopt(sockfd_, IPPROTO_TCP, TCP_QUICKACK, (char*)&val, sizeof(int)) == 0);
+  if (n > 0) { CommNetBytesCounter(true)->Increment(n); }
   if (n == read_size_) {
     (this->*set_cur_read_done)();
     return true;
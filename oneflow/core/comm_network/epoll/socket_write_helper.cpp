@@ -17,6 +17,8 @@ limitations under the License.
 
 #include "oneflow/core/comm_network/epoll/socket_write_helper.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+#include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/profiler/metrics.h"
 
 #include <sys/eventfd.h>
 
@@ -96,6 +98,7 @@ bool SocketWriteHelper::MsgBodyWriteHandle() {
 
 bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
   ssize_t n = write(sockfd_, write_ptr_, write_size_);
+  if (n > 0) { CommNetBytesCounter(false)->Increment(n); }
   if (n == write_size_) {
     (this->*set_cur_write_done)();
     return true;
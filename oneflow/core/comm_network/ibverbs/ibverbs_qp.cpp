@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/platform/include/ibv.h"
 #include "oneflow/core/comm_network/ibverbs/ibverbs_comm_network.h"
+#include "oneflow/core/profiler/metrics.h"
 
 #if defined(WITH_RDMA) && defined(OF_PLATFORM_POSIX)
 
@@ -147,6 +148,7 @@ void IBVerbsQP::PostAllRecvRequest() {
 void IBVerbsQP::PostReadRequest(const IBVerbsCommNetRMADesc& remote_mem,
                                 const IBVerbsMemDesc& local_mem, void* read_id) {
   CHECK_EQ(remote_mem.mem_size, local_mem.mem_size());
+  CommNetBytesCounter(true)->Increment(local_mem.mem_size());
   WorkRequestId* wr_id = NewWorkRequestId();
   const size_t block_num = RoundUp(remote_mem.mem_size, read_block_size_) / read_block_size_;
   wr_id->outstanding_sge_cnt = static_cast<int32_t>(block_num);
@@ -179,6 +181,7 @@ void IBVerbsQP::PostSendRequest(const ActorMsg& msg) {
   ibv_sge sge{};
   sge.addr = reinterpret_cast<uint64_t>(msg_mr->mem_desc().mem_ptr());
   sge.length = msg_mr->mem_desc().mem_size();
+  CommNetBytesCounter(false)->Increment(sge.length);
   sge.lkey = msg_mr->mem_desc().mr()->lkey;
   wr.wr_id = reinterpret_cast<uint64_t>(wr_id);
   wr.next = nullptr;
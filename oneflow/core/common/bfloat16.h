@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_BFLOAT16_H_
+#define ONEFLOW_CORE_COMMON_BFLOAT16_H_
+
+#include <cstdint>
+#include <type_traits>
+#include <cstring>
+#include <cmath>
+
+namespace oneflow {
+
+// Host-side brain floating point: the upper 16 bits of an IEEE-754 float. All arithmetic is done
+// by widening to float, so accumulations written against `float` get float precision for free.
+struct alignas(2) bfloat16 {
+  uint16_t x;
+
+  bfloat16() = default;
+  explicit bfloat16(float value) : x(RoundToNearestEven(value)) {}
+  explicit bfloat16(double value) : bfloat16(static_cast<float>(value)) {}
+  template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+  explicit bfloat16(T value) : bfloat16(static_cast<float>(value)) {}
+
+  inline operator float() const {
+    uint32_t bits = static_cast<uint32_t>(x) << 16;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  static bfloat16 FromBits(uint16_t bits) {
+    bfloat16 ret;
+    ret.x = bits;
+    return ret;
+  }
+
+  inline bfloat16& operator+=(const bfloat16& rhs) { return *this = bfloat16(float(*this) + rhs); }
+  inline bfloat16& operator-=(const bfloat16& rhs) { return *this = bfloat16(float(*this) - rhs); }
+  inline bfloat16& operator*=(const bfloat16& rhs) { return *this = bfloat16(float(*this) * rhs); }
+  inline bfloat16& operator/=(const bfloat16& rhs) { return *this = bfloat16(float(*this) / rhs); }
+
+ private:
+  static uint16_t RoundToNearestEven(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (std::isnan(value)) { return static_cast<uint16_t>((bits >> 16) | 0x0040U); }
+    const uint32_t lsb = (bits >> 16) & 1U;
+    bits += 0x7FFFU + lsb;
+    return static_cast<uint16_t>(bits >> 16);
+  }
+};
+
+static_assert(sizeof(bfloat16) == 2, "sizeof(bfloat16) != 2");
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_BFLOAT16_H_
@@ -17,13 +17,23 @@ limitations under the License.
 #include "oneflow/user/kernels/stateful_local_opkernel.h"
 #include "oneflow/core/eager/dev_vm_dep_object_consume_mode.h"
 #include "oneflow/core/framework/stream_is_comm_net_stream.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
 
 namespace oneflow {
 namespace vm {
 
 Maybe<void> LocalCallOpKernelPhyInstrOperand::Init() {
+  auto* local_tensor_infer_result = local_tensor_infer_result_.get();
+  if (local_tensor_infer_result != nullptr && local_tensor_infer_result->op_kernel() != nullptr) {
+    user_opkernel_ = local_tensor_infer_result->op_kernel();
+    need_temp_storage_ = local_tensor_infer_result->need_temp_storage();
+    return Maybe<void>::Ok();
+  }
   JUST(mut_opkernel()->ChooseOpKernel(&user_opkernel_, &need_temp_storage_, attrs(), inputs().get(),
                                       outputs().get(), consistent_tensor_infer_result().get()));
+  if (local_tensor_infer_result != nullptr) {
+    local_tensor_infer_result->set_op_kernel(user_opkernel_, need_temp_storage_);
+  }
   return Maybe<void>::Ok();
 }
 
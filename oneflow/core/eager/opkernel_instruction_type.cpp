@@ -34,6 +34,7 @@ limitations under the License.
 #include "oneflow/core/vm/symbol_storage.h"
 #include "oneflow/core/operator/op_conf_symbol.h"
 #include "oneflow/user/kernels/stateful_local_opkernel.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/core/profiler/collection.h"
 #include "oneflow/core/common/cpp_attribute.h"
@@ -78,19 +79,30 @@ struct LocalCallOpKernelUtil final {
 
  private:
   static inline void InferTempStorageBlobDesc(LocalCallOpKernelPhyInstrOperand* operand) {
-    const auto& InferTmpSizeFn = operand->opkernel().GetInferTmpSizeFn(operand->user_opkernel());
     auto* temp_eager_blob_object = operand->mut_opkernel()->mut_temp_blob_object();
     CHECK(temp_eager_blob_object->data_type() == DataType::kChar);
-    one::LocalUserOpInferContext* op_infer_ctx =
-        operand->opkernel().op_infer_ctx_for_scheduler_thread();
-    op_infer_ctx->Update(operand->inputs().get(), operand->outputs().get(),
-                         operand->consistent_tensor_infer_result().get());
-    size_t temp_size = InferTmpSizeFn(op_infer_ctx);
-    temp_eager_blob_object->mut_shape() = Shape({static_cast<int64_t>(temp_size)});
+    auto* local_tensor_infer_result = operand->local_tensor_infer_result().get();
+    int64_t temp_size = -1;
+    if (local_tensor_infer_result != nullptr) {
+      temp_size = local_tensor_infer_result->tmp_buffer_size();
+    }
+    if (temp_size < 0) {
+      const auto& InferTmpSizeFn =
+          operand->opkernel().GetInferTmpSizeFn(operand->user_opkernel());
+      one::LocalUserOpInferContext* op_infer_ctx =
+          operand->opkernel().op_infer_ctx_for_scheduler_thread();
+      op_infer_ctx->Update(operand->inputs().get(), operand->outputs().get(),
+                           operand->consistent_tensor_infer_result().get());
+      temp_size = InferTmpSizeFn(op_infer_ctx);
+      op_infer_ctx->Update(nullptr, nullptr, nullptr);
+      if (local_tensor_infer_result != nullptr) {
+        local_tensor_infer_result->set_tmp_buffer_size(temp_size);
+      }
+    }
+    temp_eager_blob_object->mut_shape() = Shape({temp_size});
     temp_eager_blob_object->mut_stride() = Stride(temp_eager_blob_object->mut_shape());
     temp_eager_blob_object->set_pin_memory(false);
     temp_eager_blob_object->set_is_dynamic(true);
-    op_infer_ctx->Update(nullptr, nullptr, nullptr);
   }
 
   static inline void TryInitOpKernelStateAndCache(LocalCallOpKernelPhyInstrOperand* operand,
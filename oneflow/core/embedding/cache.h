@@ -28,6 +28,7 @@ struct CacheOptions {
   enum class Policy {
     kLRU,
     kFull,
+    kTinyLFU,
   };
   enum class MemoryKind {
     kDevice,
@@ -39,6 +40,17 @@ struct CacheOptions {
   uint32_t key_size{};
   uint32_t value_size{};
   float load_factor = 0.75;
+  // Only used by kTinyLFU: a key missing from the cache is admitted by Put only when it has been
+  // looked up at least admission_threshold times recently.
+  uint32_t admission_threshold = 2;
+};
+
+struct CacheStatistics {
+  uint64_t num_queried_keys = 0;
+  uint64_t num_missing_keys = 0;
+  uint64_t num_put_keys = 0;
+  uint64_t num_rejected_keys = 0;
+  uint64_t num_evicted_keys = 0;
 };
 
 class Cache {
@@ -63,6 +75,8 @@ class Cache {
   virtual void Dump(ep::Stream* stream, uint64_t start_key_index, uint64_t end_key_index,
                     uint32_t* n_dumped, void* keys, void* values) = 0;
   virtual void Clear() = 0;
+  // Returns false if the cache does not collect statistics. May synchronize the device.
+  virtual bool GetStatistics(CacheStatistics* statistics) { return false; }
 };
 
 std::unique_ptr<Cache> NewCache(const CacheOptions& options);
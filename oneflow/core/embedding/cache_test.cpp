@@ -236,6 +236,289 @@ TEST(Cache, LruCache) {
   TestCache(cache.get(), line_size);
 }
 
+TEST(Cache, TinyLfuCache) {
+  if (!HasCudaDevice()) { return; }
+
+  CacheOptions options{};
+  options.policy = CacheOptions::Policy::kTinyLFU;
+  const uint32_t line_size = 128;
+  options.value_size = 512;
+  options.capacity = 65536;
+  options.key_size = 8;
+  options.value_memory_kind = CacheOptions::MemoryKind::kDevice;
+
+  std::unique_ptr<Cache> cache(NewCache(options));
+  cache->ReserveQueryLength(65536);
+  TestCache(cache.get(), line_size);
+}
+// Runs the Cache queries on batches of host keys and copies the results back, the value of key k
+// is the floats k * line_size + j.
+class CacheQueryRunner final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CacheQueryRunner);
+  CacheQueryRunner(Cache* cache, uint32_t max_n_keys)
+      : cache_(cache),
+        line_size_(cache->ValueSize() / sizeof(float)),
+        device_manager_registry_(new ep::DeviceManagerRegistry()) {
+    device_ = device_manager_registry_->GetDevice(DeviceType::kCUDA, 0);
+    stream_ = device_->CreateStream();
+    cache_->ReserveQueryLength(max_n_keys);
+    OF_CUDA_CHECK(cudaMalloc(&d_keys_, max_n_keys * sizeof(int64_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_values_, max_n_keys * cache->ValueSize()));
+    OF_CUDA_CHECK(cudaMalloc(&d_n_out_, sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_out_keys_, max_n_keys * sizeof(int64_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_out_indices_, max_n_keys * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_out_values_, max_n_keys * cache->ValueSize()));
+  }
+  ~CacheQueryRunner() {
+    OF_CUDA_CHECK(cudaFree(d_keys_));
+    OF_CUDA_CHECK(cudaFree(d_values_));
+    OF_CUDA_CHECK(cudaFree(d_n_out_));
+    OF_CUDA_CHECK(cudaFree(d_out_keys_));
+    OF_CUDA_CHECK(cudaFree(d_out_indices_));
+    OF_CUDA_CHECK(cudaFree(d_out_values_));
+    device_->DestroyStream(stream_);
+  }
+
+  // Returns the missing keys, without recording the lookups.
+  std::unordered_set<int64_t> Test(const std::vector<int64_t>& keys) {
+    CopyKeys(keys);
+    cache_->Test(stream_, keys.size(), d_keys_, d_n_out_, d_out_keys_, d_out_indices_);
+    return CopyOutKeys();
+  }
+
+  // Returns the missing keys.
+  std::unordered_set<int64_t> Get(const std::vector<int64_t>& keys) {
+    CopyKeys(keys);
+    cache_->Get(stream_, keys.size(), d_keys_, d_values_, d_n_out_, d_out_keys_, d_out_indices_);
+    return CopyOutKeys();
+  }
+
+  // Returns the evicted keys, their values must be the ones put before.
+  std::unordered_set<int64_t> Put(const std::vector<int64_t>& keys) {
+    CopyKeys(keys);
+    std::vector<float> values(keys.size() * line_size_);
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<float>(keys[i / line_size_] * line_size_ + i % line_size_);
+    }
+    OF_CUDA_CHECK(
+        cudaMemcpy(d_values_, values.data(), values.size() * sizeof(float), cudaMemcpyDefault));
+    cache_->Put(stream_, keys.size(), d_keys_, d_values_, d_n_out_, d_out_keys_, d_out_values_);
+    std::vector<int64_t> evicted_keys;
+    CopyOutKeys(&evicted_keys);
+    std::vector<float> evicted_values(evicted_keys.size() * line_size_);
+    OF_CUDA_CHECK(cudaMemcpy(evicted_values.data(), d_out_values_,
+                             evicted_values.size() * sizeof(float), cudaMemcpyDefault));
+    for (size_t i = 0; i < evicted_values.size(); ++i) {
+      EXPECT_EQ(evicted_values[i], static_cast<float>(evicted_keys[i / line_size_] * line_size_
+                                                      + i % line_size_));
+    }
+    return std::unordered_set<int64_t>(evicted_keys.begin(), evicted_keys.end());
+  }
+
+ private:
+  void CopyKeys(const std::vector<int64_t>& keys) {
+    OF_CUDA_CHECK(
+        cudaMemcpy(d_keys_, keys.data(), keys.size() * sizeof(int64_t), cudaMemcpyDefault));
+  }
+
+  std::unordered_set<int64_t> CopyOutKeys() {
+    std::vector<int64_t> keys;
+    CopyOutKeys(&keys);
+    return std::unordered_set<int64_t>(keys.begin(), keys.end());
+  }
+
+  void CopyOutKeys(std::vector<int64_t>* keys) {
+    CHECK_JUST(stream_->Sync());
+    uint32_t n_out = 0;
+    OF_CUDA_CHECK(cudaMemcpy(&n_out, d_n_out_, sizeof(uint32_t), cudaMemcpyDefault));
+    keys->resize(n_out);
+    OF_CUDA_CHECK(
+        cudaMemcpy(keys->data(), d_out_keys_, n_out * sizeof(int64_t), cudaMemcpyDefault));
+  }
+
+  Cache* cache_;
+  uint32_t line_size_;
+  std::unique_ptr<ep::DeviceManagerRegistry> device_manager_registry_;
+  std::shared_ptr<ep::Device> device_;
+  ep::Stream* stream_;
+  int64_t* d_keys_{};
+  void* d_values_{};
+  uint32_t* d_n_out_{};
+  int64_t* d_out_keys_{};
+  uint32_t* d_out_indices_{};
+  void* d_out_values_{};
+};
+
+TEST(Cache, TinyLfuAdmission) {
+  if (!HasCudaDevice()) { return; }
+
+  CacheOptions options{};
+  options.policy = CacheOptions::Policy::kTinyLFU;
+  options.value_size = 16;
+  options.capacity = 65536;
+  options.key_size = 8;
+  options.value_memory_kind = CacheOptions::MemoryKind::kDevice;
+  options.admission_threshold = 2;
+  std::unique_ptr<Cache> cache(NewCache(options));
+  const uint32_t n_keys = 256;
+  CacheQueryRunner runner(cache.get(), n_keys);
+  std::vector<int64_t> hot_keys(n_keys);
+  std::iota(hot_keys.begin(), hot_keys.end(), 1);
+  std::vector<int64_t> cold_keys(n_keys);
+  std::iota(cold_keys.begin(), cold_keys.end(), 1000001);
+  const std::unordered_set<int64_t> cold_keys_set(cold_keys.begin(), cold_keys.end());
+
+  // Looked up twice, the hot keys reach the threshold and are admitted.
+  ASSERT_EQ(runner.Get(hot_keys).size(), n_keys);
+  ASSERT_EQ(runner.Get(hot_keys).size(), n_keys);
+  ASSERT_TRUE(runner.Put(hot_keys).empty());
+  ASSERT_TRUE(runner.Test(hot_keys).empty());
+
+  // Looked up once, the cold keys are rejected and handed back to be written to the store, the
+  // hot keys stay cached.
+  ASSERT_EQ(runner.Get(cold_keys), cold_keys_set);
+  ASSERT_EQ(runner.Put(cold_keys), cold_keys_set);
+  ASSERT_EQ(runner.Test(cold_keys), cold_keys_set);
+  ASSERT_TRUE(runner.Get(hot_keys).empty());
+
+  // The second lookup brings the cold keys to the threshold.
+  ASSERT_EQ(runner.Get(cold_keys), cold_keys_set);
+  ASSERT_TRUE(runner.Put(cold_keys).empty());
+  ASSERT_TRUE(runner.Test(cold_keys).empty());
+  ASSERT_TRUE(runner.Test(hot_keys).empty());
+
+  CacheStatistics statistics;
+  ASSERT_TRUE(cache->GetStatistics(&statistics));
+  ASSERT_EQ(statistics.num_queried_keys, 5 * n_keys);
+  ASSERT_EQ(statistics.num_missing_keys, 4 * n_keys);
+  ASSERT_EQ(statistics.num_put_keys, 3 * n_keys);
+  ASSERT_EQ(statistics.num_rejected_keys, n_keys);
+  ASSERT_EQ(statistics.num_evicted_keys, 0U);
+}
+
+struct TraceResult {
+  uint64_t num_queried_keys = 0;
+  uint64_t num_missing_keys = 0;
+  uint64_t num_store_writes = 0;
+};
+
+// Replays the lookups of a training job against a cache the way CachedKeyValueStore does: each
+// batch of unique keys is looked up by Get and then written back by Put, missing and evicted keys
+// go to the underlying store.
+TraceResult ReplayTrace(Cache* cache, const std::vector<std::vector<int64_t>>& batches,
+                        uint32_t value_size) {
+  std::unique_ptr<ep::DeviceManagerRegistry> device_manager_registry(
+      new ep::DeviceManagerRegistry());
+  auto device = device_manager_registry->GetDevice(DeviceType::kCUDA, 0);
+  ep::Stream* stream = device->CreateStream();
+  uint32_t max_batch_size = 0;
+  for (const auto& batch : batches) {
+    max_batch_size = std::max(max_batch_size, static_cast<uint32_t>(batch.size()));
+  }
+  cache->ReserveQueryLength(max_batch_size);
+  int64_t* d_keys;
+  void* d_values;
+  uint32_t* d_n_missing;
+  int64_t* d_missing_keys;
+  uint32_t* d_missing_indices;
+  uint32_t* d_n_evicted;
+  int64_t* d_evicted_keys;
+  void* d_evicted_values;
+  OF_CUDA_CHECK(cudaMalloc(&d_keys, max_batch_size * sizeof(int64_t)));
+  OF_CUDA_CHECK(cudaMalloc(&d_values, max_batch_size * value_size));
+  OF_CUDA_CHECK(cudaMalloc(&d_n_missing, sizeof(uint32_t)));
+  OF_CUDA_CHECK(cudaMalloc(&d_missing_keys, max_batch_size * sizeof(int64_t)));
+  OF_CUDA_CHECK(cudaMalloc(&d_missing_indices, max_batch_size * sizeof(uint32_t)));
+  OF_CUDA_CHECK(cudaMalloc(&d_n_evicted, sizeof(uint32_t)));
+  OF_CUDA_CHECK(cudaMalloc(&d_evicted_keys, max_batch_size * sizeof(int64_t)));
+  OF_CUDA_CHECK(cudaMalloc(&d_evicted_values, max_batch_size * value_size));
+  OF_CUDA_CHECK(cudaMemset(d_values, 0, max_batch_size * value_size));
+  TraceResult result;
+  for (const auto& batch : batches) {
+    const uint32_t n_keys = batch.size();
+    uint32_t n_missing = 0;
+    uint32_t n_evicted = 0;
+    OF_CUDA_CHECK(cudaMemcpy(d_keys, batch.data(), n_keys * sizeof(int64_t), cudaMemcpyDefault));
+    cache->Get(stream, n_keys, d_keys, d_values, d_n_missing, d_missing_keys, d_missing_indices);
+    cache->Put(stream, n_keys, d_keys, d_values, d_n_evicted, d_evicted_keys, d_evicted_values);
+    CHECK_JUST(stream->Sync());
+    OF_CUDA_CHECK(cudaMemcpy(&n_missing, d_n_missing, sizeof(uint32_t), cudaMemcpyDefault));
+    OF_CUDA_CHECK(cudaMemcpy(&n_evicted, d_n_evicted, sizeof(uint32_t), cudaMemcpyDefault));
+    result.num_queried_keys += n_keys;
+    result.num_missing_keys += n_missing;
+    result.num_store_writes += n_evicted;
+  }
+  OF_CUDA_CHECK(cudaFree(d_keys));
+  OF_CUDA_CHECK(cudaFree(d_values));
+  OF_CUDA_CHECK(cudaFree(d_n_missing));
+  OF_CUDA_CHECK(cudaFree(d_missing_keys));
+  OF_CUDA_CHECK(cudaFree(d_missing_indices));
+  OF_CUDA_CHECK(cudaFree(d_n_evicted));
+  OF_CUDA_CHECK(cudaFree(d_evicted_keys));
+  OF_CUDA_CHECK(cudaFree(d_evicted_values));
+  device->DestroyStream(stream);
+  return result;
+}
+
+// Batches of unique keys drawn from a Zipf distribution, hot keys are spread over the key space.
+std::vector<std::vector<int64_t>> GenerateZipfTrace(int64_t num_ids, double exponent,
+                                                    size_t num_batches, size_t batch_size) {
+  std::vector<double> cdf(num_ids);
+  double sum = 0;
+  for (int64_t i = 0; i < num_ids; ++i) {
+    sum += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+    cdf[i] = sum;
+  }
+  std::vector<int64_t> ids(num_ids);
+  std::iota(ids.begin(), ids.end(), 1);
+  std::mt19937 g(0);
+  std::shuffle(ids.begin(), ids.end(), g);
+  std::uniform_real_distribution<double> dist(0, sum);
+  std::vector<std::vector<int64_t>> batches(num_batches);
+  for (auto& batch : batches) {
+    std::unordered_set<int64_t> unique_ids;
+    for (size_t i = 0; i < batch_size; ++i) {
+      const int64_t rank = std::lower_bound(cdf.begin(), cdf.end(), dist(g)) - cdf.begin();
+      unique_ids.insert(ids[std::min(rank, num_ids - 1)]);
+    }
+    batch.assign(unique_ids.begin(), unique_ids.end());
+  }
+  return batches;
+}
+
+// Prints the hit rate and the store writes of LRU and TinyLFU on a Zipf trace, only run when
+// ONEFLOW_TEST_CACHE_POLICY_BENCHMARK is set.
+TEST(Cache, PolicyTraceBenchmark) {
+  if (!HasCudaDevice()) { return; }
+  if (std::getenv("ONEFLOW_TEST_CACHE_POLICY_BENCHMARK") == nullptr) {
+    GTEST_SKIP() << "benchmark only";
+  }
+
+  const auto batches = GenerateZipfTrace(1 << 22, 0.9, 256, 65536);
+  for (auto policy : {CacheOptions::Policy::kLRU, CacheOptions::Policy::kTinyLFU}) {
+    CacheOptions options{};
+    options.policy = policy;
+    options.value_size = 64;
+    options.capacity = 1 << 18;
+    options.key_size = 8;
+    options.value_memory_kind = CacheOptions::MemoryKind::kDevice;
+    std::unique_ptr<Cache> cache(NewCache(options));
+    const TraceResult result = ReplayTrace(cache.get(), batches, options.value_size);
+    CacheStatistics statistics;
+    if (cache->GetStatistics(&statistics)) {
+      ASSERT_EQ(statistics.num_queried_keys, result.num_queried_keys);
+      ASSERT_EQ(statistics.num_missing_keys, result.num_missing_keys);
+      ASSERT_EQ(statistics.num_put_keys, result.num_queried_keys);
+      ASSERT_EQ(statistics.num_rejected_keys + statistics.num_evicted_keys,
+                result.num_store_writes);
+    }
+    LOG(INFO) << "policy " << static_cast<int>(policy) << " hit rate "
+              << 1.0 - static_cast<double>(result.num_missing_keys) / result.num_queried_keys
+              << " store writes " << result.num_store_writes;
+  }
+}
+
 #endif  // WITH_CUDA
 
 }  // namespace
@@ -94,8 +94,10 @@ class CacheKeyValueStoreImpl : public KeyValueStore {
   bool SnapshotExists(const std::string& name) override;
   void LoadSnapshot(const std::string& name) override;
   void SaveSnapshot(const std::string& name) override;
+  void SaveIncrementalSnapshot(const std::string& name) override;
   void LoadSnapshot(const std::string& name,
                     const std::function<void(KVIterator* iter)>& Hook) override;
+  bool GetCacheStatistics(CacheStatistics* statistics) override;
 
  private:
   void SyncCacheToStore();
@@ -217,6 +219,21 @@ void CacheKeyValueStoreImpl<Key, Elem>::SaveSnapshot(const std::string& name) {
   store_->SaveSnapshot(name);
 }
 
+template<typename Key, typename Elem>
+void CacheKeyValueStoreImpl<Key, Elem>::SaveIncrementalSnapshot(const std::string& name) {
+  CudaCurrentDeviceGuard guard(device_index_);
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  SyncCacheToStore();
+  store_->SaveIncrementalSnapshot(name);
+}
+
+template<typename Key, typename Elem>
+bool CacheKeyValueStoreImpl<Key, Elem>::GetCacheStatistics(CacheStatistics* statistics) {
+  CudaCurrentDeviceGuard guard(device_index_);
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return cache_->GetStatistics(statistics);
+}
+
 template<typename Key, typename Elem>
 void CacheKeyValueStoreImpl<Key, Elem>::SyncCacheToStore() {
   if (synced_) { return; }
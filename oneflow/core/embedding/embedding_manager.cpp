@@ -69,7 +69,8 @@ void EmbeddingManager::CreateKeyValueStore(const KeyValueStoreOptions& key_value
 }
 
 void EmbeddingManager::SaveSnapshot(const std::string& embedding_name, int64_t local_rank_id,
-                                    int64_t rank_id, const std::string& snapshot_name) {
+                                    int64_t rank_id, const std::string& snapshot_name,
+                                    bool incremental) {
   CudaCurrentDeviceGuard guard(local_rank_id);
   std::pair<std::string, int64_t> map_key = std::make_pair(embedding_name, rank_id);
   std::unique_lock<std::mutex> lock(mutex_);
@@ -77,7 +78,11 @@ void EmbeddingManager::SaveSnapshot(const std::string& embedding_name, int64_t l
   auto it = key_value_store_map_.find(map_key);
   CHECK(it != key_value_store_map_.end())
       << "Can not find embedding: " << embedding_name << "-" << rank_id;
-  it->second->SaveSnapshot(snapshot_name);
+  if (incremental) {
+    it->second->SaveIncrementalSnapshot(snapshot_name);
+  } else {
+    it->second->SaveSnapshot(snapshot_name);
+  }
 }
 
 void EmbeddingManager::LoadSnapshot(const std::string& embedding_name, int64_t local_rank_id,
@@ -33,7 +33,7 @@ class EmbeddingManager final {
   ~EmbeddingManager() = default;
 
   void SaveSnapshot(const std::string& embedding_name, int64_t local_rank_id, int64_t rank_id,
-                    const std::string& snapshot_name);
+                    const std::string& snapshot_name, bool incremental = false);
   void LoadSnapshot(const std::string& embedding_name, int64_t local_rank_id, int64_t rank_id,
                     const std::string& snapshot_name);
 
@@ -65,6 +65,8 @@ static const size_t kLocalUniqueHashSeed = 2;
 static const size_t kGlobalUniqueHashSeed = 3;
 static const size_t kFullCacheHashSeed = 4;
 static const size_t kLruCacheHashSeed = 5;
+static const size_t kPersistentTableIndexHashSeed = 6;
+static const size_t kTinyLfuSketchHashSeed = 7;
 
 }  // namespace
 
@@ -95,6 +97,16 @@ struct LruCacheHash {
   OF_DEVICE_FUNC size_t operator()(uint64_t v) { return xxh64_uint64(v, kLruCacheHashSeed); }
 };
 
+struct PersistentTableIndexHash {
+  OF_DEVICE_FUNC size_t operator()(uint64_t v) {
+    return xxh64_uint64(v, kPersistentTableIndexHashSeed);
+  }
+};
+
+struct TinyLfuSketchHash {
+  OF_DEVICE_FUNC size_t operator()(uint64_t v) { return xxh64_uint64(v, kTinyLfuSketchHashSeed); }
+};
+
 }  // namespace embedding
 }  // namespace oneflow
 #endif  // ONEFLOW_CORE_EMBEDDING_HASH_FUNCTION_H_
@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_EMBEDDING_KEY_VALUE_STORE_H_
 
 #include "oneflow/core/embedding/kv_iterator.h"
+#include "oneflow/core/embedding/cache.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/ep/include/stream.h"
 
@@ -43,6 +44,9 @@ class KeyValueStore {
   virtual void LoadSnapshot(const std::string& name,
                             const std::function<void(KVIterator* iter)>& Hook) = 0;
   virtual void SaveSnapshot(const std::string& name) = 0;
+  virtual void SaveIncrementalSnapshot(const std::string& name) { SaveSnapshot(name); }
+  // Returns false if the store has no cache in front of it or its cache keeps no statistics.
+  virtual bool GetCacheStatistics(CacheStatistics* statistics) { return false; }
 };
 
 }  // namespace embedding
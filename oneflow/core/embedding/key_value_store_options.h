@@ -34,9 +34,19 @@ void ParseCacheOptions(const nlohmann::json& cache_obj, CacheOptions* cache_opti
     cache_options->policy = CacheOptions::Policy::kLRU;
   } else if (policy == "full") {
     cache_options->policy = CacheOptions::Policy::kFull;
+  } else if (policy == "tiny_lfu") {
+    cache_options->policy = CacheOptions::Policy::kTinyLFU;
   } else {
     UNIMPLEMENTED() << "Unsupported cache policy";
   }
+  if (cache_obj.contains("admission_threshold")) {
+    CHECK(cache_options->policy == CacheOptions::Policy::kTinyLFU)
+        << "admission_threshold is only supported by the tiny_lfu policy";
+    CHECK(cache_obj["admission_threshold"].is_number());
+    const int64_t admission_threshold = cache_obj["admission_threshold"].get<int64_t>();
+    CHECK_GT(admission_threshold, 0);
+    cache_options->admission_threshold = admission_threshold;
+  }
   int64_t capacity = 0;
   if (cache_obj.contains("capacity")) {
     CHECK(cache_obj["capacity"].is_number());
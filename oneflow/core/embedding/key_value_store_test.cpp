@@ -245,6 +245,39 @@ TEST(CachedKeyValueStore, Full) {
   Global<ep::DeviceManagerRegistry>::Delete();
 }
 
+TEST(CachedKeyValueStore, TinyLFU) {
+  if (!HasCudaDevice()) { return; }
+  Global<ep::DeviceManagerRegistry>::New();
+  PersistentTableKeyValueStoreOptions store_options{};
+  std::string path = CreateTempDirectory();
+  store_options.table_options.path = path;
+  uint32_t value_length = 128;
+  store_options.table_options.value_size = value_length * sizeof(float);
+  store_options.table_options.key_size = GetSizeOfDataType(DataType::kUInt64);
+  store_options.table_options.physical_block_size = 512;
+  std::unique_ptr<KeyValueStore> store = NewPersistentTableKeyValueStore(store_options);
+  CacheStatistics statistics;
+  ASSERT_FALSE(store->GetCacheStatistics(&statistics));
+  CacheOptions cache_options{};
+  cache_options.policy = CacheOptions::Policy::kTinyLFU;
+  cache_options.value_memory_kind = CacheOptions::MemoryKind::kDevice;
+  cache_options.value_size = 512;
+  cache_options.capacity = 512;
+  cache_options.key_size = 8;
+  std::unique_ptr<Cache> cache = NewCache(cache_options);
+  std::unique_ptr<KeyValueStore> cached_store =
+      NewCachedKeyValueStore(std::move(store), std::move(cache));
+  cached_store->ReserveQueryLength(128);
+  TestKeyValueStore(cached_store.get(), 1024, 1024, value_length);
+  ASSERT_TRUE(cached_store->GetCacheStatistics(&statistics));
+  ASSERT_GT(statistics.num_queried_keys, 0U);
+  ASSERT_GT(statistics.num_put_keys, 0U);
+  ASSERT_LE(statistics.num_rejected_keys, statistics.num_put_keys);
+  cached_store.reset();
+  PosixFile::RecursiveDelete(path);
+  Global<ep::DeviceManagerRegistry>::Delete();
+}
+
 TEST(MockKeyValueStore, Mock) {
   if (!HasCudaDevice()) { return; }
   Global<ep::DeviceManagerRegistry>::New();
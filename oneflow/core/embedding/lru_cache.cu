@@ -355,10 +355,12 @@ __global__ void GetKernel(LruCacheContext<Key, Elem> cache_ctx, uint32_t num_key
 }
 
 template<typename Key, typename Elem>
-__global__ void PutWithoutEvictingKernel(LruCacheContext<Key, Elem> cache_ctx, uint32_t num_keys,
-                                         const Key* keys, const Elem* values, uint32_t* n_missing,
+__global__ void PutWithoutEvictingKernel(LruCacheContext<Key, Elem> cache_ctx, uint32_t max_n_keys,
+                                         const uint32_t* n_keys, const Key* keys,
+                                         const Elem* values, uint32_t* n_missing,
                                          Key* missing_keys, uint32_t* missing_indices) {
   ThreadContext thread_ctx{};
+  const uint32_t num_keys = n_keys == nullptr ? max_n_keys : min(*n_keys, max_n_keys);
   __shared__ Key block_keys[kNumWarpPerBlock][kWarpSize];
   __shared__ size_t block_set_ids[kNumWarpPerBlock][kWarpSize];
   for (uint32_t batch_offset = thread_ctx.global_warp_id * kWarpSize; batch_offset < num_keys;
@@ -489,10 +491,10 @@ __global__ void DumpKernel(LruCacheContext<Key, Elem> cache_ctx, size_t start_ke
 }
 
 template<typename Key, typename Elem>
-class LruCache : public Cache {
+class LruCacheImpl : public LruCache {
  public:
-  OF_DISALLOW_COPY_AND_MOVE(LruCache);
-  explicit LruCache(const CacheOptions& options)
+  OF_DISALLOW_COPY_AND_MOVE(LruCacheImpl);
+  explicit LruCacheImpl(const CacheOptions& options)
       : device_index_{},
         max_query_length_(0),
         query_indices_buffer_(nullptr),
@@ -500,7 +502,7 @@ class LruCache : public Cache {
     OF_CUDA_CHECK(cudaGetDevice(&device_index_));
     InitLruCacheContext(options, &ctx_);
   }
-  ~LruCache() override {
+  ~LruCacheImpl() override {
     CudaCurrentDeviceGuard guard(device_index_);
     if (max_query_length_ != 0) {
       OF_CUDA_CHECK(cudaFree(query_indices_buffer_));
@@ -552,15 +554,22 @@ class LruCache : public Cache {
 
   void Put(ep::Stream* stream, uint32_t n_keys, const void* keys, const void* values,
            uint32_t* n_evicted, void* evicted_keys, void* evicted_values) override {
-    CHECK_LE(n_keys, max_query_length_);
+    PutWithDeviceCount(stream, n_keys, nullptr, keys, values, n_evicted, evicted_keys,
+                       evicted_values);
+  }
+
+  void PutWithDeviceCount(ep::Stream* stream, uint32_t max_n_keys, const uint32_t* n_keys,
+                          const void* keys, const void* values, uint32_t* n_evicted,
+                          void* evicted_keys, void* evicted_values) override {
+    CHECK_LE(max_n_keys, max_query_length_);
     auto cuda_stream = stream->As<ep::CudaStream>();
     OF_CUDA_CHECK(cudaMemsetAsync(n_evicted, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
-    if (n_keys == 0) { return; }
-    cuda_stream->LaunchKernel(PutWithoutEvictingKernel<Key, Elem>, GetLaunchConfig(n_keys), ctx_,
-                              n_keys, static_cast<const Key*>(keys),
+    if (max_n_keys == 0) { return; }
+    cuda_stream->LaunchKernel(PutWithoutEvictingKernel<Key, Elem>, GetLaunchConfig(max_n_keys),
+                              ctx_, max_n_keys, n_keys, static_cast<const Key*>(keys),
                               static_cast<const Elem*>(values), n_evicted, query_keys_buffer_,
                               query_indices_buffer_);
-    cuda_stream->LaunchKernel(EvictKernel<Key, Elem>, GetLaunchConfig(n_keys), ctx_,
+    cuda_stream->LaunchKernel(EvictKernel<Key, Elem>, GetLaunchConfig(max_n_keys), ctx_,
                               query_keys_buffer_, query_indices_buffer_,
                               static_cast<const Elem*>(values), n_evicted,
                               static_cast<Key*>(evicted_keys), static_cast<Elem*>(evicted_values));
@@ -590,21 +599,21 @@ class LruCache : public Cache {
 };
 
 template<typename Key>
-std::unique_ptr<Cache> DispatchValueType(const CacheOptions& options) {
+std::unique_ptr<LruCache> DispatchValueType(const CacheOptions& options) {
   if (options.value_size % sizeof(ulonglong2) == 0) {
-    return std::unique_ptr<Cache>(new LruCache<Key, ulonglong2>(options));
+    return std::unique_ptr<LruCache>(new LruCacheImpl<Key, ulonglong2>(options));
   } else if (options.value_size % sizeof(uint64_t) == 0) {
-    return std::unique_ptr<Cache>(new LruCache<Key, uint64_t>(options));
+    return std::unique_ptr<LruCache>(new LruCacheImpl<Key, uint64_t>(options));
   } else if (options.value_size % sizeof(uint32_t) == 0) {
-    return std::unique_ptr<Cache>(new LruCache<Key, uint32_t>(options));
+    return std::unique_ptr<LruCache>(new LruCacheImpl<Key, uint32_t>(options));
   } else if (options.value_size % sizeof(uint16_t) == 0) {
-    return std::unique_ptr<Cache>(new LruCache<Key, uint16_t>(options));
+    return std::unique_ptr<LruCache>(new LruCacheImpl<Key, uint16_t>(options));
   } else {
-    return std::unique_ptr<Cache>(new LruCache<Key, uint8_t>(options));
+    return std::unique_ptr<LruCache>(new LruCacheImpl<Key, uint8_t>(options));
   }
 }
 
-std::unique_ptr<Cache> DispatchKeyType(const CacheOptions& options) {
+std::unique_ptr<LruCache> DispatchKeyType(const CacheOptions& options) {
   if (options.key_size == sizeof(uint32_t)) {
     return DispatchValueType<uint32_t>(options);
   } else if (options.key_size == sizeof(uint64_t)) {
@@ -617,7 +626,9 @@ std::unique_ptr<Cache> DispatchKeyType(const CacheOptions& options) {
 
 }  // namespace
 
-std::unique_ptr<Cache> NewLruCache(const CacheOptions& options) { return DispatchKeyType(options); }
+std::unique_ptr<LruCache> NewLruCache(const CacheOptions& options) {
+  return DispatchKeyType(options);
+}
 
 }  // namespace embedding
 
@@ -22,7 +22,21 @@ namespace oneflow {
 
 namespace embedding {
 
-std::unique_ptr<Cache> NewLruCache(const CacheOptions& options);
+class LruCache : public Cache {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LruCache);
+  LruCache() = default;
+  ~LruCache() override = default;
+
+  // Like Put, but only puts the first *n_keys of the keys, at most max_n_keys. The number is read
+  // on the device, so that a caller which counts the keys to put in a kernel, e.g. the admission
+  // of kTinyLFU, does not need to synchronize.
+  virtual void PutWithDeviceCount(ep::Stream* stream, uint32_t max_n_keys, const uint32_t* n_keys,
+                                  const void* keys, const void* values, uint32_t* n_evicted,
+                                  void* evicted_keys, void* evicted_values) = 0;
+};
+
+std::unique_ptr<LruCache> NewLruCache(const CacheOptions& options);
 
 }  // namespace embedding
 
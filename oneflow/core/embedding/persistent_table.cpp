@@ -23,6 +23,9 @@ limitations under the License.
 #include "oneflow/core/embedding/posix_file.h"
 #include "oneflow/core/common/blocking_counter.h"
 #include <robin_hood.h>
+#include <map>
+#include <shared_mutex>
+#include <condition_variable>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <dirent.h>
@@ -60,6 +63,10 @@ constexpr char const* kKeysDirName = "keys";
 constexpr char const* kValuesDirName = "values";
 constexpr char const* kSnapshotsDirName = "snapshots";
 constexpr char const* kSnapshotListFileName = "LIST";
+constexpr char const* kSnapshotBaseFileName = "BASE";
+constexpr char const* kWritingSnapshotSuffix = ".writing";
+constexpr char const* kReplacedSnapshotSuffix = ".replaced";
+constexpr uint32_t kDefaultMaxSnapshotChainLength = 8;
 constexpr size_t kParallelForStride = 256;
 
 template<typename T>
@@ -120,6 +127,46 @@ void ListChunkFiles(const std::string& base, const std::string& prefix,
   PCHECK(closedir(dir) == 0);
 }
 
+bool StripSuffix(const std::string& str, const std::string& suffix, std::string* stripped) {
+  if (str.size() <= suffix.size()
+      || str.compare(str.size() - suffix.size(), suffix.size(), suffix) != 0) {
+    return false;
+  }
+  *stripped = str.substr(0, str.size() - suffix.size());
+  return true;
+}
+
+// A snapshot is written into `<name>.writing` and swapped in by renaming `<name>` to
+// `<name>.replaced` and `<name>.writing` to `<name>`. Completes the swaps interrupted by a crash,
+// or rolls them back if the new snapshot is incomplete, and removes the leftovers.
+void RecoverSnapshots(const std::string& snapshots_dir) {
+  if (!PosixFile::FileExists(snapshots_dir)) { return; }
+  std::vector<std::string> entries;
+  DIR* dir = opendir(snapshots_dir.c_str());
+  PCHECK(dir != nullptr);
+  struct dirent* ent = nullptr;
+  while ((ent = readdir(dir)) != nullptr) { entries.emplace_back(ent->d_name); }
+  PCHECK(closedir(dir) == 0);
+  std::string name;
+  for (const std::string& entry : entries) {
+    if (!StripSuffix(entry, kReplacedSnapshotSuffix, &name)) { continue; }
+    const std::string snapshot_dir = PosixFile::JoinPath(snapshots_dir, name);
+    if (PosixFile::FileExists(snapshot_dir)) { continue; }
+    const std::string writing_dir = snapshot_dir + kWritingSnapshotSuffix;
+    const std::string& restored_dir =
+        PosixFile::FileExists(PosixFile::JoinPath(writing_dir, kSnapshotListFileName))
+            ? writing_dir
+            : PosixFile::JoinPath(snapshots_dir, entry);
+    PCHECK(rename(restored_dir.c_str(), snapshot_dir.c_str()) == 0);
+  }
+  for (const std::string& entry : entries) {
+    if (StripSuffix(entry, kReplacedSnapshotSuffix, &name)
+        || StripSuffix(entry, kWritingSnapshotSuffix, &name)) {
+      PosixFile::RecursiveDelete(PosixFile::JoinPath(snapshots_dir, entry));
+    }
+  }
+}
+
 uint32_t GetLogicalBlockSize(uint32_t physical_block_size, uint32_t value_size) {
   return physical_block_size >= value_size ? physical_block_size
                                            : RoundUp(value_size, physical_block_size);
@@ -146,6 +193,127 @@ class AlignedBuffer final {
   std::unique_ptr<char> ptr_;
 };
 
+constexpr uint32_t kDefaultNumIndexShards = 64;
+constexpr uint64_t kInvalidRowId = std::numeric_limits<uint64_t>::max();
+
+// Maps keys to row ids. Keys are spread over a power-of-two number of shards by hash and every
+// shard has its own reader-writer lock, so lookups never block each other and inserts only block
+// the operations touching the same shard. Batched operations group the keys by shard first and
+// take the lock of every shard at most once.
+template<typename Key>
+class ShardedRowIdMapping final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShardedRowIdMapping);
+  explicit ShardedRowIdMapping(uint32_t num_shards) {
+    uint32_t num_shards_pow2 = 1;
+    while (num_shards_pow2 < num_shards) { num_shards_pow2 *= 2; }
+    shards_.reset(new Shard[num_shards_pow2]);
+    num_shards_ = num_shards_pow2;
+  }
+  ~ShardedRowIdMapping() = default;
+
+  void Reserve(uint64_t capacity) {
+    for (uint32_t i = 0; i < num_shards_; ++i) {
+      std::unique_lock<std::shared_timed_mutex> lock(shards_[i].mutex);
+      shards_[i].map.reserve(capacity / num_shards_ + 1);
+    }
+  }
+
+  // row_ids[i] is the row id of keys[i], or kInvalidRowId if keys[i] is not mapped.
+  void Find(uint32_t num_keys, const Key* keys, uint64_t* row_ids) const {
+    ForEachShardOfKeys(num_keys, keys, [&](uint32_t shard_id, const uint32_t* indices,
+                                           uint32_t num_indices) {
+      const Shard& shard = shards_[shard_id];
+      std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+      for (uint32_t i = 0; i < num_indices; ++i) {
+        const uint32_t index = indices[i];
+        auto it = shard.map.find(keys[index]);
+        row_ids[index] = it == shard.map.end() ? kInvalidRowId : it->second;
+      }
+    });
+  }
+
+  // Maps keys[i] to first_row_id + i.
+  void Assign(uint32_t num_keys, const Key* keys, uint64_t first_row_id) {
+    ForEachShardOfKeys(num_keys, keys, [&](uint32_t shard_id, const uint32_t* indices,
+                                           uint32_t num_indices) {
+      Shard& shard = shards_[shard_id];
+      std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+      for (uint32_t i = 0; i < num_indices; ++i) {
+        shard.map[keys[indices[i]]] = first_row_id + indices[i];
+      }
+    });
+  }
+
+  // Replaces the whole mapping with the entries emitted by Fill(Emplace) while every shard is
+  // exclusively locked, concurrent lookups see either the old or the new mapping. Emplace
+  // overwrites the row id of a key emitted before and returns false in that case.
+  template<typename FillFn>
+  void Rebuild(const FillFn& Fill) {
+    std::vector<std::unique_lock<std::shared_timed_mutex>> locks;
+    locks.reserve(num_shards_);
+    for (uint32_t i = 0; i < num_shards_; ++i) {
+      locks.emplace_back(shards_[i].mutex);
+      shards_[i].map.clear();
+    }
+    Fill([&](Key key, uint64_t row_id) -> bool {
+      auto it = shards_[ShardId(key)].map.emplace(key, row_id);
+      if (!it.second) { it.first->second = row_id; }
+      return it.second;
+    });
+  }
+
+  // Visits every entry, one shard at a time under its shared lock.
+  template<typename VisitFn>
+  void ForEach(const VisitFn& Visit) const {
+    for (uint32_t i = 0; i < num_shards_; ++i) {
+      std::shared_lock<std::shared_timed_mutex> lock(shards_[i].mutex);
+      for (const auto& pair : shards_[i].map) { Visit(pair.first, pair.second); }
+    }
+  }
+
+  bool Empty() const {
+    for (uint32_t i = 0; i < num_shards_; ++i) {
+      std::shared_lock<std::shared_timed_mutex> lock(shards_[i].mutex);
+      if (!shards_[i].map.empty()) { return false; }
+    }
+    return true;
+  }
+
+ private:
+  struct Shard {
+    mutable std::shared_timed_mutex mutex;
+    robin_hood::unordered_flat_map<Key, uint64_t> map;
+  };
+
+  uint32_t ShardId(Key key) const {
+    return PersistentTableIndexHash()(static_cast<uint64_t>(key)) & (num_shards_ - 1);
+  }
+
+  // Calls DoEach(shard_id, indices, num_indices) for every shard holding some of the keys, with
+  // the indices of those keys in ascending order.
+  template<typename DoEachFn>
+  void ForEachShardOfKeys(uint32_t num_keys, const Key* keys, const DoEachFn& DoEach) const {
+    std::vector<uint32_t> shard_ids(num_keys);
+    std::vector<uint32_t> shard_offsets(num_shards_ + 1, 0);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+      shard_ids[i] = ShardId(keys[i]);
+      shard_offsets[shard_ids[i] + 1] += 1;
+    }
+    for (uint32_t i = 0; i < num_shards_; ++i) { shard_offsets[i + 1] += shard_offsets[i]; }
+    std::vector<uint32_t> indices(num_keys);
+    std::vector<uint32_t> cursors(shard_offsets.begin(), shard_offsets.end() - 1);
+    for (uint32_t i = 0; i < num_keys; ++i) { indices[cursors[shard_ids[i]]++] = i; }
+    for (uint32_t i = 0; i < num_shards_; ++i) {
+      const uint32_t num_indices = shard_offsets[i + 1] - shard_offsets[i];
+      if (num_indices != 0) { DoEach(i, indices.data() + shard_offsets[i], num_indices); }
+    }
+  }
+
+  std::unique_ptr<Shard[]> shards_;
+  uint32_t num_shards_;
+};
+
 template<typename Key>
 class ChunkIteratorImpl : public PersistentTable::Iterator {
  public:
@@ -358,6 +526,8 @@ class PersistentTableImpl : public PersistentTable {
   void LoadSnapshot(const std::string& name,
                     const std::function<void(Iterator* iter)>& Hook) override;
   void SaveSnapshot(const std::string& name) override;
+  void SaveIncrementalSnapshot(const std::string& name) override;
+  void ConsolidateSnapshot(const std::string& name) override;
   Iterator* ReadSnapshot(const std::string& name) override;
 
  private:
@@ -367,8 +537,28 @@ class PersistentTableImpl : public PersistentTable {
   std::string IndexFilePath(const std::string& name, uint64_t chunk_id) const;
   std::string SnapshotDirPath(const std::string& name) const;
   std::string SnapshotListFilePath(const std::string& name) const;
+  std::string SnapshotBaseFilePath(const std::string& name) const;
   void LoadSnapshotImpl(const std::string& name);
   void SaveSnapshotImpl(const std::string& name);
+  // Returns the snapshots `name` depends on followed by `name`, starting from a full snapshot.
+  std::vector<std::string> GetSnapshotChain(const std::string& name) const;
+  // Calls DoEach(chunk_id, n_entries, chunk_keys, indices) for every index file of the snapshot.
+  void ForEachSnapshotChunk(
+      const std::string& name,
+      const std::function<void(uint64_t, size_t, const Key*, const uint64_t*)>& DoEach) const;
+  // Writes the index files of a snapshot holding the rows visited by ForEachRow(Visit). The
+  // snapshot is written aside and swapped in when complete, an existing snapshot of the same name
+  // is replaced, and a crash leaves either the old or the new snapshot, see RecoverSnapshots.
+  void WriteSnapshot(const std::string& name, const std::string& base,
+                     const std::function<void(const std::function<void(uint64_t)>&)>& ForEachRow);
+  void WriteIncrementalSnapshot(const std::string& name, const std::string& base, uint64_t begin,
+                                uint64_t end,
+                                const std::vector<std::pair<uint64_t, uint64_t>>& padding_ranges);
+  void ConsolidateSnapshotImpl(const std::string& name);
+  // Must be called with write_mutex_ held.
+  void SaveFullSnapshot(const std::string& name);
+  void ScheduleSnapshotTask(std::function<void()> task);
+  void WaitPendingSnapshots();
   void ParallelFor(size_t total, const ForRange<Engine>& for_range);
 
   std::string root_dir_;
@@ -385,16 +575,28 @@ class PersistentTableImpl : public PersistentTable {
 
   std::vector<std::unique_ptr<Worker<Engine>>> workers_;
 
-  std::vector<uint32_t> offsets_buffer_;
-  AlignedBuffer blocks_buffer_;
-
-  std::recursive_mutex mutex_;
+  // serializes the operations that append to the table or replace its index
+  std::mutex write_mutex_;
   uint64_t physical_table_size_;
-  robin_hood::unordered_flat_map<Key, uint64_t> row_id_mapping_;
+  ShardedRowIdMapping<Key> row_id_mapping_;
+  // exclusively locked only while a value file is being appended to value_files_
+  std::shared_timed_mutex value_files_mutex_;
   std::vector<PosixFile> value_files_;
   PosixFile writable_key_file_;
   uint64_t writable_key_file_chunk_id_;
   PosixFileLockGuard lock_;
+
+  // The next incremental snapshot holds the rows put after snapshot_chain_.back() was saved or
+  // loaded, i.e. the rows in [snapshot_chain_end_, physical_table_size_) minus the padding rows.
+  // Guarded by write_mutex_.
+  std::vector<std::string> snapshot_chain_;
+  uint64_t snapshot_chain_end_;
+  std::vector<std::pair<uint64_t, uint64_t>> padding_ranges_;
+  uint32_t max_snapshot_chain_length_;
+  std::mutex pending_snapshots_mutex_;
+  std::condition_variable pending_snapshots_cond_;
+  uint32_t num_pending_snapshots_;
+  std::unique_ptr<Worker<Engine>> snapshot_worker_;
 };
 
 template<typename Key, typename Engine>
@@ -404,11 +606,14 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
       value_size_(options.value_size),
       physical_block_size_(options.physical_block_size),
       logical_block_size_(GetLogicalBlockSize(options.physical_block_size, value_size_)),
-      blocks_buffer_(options.physical_block_size),
-      writable_key_file_chunk_id_(-1) {
+      row_id_mapping_(ParseIntegerFromEnv("ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_NUM_INDEX_SHARDS",
+                                          kDefaultNumIndexShards)),
+      writable_key_file_chunk_id_(-1),
+      snapshot_chain_end_(0),
+      num_pending_snapshots_(0) {
   const uint64_t capacity_hint = ParseIntegerFromEnv(
       "ONEFLOW_ONE_EMBEDDING_PERSISTENT_TABLE_CAPACITY_HINT", options.capacity_hint);
-  if (capacity_hint > 0) { row_id_mapping_.reserve(capacity_hint); }
+  if (capacity_hint > 0) { row_id_mapping_.Reserve(capacity_hint); }
   PosixFile::RecursiveCreateDirectory(options.path, 0755);
   const std::string lock_filename = PosixFile::JoinPath(options.path, kLockFileName);
   const bool init = !PosixFile::FileExists(lock_filename);
@@ -427,6 +632,7 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
   keys_dir_ = PosixFile::JoinPath(options.path, kKeysDirName);
   values_dir_ = PosixFile::JoinPath(options.path, kValuesDirName);
   snapshots_dir_ = PosixFile::JoinPath(options.path, kSnapshotsDirName);
+  RecoverSnapshots(snapshots_dir_);
   if (init) {
     PosixFile::RecursiveCreateDirectory(keys_dir_, 0755);
     PosixFile::RecursiveCreateDirectory(values_dir_, 0755);
@@ -437,6 +643,11 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
   for (uint32_t tid = 0; tid < workers_.size(); ++tid) {
     workers_.at(tid).reset(new Worker<Engine>);
   }
+  max_snapshot_chain_length_ =
+      std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_ONE_EMBEDDING_MAX_SNAPSHOT_CHAIN_LENGTH",
+                                            kDefaultMaxSnapshotChainLength),
+                        1);
+  snapshot_worker_.reset(new Worker<Engine>);
   std::unordered_map<uint64_t, std::string> chunks;
   ListChunkFiles(values_dir_, kValueFileNamePrefix, &chunks);
   for (auto& chunk : chunks) {
@@ -456,6 +667,7 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
 
 template<typename Key, typename Engine>
 PersistentTableImpl<Key, Engine>::~PersistentTableImpl() {
+  WaitPendingSnapshots();
   for (uint32_t tid = 0; tid < workers_.size(); ++tid) { workers_.at(tid)->Shutdown(); }
 }
 
@@ -467,15 +679,15 @@ uint32_t PersistentTableImpl<Key, Engine>::LogicalBlockSize() const {
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::GetBlocks(uint32_t num_keys, const void* keys, void* blocks,
                                                  uint32_t* offsets) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::vector<uint64_t> row_ids(num_keys);
+  row_id_mapping_.Find(num_keys, static_cast<const Key*>(keys), row_ids.data());
+  std::shared_lock<std::shared_timed_mutex> lock(value_files_mutex_);
   ParallelFor(num_keys, [&](Engine* engine, size_t start, size_t end) {
     for (uint64_t i = start; i < end; ++i) {
-      const Key key = static_cast<const Key*>(keys)[i];
-      auto it = row_id_mapping_.find(key);
-      if (it == row_id_mapping_.end()) {
+      if (row_ids[i] == kInvalidRowId) {
         offsets[i] = logical_block_size_;
       } else {
-        const uint64_t id = it->second;
+        const uint64_t id = row_ids[i];
         const uint64_t block_id = id / num_values_per_block_;
         const uint32_t id_in_block = id - block_id * num_values_per_block_;
         const uint32_t offset_in_block = id_in_block * value_size_;
@@ -494,26 +706,26 @@ void PersistentTableImpl<Key, Engine>::GetBlocks(uint32_t num_keys, const void*
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::Get(uint32_t num_keys, const void* keys, void* values,
                                            uint32_t* n_missing, uint32_t* missing_indices) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  offsets_buffer_.resize(num_keys);
+  std::vector<uint32_t> offsets(num_keys);
+  AlignedBuffer blocks_buffer(physical_block_size_);
   void* blocks_ptr = nullptr;
   if (value_size_ == logical_block_size_
       && reinterpret_cast<uintptr_t>(values) % physical_block_size_ == 0) {
     blocks_ptr = values;
   } else {
-    blocks_buffer_.Resize(num_keys * logical_block_size_);
-    blocks_ptr = blocks_buffer_.ptr();
+    blocks_buffer.Resize(num_keys * logical_block_size_);
+    blocks_ptr = blocks_buffer.ptr();
   }
-  GetBlocks(num_keys, keys, blocks_ptr, offsets_buffer_.data());
+  GetBlocks(num_keys, keys, blocks_ptr, offsets.data());
   uint32_t missing_count = 0;
   for (uint32_t i = 0; i < num_keys; ++i) {
-    if (offsets_buffer_.at(i) == logical_block_size_) {
+    if (offsets.at(i) == logical_block_size_) {
       missing_indices[missing_count] = i;
       missing_count += 1;
     } else {
       if (value_size_ != logical_block_size_) {
         MemcpyOffset(values, i * value_size_, blocks_ptr,
-                     (i * logical_block_size_) + offsets_buffer_[i], value_size_);
+                     (i * logical_block_size_) + offsets[i], value_size_);
       }
     }
   }
@@ -523,13 +735,27 @@ void PersistentTableImpl<Key, Engine>::Get(uint32_t num_keys, const void* keys,
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void* keys,
                                                  const void* blocks) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::lock_guard<std::mutex> lock(write_mutex_);
   const uint32_t num_blocks = RoundUp(num_keys, num_values_per_block_) / num_values_per_block_;
   const uint32_t num_padded_keys = num_blocks * num_values_per_block_;
   const uint64_t start_index = physical_table_size_;
   physical_table_size_ += num_padded_keys;
   CHECK_EQ(start_index % num_values_per_block_, 0);
+  if (!snapshot_chain_.empty() && num_padded_keys > num_keys) {
+    padding_ranges_.emplace_back(start_index + num_keys, start_index + num_padded_keys);
+  }
   const uint64_t start_block_id = start_index / num_values_per_block_;
+  if (num_blocks > 0) {
+    // Created here rather than on the worker, a worker must never wait for value_files_mutex_
+    // since readers hold it shared while they wait for the workers.
+    const uint64_t last_chunk_id =
+        (start_block_id + num_blocks - 1) / num_logical_blocks_per_chunk_;
+    std::unique_lock<std::shared_timed_mutex> value_files_lock(value_files_mutex_);
+    while (value_files_.size() <= last_chunk_id) {
+      value_files_.emplace_back(ValueFilePath(value_files_.size()), O_CREAT | O_RDWR | O_DIRECT,
+                                0644);
+    }
+  }
   uint64_t written_blocks = 0;
   const uint64_t block_keys_size = num_values_per_block_ * sizeof(Key);
   BlockingCounter bc(1);
@@ -537,11 +763,7 @@ void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void*
     while (written_blocks < num_blocks) {
       const uint64_t batch_start_block_id = start_block_id + written_blocks;
       const uint64_t batch_chunk_id = batch_start_block_id / num_logical_blocks_per_chunk_;
-      if (batch_chunk_id == value_files_.size()) {
-        value_files_.emplace_back(ValueFilePath(batch_chunk_id), O_CREAT | O_RDWR | O_DIRECT, 0644);
-      } else {
-        CHECK_LE(batch_chunk_id, value_files_.size());
-      }
+      CHECK_LT(batch_chunk_id, value_files_.size());
       if ((!writable_key_file_.IsOpen()) || writable_key_file_chunk_id_ != batch_chunk_id) {
         writable_key_file_ = PosixFile(KeyFilePath(batch_chunk_id), O_CREAT | O_RDWR, 0644);
       }
@@ -570,32 +792,31 @@ void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void*
     }
     bc.Decrease();
   });
-  for (uint64_t i = 0; i < num_keys; ++i) {
-    row_id_mapping_[static_cast<const Key*>(keys)[i]] = start_index + i;
-  }
   bc.WaitForeverUntilCntEqualZero();
+  // published only after the values are written, concurrent readers never see a partial row
+  row_id_mapping_.Assign(num_keys, static_cast<const Key*>(keys), start_index);
 }
 
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::Put(uint32_t num_keys, const void* keys,
                                            const void* values) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  AlignedBuffer blocks_buffer(physical_block_size_);
   const void* blocks_ptr = nullptr;
   if (value_size_ == logical_block_size_
       && reinterpret_cast<uintptr_t>(values) % physical_block_size_ == 0) {
     blocks_ptr = values;
   } else {
     const uint32_t num_blocks = RoundUp(num_keys, num_values_per_block_);
-    blocks_buffer_.Resize(num_blocks * logical_block_size_);
+    blocks_buffer.Resize(num_blocks * logical_block_size_);
     for (uint32_t i = 0; i < num_keys; i += num_values_per_block_) {
       const uint32_t block_id = i / num_values_per_block_;
       const uint32_t copy_size = (num_keys - i) < num_values_per_block_
                                      ? (num_keys - i) * value_size_
                                      : logical_block_size_;
-      MemcpyOffset(blocks_buffer_.ptr(), block_id * logical_block_size_, values, i * value_size_,
+      MemcpyOffset(blocks_buffer.ptr(), block_id * logical_block_size_, values, i * value_size_,
                    copy_size);
     }
-    blocks_ptr = blocks_buffer_.ptr();
+    blocks_ptr = blocks_buffer.ptr();
   }
   PutBlocks(num_keys, keys, blocks_ptr);
 }
@@ -626,48 +847,55 @@ std::string PersistentTableImpl<Key, Engine>::SnapshotListFilePath(const std::st
   return PosixFile::JoinPath(SnapshotDirPath(name), kSnapshotListFileName);
 }
 
+template<typename Key, typename Engine>
+std::string PersistentTableImpl<Key, Engine>::SnapshotBaseFilePath(const std::string& name) const {
+  return PosixFile::JoinPath(SnapshotDirPath(name), kSnapshotBaseFileName);
+}
+
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::LoadSnapshotImpl(const std::string& name) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  const std::string snapshot_base = SnapshotDirPath(name);
-  const std::string snapshot_list = SnapshotListFilePath(name);
-  row_id_mapping_.clear();
-  std::ifstream list_if(snapshot_list);
-  std::string index_filename;
-  while (std::getline(list_if, index_filename)) {
-    const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
-    PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
-    const size_t index_file_size = index_file.Size();
-    CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-    if (index_file_size == 0) { return; }
-    const size_t n_entries = index_file_size / sizeof(uint64_t);
-    PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ);
-    PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
-    PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ);
-    const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
-    const Key* keys = static_cast<const Key*>(mapped_key.ptr());
-    const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
-    row_id_mapping_.reserve(row_id_mapping_.size() + n_entries);
-    for (size_t i = 0; i < n_entries; ++i) {
-      CHECK(row_id_mapping_.emplace(keys[indices[i] - chunk_start_index], indices[i]).second);
-    }
-  }
+  LoadSnapshot(name, nullptr);
 }
 
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::SaveSnapshotImpl(const std::string& name) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  PosixFile::RecursiveCreateDirectory(SnapshotDirPath(name), 0755);
-  std::ofstream list_ofs(SnapshotListFilePath(name));
-  if (row_id_mapping_.empty()) { return; }
-  std::vector<PosixMappedFile> index_files(value_files_.size());
-  std::vector<uint64_t> counters(value_files_.size());
+  WaitPendingSnapshots();
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  SaveFullSnapshot(name);
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::SaveFullSnapshot(const std::string& name) {
+  WriteSnapshot(name, "", [&](const std::function<void(uint64_t)>& Visit) {
+    row_id_mapping_.ForEach([&](Key key, uint64_t row_id) { Visit(row_id); });
+  });
+  snapshot_chain_.assign(1, name);
+  snapshot_chain_end_ = physical_table_size_;
+  padding_ranges_.clear();
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::WriteSnapshot(
+    const std::string& name, const std::string& base,
+    const std::function<void(const std::function<void(uint64_t)>&)>& ForEachRow) {
+  const std::string writing_name = name + kWritingSnapshotSuffix;
+  PosixFile::RecursiveDelete(SnapshotDirPath(writing_name));
+  PosixFile::RecursiveCreateDirectory(SnapshotDirPath(writing_name), 0755);
+  if (!base.empty()) {
+    std::ofstream base_ofs(SnapshotBaseFilePath(writing_name));
+    base_ofs << base << std::endl;
+  }
+  std::vector<PosixMappedFile> index_files;
+  std::vector<uint64_t> counters;
   const uint64_t max_index_file_size = num_values_per_chunk_ * sizeof(uint64_t);
-  for (const auto& pair : row_id_mapping_) {
-    const uint64_t chunk_id = pair.second / num_values_per_chunk_;
-    CHECK(chunk_id < value_files_.size());
+  ForEachRow([&](uint64_t row_id) {
+    const uint64_t chunk_id = row_id / num_values_per_chunk_;
+    if (chunk_id >= index_files.size()) {
+      index_files.resize(chunk_id + 1);
+      counters.resize(chunk_id + 1);
+    }
     if (index_files[chunk_id].ptr() == nullptr) {
-      PosixFile snapshot_file(IndexFilePath(name, chunk_id), O_CREAT | O_RDWR, 0644);
+      PosixFile snapshot_file(IndexFilePath(writing_name, chunk_id), O_CREAT | O_RDWR, 0644);
       snapshot_file.Truncate(max_index_file_size);
       index_files[chunk_id] =
           PosixMappedFile(std::move(snapshot_file), max_index_file_size, PROT_READ | PROT_WRITE);
@@ -675,77 +903,244 @@ void PersistentTableImpl<Key, Engine>::SaveSnapshotImpl(const std::string& name)
     uint64_t* indices = static_cast<uint64_t*>(index_files[chunk_id].ptr());
     uint64_t& count = counters[chunk_id];
     CHECK_LT(count, num_values_per_chunk_);
-    indices[count] = pair.second;
+    indices[count] = row_id;
     count += 1;
-  }
-  for (size_t i = 0; i < value_files_.size(); ++i) {
-    const uint64_t count = counters[i];
-    if (count > 0) {
-      index_files[i].file().Truncate(count * sizeof(uint64_t));
-      list_ofs << kIndexFileNamePrefix + GetChunkName(i) << std::endl;
-    } else {
-      CHECK(index_files[i].ptr() == nullptr);
+  });
+  {
+    std::ofstream list_ofs(SnapshotListFilePath(writing_name));
+    for (size_t i = 0; i < index_files.size(); ++i) {
+      const uint64_t count = counters[i];
+      if (count > 0) {
+        index_files[i].file().Truncate(count * sizeof(uint64_t));
+        list_ofs << kIndexFileNamePrefix + GetChunkName(i) << std::endl;
+      } else {
+        CHECK(index_files[i].ptr() == nullptr);
+      }
     }
   }
+  index_files.clear();
+  const std::string replaced_name = name + kReplacedSnapshotSuffix;
+  PosixFile::RecursiveDelete(SnapshotDirPath(replaced_name));
+  if (PosixFile::FileExists(SnapshotDirPath(name))) {
+    PCHECK(rename(SnapshotDirPath(name).c_str(), SnapshotDirPath(replaced_name).c_str()) == 0);
+  }
+  PCHECK(rename(SnapshotDirPath(writing_name).c_str(), SnapshotDirPath(name).c_str()) == 0);
+  PosixFile::RecursiveDelete(SnapshotDirPath(replaced_name));
 }
 
 template<typename Key, typename Engine>
-bool PersistentTableImpl<Key, Engine>::SnapshotExists(const std::string& name) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  return PosixFile::FileExists(SnapshotListFilePath(name));
+void PersistentTableImpl<Key, Engine>::WriteIncrementalSnapshot(
+    const std::string& name, const std::string& base, uint64_t begin, uint64_t end,
+    const std::vector<std::pair<uint64_t, uint64_t>>& padding_ranges) {
+  // The rows are visited from the newest one, only the last row put for every key is kept.
+  robin_hood::unordered_flat_set<Key> visited_keys;
+  std::vector<uint64_t> row_ids;
+  size_t num_remaining_padding_ranges = padding_ranges.size();
+  uint64_t row_end = end;
+  while (row_end > begin) {
+    const uint64_t chunk_id = (row_end - 1) / num_values_per_chunk_;
+    const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
+    const uint64_t row_begin = std::max(begin, chunk_start_index);
+    // rows below physical_table_size_ are never rewritten, they are safe to read without a lock
+    PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
+    PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ);
+    const Key* keys = static_cast<const Key*>(mapped_key.ptr());
+    for (uint64_t row_id = row_end - 1; row_id + 1 > row_begin; --row_id) {
+      while (num_remaining_padding_ranges > 0
+             && padding_ranges[num_remaining_padding_ranges - 1].first > row_id) {
+        num_remaining_padding_ranges -= 1;
+      }
+      if (num_remaining_padding_ranges > 0
+          && row_id < padding_ranges[num_remaining_padding_ranges - 1].second) {
+        continue;
+      }
+      if (visited_keys.insert(keys[row_id - chunk_start_index]).second) {
+        row_ids.push_back(row_id);
+      }
+    }
+    row_end = row_begin;
+  }
+  WriteSnapshot(name, base, [&](const std::function<void(uint64_t)>& Visit) {
+    for (auto it = row_ids.rbegin(); it != row_ids.rend(); ++it) { Visit(*it); }
+  });
 }
 
 template<typename Key, typename Engine>
-void PersistentTableImpl<Key, Engine>::LoadSnapshot(const std::string& name) {
-  LoadSnapshotImpl(name);
+std::vector<std::string> PersistentTableImpl<Key, Engine>::GetSnapshotChain(
+    const std::string& name) const {
+  std::vector<std::string> chain(1, name);
+  while (PosixFile::FileExists(SnapshotBaseFilePath(chain.back()))) {
+    std::ifstream base_ifs(SnapshotBaseFilePath(chain.back()));
+    std::string base;
+    std::getline(base_ifs, base);
+    CHECK(!base.empty()) << "Invalid base of snapshot " << chain.back();
+    CHECK(std::find(chain.begin(), chain.end(), base) == chain.end())
+        << "Snapshot " << base << " is its own base";
+    CHECK(PosixFile::FileExists(SnapshotListFilePath(base)))
+        << "Snapshot " << base << ", the base of snapshot " << chain.back() << ", does not exist";
+    chain.push_back(base);
+  }
+  std::reverse(chain.begin(), chain.end());
+  return chain;
 }
 
 template<typename Key, typename Engine>
-void PersistentTableImpl<Key, Engine>::LoadSnapshot(
-    const std::string& name, const std::function<void(Iterator* iter)>& Hook) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
+void PersistentTableImpl<Key, Engine>::ForEachSnapshotChunk(
+    const std::string& name,
+    const std::function<void(uint64_t, size_t, const Key*, const uint64_t*)>& DoEach) const {
   const std::string snapshot_base = SnapshotDirPath(name);
-  const std::string snapshot_list = SnapshotListFilePath(name);
-  row_id_mapping_.clear();
-  std::ifstream list_if(snapshot_list);
+  std::ifstream list_if(SnapshotListFilePath(name));
   std::string index_filename;
   while (std::getline(list_if, index_filename)) {
     const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
     PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
     const size_t index_file_size = index_file.Size();
     CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-    if (index_file_size == 0) { return; }
+    if (index_file_size == 0) { continue; }
     const size_t n_entries = index_file_size / sizeof(uint64_t);
     PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ);
     PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
     PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ);
-    const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
-    const Key* keys = static_cast<const Key*>(mapped_key.ptr());
-    const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
-    row_id_mapping_.reserve(row_id_mapping_.size() + n_entries);
-    for (size_t i = 0; i < n_entries; ++i) {
-      CHECK(row_id_mapping_.emplace(keys[indices[i] - chunk_start_index], indices[i]).second);
-    }
-    if (Hook) {
-      PosixFile value_file(ValueFilePath(chunk_id), O_RDONLY, 0644);
-      PosixMappedFile mapped_value(std::move(value_file), value_file.Size(), PROT_READ);
-      ChunkIteratorImpl<Key> chunk_iterator(value_size_, logical_block_size_, num_values_per_block_,
-                                            num_values_per_chunk_, chunk_id, n_entries, keys,
-                                            indices, mapped_value.ptr());
-      Hook(&chunk_iterator);
-    }
+    DoEach(chunk_id, n_entries, static_cast<const Key*>(mapped_key.ptr()),
+           static_cast<const uint64_t*>(mapped_index.ptr()));
   }
 }
 
+template<typename Key, typename Engine>
+bool PersistentTableImpl<Key, Engine>::SnapshotExists(const std::string& name) {
+  WaitPendingSnapshots();
+  return PosixFile::FileExists(SnapshotListFilePath(name));
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::LoadSnapshot(const std::string& name) {
+  LoadSnapshotImpl(name);
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::LoadSnapshot(
+    const std::string& name, const std::function<void(Iterator* iter)>& Hook) {
+  WaitPendingSnapshots();
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  const std::vector<std::string> chain = GetSnapshotChain(name);
+  row_id_mapping_.Rebuild([&](const std::function<bool(Key, uint64_t)>& Emplace) {
+    // Incremental snapshots are applied on top of their base, the Hook sees the rows of every
+    // snapshot in the chain in the same order.
+    for (size_t i = 0; i < chain.size(); ++i) {
+      const bool is_base = i == 0;
+      ForEachSnapshotChunk(chain[i], [&](uint64_t chunk_id, size_t n_entries, const Key* keys,
+                                         const uint64_t* indices) {
+        const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
+        for (size_t j = 0; j < n_entries; ++j) {
+          const bool inserted = Emplace(keys[indices[j] - chunk_start_index], indices[j]);
+          if (is_base) { CHECK(inserted); }
+        }
+        if (Hook) {
+          PosixFile value_file(ValueFilePath(chunk_id), O_RDONLY, 0644);
+          PosixMappedFile mapped_value(std::move(value_file), value_file.Size(), PROT_READ);
+          ChunkIteratorImpl<Key> chunk_iterator(value_size_, logical_block_size_,
+                                                num_values_per_block_, num_values_per_chunk_,
+                                                chunk_id, n_entries, keys, indices,
+                                                mapped_value.ptr());
+          Hook(&chunk_iterator);
+        }
+      });
+    }
+  });
+  snapshot_chain_ = chain;
+  snapshot_chain_end_ = physical_table_size_;
+  padding_ranges_.clear();
+}
+
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::SaveSnapshot(const std::string& name) {
   SaveSnapshotImpl(name);
 }
 
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::SaveIncrementalSnapshot(const std::string& name) {
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  if (snapshot_chain_.empty()
+      || std::find(snapshot_chain_.begin(), snapshot_chain_.end(), name)
+             != snapshot_chain_.end()) {
+    // nothing to be based on, or the snapshot would replace one of its own bases
+    lock.unlock();
+    SaveSnapshotImpl(name);
+    return;
+  }
+  // Only the end of the table is recorded under the lock, the rows before it are immutable and the
+  // index files are written by snapshot_worker_.
+  const std::string base = snapshot_chain_.back();
+  const uint64_t begin = snapshot_chain_end_;
+  const uint64_t end = physical_table_size_;
+  std::vector<std::pair<uint64_t, uint64_t>> padding_ranges;
+  padding_ranges.swap(padding_ranges_);
+  const bool consolidate = snapshot_chain_.size() >= max_snapshot_chain_length_;
+  if (consolidate) {
+    snapshot_chain_.assign(1, name);
+  } else {
+    snapshot_chain_.push_back(name);
+  }
+  snapshot_chain_end_ = end;
+  lock.unlock();
+  ScheduleSnapshotTask([this, name, base, begin, end, padding_ranges, consolidate]() {
+    WriteIncrementalSnapshot(name, base, begin, end, padding_ranges);
+    if (consolidate) { ConsolidateSnapshotImpl(name); }
+  });
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ConsolidateSnapshot(const std::string& name) {
+  WaitPendingSnapshots();
+  ConsolidateSnapshotImpl(name);
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ConsolidateSnapshotImpl(const std::string& name) {
+  const std::vector<std::string> chain = GetSnapshotChain(name);
+  if (chain.size() == 1) { return; }
+  robin_hood::unordered_flat_map<Key, uint64_t> row_ids;
+  for (const std::string& snapshot : chain) {
+    ForEachSnapshotChunk(snapshot, [&](uint64_t chunk_id, size_t n_entries, const Key* keys,
+                                       const uint64_t* indices) {
+      const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
+      for (size_t i = 0; i < n_entries; ++i) {
+        row_ids[keys[indices[i] - chunk_start_index]] = indices[i];
+      }
+    });
+  }
+  // `name` is replaced as a whole, the snapshots based on it stay valid at every point.
+  WriteSnapshot(name, "", [&](const std::function<void(uint64_t)>& Visit) {
+    for (const auto& pair : row_ids) { Visit(pair.second); }
+  });
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::ScheduleSnapshotTask(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(pending_snapshots_mutex_);
+    num_pending_snapshots_ += 1;
+  }
+  snapshot_worker_->Schedule([this, task](Engine*) {
+    task();
+    std::lock_guard<std::mutex> lock(pending_snapshots_mutex_);
+    num_pending_snapshots_ -= 1;
+    pending_snapshots_cond_.notify_all();
+  });
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::WaitPendingSnapshots() {
+  std::unique_lock<std::mutex> lock(pending_snapshots_mutex_);
+  pending_snapshots_cond_.wait(lock, [&]() { return num_pending_snapshots_ == 0; });
+}
+
 template<typename Key, typename Engine>
 PersistentTable::Iterator* PersistentTableImpl<Key, Engine>::ReadSnapshot(const std::string& name) {
-  return new SnapshotIteratorImpl<Key, Engine>(this, name, value_size_, logical_block_size_,
-                                               num_values_per_block_, num_values_per_chunk_);
+  WaitPendingSnapshots();
+  return new SnapshotIteratorImpl<Key, Engine>(this, GetSnapshotChain(name), value_size_,
+                                               logical_block_size_, num_values_per_block_,
+                                               num_values_per_chunk_);
 }
 
 template<typename Key, typename Engine>
@@ -769,43 +1164,81 @@ void PersistentTableImpl<Key, Engine>::ParallelFor(size_t total,
   bc.WaitForeverUntilCntEqualZero();
 }
 
+// Iterates the rows of a snapshot. The rows of a full snapshot are read from its index files, the
+// rows of an incremental one are merged from its chain in memory, leaving the snapshot files as
+// they are.
 template<typename Key, typename Engine>
 class SnapshotIteratorImpl : public PersistentTable::Iterator {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SnapshotIteratorImpl);
-  SnapshotIteratorImpl(PersistentTableImpl<Key, Engine>* table, const std::string& snapshot_name,
-                       uint32_t value_size, uint32_t logical_block_size,
-                       uint32_t num_values_per_block, uint64_t num_values_per_chunk)
+  SnapshotIteratorImpl(PersistentTableImpl<Key, Engine>* table,
+                       const std::vector<std::string>& snapshot_chain, uint32_t value_size,
+                       uint32_t logical_block_size, uint32_t num_values_per_block,
+                       uint64_t num_values_per_chunk)
       : table_(table),
-        snapshot_name_(snapshot_name),
+        snapshot_name_(snapshot_chain.back()),
         value_size_(value_size),
         logical_block_size_(logical_block_size),
         num_values_per_block_(num_values_per_block),
         num_values_per_chunk_(num_values_per_chunk),
-        current_chunk_(0) {
-    const std::string snapshot_list = table_->SnapshotListFilePath(snapshot_name);
-    std::ifstream list_if(snapshot_list);
-    std::string index_filename;
-    while (std::getline(list_if, index_filename)) { indices_names_.push_back(index_filename); }
+        current_chunk_(0),
+        merged_(snapshot_chain.size() > 1) {
+    if (merged_) {
+      robin_hood::unordered_flat_map<Key, uint64_t> row_ids;
+      for (const std::string& snapshot : snapshot_chain) {
+        table_->ForEachSnapshotChunk(snapshot, [&](uint64_t chunk_id, size_t n_entries,
+                                                   const Key* keys, const uint64_t* indices) {
+          const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
+          for (size_t i = 0; i < n_entries; ++i) {
+            row_ids[keys[indices[i] - chunk_start_index]] = indices[i];
+          }
+        });
+      }
+      std::map<uint64_t, std::vector<uint64_t>> chunk_id2indices;
+      for (const auto& pair : row_ids) {
+        chunk_id2indices[pair.second / num_values_per_chunk_].push_back(pair.second);
+      }
+      for (auto& pair : chunk_id2indices) {
+        std::sort(pair.second.begin(), pair.second.end());
+        merged_chunks_.emplace_back(pair.first, std::move(pair.second));
+      }
+    } else {
+      const std::string snapshot_list = table_->SnapshotListFilePath(snapshot_name_);
+      std::ifstream list_if(snapshot_list);
+      std::string index_filename;
+      while (std::getline(list_if, index_filename)) { indices_names_.push_back(index_filename); }
+    }
   }
   ~SnapshotIteratorImpl() override = default;
 
   void Next(uint32_t num_keys, uint32_t* return_keys, void* keys, void* values) override {
     *return_keys = 0;
-    while (current_chunk_ < indices_names_.size()) {
+    const size_t num_chunks = merged_ ? merged_chunks_.size() : indices_names_.size();
+    while (current_chunk_ < num_chunks) {
       if (!chunk_iterator_) {
-        const std::string snapshot_base = table_->SnapshotDirPath(snapshot_name_);
-        const uint64_t chunk_id = GetChunkId(indices_names_[current_chunk_], kIndexFileNamePrefix);
-        PosixFile index_file(PosixFile::JoinPath(snapshot_base, indices_names_[current_chunk_]),
-                             O_RDONLY, 0644);
-        const size_t index_file_size = index_file.Size();
-        CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-        if (index_file_size == 0) {
-          current_chunk_ += 1;
-          continue;
+        uint64_t chunk_id = 0;
+        size_t n_entries = 0;
+        const uint64_t* indices = nullptr;
+        if (merged_) {
+          chunk_id = merged_chunks_[current_chunk_].first;
+          n_entries = merged_chunks_[current_chunk_].second.size();
+          indices = merged_chunks_[current_chunk_].second.data();
+        } else {
+          const std::string snapshot_base = table_->SnapshotDirPath(snapshot_name_);
+          chunk_id = GetChunkId(indices_names_[current_chunk_], kIndexFileNamePrefix);
+          PosixFile index_file(PosixFile::JoinPath(snapshot_base, indices_names_[current_chunk_]),
+                               O_RDONLY, 0644);
+          const size_t index_file_size = index_file.Size();
+          CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
+          if (index_file_size == 0) {
+            current_chunk_ += 1;
+            continue;
+          }
+          n_entries = index_file_size / sizeof(uint64_t);
+          indices_file_.reset(
+              new PosixMappedFile(std::move(index_file), index_file_size, PROT_READ));
+          indices = static_cast<const uint64_t*>(indices_file_->ptr());
         }
-        const size_t n_entries = index_file_size / sizeof(uint64_t);
-        indices_file_.reset(new PosixMappedFile(std::move(index_file), index_file_size, PROT_READ));
         PosixFile key_file(table_->KeyFilePath(chunk_id), O_RDONLY, 0644);
         keys_file_.reset(new PosixMappedFile(std::move(key_file), key_file.Size(), PROT_READ));
         PosixFile value_file(table_->ValueFilePath(chunk_id), O_RDONLY, 0644);
@@ -813,8 +1246,8 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
             new PosixMappedFile(std::move(value_file), value_file.Size(), PROT_READ));
         chunk_iterator_.reset(new ChunkIteratorImpl<Key>(
             value_size_, logical_block_size_, num_values_per_block_, num_values_per_chunk_,
-            chunk_id, n_entries, static_cast<const Key*>(keys_file_->ptr()),
-            static_cast<const uint64_t*>(indices_file_->ptr()), values_file_->ptr()));
+            chunk_id, n_entries, static_cast<const Key*>(keys_file_->ptr()), indices,
+            values_file_->ptr()));
       }
       chunk_iterator_->Next(num_keys, return_keys, keys, values);
       if (*return_keys == 0) {
@@ -840,7 +1273,9 @@ class SnapshotIteratorImpl : public PersistentTable::Iterator {
   uint32_t num_values_per_block_;
   uint64_t num_values_per_chunk_;
   size_t current_chunk_;
+  bool merged_;
   std::vector<std::string> indices_names_;
+  std::vector<std::pair<uint64_t, std::vector<uint64_t>>> merged_chunks_;
   std::unique_ptr<PosixMappedFile> keys_file_;
   std::unique_ptr<PosixMappedFile> values_file_;
   std::unique_ptr<PosixMappedFile> indices_file_;
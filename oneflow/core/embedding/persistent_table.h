@@ -60,6 +60,16 @@ class PersistentTable {
   virtual void LoadSnapshot(const std::string& name,
                             const std::function<void(Iterator* iter)>& Hook) = 0;
   virtual void SaveSnapshot(const std::string& name) = 0;
+  // Saves only the rows put since the last snapshot saved or loaded by this table, that snapshot
+  // becomes the base of the new one and is loaded first when the new one is loaded. The index
+  // files are written in the background, puts and gets are not blocked meanwhile. Long chains are
+  // consolidated into a full snapshot. The bases of a snapshot must not be overwritten.
+  virtual void SaveIncrementalSnapshot(const std::string& name) = 0;
+  // Rewrites an incremental snapshot as a full snapshot which does not depend on its bases. This
+  // is the maintenance call to shorten a chain, loading or reading a snapshot never rewrites it.
+  virtual void ConsolidateSnapshot(const std::string& name) = 0;
+  // Iterates the rows of a snapshot, including the rows an incremental snapshot inherits from its
+  // bases.
   virtual Iterator* ReadSnapshot(const std::string& name) = 0;
 };
 
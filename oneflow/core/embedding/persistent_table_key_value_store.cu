@@ -135,6 +135,7 @@ class KeyValueStoreImpl : public KeyValueStore {
   void LoadSnapshot(const std::string& name,
                     const std::function<void(KVIterator* iter)>& Hook) override;
   void SaveSnapshot(const std::string& name) override;
+  void SaveIncrementalSnapshot(const std::string& name) override;
 
  private:
   int device_index_;
@@ -224,6 +225,12 @@ void KeyValueStoreImpl<Key>::SaveSnapshot(const std::string& name) {
   table_->SaveSnapshot(name);
 }
 
+template<typename Key>
+void KeyValueStoreImpl<Key>::SaveIncrementalSnapshot(const std::string& name) {
+  CudaCurrentDeviceGuard guard(device_index_);
+  table_->SaveIncrementalSnapshot(name);
+}
+
 }  // namespace
 
 std::unique_ptr<KeyValueStore> NewPersistentTableKeyValueStore(
@@ -0,0 +1,293 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/persistent_table.h"
+#include "oneflow/core/embedding/posix_file.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+#ifdef __linux__
+
+std::string CreateTempDirectory() {
+  const char* tmp_env = getenv("TMPDIR");
+  const char* tmp_dir = tmp_env == nullptr ? "/tmp" : tmp_env;
+  std::string tpl = std::string(tmp_dir) + "/test_pt_XXXXXX";
+  char* path = mkdtemp(const_cast<char*>(tpl.c_str()));
+  PCHECK(path != nullptr);
+  return std::string(path);
+}
+
+constexpr uint32_t kValueLength = 32;
+constexpr uint32_t kBatchSize = 256;
+
+std::unique_ptr<PersistentTable> NewTestTable(const std::string& path) {
+  PersistentTableOptions options{};
+  options.path = path;
+  options.key_size = sizeof(uint64_t);
+  options.value_size = kValueLength * sizeof(float);
+  options.physical_block_size = 512;
+  options.target_chunk_size_mb = 1;
+  return NewPersistentTable(options);
+}
+
+// Values of different versions of a key differ, keys must stay below 2^16.
+float ValueOf(uint64_t key, uint32_t i, uint32_t version = 0) {
+  return static_cast<float>((version << 21) + key * kValueLength + i);
+}
+
+void PutRange(PersistentTable* table, uint64_t begin, uint64_t end, uint32_t version = 0) {
+  std::vector<uint64_t> keys;
+  std::vector<float> values;
+  for (uint64_t key = begin; key < end; ++key) {
+    keys.push_back(key);
+    for (uint32_t i = 0; i < kValueLength; ++i) { values.push_back(ValueOf(key, i, version)); }
+    if (keys.size() == kBatchSize || key + 1 == end) {
+      table->Put(keys.size(), keys.data(), values.data());
+      keys.clear();
+      values.clear();
+    }
+  }
+}
+
+// Looks up keys [begin, end) in batches, returns the number of keys found. Found values must be
+// intact.
+uint64_t GetRange(PersistentTable* table, uint64_t begin, uint64_t end, uint32_t version = 0) {
+  std::vector<uint64_t> keys(kBatchSize);
+  std::vector<float> values(kBatchSize * kValueLength);
+  std::vector<uint32_t> missing_indices(kBatchSize);
+  uint64_t num_found = 0;
+  for (uint64_t batch_begin = begin; batch_begin < end; batch_begin += kBatchSize) {
+    const uint32_t n = std::min<uint64_t>(kBatchSize, end - batch_begin);
+    for (uint32_t j = 0; j < n; ++j) { keys[j] = batch_begin + j; }
+    uint32_t n_missing = 0;
+    table->Get(n, keys.data(), values.data(), &n_missing, missing_indices.data());
+    std::vector<bool> missing(n, false);
+    for (uint32_t j = 0; j < n_missing; ++j) { missing[missing_indices[j]] = true; }
+    for (uint32_t j = 0; j < n; ++j) {
+      if (missing[j]) { continue; }
+      num_found += 1;
+      for (uint32_t i = 0; i < kValueLength; ++i) {
+        EXPECT_EQ(values[j * kValueLength + i], ValueOf(keys[j], i, version));
+      }
+    }
+  }
+  return num_found;
+}
+
+TEST(PersistentTable, ConcurrentPutAndGet) {
+  const std::string path = CreateTempDirectory();
+  std::unique_ptr<PersistentTable> table = NewTestTable(path);
+  constexpr uint32_t kNumThreads = 4;
+  constexpr uint64_t kKeysPerThread = 8192;
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      const uint64_t begin = t * kKeysPerThread;
+      const uint64_t mid = begin + kKeysPerThread / 2;
+      const uint64_t end = begin + kKeysPerThread;
+      PutRange(table.get(), begin, mid);
+      // keys of the other threads may or may not be there yet, but must never be torn
+      GetRange(table.get(), 0, kNumThreads * kKeysPerThread);
+      PutRange(table.get(), mid, end);
+      EXPECT_EQ(GetRange(table.get(), begin, end), kKeysPerThread);
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  EXPECT_EQ(GetRange(table.get(), 0, kNumThreads * kKeysPerThread), kNumThreads * kKeysPerThread);
+  table->SaveSnapshot("concurrent");
+  table.reset();
+  table = NewTestTable(path);
+  table->LoadSnapshot("concurrent");
+  EXPECT_EQ(GetRange(table.get(), 0, kNumThreads * kKeysPerThread), kNumThreads * kKeysPerThread);
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+// Lookup throughput with a growing number of client threads, each thread plays one embedding
+// lookup stream, only run when ONEFLOW_TEST_PERSISTENT_TABLE_BENCHMARK is set.
+TEST(PersistentTable, ConcurrentGetBenchmark) {
+  if (std::getenv("ONEFLOW_TEST_PERSISTENT_TABLE_BENCHMARK") == nullptr) {
+    GTEST_SKIP() << "benchmark only";
+  }
+  const std::string path = CreateTempDirectory();
+  std::unique_ptr<PersistentTable> table = NewTestTable(path);
+  constexpr uint64_t kNumKeys = 65536;
+  PutRange(table.get(), 0, kNumKeys);
+  for (uint32_t num_threads : {1, 2, 4, 8}) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&]() { EXPECT_EQ(GetRange(table.get(), 0, kNumKeys), kNumKeys); });
+    }
+    for (auto& thread : threads) { thread.join(); }
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG(INFO) << "PersistentTable Get, " << num_threads
+              << " threads: " << num_threads * kNumKeys / seconds << " keys/s";
+  }
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+TEST(PersistentTable, IncrementalSnapshot) {
+  const std::string path = CreateTempDirectory();
+  std::unique_ptr<PersistentTable> table = NewTestTable(path);
+  // the ranges are not multiples of the block size, the padding rows must not leak into snapshots
+  PutRange(table.get(), 0, 1001, 0);
+  table->SaveSnapshot("full");
+  PutRange(table.get(), 500, 1503, 1);
+  table->SaveIncrementalSnapshot("delta1");
+  PutRange(table.get(), 1400, 2005, 2);
+  PutRange(table.get(), 1450, 1460, 3);
+  table->SaveIncrementalSnapshot("delta2");
+  PutRange(table.get(), 0, 3000, 4);
+  table.reset();
+
+  table = NewTestTable(path);
+  table->LoadSnapshot("delta1");
+  EXPECT_EQ(GetRange(table.get(), 0, 500, 0), 500);
+  EXPECT_EQ(GetRange(table.get(), 500, 1503, 1), 1003);
+  EXPECT_EQ(GetRange(table.get(), 1503, 3000), 0);
+  table->LoadSnapshot("delta2");
+  EXPECT_EQ(GetRange(table.get(), 0, 500, 0), 500);
+  EXPECT_EQ(GetRange(table.get(), 500, 1400, 1), 900);
+  EXPECT_EQ(GetRange(table.get(), 1400, 1450, 2), 50);
+  EXPECT_EQ(GetRange(table.get(), 1450, 1460, 3), 10);
+  EXPECT_EQ(GetRange(table.get(), 1460, 2005, 2), 545);
+  EXPECT_EQ(GetRange(table.get(), 2005, 3000), 0);
+  // incremental snapshots of a loaded snapshot are based on it
+  PutRange(table.get(), 0, 100, 5);
+  table->SaveIncrementalSnapshot("delta3");
+  table->ConsolidateSnapshot("delta3");
+  table.reset();
+
+  table = NewTestTable(path);
+  EXPECT_TRUE(table->SnapshotExists("delta3"));
+  EXPECT_FALSE(PosixFile::FileExists(path + "/snapshots/delta3/BASE"));
+  table->LoadSnapshot("delta3");
+  EXPECT_EQ(GetRange(table.get(), 0, 100, 5), 100);
+  EXPECT_EQ(GetRange(table.get(), 100, 500, 0), 400);
+  EXPECT_EQ(GetRange(table.get(), 1450, 1460, 3), 10);
+  EXPECT_EQ(GetRange(table.get(), 1460, 2005, 2), 545);
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+TEST(PersistentTable, ReadIncrementalSnapshot) {
+  const std::string path = CreateTempDirectory();
+  std::unique_ptr<PersistentTable> table = NewTestTable(path);
+  PutRange(table.get(), 0, 1001, 0);
+  table->SaveSnapshot("full");
+  PutRange(table.get(), 500, 1503, 1);
+  table->SaveIncrementalSnapshot("delta");
+  // the rows put after the snapshot are not part of it
+  PutRange(table.get(), 0, 3000, 2);
+  std::unique_ptr<PersistentTable::Iterator> iter(table->ReadSnapshot("delta"));
+  std::vector<uint64_t> keys(kBatchSize);
+  std::vector<float> values(kBatchSize * kValueLength);
+  std::vector<bool> visited(1503, false);
+  uint64_t num_read = 0;
+  while (true) {
+    uint32_t n = 0;
+    iter->Next(kBatchSize, &n, keys.data(), values.data());
+    if (n == 0) { break; }
+    for (uint32_t j = 0; j < n; ++j) {
+      ASSERT_LT(keys[j], 1503);
+      EXPECT_FALSE(visited[keys[j]]);
+      visited[keys[j]] = true;
+      const uint32_t version = keys[j] < 500 ? 0 : 1;
+      for (uint32_t i = 0; i < kValueLength; ++i) {
+        EXPECT_EQ(values[j * kValueLength + i], ValueOf(keys[j], i, version));
+      }
+    }
+    num_read += n;
+  }
+  EXPECT_EQ(num_read, 1503);
+  iter.reset();
+  // reading leaves the snapshot as it is
+  EXPECT_TRUE(PosixFile::FileExists(path + "/snapshots/delta/BASE"));
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+TEST(PersistentTable, RecoverInterruptedSnapshotReplace) {
+  for (const bool new_snapshot_complete : {true, false}) {
+    const std::string path = CreateTempDirectory();
+    const std::string snapshots_dir = path + "/snapshots";
+    std::unique_ptr<PersistentTable> table = NewTestTable(path);
+    PutRange(table.get(), 0, 100, 0);
+    table->SaveSnapshot("snap");
+    PutRange(table.get(), 0, 100, 1);
+    table->SaveSnapshot("next");
+    table.reset();
+    // the state left by a crash in the middle of saving `next` over `snap`
+    PCHECK(rename((snapshots_dir + "/next").c_str(), (snapshots_dir + "/snap.writing").c_str())
+           == 0);
+    if (!new_snapshot_complete) {
+      PCHECK(unlink((snapshots_dir + "/snap.writing/LIST").c_str()) == 0);
+    }
+    PCHECK(rename((snapshots_dir + "/snap").c_str(), (snapshots_dir + "/snap.replaced").c_str())
+           == 0);
+    table = NewTestTable(path);
+    EXPECT_FALSE(PosixFile::FileExists(snapshots_dir + "/snap.writing"));
+    EXPECT_FALSE(PosixFile::FileExists(snapshots_dir + "/snap.replaced"));
+    table->LoadSnapshot("snap");
+    EXPECT_EQ(GetRange(table.get(), 0, 100, new_snapshot_complete ? 1 : 0), 100);
+    table.reset();
+    PosixFile::RecursiveDelete(path);
+  }
+}
+
+// Time spent in SaveSnapshot and SaveIncrementalSnapshot after a small number of updates.
+TEST(PersistentTable, IncrementalSnapshotBenchmark) {
+  const std::string path = CreateTempDirectory();
+  std::unique_ptr<PersistentTable> table = NewTestTable(path);
+  constexpr uint64_t kNumKeys = 65536;
+  PutRange(table.get(), 0, kNumKeys);
+  table->SaveSnapshot("base");
+  for (uint32_t step = 1; step <= 4; ++step) {
+    PutRange(table.get(), step * 1024, step * 1024 + 1024, step);
+    // based on the previous full snapshot, so it only holds the 1024 keys put above
+    auto start = std::chrono::steady_clock::now();
+    table->SaveIncrementalSnapshot("delta-" + std::to_string(step));
+    const double incremental_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_TRUE(table->SnapshotExists("delta-" + std::to_string(step)));
+    start = std::chrono::steady_clock::now();
+    table->SaveSnapshot("full-" + std::to_string(step));
+    const double full_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG(INFO) << "PersistentTable snapshot, full: " << full_seconds
+              << " s, incremental: " << incremental_seconds << " s";
+  }
+  table.reset();
+  PosixFile::RecursiveDelete(path);
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -0,0 +1,365 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Inspired by TinyLFU: A Highly Efficient Cache Admission Policy, https://arxiv.org/abs/1512.00727
+
+#include "oneflow/core/embedding/tiny_lfu_cache.h"
+#include "oneflow/core/embedding/lru_cache.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/embedding/hash_functions.cuh"
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+constexpr uint32_t kSketchDepth = 4;
+constexpr uint64_t kMinSketchWidth = 1024;
+// All sketch counters are halved once the number of recorded lookups reaches
+// kSketchResetFactor * capacity, so the sketch follows changes of the access distribution.
+constexpr uint64_t kSketchResetFactor = 10;
+
+enum DeviceCounter {
+  kNumMissingKeys = 0,
+  kNumEvictedKeys,
+  kNumRejectedKeys,
+  kNumDeviceCounters,
+};
+
+struct CountMinSketch {
+  uint32_t* counters;
+  uint64_t width_mask;
+
+  template<typename Key, typename Fn>
+  __device__ void ForEachCounter(Key key, const Fn& fn) const {
+    const uint64_t hash = TinyLfuSketchHash()(static_cast<uint64_t>(key));
+    const uint64_t h1 = hash & 0xFFFFFFFFULL;
+    const uint64_t h2 = hash >> 32;
+    const uint64_t width = width_mask + 1;
+    for (uint32_t row = 0; row < kSketchDepth; ++row) {
+      fn(counters + row * width + ((h1 + row * h2) & width_mask));
+    }
+  }
+
+  template<typename Key>
+  __device__ void Increment(Key key) const {
+    ForEachCounter(key, [](uint32_t* counter) { atomicAdd(counter, 1U); });
+  }
+
+  template<typename Key>
+  __device__ uint32_t Estimate(Key key) const {
+    uint32_t estimate = 0xFFFFFFFFU;
+    ForEachCounter(key, [&](uint32_t* counter) { estimate = min(estimate, *counter); });
+    return estimate;
+  }
+};
+
+template<typename Key>
+__global__ void SketchIncrementKernel(CountMinSketch sketch, uint32_t n_keys, const Key* keys) {
+  CUDA_1D_KERNEL_LOOP_T(uint32_t, i, n_keys) { sketch.Increment(keys[i]); }
+}
+
+__global__ void SketchHalveKernel(uint64_t n_counters, uint32_t* counters) {
+  CUDA_1D_KERNEL_LOOP_T(uint64_t, i, n_counters) { counters[i] >>= 1; }
+}
+
+template<typename Key>
+__global__ void RejectInfrequentKernel(CountMinSketch sketch, uint32_t admission_threshold,
+                                       const uint32_t* n_missing, const Key* missing_keys,
+                                       const uint32_t* missing_indices, uint8_t* admitted) {
+  const uint32_t n = *n_missing;
+  CUDA_1D_KERNEL_LOOP_T(uint32_t, i, n) {
+    if (sketch.Estimate(missing_keys[i]) < admission_threshold) {
+      admitted[missing_indices[i]] = 0;
+    }
+  }
+}
+
+// Admitted keys are written to the front of partitioned_keys, rejected keys to the back, so that
+// the admitted keys can be put without knowing their number on the host.
+template<typename Key>
+__global__ void PartitionKeysKernel(uint32_t n_keys, const Key* keys, const uint8_t* admitted,
+                                    uint32_t* n_admitted, uint32_t* n_rejected,
+                                    Key* partitioned_keys, uint32_t* positions) {
+  CUDA_1D_KERNEL_LOOP_T(uint32_t, i, n_keys) {
+    const uint32_t position =
+        admitted[i] ? atomicAdd(n_admitted, 1U) : n_keys - 1 - atomicAdd(n_rejected, 1U);
+    partitioned_keys[position] = keys[i];
+    positions[i] = position;
+  }
+}
+
+template<typename Elem>
+__global__ void PartitionValuesKernel(uint32_t n_keys, uint32_t num_elems_per_value,
+                                      const Elem* values, const uint32_t* positions,
+                                      Elem* partitioned_values) {
+  CUDA_1D_KERNEL_LOOP_T(uint32_t, i, n_keys * num_elems_per_value) {
+    const uint32_t key_index = i / num_elems_per_value;
+    const uint32_t elem_index = i - key_index * num_elems_per_value;
+    partitioned_values[positions[key_index] * num_elems_per_value + elem_index] = values[i];
+  }
+}
+
+// Appends the rejected keys and values, the last *n_rejected of the partitioned ones, to the keys
+// and values evicted by the LRU cache.
+template<typename Key, typename Elem>
+__global__ void AppendRejectedKernel(uint32_t n_keys, uint32_t num_elems_per_value,
+                                     const uint32_t* n_rejected, const Key* partitioned_keys,
+                                     const Elem* partitioned_values, const uint32_t* n_evicted,
+                                     Key* evicted_keys, Elem* evicted_values) {
+  const uint32_t num_rejected = *n_rejected;
+  const uint32_t num_evicted = *n_evicted;
+  const uint32_t rejected_offset = n_keys - num_rejected;
+  CUDA_1D_KERNEL_LOOP_T(uint32_t, i, num_rejected * num_elems_per_value) {
+    const uint32_t key_index = i / num_elems_per_value;
+    const uint32_t elem_index = i - key_index * num_elems_per_value;
+    if (elem_index == 0) {
+      evicted_keys[num_evicted + key_index] = partitioned_keys[rejected_offset + key_index];
+    }
+    evicted_values[(num_evicted + key_index) * num_elems_per_value + elem_index] =
+        partitioned_values[(rejected_offset + key_index) * num_elems_per_value + elem_index];
+  }
+}
+
+__global__ void AccumulateMissingKernel(const uint32_t* n_missing, uint64_t* device_counters) {
+  device_counters[kNumMissingKeys] += *n_missing;
+}
+
+__global__ void AccumulateEvictedKernel(const uint32_t* n_rejected, uint32_t* n_evicted,
+                                        uint64_t* device_counters) {
+  device_counters[kNumEvictedKeys] += *n_evicted;
+  device_counters[kNumRejectedKeys] += *n_rejected;
+  *n_evicted += *n_rejected;
+}
+
+uint64_t GetSketchWidth(uint64_t capacity) {
+  uint64_t width = kMinSketchWidth;
+  while (width < capacity) { width *= 2; }
+  return width;
+}
+
+// Puts an admission filter in front of an LRU cache. Every key looked up by Get is recorded in a
+// count-min sketch, Put only inserts a key which is not already cached if its estimated lookup
+// frequency reaches the admission threshold, rejected keys are returned as evicted so that the
+// caller writes them back to the underlying store. Keys seen only once therefore never push hot
+// keys out of the cache.
+template<typename Key, typename Elem>
+class TinyLfuCache : public Cache {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TinyLfuCache);
+  explicit TinyLfuCache(const CacheOptions& options)
+      : device_index_{},
+        max_query_length_(0),
+        admission_threshold_(options.admission_threshold),
+        num_recorded_lookups_(0),
+        statistics_{} {
+    OF_CUDA_CHECK(cudaGetDevice(&device_index_));
+    CacheOptions lru_options = options;
+    lru_options.policy = CacheOptions::Policy::kLRU;
+    lru_cache_ = NewLruCache(lru_options);
+    num_elems_per_value_ = lru_cache_->ValueSize() / sizeof(Elem);
+    const uint64_t sketch_width = GetSketchWidth(lru_cache_->Capacity());
+    sketch_.width_mask = sketch_width - 1;
+    num_sketch_counters_ = sketch_width * kSketchDepth;
+    sketch_reset_period_ = lru_cache_->Capacity() * kSketchResetFactor;
+    OF_CUDA_CHECK(cudaMalloc(&sketch_.counters, num_sketch_counters_ * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMemset(sketch_.counters, 0, num_sketch_counters_ * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&device_counters_, kNumDeviceCounters * sizeof(uint64_t)));
+    OF_CUDA_CHECK(cudaMemset(device_counters_, 0, kNumDeviceCounters * sizeof(uint64_t)));
+    OF_CUDA_CHECK(cudaMalloc(&num_buffer_, 3 * sizeof(uint32_t)));
+  }
+  ~TinyLfuCache() override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    if (max_query_length_ != 0) { FreeQueryBuffers(); }
+    OF_CUDA_CHECK(cudaFree(sketch_.counters));
+    OF_CUDA_CHECK(cudaFree(device_counters_));
+    OF_CUDA_CHECK(cudaFree(num_buffer_));
+    lru_cache_.reset();
+  }
+
+  uint32_t KeySize() const override { return lru_cache_->KeySize(); }
+  uint32_t ValueSize() const override { return lru_cache_->ValueSize(); }
+  uint64_t Capacity() const override { return lru_cache_->Capacity(); }
+  uint64_t DumpCapacity() const override { return lru_cache_->DumpCapacity(); }
+  uint32_t MaxQueryLength() const override { return max_query_length_; }
+
+  void ReserveQueryLength(uint32_t query_length) override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    if (query_length < max_query_length_) { return; }
+    lru_cache_->ReserveQueryLength(query_length);
+    if (max_query_length_ != 0) { FreeQueryBuffers(); }
+    OF_CUDA_CHECK(cudaMalloc(&keys_buffer_, query_length * sizeof(Key)));
+    OF_CUDA_CHECK(cudaMalloc(&values_buffer_, query_length * ValueSize()));
+    OF_CUDA_CHECK(cudaMalloc(&indices_buffer_, query_length * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&positions_buffer_, query_length * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&admitted_buffer_, query_length * sizeof(uint8_t)));
+    max_query_length_ = query_length;
+  }
+
+  CacheOptions::Policy Policy() const override { return CacheOptions::Policy::kTinyLFU; }
+
+  void Test(ep::Stream* stream, uint32_t n_keys, const void* keys, uint32_t* n_missing,
+            void* missing_keys, uint32_t* missing_indices) override {
+    lru_cache_->Test(stream, n_keys, keys, n_missing, missing_keys, missing_indices);
+  }
+
+  void Get(ep::Stream* stream, uint32_t n_keys, const void* keys, void* values, uint32_t* n_missing,
+           void* missing_keys, uint32_t* missing_indices) override {
+    CHECK_LE(n_keys, max_query_length_);
+    lru_cache_->Get(stream, n_keys, keys, values, n_missing, missing_keys, missing_indices);
+    if (n_keys == 0) { return; }
+    RecordLookups(stream, n_keys, static_cast<const Key*>(keys));
+    auto cuda_stream = stream->As<ep::CudaStream>();
+    cuda_stream->LaunchKernel(AccumulateMissingKernel, ep::CudaLaunchConfig(1, 1, 0), n_missing,
+                              device_counters_);
+  }
+
+  void Put(ep::Stream* stream, uint32_t n_keys, const void* keys, const void* values,
+           uint32_t* n_evicted, void* evicted_keys, void* evicted_values) override {
+    CHECK_LE(n_keys, max_query_length_);
+    auto cuda_stream = stream->As<ep::CudaStream>();
+    if (n_keys == 0) {
+      OF_CUDA_CHECK(cudaMemsetAsync(n_evicted, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
+      return;
+    }
+    uint32_t* n_missing = num_buffer_;
+    uint32_t* n_admitted = num_buffer_ + 1;
+    uint32_t* n_rejected = num_buffer_ + 2;
+    // Keys already in the cache are always admitted, their values are updated in place.
+    lru_cache_->Test(stream, n_keys, keys, n_missing, keys_buffer_, indices_buffer_);
+    OF_CUDA_CHECK(cudaMemsetAsync(admitted_buffer_, 1, n_keys * sizeof(uint8_t),
+                                  cuda_stream->cuda_stream()));
+    RUN_CUDA_KERNEL((RejectInfrequentKernel<Key>), stream, n_keys, sketch_, admission_threshold_,
+                    n_missing, keys_buffer_, indices_buffer_, admitted_buffer_);
+    OF_CUDA_CHECK(cudaMemsetAsync(n_admitted, 0, 2 * sizeof(uint32_t), cuda_stream->cuda_stream()));
+    RUN_CUDA_KERNEL((PartitionKeysKernel<Key>), stream, n_keys, n_keys,
+                    static_cast<const Key*>(keys), admitted_buffer_, n_admitted, n_rejected,
+                    keys_buffer_, positions_buffer_);
+    RUN_CUDA_KERNEL((PartitionValuesKernel<Elem>), stream, n_keys * num_elems_per_value_, n_keys,
+                    num_elems_per_value_, static_cast<const Elem*>(values), positions_buffer_,
+                    values_buffer_);
+    // The number of admitted keys stays on the device, the keys evicted by the LRU cache are
+    // followed by the rejected ones.
+    lru_cache_->PutWithDeviceCount(stream, n_keys, n_admitted, keys_buffer_, values_buffer_,
+                                   n_evicted, evicted_keys, evicted_values);
+    RUN_CUDA_KERNEL((AppendRejectedKernel<Key, Elem>), stream, n_keys * num_elems_per_value_,
+                    n_keys, num_elems_per_value_, n_rejected, keys_buffer_, values_buffer_,
+                    n_evicted, static_cast<Key*>(evicted_keys), static_cast<Elem*>(evicted_values));
+    cuda_stream->LaunchKernel(AccumulateEvictedKernel, ep::CudaLaunchConfig(1, 1, 0), n_rejected,
+                              n_evicted, device_counters_);
+    statistics_.num_put_keys += n_keys;
+  }
+
+  void Dump(ep::Stream* stream, uint64_t start_key_index, uint64_t end_key_index,
+            uint32_t* n_dumped, void* keys, void* values) override {
+    lru_cache_->Dump(stream, start_key_index, end_key_index, n_dumped, keys, values);
+  }
+
+  void Clear() override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    lru_cache_->Clear();
+    OF_CUDA_CHECK(cudaMemset(sketch_.counters, 0, num_sketch_counters_ * sizeof(uint32_t)));
+    num_recorded_lookups_ = 0;
+  }
+
+  bool GetStatistics(CacheStatistics* statistics) override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    uint64_t device_counters[kNumDeviceCounters];
+    OF_CUDA_CHECK(cudaMemcpy(device_counters, device_counters_, sizeof(device_counters),
+                             cudaMemcpyDefault));
+    *statistics = statistics_;
+    statistics->num_missing_keys = device_counters[kNumMissingKeys];
+    statistics->num_evicted_keys = device_counters[kNumEvictedKeys];
+    statistics->num_rejected_keys = device_counters[kNumRejectedKeys];
+    return true;
+  }
+
+ private:
+  void RecordLookups(ep::Stream* stream, uint32_t n_keys, const Key* keys) {
+    RUN_CUDA_KERNEL((SketchIncrementKernel<Key>), stream, n_keys, sketch_, n_keys, keys);
+    statistics_.num_queried_keys += n_keys;
+    num_recorded_lookups_ += n_keys;
+    if (num_recorded_lookups_ >= sketch_reset_period_) {
+      RUN_CUDA_KERNEL(SketchHalveKernel, stream, num_sketch_counters_, num_sketch_counters_,
+                      sketch_.counters);
+      num_recorded_lookups_ /= 2;
+    }
+  }
+
+  void FreeQueryBuffers() {
+    OF_CUDA_CHECK(cudaFree(keys_buffer_));
+    OF_CUDA_CHECK(cudaFree(values_buffer_));
+    OF_CUDA_CHECK(cudaFree(indices_buffer_));
+    OF_CUDA_CHECK(cudaFree(positions_buffer_));
+    OF_CUDA_CHECK(cudaFree(admitted_buffer_));
+  }
+
+  int device_index_;
+  uint32_t max_query_length_;
+  uint32_t admission_threshold_;
+  uint32_t num_elems_per_value_{};
+  std::unique_ptr<LruCache> lru_cache_;
+  CountMinSketch sketch_{};
+  uint64_t num_sketch_counters_{};
+  uint64_t sketch_reset_period_{};
+  uint64_t num_recorded_lookups_;
+  uint64_t* device_counters_{};
+  CacheStatistics statistics_;
+  uint32_t* num_buffer_{};
+  Key* keys_buffer_{};
+  Elem* values_buffer_{};
+  uint32_t* indices_buffer_{};
+  uint32_t* positions_buffer_{};
+  uint8_t* admitted_buffer_{};
+};
+
+template<typename Key>
+std::unique_ptr<Cache> DispatchValueType(const CacheOptions& options) {
+  if (options.value_size % sizeof(ulonglong2) == 0) {
+    return std::unique_ptr<Cache>(new TinyLfuCache<Key, ulonglong2>(options));
+  } else if (options.value_size % sizeof(uint64_t) == 0) {
+    return std::unique_ptr<Cache>(new TinyLfuCache<Key, uint64_t>(options));
+  } else if (options.value_size % sizeof(uint32_t) == 0) {
+    return std::unique_ptr<Cache>(new TinyLfuCache<Key, uint32_t>(options));
+  } else if (options.value_size % sizeof(uint16_t) == 0) {
+    return std::unique_ptr<Cache>(new TinyLfuCache<Key, uint16_t>(options));
+  } else {
+    return std::unique_ptr<Cache>(new TinyLfuCache<Key, uint8_t>(options));
+  }
+}
+
+std::unique_ptr<Cache> DispatchKeyType(const CacheOptions& options) {
+  if (options.key_size == sizeof(uint32_t)) {
+    return DispatchValueType<uint32_t>(options);
+  } else if (options.key_size == sizeof(uint64_t)) {
+    return DispatchValueType<uint64_t>(options);
+  } else {
+    UNIMPLEMENTED();
+    return nullptr;
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<Cache> NewTinyLfuCache(const CacheOptions& options) {
+  return DispatchKeyType(options);
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -100,6 +100,15 @@ class CpuStream : public Stream {
   Maybe<void> Sync() override;
   void RecordEvent(Event* event) override;
 
+  static constexpr size_t kParallelForDefaultGrain = 32768;
+
+  // Grain for a ParallelFor over rows of `row_size` elements, so that a task still covers about
+  // kParallelForDefaultGrain elements.
+  static size_t ParallelForRowGrain(int64_t row_size) {
+    return std::max<int64_t>(
+        static_cast<int64_t>(kParallelForDefaultGrain) / std::max<int64_t>(row_size, 1), 1);
+  }
+
   template<typename F>
   void ParallelFor(int64_t begin, int64_t end, const F& func) {
     ParallelFor(begin, end, func, kParallelForDefaultGrain);
@@ -150,7 +159,6 @@ class CpuStream : public Stream {
 
  private:
   CpuDevice* device_;
-  static constexpr size_t kParallelForDefaultGrain = 32768;
 #ifdef WITH_ONEDNN
   std::unique_ptr<ep::OneDnnExecutor> onednn_executor_;
 #endif
@@ -33,6 +33,13 @@ struct BinaryFunctor<DeviceType::kCPU, BinaryOp::kPow, float16, float16> {
   }
 };
 
+template<>
+struct BinaryFunctor<DeviceType::kCPU, BinaryOp::kPow, bfloat16, bfloat16> {
+  OF_DEVICE_FUNC bfloat16 operator()(bfloat16 src0, bfloat16 src1) const {
+    return static_cast<bfloat16>(std::pow(static_cast<float>(src0), static_cast<float>(src1)));
+  }
+};
+
 }  // namespace broadcast_elementwise_binary
 }  // namespace primitive
 }  // namespace ep
@@ -19,8 +19,6 @@ limitations under the License.
 #include "oneflow/core/ep/common/primitive/broadcast_elementwise_binary.h"
 #include "oneflow/core/ep/cpu/primitive/binary_functor.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
-#include "oneflow/core/ndarray/ndarray_util.h"
-#include "oneflow/core/ndarray/xpu_var_ndarray.h"
 #include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/cpu/cpu_device.h"
 #include "oneflow/core/ep/common/primitive/util.h"
@@ -44,37 +42,109 @@ float16 GetValue<float16>(Scalar value) {
   return static_cast<float16>(GetValue<float>(value));
 }
 
-template<BinaryOp binary_op, typename Src, typename Dst,
-         void (*binary_func)(ep::Stream* stream, const XpuVarNdarray<Dst>& z,
-                             const XpuVarNdarray<const Src>& x, const XpuVarNdarray<const Src>& y)>
-class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
+template<>
+bfloat16 GetValue<bfloat16>(Scalar value) {
+  return static_cast<bfloat16>(GetValue<float>(value));
+}
+
+// Runs `dst[i] = functor(src0[i * src0_stride], src1[i * src1_stride])` over a contiguous run,
+// the strides are 0 (broadcast) or 1. Each case is a separate loop so that the compiler can
+// vectorize it.
+template<typename Functor, typename Src, typename Dst>
+void BinaryInnerLoop(const Functor& functor, int64_t n, const Src* src0, bool broadcast_src0,
+                     const Src* src1, bool broadcast_src1, Dst* dst) {
+  if (broadcast_src0) {
+    const Src src0_val = *src0;
+    for (int64_t i = 0; i < n; ++i) { dst[i] = functor(src0_val, src1[i]); }
+  } else if (broadcast_src1) {
+    const Src src1_val = *src1;
+    for (int64_t i = 0; i < n; ++i) { dst[i] = functor(src0[i], src1_val); }
+  } else {
+    for (int64_t i = 0; i < n; ++i) { dst[i] = functor(src0[i], src1[i]); }
+  }
+}
+
+// The dims are expected to be simplified, so that two adjacent dims never share the same broadcast
+// pattern. Same-shape and scalar operands run as one flat loop, everything else (row, column and
+// general broadcast) runs as a parallel loop over the rows of the innermost dim.
+template<BinaryOp binary_op, typename Src, typename Dst>
+void LaunchBroadcastElementwiseBinaryNative(CpuStream* cpu_stream, size_t num_dims,
+                                            const int64_t* src0_dims, const Src* src0,
+                                            const int64_t* src1_dims, const Src* src1,
+                                            const int64_t* dst_dims, Dst* dst) {
+  const auto functor = BinaryFunctor<DeviceType::kCPU, binary_op, Src, Dst>();
+  const int64_t elem_cnt = GetElementCount(num_dims, dst_dims);
+  if (elem_cnt == 0) { return; }
+  const int64_t src0_elem_cnt = GetElementCount(num_dims, src0_dims);
+  const int64_t src1_elem_cnt = GetElementCount(num_dims, src1_dims);
+  if (num_dims <= 1 || src0_elem_cnt == 1 || src1_elem_cnt == 1) {
+    const bool broadcast_src0 = (src0_elem_cnt == 1 && elem_cnt != 1);
+    const bool broadcast_src1 = (src1_elem_cnt == 1 && elem_cnt != 1);
+    cpu_stream->ParallelFor(0, elem_cnt, [&](int64_t begin, int64_t end) {
+      BinaryInnerLoop(functor, end - begin, broadcast_src0 ? src0 : src0 + begin, broadcast_src0,
+                      broadcast_src1 ? src1 : src1 + begin, broadcast_src1, dst + begin);
+    });
+    return;
+  }
+  const size_t num_outer_dims = num_dims - 1;
+  const int64_t inner_size = dst_dims[num_outer_dims];
+  const bool broadcast_src0 = (src0_dims[num_outer_dims] == 1);
+  const bool broadcast_src1 = (src1_dims[num_outer_dims] == 1);
+  int64_t src0_strides[kMaxNumDims];
+  int64_t src1_strides[kMaxNumDims];
+  int64_t src0_stride = 1;
+  int64_t src1_stride = 1;
+  for (int64_t i = num_dims - 1; i >= 0; --i) {
+    src0_strides[i] = (src0_dims[i] == 1) ? 0 : src0_stride;
+    src1_strides[i] = (src1_dims[i] == 1) ? 0 : src1_stride;
+    src0_stride *= src0_dims[i];
+    src1_stride *= src1_dims[i];
+  }
+  const NdIndexOffsetHelper<int64_t, kMaxNumDims> row_index_helper(dst_dims, num_outer_dims);
+  const int64_t num_rows = elem_cnt / inner_size;
+  cpu_stream->ParallelFor(
+      0, num_rows,
+      [&](int64_t begin, int64_t end) {
+        int64_t row_index[kMaxNumDims];
+        for (int64_t row = begin; row < end; ++row) {
+          row_index_helper.OffsetToNdIndex(row, row_index, num_outer_dims);
+          int64_t src0_offset = 0;
+          int64_t src1_offset = 0;
+          for (size_t i = 0; i < num_outer_dims; ++i) {
+            src0_offset += row_index[i] * src0_strides[i];
+            src1_offset += row_index[i] * src1_strides[i];
+          }
+          BinaryInnerLoop(functor, inner_size, src0 + src0_offset, broadcast_src0,
+                          src1 + src1_offset, broadcast_src1, dst + row * inner_size);
+        }
+      },
+      CpuStream::ParallelForRowGrain(inner_size));
+}
+
+// NOTE: for bfloat16 BinaryFunctor widens the operands to float, so only the final store is
+// rounded.
+template<BinaryOp binary_op, typename Src, typename Dst>
+class BroadcastElementwiseBinaryNativeImpl : public BroadcastElementwiseBinary {
  public:
-  OF_DISALLOW_COPY_AND_MOVE(BroadcastElementwiseBinaryImpl);
-  BroadcastElementwiseBinaryImpl() = default;
-  ~BroadcastElementwiseBinaryImpl() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(BroadcastElementwiseBinaryNativeImpl);
+  BroadcastElementwiseBinaryNativeImpl() = default;
+  ~BroadcastElementwiseBinaryNativeImpl() override = default;
 
   void Launch(Stream* stream, Scalar src0, size_t num_src1_dims, const int64_t* src1_dims,
               const void* src1, void* dst) override {
-    int64_t elem_cnt = GetElementCount(num_src1_dims, src1_dims);
-    Src src0_val = GetValue<Src>(src0);
-    binary_func(stream, XpuVarNdarray<Dst>(Shape({elem_cnt}), reinterpret_cast<Dst*>(dst), 1),
-                XpuVarNdarray<const Src>(Shape({1}), &src0_val, 1),
-                XpuVarNdarray<const Src>(Shape({elem_cnt}), reinterpret_cast<const Src*>(src1), 1));
+    const Src src0_val = GetValue<Src>(src0);
+    const int64_t src0_dims = 1;
+    Launch(stream, 1, &src0_dims, &src0_val, num_src1_dims, src1_dims, src1, dst);
   }
   void Launch(Stream* stream, size_t num_src0_dims, const int64_t* src0_dims, const void* src0,
               Scalar src1, void* dst) override {
-    int64_t elem_cnt = GetElementCount(num_src0_dims, src0_dims);
-    Src src1_val = GetValue<Src>(src1);
-    binary_func(stream, XpuVarNdarray<Dst>(Shape({elem_cnt}), reinterpret_cast<Dst*>(dst), 1),
-                XpuVarNdarray<const Src>(Shape({elem_cnt}), reinterpret_cast<const Src*>(src0), 1),
-                XpuVarNdarray<const Src>(Shape({1}), &src1_val, 1));
+    const Src src1_val = GetValue<Src>(src1);
+    const int64_t src1_dims = 1;
+    Launch(stream, num_src0_dims, src0_dims, src0, 1, &src1_dims, &src1_val, dst);
   }
   void Launch(Stream* stream, size_t num_src0_dims, const int64_t* src0_dims, const void* src0,
               size_t num_src1_dims, const int64_t* src1_dims, const void* src1,
               void* dst) override {
-    Shape src0_shape;
-    Shape src1_shape;
-    Shape dst_shape;
     size_t num_dims = 0;
     int64_t simplified_src0_dims[kMaxNumDims];
     int64_t simplified_src1_dims[kMaxNumDims];
@@ -84,54 +154,29 @@ class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
                                        simplified_dst_dims);
     CheckInplace(num_dims, simplified_src0_dims, src0, simplified_src1_dims, src1,
                  simplified_dst_dims, dst);
-    for (int64_t i = 0; i < num_dims; ++i) {
-      src0_shape.push_back(simplified_src0_dims[i]);
-      src1_shape.push_back(simplified_src1_dims[i]);
-      dst_shape.push_back(simplified_dst_dims[i]);
-    }
-    binary_func(stream, XpuVarNdarray<Dst>(dst_shape, reinterpret_cast<Dst*>(dst), num_dims),
-                XpuVarNdarray<const Src>(src0_shape, reinterpret_cast<const Src*>(src0), num_dims),
-                XpuVarNdarray<const Src>(src1_shape, reinterpret_cast<const Src*>(src1), num_dims));
+    LaunchBroadcastElementwiseBinaryNative<binary_op, Src, Dst>(
+        stream->As<CpuStream>(), num_dims, simplified_src0_dims,
+        reinterpret_cast<const Src*>(src0), simplified_src1_dims,
+        reinterpret_cast<const Src*>(src1), simplified_dst_dims, reinterpret_cast<Dst*>(dst));
   }
 };
 
-template<BinaryOp binary_op, typename Src, typename Dst,
-         void (*binary_func)(ep::Stream* stream, const XpuVarNdarray<Dst>& z,
-                             const XpuVarNdarray<const Src>& x, const XpuVarNdarray<const Src>& y)>
-std::unique_ptr<BroadcastElementwiseBinary> NewBroadcastElementwiseBinary() {
+template<BinaryOp binary_op, typename Src, typename Dst>
+std::unique_ptr<BroadcastElementwiseBinary> NewBroadcastElementwiseBinaryNative() {
   return std::unique_ptr<BroadcastElementwiseBinary>(
-      new BroadcastElementwiseBinaryImpl<binary_op, Src, Dst, binary_func>());
+      new BroadcastElementwiseBinaryNativeImpl<binary_op, Src, Dst>());
 }
 
-#define BINARY_MATH_OP_NDARRAY_PAIR         \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kAdd, Add) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kSub, Sub) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMul, Mul) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kDiv, Div) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMax, Max) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMin, Min) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kPow, Pow)
-
-#define NDARRAY_BINARY_TYPE_SEQ \
-  CPU_PRIMITIVE_BOOL_TYPE_SEQ   \
-  CPU_PRIMITIVE_INT8_TYPE_SEQ   \
-  CPU_PRIMITIVE_UINT8_TYPE_SEQ  \
-  CPU_PRIMITIVE_INT32_TYPE_SEQ  \
-  CPU_PRIMITIVE_INT64_TYPE_SEQ  \
-  CPU_PRIMITIVE_FLOAT_TYPE_SEQ  \
-  CPU_PRIMITIVE_DOUBLE_TYPE_SEQ \
-  CPU_PRIMITIVE_FLOAT16_TYPE_SEQ
-
-#define BINARY_LOGICAL_COMPARISION_OP_NDARRAY_PAIR  \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kEqual, EQ)        \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kNotEqual, NE)     \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLessThan, LT)     \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLessEqual, LE)    \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kGreaterThan, GT)  \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kGreaterEqual, GE) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalAnd, AND)  \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalOr, OR)    \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalXor, XOR)
+#define NATIVE_BINARY_TYPE_SEQ   \
+  CPU_PRIMITIVE_BOOL_TYPE_SEQ    \
+  CPU_PRIMITIVE_INT8_TYPE_SEQ    \
+  CPU_PRIMITIVE_UINT8_TYPE_SEQ   \
+  CPU_PRIMITIVE_INT32_TYPE_SEQ   \
+  CPU_PRIMITIVE_INT64_TYPE_SEQ   \
+  CPU_PRIMITIVE_FLOAT_TYPE_SEQ   \
+  CPU_PRIMITIVE_DOUBLE_TYPE_SEQ  \
+  CPU_PRIMITIVE_FLOAT16_TYPE_SEQ \
+  CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ
 
 #ifdef WITH_ONEDNN
 
@@ -315,37 +360,32 @@ class BroadcastElementwiseBinaryFactoryImpl : public BroadcastElementwiseBinaryF
   std::unique_ptr<BroadcastElementwiseBinary> New(BinaryOp binary_op, DataType src_type,
                                                   DataType dst_type, size_t max_num_dims) override {
     if (max_num_dims > kMaxNumDims) { return nullptr; }
-#define MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY(binary_op_pair, data_type_pair) \
-  {std::make_tuple(OF_PP_PAIR_FIRST(binary_op_pair), OF_PP_PAIR_SECOND(data_type_pair),  \
-                   OF_PP_PAIR_SECOND(data_type_pair)),                                   \
-   NewBroadcastElementwiseBinary<                                                        \
-       OF_PP_PAIR_FIRST(binary_op_pair), OF_PP_PAIR_FIRST(data_type_pair),               \
-       OF_PP_PAIR_FIRST(data_type_pair),                                                 \
-       &NdarrayUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(data_type_pair)>::OF_PP_CAT(      \
-           Broadcast, OF_PP_PAIR_SECOND(binary_op_pair))>},
-
-#define MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY(                \
-    binary_op_pair, src_data_type_pair, dst_data_type_pair)                                 \
-  {std::make_tuple(OF_PP_PAIR_FIRST(binary_op_pair), OF_PP_PAIR_SECOND(src_data_type_pair), \
-                   OF_PP_PAIR_SECOND(dst_data_type_pair)),                                  \
-   NewBroadcastElementwiseBinary<                                                           \
-       OF_PP_PAIR_FIRST(binary_op_pair), OF_PP_PAIR_FIRST(src_data_type_pair),              \
-       OF_PP_PAIR_FIRST(dst_data_type_pair),                                                \
-       &NdarrayUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(src_data_type_pair)>::OF_PP_CAT(     \
-           Broadcast, OF_PP_PAIR_SECOND(binary_op_pair))>},
+#define MAKE_NEW_NATIVE_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY(binary_op, data_type_pair) \
+  {std::make_tuple(binary_op, OF_PP_PAIR_SECOND(data_type_pair),                           \
+                   OF_PP_PAIR_SECOND(data_type_pair)),                                     \
+   NewBroadcastElementwiseBinaryNative<binary_op, OF_PP_PAIR_FIRST(data_type_pair),        \
+                                       OF_PP_PAIR_FIRST(data_type_pair)>},
+
+#define MAKE_NEW_NATIVE_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY(     \
+    binary_op, src_data_type_pair, dst_data_type_pair)                                  \
+  {std::make_tuple(binary_op, OF_PP_PAIR_SECOND(src_data_type_pair),                    \
+                   OF_PP_PAIR_SECOND(dst_data_type_pair)),                              \
+   NewBroadcastElementwiseBinaryNative<binary_op, OF_PP_PAIR_FIRST(src_data_type_pair), \
+                                       OF_PP_PAIR_FIRST(dst_data_type_pair)>},
 
     static const std::map<std::tuple<BinaryOp, DataType, DataType>,
                           std::function<std::unique_ptr<BroadcastElementwiseBinary>()>>
-        new_broadcast_elementwise_binary_handle{
-            OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY,
-                                             BINARY_MATH_OP_NDARRAY_PAIR, NDARRAY_BINARY_TYPE_SEQ)
+        new_broadcast_elementwise_binary_native_handle{
+            OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
+                MAKE_NEW_NATIVE_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY, BINARY_MATH_OP_SEQ,
+                NATIVE_BINARY_TYPE_SEQ)
                 OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
-                    MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY,
-                    BINARY_LOGICAL_COMPARISION_OP_NDARRAY_PAIR, NDARRAY_BINARY_TYPE_SEQ,
+                    MAKE_NEW_NATIVE_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY,
+                    BINARY_COMPARISION_OP_SEQ BINARY_LOGICAL_OP_SEQ, NATIVE_BINARY_TYPE_SEQ,
                     CPU_PRIMITIVE_BOOL_TYPE_SEQ)};
 
-#undef MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY
-#undef MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY
+#undef MAKE_NEW_NATIVE_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY
+#undef MAKE_NEW_NATIVE_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY
 
 #ifdef WITH_ONEDNN
     static const std::map<std::tuple<BinaryOp, DataType, DataType>,
@@ -371,7 +411,7 @@ class BroadcastElementwiseBinaryFactoryImpl : public BroadcastElementwiseBinaryF
     }
 
 #endif
-    return NewPrimitiveFromHandlers(new_broadcast_elementwise_binary_handle,
+    return NewPrimitiveFromHandlers(new_broadcast_elementwise_binary_native_handle,
                                     std::make_tuple(binary_op, src_type, dst_type));
   }
 };
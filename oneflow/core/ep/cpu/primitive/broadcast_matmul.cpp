@@ -85,6 +85,39 @@ void LaunchCblasBroadcastMatmul(Stream* /*stream*/, DataType data_type,
                              a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
 }
 
+// There is no bfloat16 gemm in cblas, so each batch is widened to float, multiplied with sgemm and
+// rounded back once, which keeps the accumulation in float.
+void LaunchBFloat16BroadcastMatmul(Stream* /*stream*/, DataType data_type,
+                                   BlasTransposeType transpose_a, BlasTransposeType transpose_b,
+                                   int64_t num_batch_dims, const int64_t* broadcast_batch_dims,
+                                   const int64_t* a_batch_dims, const int64_t* b_batch_dims,
+                                   const int64_t* c_batch_dims, int64_t m, int64_t n, int64_t k,
+                                   Scalar alpha, const void* a, const void* b, Scalar beta,
+                                   void* c) {
+  const CBLAS_TRANSPOSE cblas_trans_a = GetCblasTranspose(transpose_a);
+  const CBLAS_TRANSPOSE cblas_trans_b = GetCblasTranspose(transpose_b);
+  const float alpha_value = alpha.Value<float>();
+  std::vector<float> a_buffer(m * k);
+  std::vector<float> b_buffer(k * n);
+  std::vector<float> c_buffer(m * n);
+  auto ToFloat = [](const void* src, std::vector<float>* dst) {
+    const bfloat16* src_ptr = static_cast<const bfloat16*>(src);
+    for (size_t i = 0; i < dst->size(); ++i) { (*dst)[i] = static_cast<float>(src_ptr[i]); }
+  };
+  auto func = [&](const void* batch_a, const void* batch_b, void* batch_c, Scalar batch_beta) {
+    const float beta_value = batch_beta.Value<float>();
+    ToFloat(batch_a, &a_buffer);
+    ToFloat(batch_b, &b_buffer);
+    if (beta_value != 0) { ToFloat(batch_c, &c_buffer); }
+    CblasMatmul<float>(cblas_trans_a, cblas_trans_b, m, n, k, alpha_value, a_buffer.data(),
+                       b_buffer.data(), beta_value, c_buffer.data());
+    bfloat16* c_ptr = static_cast<bfloat16*>(batch_c);
+    for (size_t i = 0; i < c_buffer.size(); ++i) { c_ptr[i] = static_cast<bfloat16>(c_buffer[i]); }
+  };
+  ForEachMatmul<kMaxNumDims>(data_type, m, n, k, beta, num_batch_dims, broadcast_batch_dims,
+                             a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
+}
+
 void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType transpose_a,
                            BlasTransposeType transpose_b, int64_t num_batch_dims,
                            const int64_t* broadcast_batch_dims, const int64_t* a_batch_dims,
@@ -99,6 +132,10 @@ void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType
     LaunchCblasBroadcastMatmul<double>(stream, data_type, transpose_a, transpose_b, num_batch_dims,
                                        broadcast_batch_dims, a_batch_dims, b_batch_dims,
                                        c_batch_dims, m, n, k, alpha, a, b, beta, c);
+  } else if (data_type == DataType::kBFloat16) {
+    LaunchBFloat16BroadcastMatmul(stream, data_type, transpose_a, transpose_b, num_batch_dims,
+                                  broadcast_batch_dims, a_batch_dims, b_batch_dims, c_batch_dims,
+                                  m, n, k, alpha, a, b, beta, c);
   } else {
     UNIMPLEMENTED();
   }
@@ -114,7 +151,8 @@ class BroadcastMatmulFactoryImpl : public BroadcastMatmulFactory {
                                        BlasTransposeType transpose_b,
                                        size_t max_num_dims) override {
     if (max_num_dims > kMaxNumDims) { return nullptr; }
-    if (data_type == DataType::kFloat || data_type == DataType::kDouble) {
+    if (data_type == DataType::kFloat || data_type == DataType::kDouble
+        || data_type == DataType::kBFloat16) {
       return std::make_unique<BroadcastMatmulImpl<kMaxNumDims>>(data_type, transpose_a,
                                                                 transpose_b);
     } else {
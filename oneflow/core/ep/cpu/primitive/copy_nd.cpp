@@ -15,6 +15,8 @@ limitations under the License.
 */
 #include "oneflow/core/ep/include/primitive/copy_nd.h"
 #include "oneflow/core/ep/common/primitive/copy_nd.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include <cstring>
 
 namespace oneflow {
 
@@ -23,29 +25,61 @@ namespace primitive {
 
 namespace {
 
+template<typename T>
+void CopyRow(const T* src, T* dst, int64_t size) {
+  if (size == 1) {
+    *dst = *src;
+  } else {
+    std::memcpy(dst, src, size * sizeof(T));
+  }
+}
+
+// The innermost dim is contiguous in both src and dst once the dims are simplified, so each row of
+// it is copied with one memcpy and only the outer dims are indexed, by stepping the nd index of
+// the rows in order instead of recomputing it from the flat offset.
 template<size_t num_dims, size_t movement_size, typename IndexType>
-void CopyNdKernel(CopyNdKernelParams<num_dims, IndexType> params) {
+void CopyNdKernel(CpuStream* cpu_stream, CopyNdKernelParams<num_dims, IndexType> params) {
   using T = typename std::aligned_storage<movement_size, movement_size>::type;
   const T* src = reinterpret_cast<const T*>(params.src);
   T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
-    IndexType copy_index[num_dims];
-    IndexType src_index[num_dims];
-    IndexType dst_index[num_dims];
-    params.copy_index_helper.OffsetToNdIndex(i, copy_index);
-    for (size_t j = 0; j < num_dims; ++j) {
-      src_index[j] = params.src_pos[j] + copy_index[j];
-      dst_index[j] = params.dst_pos[j] + copy_index[j];
-    }
-    const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(dst_index);
-    dst[dst_offset] = src[src_offset];
+  if (params.count == 0) { return; }
+  const IndexType row_size = params.extent[num_dims - 1];
+  const IndexType num_rows = params.count / row_size;
+  if (num_rows == 1) {
+    const IndexType src_offset = params.src_index_helper.NdIndexToOffset(params.src_pos);
+    const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(params.dst_pos);
+    cpu_stream->ParallelFor(0, row_size, [&](int64_t begin, int64_t end) {
+      CopyRow(src + src_offset + begin, dst + dst_offset + begin, end - begin);
+    });
+    return;
   }
+  cpu_stream->ParallelFor(
+      0, num_rows,
+      [&](int64_t begin, int64_t end) {
+        IndexType copy_index[num_dims];
+        params.copy_index_helper.OffsetToNdIndex(static_cast<IndexType>(begin * row_size),
+                                                 copy_index);
+        for (int64_t row = begin; row < end; ++row) {
+          IndexType src_index[num_dims];
+          IndexType dst_index[num_dims];
+          for (size_t j = 0; j < num_dims; ++j) {
+            src_index[j] = params.src_pos[j] + copy_index[j];
+            dst_index[j] = params.dst_pos[j] + copy_index[j];
+          }
+          CopyRow(src + params.src_index_helper.NdIndexToOffset(src_index),
+                  dst + params.dst_index_helper.NdIndexToOffset(dst_index), row_size);
+          for (int64_t j = static_cast<int64_t>(num_dims) - 2; j >= 0; --j) {
+            if (++copy_index[j] < params.extent[j]) { break; }
+            copy_index[j] = 0;
+          }
+        }
+      },
+      CpuStream::ParallelForRowGrain(row_size));
 }
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, CopyNdKernelParams<num_dims, IndexType> params) {
-  CopyNdKernel<num_dims, movement_size, IndexType>(params);
+  CopyNdKernel<num_dims, movement_size, IndexType>(stream->As<CpuStream>(), params);
 }
 
 class CopyNdImpl : public CopyNd {
@@ -39,14 +39,29 @@ class ElementwiseUnaryImpl : public ElementwiseUnary {
 
     Dst* dst = reinterpret_cast<Dst*>(dst_ptr);
     const Src* src = reinterpret_cast<const Src*>(src_ptr);
+    LaunchElementwise(
+        cpu_stream, src, dst, count,
+        std::integral_constant<bool, VectorizedUnaryFunctor<unary_op, Dst, Src>::value>());
+  }
+
+ protected:
+  Scalar attr0, attr1;
+
+ private:
+  void LaunchElementwise(CpuStream* cpu_stream, const Src* src, Dst* dst, size_t count,
+                         std::false_type) {
     auto functor = UnaryFunctor<DeviceType::kCPU, unary_op, Dst, Src>(attr0, attr1);
     cpu_stream->ParallelFor(0, count, [functor, src, dst](int64_t begin, int64_t end) {
       for (int64_t i = begin; i < end; i++) { dst[i] = functor(src[i]); }
     });
   }
 
- protected:
-  Scalar attr0, attr1;
+  void LaunchElementwise(CpuStream* cpu_stream, const Src* src, Dst* dst, size_t count,
+                         std::true_type) {
+    cpu_stream->ParallelFor(0, count, [src, dst](int64_t begin, int64_t end) {
+      VectorizedUnaryFunctor<unary_op, Dst, Src>::Apply(src + begin, dst + begin, end - begin);
+    });
+  }
 };
 
 template<UnaryOp unary_op, typename Src, typename Dst>
@@ -87,14 +102,19 @@ class ElementwiseUnaryFactoryImpl : public ElementwiseUnaryFactory {
         new_elementwise_unary_handle{
             // For All Type OP
             OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_SAME_DTYPE_ELEMENTWISE_UNARY_ENTRY,
-                                             UNARY_MATH_OP_SEQ, CPU_PRIMITIVE_NATIVE_TYPE_SEQ)
+                                             UNARY_MATH_OP_SEQ,
+                                             CPU_PRIMITIVE_NATIVE_TYPE_SEQ
+                                                 CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ)
             // For Float Type OP
             OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_SAME_DTYPE_ELEMENTWISE_UNARY_ENTRY,
                                              UNARY_FLOATING_MATH_OP_SEQ,
-                                             CPU_PRIMITIVE_FLOATING_TYPE_SEQ)
+                                             CPU_PRIMITIVE_FLOATING_TYPE_SEQ
+                                                 CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ)
             // For Logical OP
             OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_DIFFERENT_DTYPE_ELEMENTWISE_UNARY_ENTRY,
-                                             UNARY_LOGICAL_OP_SEQ, CPU_PRIMITIVE_NATIVE_TYPE_SEQ,
+                                             UNARY_LOGICAL_OP_SEQ,
+                                             CPU_PRIMITIVE_NATIVE_TYPE_SEQ
+                                                 CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ,
                                              CPU_PRIMITIVE_BOOL_TYPE_SEQ)};
 
 #undef MAKE_NEW_DIFFERENT_DTYPE_ELEMENTWISE_UNARY_ENTRY
@@ -18,6 +18,9 @@ limitations under the License.
 #include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/cpu/cpu_device.h"
 #include "oneflow/core/ep/common/onednn.h"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif  // defined(__SSE2__)
 
 namespace oneflow {
 
@@ -30,30 +33,146 @@ namespace internal {
 
 namespace {
 
+constexpr int64_t kTransposeTileSize = 32;
+
+// Transposes a kBlockSize x kBlockSize block, the SIMD specializations do it in registers.
+template<size_t movement_size>
+struct TransposeBlock {
+  using T = typename std::aligned_storage<movement_size, movement_size>::type;
+  static constexpr int64_t kBlockSize = 1;
+  static void Apply(const T* src, int64_t src_stride, T* dst, int64_t dst_stride) { *dst = *src; }
+};
+
+#if defined(__SSE2__)
+
+template<>
+struct TransposeBlock<4> {
+  using T = typename std::aligned_storage<4, 4>::type;
+  static constexpr int64_t kBlockSize = 4;
+  static void Apply(const T* src, int64_t src_stride, T* dst, int64_t dst_stride) {
+    // shuffles only, the bits are moved as is
+    const float* src_ptr = reinterpret_cast<const float*>(src);
+    float* dst_ptr = reinterpret_cast<float*>(dst);
+    __m128 row0 = _mm_loadu_ps(src_ptr);
+    __m128 row1 = _mm_loadu_ps(src_ptr + src_stride);
+    __m128 row2 = _mm_loadu_ps(src_ptr + 2 * src_stride);
+    __m128 row3 = _mm_loadu_ps(src_ptr + 3 * src_stride);
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    _mm_storeu_ps(dst_ptr, row0);
+    _mm_storeu_ps(dst_ptr + dst_stride, row1);
+    _mm_storeu_ps(dst_ptr + 2 * dst_stride, row2);
+    _mm_storeu_ps(dst_ptr + 3 * dst_stride, row3);
+  }
+};
+
+template<>
+struct TransposeBlock<8> {
+  using T = typename std::aligned_storage<8, 8>::type;
+  static constexpr int64_t kBlockSize = 2;
+  static void Apply(const T* src, int64_t src_stride, T* dst, int64_t dst_stride) {
+    const double* src_ptr = reinterpret_cast<const double*>(src);
+    double* dst_ptr = reinterpret_cast<double*>(dst);
+    const __m128d row0 = _mm_loadu_pd(src_ptr);
+    const __m128d row1 = _mm_loadu_pd(src_ptr + src_stride);
+    _mm_storeu_pd(dst_ptr, _mm_unpacklo_pd(row0, row1));
+    _mm_storeu_pd(dst_ptr + dst_stride, _mm_unpackhi_pd(row0, row1));
+  }
+};
+
+#endif  // defined(__SSE2__)
+
+// dst[j][i] = src[i][j] for a rows x cols tile
+template<size_t movement_size>
+void TransposeTile(const typename TransposeBlock<movement_size>::T* src, int64_t src_stride,
+                   typename TransposeBlock<movement_size>::T* dst, int64_t dst_stride,
+                   int64_t rows, int64_t cols) {
+  constexpr int64_t kBlockSize = TransposeBlock<movement_size>::kBlockSize;
+  const int64_t block_rows = rows / kBlockSize * kBlockSize;
+  const int64_t block_cols = cols / kBlockSize * kBlockSize;
+  for (int64_t i = 0; i < block_rows; i += kBlockSize) {
+    for (int64_t j = 0; j < block_cols; j += kBlockSize) {
+      TransposeBlock<movement_size>::Apply(src + i * src_stride + j, src_stride,
+                                           dst + j * dst_stride + i, dst_stride);
+    }
+    for (int64_t ii = i; ii < i + kBlockSize; ++ii) {
+      for (int64_t j = block_cols; j < cols; ++j) {
+        dst[j * dst_stride + ii] = src[ii * src_stride + j];
+      }
+    }
+  }
+  for (int64_t i = block_rows; i < rows; ++i) {
+    for (int64_t j = 0; j < cols; ++j) { dst[j * dst_stride + i] = src[i * src_stride + j]; }
+  }
+}
+
+// [num_batches, rows, cols] -> [num_batches, cols, rows], in kTransposeTileSize square tiles so
+// that both the reads and the writes of a tile stay in cache.
+template<size_t movement_size>
+void LaunchBatchTranspose(CpuStream* cpu_stream, int64_t num_batches, int64_t rows, int64_t cols,
+                          const void* src, void* dst) {
+  using T = typename TransposeBlock<movement_size>::T;
+  const T* src_ptr = reinterpret_cast<const T*>(src);
+  T* dst_ptr = reinterpret_cast<T*>(dst);
+  const int64_t num_row_tiles = (rows + kTransposeTileSize - 1) / kTransposeTileSize;
+  const int64_t num_col_tiles = (cols + kTransposeTileSize - 1) / kTransposeTileSize;
+  const int64_t num_tiles_per_batch = num_row_tiles * num_col_tiles;
+  const int64_t matrix_size = rows * cols;
+  cpu_stream->ParallelFor(
+      0, num_batches * num_tiles_per_batch,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t tile = begin; tile < end; ++tile) {
+          const int64_t batch = tile / num_tiles_per_batch;
+          const int64_t row_tile = tile % num_tiles_per_batch / num_col_tiles;
+          const int64_t col_tile = tile % num_col_tiles;
+          const int64_t row = row_tile * kTransposeTileSize;
+          const int64_t col = col_tile * kTransposeTileSize;
+          TransposeTile<movement_size>(src_ptr + batch * matrix_size + row * cols + col, cols,
+                                       dst_ptr + batch * matrix_size + col * rows + row, rows,
+                                       std::min(kTransposeTileSize, rows - row),
+                                       std::min(kTransposeTileSize, cols - col));
+        }
+      },
+      CpuStream::ParallelForRowGrain(kTransposeTileSize * kTransposeTileSize));
+}
+
 template<size_t num_dims, size_t movement_size, typename IndexType>
-void PermuteKernel(PermuteKernelParams<num_dims, IndexType> params) {
+void PermuteKernel(CpuStream* cpu_stream, PermuteKernelParams<num_dims, IndexType> params) {
   using T = typename std::aligned_storage<movement_size, movement_size>::type;
   const T* src = reinterpret_cast<const T*>(params.src);
   T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
-    IndexType src_index[num_dims];
-    IndexType dst_index[num_dims];
-    params.dst_index_helper.OffsetToNdIndex(i, dst_index);
-    for (size_t dim = 0; dim < num_dims; ++dim) {
-      src_index[params.permutation[dim]] = dst_index[dim];
+  cpu_stream->ParallelFor(0, params.count, [&](int64_t begin, int64_t end) {
+    for (IndexType i = begin; i < end; ++i) {
+      IndexType src_index[num_dims];
+      IndexType dst_index[num_dims];
+      params.dst_index_helper.OffsetToNdIndex(i, dst_index);
+      for (size_t dim = 0; dim < num_dims; ++dim) {
+        src_index[params.permutation[dim]] = dst_index[dim];
+      }
+      IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
+      dst[i] = src[src_offset];
     }
-    IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    dst[i] = src[src_offset];
-  }
+  });
 }
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, const int64_t* src_dims, const void* src, const int* permutation,
                   void* dst, size_t count) {
+  CpuStream* cpu_stream = stream->As<CpuStream>();
+  // the simplified permutation of a (batched) matrix transpose
+  if (num_dims == 2 && permutation[0] == 1 && permutation[1] == 0) {
+    LaunchBatchTranspose<movement_size>(cpu_stream, 1, src_dims[0], src_dims[1], src, dst);
+    return;
+  }
+  if (num_dims == 3 && permutation[0] == 0 && permutation[1] == 2 && permutation[2] == 1) {
+    LaunchBatchTranspose<movement_size>(cpu_stream, src_dims[0], src_dims[1], src_dims[2], src,
+                                        dst);
+    return;
+  }
   PermuteKernelParams<num_dims, IndexType> params =
       MakePermuteParams<num_dims, IndexType>(src_dims, src, permutation, dst, count);
-  PermuteKernel<num_dims, movement_size, IndexType>(params);
+  PermuteKernel<num_dims, movement_size, IndexType>(cpu_stream, params);
 }
+
 class PermuteImpl : public Permute {
  public:
   OF_DISALLOW_COPY_AND_MOVE(PermuteImpl);
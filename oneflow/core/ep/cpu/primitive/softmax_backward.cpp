@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/softmax_backward.h"
 #include "oneflow/core/ep/include/primitive/log_softmax_backward.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/primitive/softmax_impl.h"
 #include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/cpu/cpu_device.h"
 #include "oneflow/core/ep/common/onednn.h"
@@ -28,39 +29,7 @@ namespace primitive {
 
 namespace {
 
-enum class Algorithm {
-  kSoftmax,
-  kLogSoftmax,
-};
-
-template<Algorithm algorithm, typename T>
-void SoftmaxBackwardCpu(size_t rows, size_t cols, const T* y, const T* dy, T* dx) {
-  for (size_t i = 0; i < rows; ++i) {
-    size_t row_offset = i * cols;
-    const T* row_y = y + row_offset;
-    const T* row_dy = dy + row_offset;
-    T* row_dx = dx + row_offset;
-    T row_sum = 0;
-    for (size_t j = 0; j < cols; ++j) {
-      if (algorithm == Algorithm::kSoftmax) {
-        row_sum += row_y[j] * row_dy[j];
-      } else if (algorithm == Algorithm::kLogSoftmax) {
-        row_sum += row_dy[j];
-      } else {
-        UNIMPLEMENTED();
-      }
-    }
-    for (size_t j = 0; j < cols; ++j) {
-      if (algorithm == Algorithm::kSoftmax) {
-        row_dx[j] = (row_dy[j] - row_sum) * row_y[j];
-      } else if (algorithm == Algorithm::kLogSoftmax) {
-        row_dx[j] = row_dy[j] - std::exp(row_y[j]) * row_sum;
-      } else {
-        UNIMPLEMENTED();
-      }
-    }
-  }
-}
+using softmax::Algorithm;
 
 template<typename SoftmaxBackwardBase, Algorithm algorithm, typename T>
 class SoftmaxBackwardImpl : public SoftmaxBackwardBase {
@@ -71,8 +40,13 @@ class SoftmaxBackwardImpl : public SoftmaxBackwardBase {
 
   void Launch(Stream* stream, size_t rows, size_t cols, const void* y, const void* dy,
               void* dx) override {
-    SoftmaxBackwardCpu<algorithm, T>(rows, cols, reinterpret_cast<const T*>(y),
-                                     reinterpret_cast<const T*>(dy), reinterpret_cast<T*>(dx));
+    using ComputeType = typename DefaultComputeType<T>::type;
+    softmax::DirectLoad<T, ComputeType> load_y(reinterpret_cast<const T*>(y), cols);
+    softmax::DirectLoad<T, ComputeType> load_dy(reinterpret_cast<const T*>(dy), cols);
+    softmax::DirectStore<ComputeType, T> store(reinterpret_cast<T*>(dx), cols);
+    softmax::DispatchSoftmaxGradAlgorithm<decltype(load_y), decltype(load_dy), decltype(store),
+                                          ComputeType, algorithm>(stream->As<CpuStream>(), load_y,
+                                                                  load_dy, store, rows, cols);
   }
 };
 
@@ -159,7 +133,8 @@ class GenericSoftmaxBackwardFactoryImpl : public BackwardFactoryBase {
   {type_proto, NewSoftmaxBackward<SoftmaxBackwardBase, algorithm, type_cpp>},
     static const std::map<DataType, std::function<std::unique_ptr<SoftmaxBackwardBase>()>>
         new_softmax_backward_handle{
-            OF_PP_FOR_EACH_TUPLE(MAKE_NEW_SOFTMAX_BACKWARD_ENTRY, CPU_PRIMITIVE_FLOATING_TYPE_SEQ)};
+            OF_PP_FOR_EACH_TUPLE(MAKE_NEW_SOFTMAX_BACKWARD_ENTRY,
+                                 CPU_PRIMITIVE_FLOATING_TYPE_SEQ CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ)};
 #undef MAKE_NEW_SOFTMAX_BACKWARD_ENTRY
 
 #ifdef WITH_ONEDNN
@@ -0,0 +1,249 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_PRIMITIVE_SOFTMAX_IMPL_H_
+#define ONEFLOW_CORE_EP_CPU_PRIMITIVE_SOFTMAX_IMPL_H_
+
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/primitive/vectorized_math_kernels.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace softmax {
+
+// Row softmax on CPU, the counterpart of cuda::softmax. The rows are spread over
+// CpuStream::ParallelFor, each row is loaded into a ComputeType buffer by LOAD and written back by
+// STORE, so that the fused kernels only differ in how they load and store a row:
+//
+//   struct Load {
+//     void Load(ComputeType* dst, int64_t row, int64_t cols) const;
+//   };
+//   struct Store {
+//     void Store(const ComputeType* src, int64_t row, int64_t cols) const;
+//   };
+
+enum class Algorithm {
+  kSoftmax,
+  kLogSoftmax,
+};
+
+// The row max and sum are computed in one pass over blocks of the row, the sum of the blocks seen
+// so far is rescaled whenever a block raises the max.
+constexpr int64_t kBlockSize = 1024;
+
+// x[i] = exp(x[i] - shift), returns the sum of the results.
+template<typename T>
+T ExpSubAndSum(T* x, int64_t n, T shift) {
+  T sum = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    x[i] = std::exp(x[i] - shift);
+    sum += x[i];
+  }
+  return sum;
+}
+
+#if defined(__SSE2__)
+
+template<>
+inline float ExpSubAndSum<float>(float* x, int64_t n, float shift) {
+  const __m128 shift4 = _mm_set1_ps(shift);
+  __m128 sum4 = _mm_setzero_ps();
+  int64_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m128 y = vectorized_math::internal::Exp<vectorized_math::internal::VecSse2>(
+        _mm_sub_ps(_mm_loadu_ps(x + i), shift4));
+    _mm_storeu_ps(x + i, y);
+    sum4 = _mm_add_ps(sum4, y);
+  }
+  float sum_lanes[4];
+  _mm_storeu_ps(sum_lanes, sum4);
+  float sum = (sum_lanes[0] + sum_lanes[1]) + (sum_lanes[2] + sum_lanes[3]);
+  for (; i < n; ++i) {
+    x[i] = std::exp(x[i] - shift);
+    sum += x[i];
+  }
+  return sum;
+}
+
+#endif  // defined(__SSE2__)
+
+template<typename T>
+T MaxOf(const T* x, int64_t n) {
+  T max = -std::numeric_limits<T>::infinity();
+  for (int64_t i = 0; i < n; ++i) { max = std::max(max, x[i]); }
+  return max;
+}
+
+template<typename LOAD, typename STORE, typename ComputeType, Algorithm algorithm>
+void SoftmaxRows(LOAD load, STORE store, int64_t begin, int64_t end, int64_t cols) {
+  const int64_t num_blocks = (cols + kBlockSize - 1) / kBlockSize;
+  std::vector<ComputeType> row_buf(cols);
+  std::vector<ComputeType> exp_buf(algorithm == Algorithm::kLogSoftmax ? kBlockSize : 0);
+  std::vector<ComputeType> block_max(num_blocks);
+  ComputeType* x = row_buf.data();
+  for (int64_t row = begin; row < end; ++row) {
+    load.Load(x, row, cols);
+    ComputeType row_max = -std::numeric_limits<ComputeType>::infinity();
+    ComputeType row_sum = 0;
+    for (int64_t block = 0; block < num_blocks; ++block) {
+      ComputeType* block_x = x + block * kBlockSize;
+      const int64_t n = std::min(kBlockSize, cols - block * kBlockSize);
+      const ComputeType max = std::max(row_max, MaxOf(block_x, n));
+      if (max == -std::numeric_limits<ComputeType>::infinity()) {
+        // the row is -inf so far (e.g. a masked prefix), its exps are 0 and exp(max - max) would
+        // be NaN
+        if (algorithm == Algorithm::kSoftmax) { std::fill(block_x, block_x + n, 0); }
+        block_max[block] = max;
+        continue;
+      }
+      if (max != row_max) { row_sum *= std::exp(row_max - max); }
+      if (algorithm == Algorithm::kSoftmax) {
+        row_sum += ExpSubAndSum(block_x, n, max);
+      } else {
+        std::copy(block_x, block_x + n, exp_buf.data());
+        row_sum += ExpSubAndSum(exp_buf.data(), n, max);
+      }
+      block_max[block] = max;
+      row_max = max;
+    }
+    if (algorithm == Algorithm::kSoftmax) {
+      // the exps of each block are relative to the max when the block was visited
+      for (int64_t block = 0; block < num_blocks; ++block) {
+        ComputeType* block_x = x + block * kBlockSize;
+        const int64_t n = std::min(kBlockSize, cols - block * kBlockSize);
+        const ComputeType scale = std::exp(block_max[block] - row_max) / row_sum;
+        for (int64_t i = 0; i < n; ++i) { block_x[i] *= scale; }
+      }
+    } else {
+      const ComputeType shift = row_max + std::log(row_sum);
+      for (int64_t i = 0; i < cols; ++i) { x[i] -= shift; }
+    }
+    store.Store(x, row, cols);
+  }
+}
+
+template<typename LOAD_Y, typename LOAD_DY, typename STORE, typename ComputeType,
+         Algorithm algorithm>
+void SoftmaxGradRows(LOAD_Y load_y, LOAD_DY load_dy, STORE store, int64_t begin, int64_t end,
+                     int64_t cols) {
+  std::vector<ComputeType> y_buf(cols);
+  std::vector<ComputeType> dy_buf(cols);
+  ComputeType* y = y_buf.data();
+  ComputeType* dy = dy_buf.data();
+  for (int64_t row = begin; row < end; ++row) {
+    load_y.Load(y, row, cols);
+    load_dy.Load(dy, row, cols);
+    ComputeType row_sum = 0;
+    if (algorithm == Algorithm::kSoftmax) {
+      for (int64_t i = 0; i < cols; ++i) { row_sum += y[i] * dy[i]; }
+      for (int64_t i = 0; i < cols; ++i) { dy[i] = (dy[i] - row_sum) * y[i]; }
+    } else {
+      for (int64_t i = 0; i < cols; ++i) { row_sum += dy[i]; }
+      ExpSubAndSum<ComputeType>(y, cols, 0);
+      for (int64_t i = 0; i < cols; ++i) { dy[i] -= y[i] * row_sum; }
+    }
+    store.Store(dy, row, cols);
+  }
+}
+
+template<typename SRC, typename DST>
+struct DirectLoad {
+  DirectLoad(const SRC* src, int64_t row_size) : src(src), row_size(row_size) {}
+  void Load(DST* dst, int64_t row, int64_t cols) const {
+    const SRC* row_src = src + row * row_size;
+    for (int64_t i = 0; i < cols; ++i) { dst[i] = static_cast<DST>(row_src[i]); }
+  }
+  const SRC* src;
+  int64_t row_size;
+};
+
+template<typename SRC, typename DST>
+struct DirectStore {
+  DirectStore(DST* dst, int64_t row_size) : dst(dst), row_size(row_size) {}
+  void Store(const SRC* src, int64_t row, int64_t cols) const {
+    DST* row_dst = dst + row * row_size;
+    for (int64_t i = 0; i < cols; ++i) { row_dst[i] = static_cast<DST>(src[i]); }
+  }
+  DST* dst;
+  int64_t row_size;
+};
+
+template<typename LOAD, typename STORE, typename ComputeType, Algorithm algorithm>
+void DispatchSoftmaxAlgorithm(CpuStream* stream, LOAD load, STORE store, int64_t rows,
+                              int64_t cols) {
+  if (rows == 0 || cols == 0) { return; }
+  stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        SoftmaxRows<LOAD, STORE, ComputeType, algorithm>(load, store, begin, end, cols);
+      },
+      CpuStream::ParallelForRowGrain(cols));
+}
+
+template<typename LOAD, typename STORE, typename ComputeType>
+void DispatchSoftmax(CpuStream* stream, LOAD load, STORE store, int64_t rows, int64_t cols) {
+  DispatchSoftmaxAlgorithm<LOAD, STORE, ComputeType, Algorithm::kSoftmax>(stream, load, store,
+                                                                          rows, cols);
+}
+
+template<typename LOAD, typename STORE, typename ComputeType>
+void DispatchLogSoftmax(CpuStream* stream, LOAD load, STORE store, int64_t rows, int64_t cols) {
+  DispatchSoftmaxAlgorithm<LOAD, STORE, ComputeType, Algorithm::kLogSoftmax>(stream, load, store,
+                                                                             rows, cols);
+}
+
+template<typename LOAD_Y, typename LOAD_DY, typename STORE, typename ComputeType,
+         Algorithm algorithm>
+void DispatchSoftmaxGradAlgorithm(CpuStream* stream, LOAD_Y load_y, LOAD_DY load_dy, STORE store,
+                                  int64_t rows, int64_t cols) {
+  if (rows == 0 || cols == 0) { return; }
+  stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        SoftmaxGradRows<LOAD_Y, LOAD_DY, STORE, ComputeType, algorithm>(load_y, load_dy, store,
+                                                                        begin, end, cols);
+      },
+      CpuStream::ParallelForRowGrain(cols));
+}
+
+template<typename LOAD_Y, typename LOAD_DY, typename STORE, typename ComputeType>
+void DispatchSoftmaxGrad(CpuStream* stream, LOAD_Y load_y, LOAD_DY load_dy, STORE store,
+                         int64_t rows, int64_t cols) {
+  DispatchSoftmaxGradAlgorithm<LOAD_Y, LOAD_DY, STORE, ComputeType, Algorithm::kSoftmax>(
+      stream, load_y, load_dy, store, rows, cols);
+}
+
+template<typename LOAD_Y, typename LOAD_DY, typename STORE, typename ComputeType>
+void DispatchLogSoftmaxGrad(CpuStream* stream, LOAD_Y load_y, LOAD_DY load_dy, STORE store,
+                            int64_t rows, int64_t cols) {
+  DispatchSoftmaxGradAlgorithm<LOAD_Y, LOAD_DY, STORE, ComputeType, Algorithm::kLogSoftmax>(
+      stream, load_y, load_dy, store, rows, cols);
+}
+
+}  // namespace softmax
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_PRIMITIVE_SOFTMAX_IMPL_H_
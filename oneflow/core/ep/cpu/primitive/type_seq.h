@@ -35,6 +35,7 @@ limitations under the License.
 #define CPU_PRIMITIVE_FLOAT_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(float, DataType::kFloat)
 #define CPU_PRIMITIVE_DOUBLE_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(double, DataType::kDouble)
 #define CPU_PRIMITIVE_FLOAT16_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(float16, DataType::kFloat16)
+#define CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ OF_PP_MAKE_TUPLE_SEQ(bfloat16, DataType::kBFloat16)
 
 #define CPU_PRIMITIVE_ONEDNN_BOOl_TYPE_SEQ \
   OF_PP_MAKE_TUPLE_SEQ(dnnl::memory::data_type::u8, DataType::kBool)
@@ -63,10 +64,37 @@ limitations under the License.
 
 #define CPU_PRIMITIVE_ALL_TYPE_SEQ \
   CPU_PRIMITIVE_NATIVE_TYPE_SEQ    \
-  CPU_PRIMITIVE_FLOAT16_TYPE_SEQ
+  CPU_PRIMITIVE_FLOAT16_TYPE_SEQ   \
+  CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ
 
 #define CPU_PRIMITIVE_FLOATING_TYPE_SEQ \
   CPU_PRIMITIVE_FLOAT_TYPE_SEQ          \
   CPU_PRIMITIVE_DOUBLE_TYPE_SEQ
 
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+// Type used for accumulation by CPU primitives, reduced precision types are widened to float.
+template<typename T>
+struct DefaultComputeType {
+  using type = T;
+};
+
+template<>
+struct DefaultComputeType<float16> {
+  using type = float;
+};
+
+template<>
+struct DefaultComputeType<bfloat16> {
+  using type = float;
+};
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
 #endif  // ONEFLOW_CORE_EP_CPU_PRIMITIVE_TYPE_SEQ_H_
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/ep/common/primitive/unary_functor.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
 #include <cmath>
 
 namespace oneflow {
@@ -38,6 +39,62 @@ struct UnaryFunctor<DeviceType::kCPU, UnaryOp::kTanh, Dst, Src> {
   OF_DEVICE_FUNC Dst operator()(Src src) const { return std::tanh(src); }
 };
 
+#define SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(op)                         \
+  template<>                                                                  \
+  struct UnaryFunctor<DeviceType::kCPU, op, bfloat16, bfloat16> {             \
+    UnaryFunctor(Scalar attr0, Scalar attr1) : float_functor(attr0, attr1) {} \
+                                                                              \
+    UnaryFunctor<DeviceType::kCPU, op, float, float> float_functor;           \
+    OF_DEVICE_FUNC bfloat16 operator()(bfloat16 src) const {                  \
+      return static_cast<bfloat16>(float_functor(static_cast<float>(src)));   \
+    }                                                                         \
+  };
+
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kRelu);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kElu);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kCelu);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kGelu);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kHardSwish);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kHardSigmoid);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kHardShrink);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kHardTanh);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kLeakyRelu);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kMish);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kSelu);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kSilu);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kSoftShrink);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kSoftSign);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kSoftPlus);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kTanh);
+SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR(UnaryOp::kThreshold);
+
+#undef SPECIALIZATION_CPU_BFLOAT16_UNARY_FUNCTOR
+
+// Ops whose whole arrays are computed by the vectorized_math functions instead of the functors
+// above, element by element.
+template<UnaryOp unary_op, typename Dst, typename Src>
+struct VectorizedUnaryFunctor {
+  static constexpr bool value = false;
+};
+
+#define SPECIALIZATION_CPU_VECTORIZED_UNARY_FUNCTOR(op, func, type) \
+  template<>                                                        \
+  struct VectorizedUnaryFunctor<op, type, type> {                   \
+    static constexpr bool value = true;                             \
+    static void Apply(const type* src, type* dst, int64_t n) {      \
+      vectorized_math::func(src, dst, n);                           \
+    }                                                               \
+  };
+
+SPECIALIZATION_CPU_VECTORIZED_UNARY_FUNCTOR(UnaryOp::kGelu, Gelu, float);
+SPECIALIZATION_CPU_VECTORIZED_UNARY_FUNCTOR(UnaryOp::kGelu, Gelu, bfloat16);
+SPECIALIZATION_CPU_VECTORIZED_UNARY_FUNCTOR(UnaryOp::kSilu, Silu, float);
+SPECIALIZATION_CPU_VECTORIZED_UNARY_FUNCTOR(UnaryOp::kSilu, Silu, bfloat16);
+SPECIALIZATION_CPU_VECTORIZED_UNARY_FUNCTOR(UnaryOp::kTanh, Tanh, float);
+SPECIALIZATION_CPU_VECTORIZED_UNARY_FUNCTOR(UnaryOp::kTanh, Tanh, bfloat16);
+
+#undef SPECIALIZATION_CPU_VECTORIZED_UNARY_FUNCTOR
+
 }  // namespace primitive
 }  // namespace ep
 }  // namespace oneflow
@@ -0,0 +1,142 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include "oneflow/core/ep/cpu/primitive/vectorized_math_kernels.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+namespace vectorized_math {
+
+namespace {
+
+Isa DetectIsa() {
+#if defined(OF_VECTORIZED_MATH_X86_64)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) { return Isa::kAvx512; }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { return Isa::kAvx2; }
+  return Isa::kSse2;
+#else
+  return Isa::kScalar;
+#endif  // defined(OF_VECTORIZED_MATH_X86_64)
+}
+
+Isa IsaFromEnv() {
+  const std::string isa = GetStringFromEnv("ONEFLOW_EP_CPU_VECTORIZED_MATH_ISA", "avx512");
+  if (isa == "scalar") { return Isa::kScalar; }
+  if (isa == "sse2") { return Isa::kSse2; }
+  if (isa == "avx2") { return Isa::kAvx2; }
+  CHECK_EQ(isa, "avx512") << "ONEFLOW_EP_CPU_VECTORIZED_MATH_ISA must be one of scalar, sse2, "
+                             "avx2 and avx512";
+  return Isa::kAvx512;
+}
+
+template<typename F>
+void ComputeBfloat16(F func, const bfloat16* x, bfloat16* y, int64_t n) {
+  constexpr int64_t kChunkSize = 256;
+  float buf[kChunkSize];
+  const Isa isa = CurrentIsa();
+  for (int64_t i = 0; i < n; i += kChunkSize) {
+    const int64_t chunk_size = std::min(kChunkSize, n - i);
+    for (int64_t j = 0; j < chunk_size; ++j) { buf[j] = static_cast<float>(x[i + j]); }
+    func(isa, buf, buf, chunk_size);
+    for (int64_t j = 0; j < chunk_size; ++j) { y[i + j] = static_cast<bfloat16>(buf[j]); }
+  }
+}
+
+}  // namespace
+
+Isa MaxIsa() {
+  static const Isa isa = DetectIsa();
+  return isa;
+}
+
+Isa CurrentIsa() {
+  static const Isa isa = std::min(MaxIsa(), IsaFromEnv());
+  return isa;
+}
+
+namespace internal {
+
+float ExpOp::ComputeScalar(float x) { return std::exp(x); }
+float LogOp::ComputeScalar(float x) { return std::log(x); }
+float SigmoidOp::ComputeScalar(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+float TanhOp::ComputeScalar(float x) { return std::tanh(x); }
+float ErfOp::ComputeScalar(float x) { return std::erf(x); }
+float GeluOp::ComputeScalar(float x) {
+  return 0.5f * x * std::erfc(x * -0.707106781186547524f);
+}
+float SiluOp::ComputeScalar(float x) { return x / (1.0f + std::exp(-x)); }
+float SinOp::ComputeScalar(float x) { return std::sin(x); }
+float CosOp::ComputeScalar(float x) { return std::cos(x); }
+
+#if defined(OF_VECTORIZED_MATH_X86_64)
+
+#define DEFINE_SSE2_VECTORIZED_MATH_FUNC(func)           \
+  void Sse2##func(const float* x, float* y, int64_t n) { \
+    VectorLoop<VecSse2, func##Op>(x, y, n);              \
+  }
+
+OF_PP_FOR_EACH_TUPLE(DEFINE_SSE2_VECTORIZED_MATH_FUNC, VECTORIZED_MATH_FUNC_SEQ)
+
+#undef DEFINE_SSE2_VECTORIZED_MATH_FUNC
+
+#endif  // defined(OF_VECTORIZED_MATH_X86_64)
+
+}  // namespace internal
+
+#if defined(OF_VECTORIZED_MATH_X86_64)
+
+#define DISPATCH_X86_64_VECTORIZED_MATH_FUNC(func)           \
+  case Isa::kAvx512: return internal::Avx512##func(x, y, n); \
+  case Isa::kAvx2: return internal::Avx2##func(x, y, n);     \
+  case Isa::kSse2: return internal::Sse2##func(x, y, n);
+
+#else
+
+#define DISPATCH_X86_64_VECTORIZED_MATH_FUNC(func)
+
+#endif  // defined(OF_VECTORIZED_MATH_X86_64)
+
+#define DEFINE_VECTORIZED_MATH_FUNC(func)                                         \
+  void func(Isa isa, const float* x, float* y, int64_t n) {                       \
+    CHECK_LE(static_cast<int>(isa), static_cast<int>(MaxIsa()));                  \
+    switch (isa) {                                                                \
+      DISPATCH_X86_64_VECTORIZED_MATH_FUNC(func)                                  \
+      default: return internal::ScalarLoop<internal::func##Op>(x, y, n);          \
+    }                                                                             \
+  }                                                                               \
+                                                                                  \
+  void func(const float* x, float* y, int64_t n) { func(CurrentIsa(), x, y, n); } \
+                                                                                  \
+  void func(const bfloat16* x, bfloat16* y, int64_t n) {                          \
+    ComputeBfloat16(                                                              \
+        [](Isa isa, const float* x, float* y, int64_t n) { func(isa, x, y, n); }, \
+        x, y, n);                                                                 \
+  }
+
+OF_PP_FOR_EACH_TUPLE(DEFINE_VECTORIZED_MATH_FUNC, VECTORIZED_MATH_FUNC_SEQ)
+
+#undef DEFINE_VECTORIZED_MATH_FUNC
+#undef DISPATCH_X86_64_VECTORIZED_MATH_FUNC
+
+}  // namespace vectorized_math
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_H_
+#define ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_H_
+
+#include "oneflow/core/common/preprocessor.h"
+#include "oneflow/core/common/bfloat16.h"
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(__GNUC__)
+#define OF_VECTORIZED_MATH_X86_64
+#endif
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+// SIMD versions of the transcendental functions used by the cpu elementwise kernels. The functions
+// are evaluated by polynomial approximations on 4 (sse2), 8 (avx2) or 16 (avx512)
+// floats at once, the widest isa the cpu supports is picked at runtime. bfloat16 inputs are
+// converted to float in chunks. Off x86-64 the functions fall back to the scalar <cmath> ones.
+//
+// The max error against the correctly rounded results, measured over every 37th float:
+//   Exp      1.3 ulp   subnormal results included
+//   Log      0.8 ulp
+//   Sigmoid  3.1 ulp   0 for x < -88.7, where the result is subnormal
+//   Tanh     1.4 ulp
+//   Erf      2.6 ulp
+//   Gelu     16 ulp    for x >= -3, the error grows with x^2 below, 240 ulp at x = -12
+//   Silu     3 ulp     -0 for x < -88.7
+//   Sin      2.4 ulp   for |x| <= 8192, larger inputs are computed by std::sin
+//   Cos      2.4 ulp   for |x| <= 8192, larger inputs are computed by std::cos
+// Specials follow <cmath>: NaNs are propagated, exp(-inf) = 0, log(0) = -inf, log(x < 0) = NaN.
+namespace vectorized_math {
+
+enum class Isa { kScalar = 0, kSse2, kAvx2, kAvx512 };
+
+// The widest isa supported by both the build and the cpu.
+Isa MaxIsa();
+
+// The isa the functions run with, MaxIsa() capped by the env ONEFLOW_EP_CPU_VECTORIZED_MATH_ISA
+// (scalar, sse2, avx2 or avx512).
+Isa CurrentIsa();
+
+#define VECTORIZED_MATH_FUNC_SEQ \
+  OF_PP_MAKE_TUPLE_SEQ(Exp)      \
+  OF_PP_MAKE_TUPLE_SEQ(Log)      \
+  OF_PP_MAKE_TUPLE_SEQ(Sigmoid)  \
+  OF_PP_MAKE_TUPLE_SEQ(Tanh)     \
+  OF_PP_MAKE_TUPLE_SEQ(Erf)      \
+  OF_PP_MAKE_TUPLE_SEQ(Gelu)     \
+  OF_PP_MAKE_TUPLE_SEQ(Silu)     \
+  OF_PP_MAKE_TUPLE_SEQ(Sin)      \
+  OF_PP_MAKE_TUPLE_SEQ(Cos)
+
+// y[i] = func(x[i]) for i in [0, n), x and y may be the same array. The overload taking an isa
+// runs with the given one, which must not be wider than MaxIsa().
+#define DECLARE_VECTORIZED_MATH_FUNC(func)              \
+  void func(const float* x, float* y, int64_t n);       \
+  void func(const bfloat16* x, bfloat16* y, int64_t n); \
+  void func(Isa isa, const float* x, float* y, int64_t n);
+
+OF_PP_FOR_EACH_TUPLE(DECLARE_VECTORIZED_MATH_FUNC, VECTORIZED_MATH_FUNC_SEQ)
+
+#undef DECLARE_VECTORIZED_MATH_FUNC
+
+}  // namespace vectorized_math
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_H_
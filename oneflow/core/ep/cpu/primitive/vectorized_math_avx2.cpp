@@ -0,0 +1,111 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include <cmath>
+#include <limits>
+
+#if defined(OF_VECTORIZED_MATH_X86_64)
+
+#include <immintrin.h>
+
+// Everything below is compiled for avx2 and fma, the headers are all included ahead so that no
+// inline function shared with other translation units is. The functions are only called once
+// MaxIsa() has checked the cpu.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif  // defined(__clang__)
+
+#include "oneflow/core/ep/cpu/primitive/vectorized_math_kernels.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+namespace vectorized_math {
+
+namespace internal {
+
+namespace {
+
+struct VecAvx2 {
+  using Reg = __m256;
+  using Mask = __m256;
+  static constexpr int kSize = 8;
+
+  static Reg Load(const float* p) { return _mm256_loadu_ps(p); }
+  static void Store(float* p, Reg x) { _mm256_storeu_ps(p, x); }
+  static Reg Set1(float v) { return _mm256_set1_ps(v); }
+  static Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+  static Reg MulAdd(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+  static Reg Min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+  static Reg Max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+  static Reg Abs(Reg x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+  static Reg SignBit(Reg x) { return _mm256_and_ps(_mm256_set1_ps(-0.0f), x); }
+  static Reg Xor(Reg a, Reg b) { return _mm256_xor_ps(a, b); }
+  static Reg Round(Reg x) { return _mm256_cvtepi32_ps(_mm256_cvtps_epi32(x)); }
+  static Mask CmpLt(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static Mask CmpGt(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static Mask CmpEq(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static Mask IsNan(Reg x) { return _mm256_cmp_ps(x, x, _CMP_UNORD_Q); }
+  static Mask MaskOr(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+  static bool Any(Mask m) { return _mm256_movemask_ps(m) != 0; }
+  static Reg Select(Mask m, Reg a, Reg b) { return _mm256_blendv_ps(b, a, m); }
+  static Reg Pow2(Reg n) {
+    const __m256i biased = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(biased, 23));
+  }
+  static Reg Exponent(Reg x) {
+    const __m256i bits = _mm256_srli_epi32(_mm256_castps_si256(x), 23);
+    return _mm256_cvtepi32_ps(_mm256_sub_epi32(bits, _mm256_set1_epi32(126)));
+  }
+  static Reg Mantissa(Reg x) {
+    const __m256i bits = _mm256_and_si256(_mm256_castps_si256(x), _mm256_set1_epi32(0x007fffff));
+    return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(0x3f000000)));
+  }
+};
+
+}  // namespace
+
+#define DEFINE_AVX2_VECTORIZED_MATH_FUNC(func)           \
+  void Avx2##func(const float* x, float* y, int64_t n) { \
+    VectorLoop<VecAvx2, func##Op>(x, y, n);              \
+  }
+
+OF_PP_FOR_EACH_TUPLE(DEFINE_AVX2_VECTORIZED_MATH_FUNC, VECTORIZED_MATH_FUNC_SEQ)
+
+#undef DEFINE_AVX2_VECTORIZED_MATH_FUNC
+
+}  // namespace internal
+
+}  // namespace vectorized_math
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif  // defined(__clang__)
+
+#endif  // defined(OF_VECTORIZED_MATH_X86_64)
@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include <cmath>
+#include <limits>
+
+#if defined(OF_VECTORIZED_MATH_X86_64)
+
+#include <immintrin.h>
+
+// Everything below is compiled for avx512f, see vectorized_math_avx2.cpp.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif  // defined(__clang__)
+
+#include "oneflow/core/ep/cpu/primitive/vectorized_math_kernels.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+namespace vectorized_math {
+
+namespace internal {
+
+namespace {
+
+// Only avx512f is required, the bitwise float ops go through the integer ones since the float
+// ones are avx512dq.
+struct VecAvx512 {
+  using Reg = __m512;
+  using Mask = __mmask16;
+  static constexpr int kSize = 16;
+
+  static Reg Load(const float* p) { return _mm512_loadu_ps(p); }
+  static void Store(float* p, Reg x) { _mm512_storeu_ps(p, x); }
+  static Reg Set1(float v) { return _mm512_set1_ps(v); }
+  static Reg Add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm512_div_ps(a, b); }
+  static Reg MulAdd(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+  static Reg Min(Reg a, Reg b) { return _mm512_min_ps(a, b); }
+  static Reg Max(Reg a, Reg b) { return _mm512_max_ps(a, b); }
+  static Reg Abs(Reg x) { return _mm512_abs_ps(x); }
+  static Reg SignBit(Reg x) {
+    return _mm512_castsi512_ps(
+        _mm512_and_epi32(_mm512_castps_si512(x), _mm512_set1_epi32(0x80000000)));
+  }
+  static Reg Xor(Reg a, Reg b) {
+    return _mm512_castsi512_ps(_mm512_xor_epi32(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+  }
+  static Reg Round(Reg x) { return _mm512_cvtepi32_ps(_mm512_cvtps_epi32(x)); }
+  static Mask CmpLt(Reg a, Reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+  static Mask CmpGt(Reg a, Reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+  static Mask CmpEq(Reg a, Reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+  static Mask IsNan(Reg x) { return _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q); }
+  static Mask MaskOr(Mask a, Mask b) { return _mm512_kor(a, b); }
+  static bool Any(Mask m) { return m != 0; }
+  static Reg Select(Mask m, Reg a, Reg b) { return _mm512_mask_blend_ps(m, b, a); }
+  static Reg Pow2(Reg n) {
+    const __m512i biased = _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(biased, 23));
+  }
+  static Reg Exponent(Reg x) {
+    const __m512i bits = _mm512_srli_epi32(_mm512_castps_si512(x), 23);
+    return _mm512_cvtepi32_ps(_mm512_sub_epi32(bits, _mm512_set1_epi32(126)));
+  }
+  static Reg Mantissa(Reg x) {
+    const __m512i bits = _mm512_and_epi32(_mm512_castps_si512(x), _mm512_set1_epi32(0x007fffff));
+    return _mm512_castsi512_ps(_mm512_or_epi32(bits, _mm512_set1_epi32(0x3f000000)));
+  }
+};
+
+}  // namespace
+
+#define DEFINE_AVX512_VECTORIZED_MATH_FUNC(func)           \
+  void Avx512##func(const float* x, float* y, int64_t n) { \
+    VectorLoop<VecAvx512, func##Op>(x, y, n);              \
+  }
+
+OF_PP_FOR_EACH_TUPLE(DEFINE_AVX512_VECTORIZED_MATH_FUNC, VECTORIZED_MATH_FUNC_SEQ)
+
+#undef DEFINE_AVX512_VECTORIZED_MATH_FUNC
+
+}  // namespace internal
+
+}  // namespace vectorized_math
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif  // defined(__clang__)
+
+#endif  // defined(OF_VECTORIZED_MATH_X86_64)
@@ -0,0 +1,385 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_KERNELS_H_
+#define ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_KERNELS_H_
+
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include <cmath>
+#include <limits>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif  // defined(__SSE2__)
+
+// The approximations of vectorized_math.h, written once against a vector type V of V::kSize floats
+// and instantiated for each isa. V provides:
+//   Reg, Mask                       the float vector and the lane mask types
+//   Load, Store, Set1               unaligned load and store, broadcast
+//   Add, Sub, Mul, Div, MulAdd      MulAdd(a, b, c) = a * b + c, fused or not
+//   Min, Max                        returning the second operand when either one is NaN
+//   Abs, SignBit, Xor               bitwise, SignBit keeps only the sign bit
+//   Round                           to the nearest integer, ties to even, for |x| < 2^31
+//   CmpLt, CmpGt, CmpEq, IsNan      ordered compares
+//   MaskOr, Any, Select             Select(m, a, b) takes a where m is set
+//   Pow2                            2^n for an integral n in [-126, 127]
+//   Exponent, Mantissa              x = Mantissa(x) * 2^Exponent(x), Mantissa in [0.5, 1), for
+//                                   a positive normal x
+// All the code here is header only and inline, so that the isa specific translation units can
+// compile it for their isa.
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+namespace vectorized_math {
+
+namespace internal {
+
+template<typename V>
+inline typename V::Reg Floor(typename V::Reg x) {
+  const typename V::Reg rounded = V::Round(x);
+  return V::Sub(rounded, V::Select(V::CmpGt(rounded, x), V::Set1(1.0f), V::Set1(0.0f)));
+}
+
+// exp(x) = 2^n * exp(r) with n = round(x / ln2) and |r| <= ln2 / 2, ln2 being split in two so that
+// n * ln2 is exact. exp(r) is the Cephes expf polynomial. 2^n is applied in two halves so that the
+// results overflow to inf past the float max and are subnormal below the normal min.
+template<typename V>
+inline typename V::Reg Exp(typename V::Reg x) {
+  using Reg = typename V::Reg;
+  x = V::Min(V::Set1(88.8f), x);
+  x = V::Max(V::Set1(-104.0f), x);
+  const Reg n = V::Round(V::Mul(x, V::Set1(1.44269504088896341f)));
+  Reg r = V::Sub(x, V::Mul(n, V::Set1(0.693359375f)));
+  r = V::Sub(r, V::Mul(n, V::Set1(-2.12194440e-4f)));
+  Reg p = V::Set1(1.9875691500e-4f);
+  p = V::MulAdd(p, r, V::Set1(1.3981999507e-3f));
+  p = V::MulAdd(p, r, V::Set1(8.3334519073e-3f));
+  p = V::MulAdd(p, r, V::Set1(4.1665795894e-2f));
+  p = V::MulAdd(p, r, V::Set1(1.6666665459e-1f));
+  p = V::MulAdd(p, r, V::Set1(5.0000001201e-1f));
+  p = V::MulAdd(p, V::Mul(r, r), V::Add(r, V::Set1(1.0f)));
+  const Reg n0 = V::Round(V::Mul(n, V::Set1(0.5f)));
+  return V::Mul(V::Mul(p, V::Pow2(n0)), V::Pow2(V::Sub(n, n0)));
+}
+
+// log(x) = e * ln2 + log(m) with x = m * 2^e and m in [sqrt(0.5), sqrt(2)), log(m) is the Cephes
+// logf polynomial in m - 1.
+template<typename V>
+inline typename V::Reg Log(typename V::Reg x) {
+  using Reg = typename V::Reg;
+  using Mask = typename V::Mask;
+  const Reg zero = V::Set1(0.0f);
+  const Reg one = V::Set1(1.0f);
+  const Mask subnormal = V::CmpLt(x, V::Set1(std::numeric_limits<float>::min()));
+  const Reg normal_x = V::Select(subnormal, V::Mul(x, V::Set1(8388608.0f)), x);
+  Reg e = V::Sub(V::Exponent(normal_x), V::Select(subnormal, V::Set1(23.0f), zero));
+  Reg m = V::Mantissa(normal_x);
+  const Mask below_sqrt_half = V::CmpLt(m, V::Set1(0.707106781186547524f));
+  e = V::Sub(e, V::Select(below_sqrt_half, one, zero));
+  m = V::Sub(V::Add(m, V::Select(below_sqrt_half, m, zero)), one);
+  const Reg z = V::Mul(m, m);
+  Reg p = V::Set1(7.0376836292e-2f);
+  p = V::MulAdd(p, m, V::Set1(-1.1514610310e-1f));
+  p = V::MulAdd(p, m, V::Set1(1.1676998740e-1f));
+  p = V::MulAdd(p, m, V::Set1(-1.2420140846e-1f));
+  p = V::MulAdd(p, m, V::Set1(1.4249322787e-1f));
+  p = V::MulAdd(p, m, V::Set1(-1.6668057665e-1f));
+  p = V::MulAdd(p, m, V::Set1(2.0000714765e-1f));
+  p = V::MulAdd(p, m, V::Set1(-2.4999993993e-1f));
+  p = V::MulAdd(p, m, V::Set1(3.3333331174e-1f));
+  Reg y = V::Mul(V::Mul(p, m), z);
+  y = V::MulAdd(e, V::Set1(-2.12194440e-4f), y);
+  y = V::MulAdd(z, V::Set1(-0.5f), y);
+  y = V::MulAdd(e, V::Set1(0.693359375f), V::Add(m, y));
+  y = V::Select(V::CmpEq(x, V::Set1(std::numeric_limits<float>::infinity())), x, y);
+  y = V::Select(V::CmpEq(x, zero), V::Set1(-std::numeric_limits<float>::infinity()), y);
+  return V::Select(V::MaskOr(V::CmpLt(x, zero), V::IsNan(x)),
+                   V::Set1(std::numeric_limits<float>::quiet_NaN()), y);
+}
+
+template<typename V>
+inline typename V::Reg Sigmoid(typename V::Reg x) {
+  const typename V::Reg one = V::Set1(1.0f);
+  return V::Div(one, V::Add(one, Exp<V>(V::Xor(x, V::Set1(-0.0f)))));
+}
+
+// The Cephes tanhf polynomial for |x| < 0.625 and 1 - 2 / (exp(2|x|) + 1) above, computed on |x|
+// then given the sign of x.
+template<typename V>
+inline typename V::Reg Tanh(typename V::Reg x) {
+  using Reg = typename V::Reg;
+  const Reg one = V::Set1(1.0f);
+  const Reg abs_x = V::Abs(x);
+  const Reg z = V::Mul(x, x);
+  Reg p = V::Set1(-5.70498872745e-3f);
+  p = V::MulAdd(p, z, V::Set1(2.06390887954e-2f));
+  p = V::MulAdd(p, z, V::Set1(-5.37397155531e-2f));
+  p = V::MulAdd(p, z, V::Set1(1.33314422036e-1f));
+  p = V::MulAdd(p, z, V::Set1(-3.33332819422e-1f));
+  const Reg small = V::MulAdd(V::Mul(p, z), abs_x, abs_x);
+  const Reg exp_2x = Exp<V>(V::Add(abs_x, abs_x));
+  const Reg large = V::Sub(one, V::Div(V::Set1(2.0f), V::Add(exp_2x, one)));
+  return V::Xor(V::Select(V::CmpLt(abs_x, V::Set1(0.625f)), small, large), V::SignBit(x));
+}
+
+// erf(x) = x * T(x^2) for |x| < 1, the Cephes erff polynomial.
+template<typename V>
+inline typename V::Reg ErfSmall(typename V::Reg x) {
+  const typename V::Reg z = V::Mul(x, x);
+  typename V::Reg t = V::Set1(7.853861353153693e-5f);
+  t = V::MulAdd(t, z, V::Set1(-8.010193625184903e-4f));
+  t = V::MulAdd(t, z, V::Set1(5.188327685732524e-3f));
+  t = V::MulAdd(t, z, V::Set1(-2.685381193529856e-2f));
+  t = V::MulAdd(t, z, V::Set1(1.128358514861418e-1f));
+  t = V::MulAdd(t, z, V::Set1(-3.761262582423300e-1f));
+  t = V::MulAdd(t, z, V::Set1(1.128379165726710f));
+  return V::Mul(x, t);
+}
+
+// erfc(|x|) = exp(-x^2) / |x| * P(1 / x^2) for |x| >= 1, the Cephes erfcf polynomials on [1, 2)
+// and [2, inf).
+template<typename V>
+inline typename V::Reg ErfcLarge(typename V::Reg x) {
+  using Reg = typename V::Reg;
+  const Reg abs_x = V::Abs(x);
+  const Reg q = V::Div(V::Set1(1.0f), abs_x);
+  const Reg w = V::Mul(q, q);
+  Reg p = V::Set1(2.326819970068386e-2f);
+  p = V::MulAdd(p, w, V::Set1(-1.387039388740657e-1f));
+  p = V::MulAdd(p, w, V::Set1(3.687424674597105e-1f));
+  p = V::MulAdd(p, w, V::Set1(-5.824733027278666e-1f));
+  p = V::MulAdd(p, w, V::Set1(6.210004621745983e-1f));
+  p = V::MulAdd(p, w, V::Set1(-4.944515323274145e-1f));
+  p = V::MulAdd(p, w, V::Set1(3.404879937665872e-1f));
+  p = V::MulAdd(p, w, V::Set1(-2.741127028184656e-1f));
+  p = V::MulAdd(p, w, V::Set1(5.638259427386472e-1f));
+  Reg r = V::Set1(-1.047766399936249e1f);
+  r = V::MulAdd(r, w, V::Set1(1.297719955372516e1f));
+  r = V::MulAdd(r, w, V::Set1(-7.495518717768503f));
+  r = V::MulAdd(r, w, V::Set1(2.921019019210786f));
+  r = V::MulAdd(r, w, V::Set1(-1.015265279202700f));
+  r = V::MulAdd(r, w, V::Set1(4.218463358204948e-1f));
+  r = V::MulAdd(r, w, V::Set1(-2.820767439740514e-1f));
+  r = V::MulAdd(r, w, V::Set1(5.641895067754075e-1f));
+  p = V::Select(V::CmpLt(abs_x, V::Set1(2.0f)), p, r);
+  return V::Mul(V::Mul(Exp<V>(V::Xor(V::Mul(x, x), V::Set1(-0.0f))), q), p);
+}
+
+template<typename V>
+inline typename V::Reg Erf(typename V::Reg x) {
+  using Reg = typename V::Reg;
+  const Reg one = V::Set1(1.0f);
+  const Reg large = V::Xor(V::Sub(one, ErfcLarge<V>(x)), V::SignBit(x));
+  return V::Select(V::CmpLt(V::Abs(x), one), ErfSmall<V>(x), large);
+}
+
+// 0.5 * x * (1 + erf(x / sqrt(2))), with 1 + erf(u) = erfc(-u) for u <= -1 so that the negative
+// tail does not cancel.
+template<typename V>
+inline typename V::Reg Gelu(typename V::Reg x) {
+  using Reg = typename V::Reg;
+  const Reg one = V::Set1(1.0f);
+  const Reg u = V::Mul(x, V::Set1(0.707106781186547524f));
+  const Reg erfc = ErfcLarge<V>(u);
+  Reg one_plus_erf =
+      V::Select(V::CmpLt(u, V::Set1(0.0f)), erfc, V::Sub(V::Set1(2.0f), erfc));
+  one_plus_erf = V::Select(V::CmpLt(V::Abs(u), one), V::Add(one, ErfSmall<V>(u)), one_plus_erf);
+  return V::Mul(V::Mul(x, V::Set1(0.5f)), one_plus_erf);
+}
+
+template<typename V>
+inline typename V::Reg Silu(typename V::Reg x) {
+  return V::Div(x, V::Add(V::Set1(1.0f), Exp<V>(V::Xor(x, V::Set1(-0.0f)))));
+}
+
+// x = q * pi / 2 + r with |r| <= pi / 4, pi / 2 being split in four so that q * pi / 2 is exact
+// for |x| <= 8192. sin(r) and cos(r) are the Cephes sinf and cosf polynomials, the quadrant q mod
+// 4 picks one of them and the sign.
+template<typename V>
+inline void ReduceToQuadrant(typename V::Reg x, typename V::Reg* sin_r, typename V::Reg* cos_r,
+                             typename V::Reg* quadrant) {
+  using Reg = typename V::Reg;
+  const Reg q = V::Round(V::Mul(x, V::Set1(0.636619772367581343f)));
+  Reg r = V::Sub(x, V::Mul(q, V::Set1(1.5703125f)));
+  r = V::Sub(r, V::Mul(q, V::Set1(4.837512969970703125e-4f)));
+  r = V::Sub(r, V::Mul(q, V::Set1(7.549533620476722717e-8f)));
+  r = V::Sub(r, V::Mul(q, V::Set1(2.563344068257089603e-12f)));
+  const Reg z = V::Mul(r, r);
+  Reg s = V::Set1(-1.9515295891e-4f);
+  s = V::MulAdd(s, z, V::Set1(8.3321608736e-3f));
+  s = V::MulAdd(s, z, V::Set1(-1.6666654611e-1f));
+  *sin_r = V::MulAdd(V::Mul(s, z), r, r);
+  Reg c = V::Set1(2.443315711809948e-5f);
+  c = V::MulAdd(c, z, V::Set1(-1.388731625493765e-3f));
+  c = V::MulAdd(c, z, V::Set1(4.166664568298827e-2f));
+  *cos_r = V::MulAdd(V::Mul(c, z), z, V::MulAdd(z, V::Set1(-0.5f), V::Set1(1.0f)));
+  *quadrant = V::Sub(q, V::Mul(Floor<V>(V::Mul(q, V::Set1(0.25f))), V::Set1(4.0f)));
+}
+
+template<typename V>
+inline typename V::Reg Sin(typename V::Reg x) {
+  using Reg = typename V::Reg;
+  Reg sin_r, cos_r, quadrant;
+  ReduceToQuadrant<V>(x, &sin_r, &cos_r, &quadrant);
+  const typename V::Mask odd =
+      V::MaskOr(V::CmpEq(quadrant, V::Set1(1.0f)), V::CmpEq(quadrant, V::Set1(3.0f)));
+  Reg y = V::Select(odd, cos_r, sin_r);
+  y = V::Select(V::CmpGt(quadrant, V::Set1(1.5f)), V::Xor(y, V::Set1(-0.0f)), y);
+  // Keeps the sign of a zero x, which the polynomial loses.
+  return V::Select(V::CmpEq(x, V::Set1(0.0f)), x, y);
+}
+
+template<typename V>
+inline typename V::Reg Cos(typename V::Reg x) {
+  using Reg = typename V::Reg;
+  Reg sin_r, cos_r, quadrant;
+  ReduceToQuadrant<V>(x, &sin_r, &cos_r, &quadrant);
+  const typename V::Mask odd =
+      V::MaskOr(V::CmpEq(quadrant, V::Set1(1.0f)), V::CmpEq(quadrant, V::Set1(3.0f)));
+  const Reg y = V::Select(odd, sin_r, cos_r);
+  const typename V::Mask negative =
+      V::MaskOr(V::CmpEq(quadrant, V::Set1(1.0f)), V::CmpEq(quadrant, V::Set1(2.0f)));
+  return V::Select(negative, V::Xor(y, V::Set1(-0.0f)), y);
+}
+
+// Each op pairs the vector approximation with the <cmath> scalar, which serves as the fallback
+// off x86-64 and for the inputs beyond kMaxVectorizedAbsInput. ComputeScalar is defined out of
+// line in vectorized_math.cpp, an inline one would also be compiled by the avx translation units
+// and the linker might keep that copy.
+#define DEFINE_VECTORIZED_MATH_OP(func, max_vectorized_abs_input)             \
+  struct func##Op {                                                           \
+    static constexpr float kMaxVectorizedAbsInput = max_vectorized_abs_input; \
+    template<typename V>                                                      \
+    static typename V::Reg Compute(typename V::Reg x) {                       \
+      return func<V>(x);                                                      \
+    }                                                                         \
+    static float ComputeScalar(float x);                                      \
+  };
+
+DEFINE_VECTORIZED_MATH_OP(Exp, std::numeric_limits<float>::infinity())
+DEFINE_VECTORIZED_MATH_OP(Log, std::numeric_limits<float>::infinity())
+DEFINE_VECTORIZED_MATH_OP(Sigmoid, std::numeric_limits<float>::infinity())
+DEFINE_VECTORIZED_MATH_OP(Tanh, std::numeric_limits<float>::infinity())
+DEFINE_VECTORIZED_MATH_OP(Erf, std::numeric_limits<float>::infinity())
+DEFINE_VECTORIZED_MATH_OP(Gelu, std::numeric_limits<float>::infinity())
+DEFINE_VECTORIZED_MATH_OP(Silu, std::numeric_limits<float>::infinity())
+DEFINE_VECTORIZED_MATH_OP(Sin, 8192.0f)
+DEFINE_VECTORIZED_MATH_OP(Cos, 8192.0f)
+
+#undef DEFINE_VECTORIZED_MATH_OP
+
+template<typename Op>
+void ScalarLoop(const float* x, float* y, int64_t n) {
+  for (int64_t i = 0; i < n; ++i) { y[i] = Op::ComputeScalar(x[i]); }
+}
+
+template<typename V, typename Op>
+inline void ComputeVector(const float* x, float* y) {
+  const typename V::Reg v = V::Load(x);
+  V::Store(y, Op::template Compute<V>(v));
+  if (V::Any(V::CmpGt(V::Abs(v), V::Set1(Op::kMaxVectorizedAbsInput)))) {
+    float x_lanes[V::kSize];
+    V::Store(x_lanes, v);
+    for (int i = 0; i < V::kSize; ++i) {
+      if (std::abs(x_lanes[i]) > Op::kMaxVectorizedAbsInput) {
+        y[i] = Op::ComputeScalar(x_lanes[i]);
+      }
+    }
+  }
+}
+
+// The tail shorter than a vector goes through a zero padded buffer, so that every element is
+// computed by the same approximation.
+template<typename V, typename Op>
+void VectorLoop(const float* x, float* y, int64_t n) {
+  int64_t i = 0;
+  for (; i + V::kSize <= n; i += V::kSize) { ComputeVector<V, Op>(x + i, y + i); }
+  if (i < n) {
+    float buf[V::kSize] = {};
+    for (int64_t j = i; j < n; ++j) { buf[j - i] = x[j]; }
+    ComputeVector<V, Op>(buf, buf);
+    for (int64_t j = i; j < n; ++j) { y[j] = buf[j - i]; }
+  }
+}
+
+#if defined(__SSE2__)
+
+struct VecSse2 {
+  using Reg = __m128;
+  using Mask = __m128;
+  static constexpr int kSize = 4;
+
+  static Reg Load(const float* p) { return _mm_loadu_ps(p); }
+  static void Store(float* p, Reg x) { _mm_storeu_ps(p, x); }
+  static Reg Set1(float v) { return _mm_set1_ps(v); }
+  static Reg Add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm_div_ps(a, b); }
+  static Reg MulAdd(Reg a, Reg b, Reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static Reg Min(Reg a, Reg b) { return _mm_min_ps(a, b); }
+  static Reg Max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+  static Reg Abs(Reg x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+  static Reg SignBit(Reg x) { return _mm_and_ps(_mm_set1_ps(-0.0f), x); }
+  static Reg Xor(Reg a, Reg b) { return _mm_xor_ps(a, b); }
+  static Reg Round(Reg x) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(x)); }
+  static Mask CmpLt(Reg a, Reg b) { return _mm_cmplt_ps(a, b); }
+  static Mask CmpGt(Reg a, Reg b) { return _mm_cmpgt_ps(a, b); }
+  static Mask CmpEq(Reg a, Reg b) { return _mm_cmpeq_ps(a, b); }
+  static Mask IsNan(Reg x) { return _mm_cmpunord_ps(x, x); }
+  static Mask MaskOr(Mask a, Mask b) { return _mm_or_ps(a, b); }
+  static bool Any(Mask m) { return _mm_movemask_ps(m) != 0; }
+  static Reg Select(Mask m, Reg a, Reg b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+  }
+  static Reg Pow2(Reg n) {
+    const __m128i biased = _mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(biased, 23));
+  }
+  static Reg Exponent(Reg x) {
+    const __m128i bits = _mm_srli_epi32(_mm_castps_si128(x), 23);
+    return _mm_cvtepi32_ps(_mm_sub_epi32(bits, _mm_set1_epi32(126)));
+  }
+  static Reg Mantissa(Reg x) {
+    const __m128i bits = _mm_and_si128(_mm_castps_si128(x), _mm_set1_epi32(0x007fffff));
+    return _mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x3f000000)));
+  }
+};
+
+#endif  // defined(__SSE2__)
+
+#if defined(OF_VECTORIZED_MATH_X86_64)
+
+#define DECLARE_ISA_VECTORIZED_MATH_FUNC(func)          \
+  void Sse2##func(const float* x, float* y, int64_t n); \
+  void Avx2##func(const float* x, float* y, int64_t n); \
+  void Avx512##func(const float* x, float* y, int64_t n);
+
+OF_PP_FOR_EACH_TUPLE(DECLARE_ISA_VECTORIZED_MATH_FUNC, VECTORIZED_MATH_FUNC_SEQ)
+
+#undef DECLARE_ISA_VECTORIZED_MATH_FUNC
+
+#endif  // defined(OF_VECTORIZED_MATH_X86_64)
+
+}  // namespace internal
+
+}  // namespace vectorized_math
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_KERNELS_H_
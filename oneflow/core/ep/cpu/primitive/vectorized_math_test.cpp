@@ -0,0 +1,231 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace vectorized_math {
+
+namespace {
+
+using Func = void (*)(Isa, const float*, float*, int64_t);
+
+struct FuncCase {
+  std::string name;
+  Func func;
+  double (*reference)(double);
+  float min_x;
+  float max_x;
+  double max_ulp;
+};
+
+// The bounds are the ones documented in vectorized_math.h with some slack, the references are
+// computed in double. Gelu is only checked above -3, where the documented bound holds.
+std::vector<FuncCase> FuncCases() {
+  return {
+      {"Exp", Exp, [](double x) { return std::exp(x); }, -104.0f, 88.7f, 1.5},
+      {"Log", Log, [](double x) { return std::log(x); }, 0.0f, std::numeric_limits<float>::max(),
+       1.0},
+      {"Sigmoid", Sigmoid, [](double x) { return 1.0 / (1.0 + std::exp(-x)); }, -87.0f, 100.0f,
+       3.5},
+      {"Tanh", Tanh, [](double x) { return std::tanh(x); }, -100.0f, 100.0f, 1.5},
+      {"Erf", Erf, [](double x) { return std::erf(x); }, -100.0f, 100.0f, 3.0},
+      {"Gelu", Gelu, [](double x) { return 0.5 * x * std::erfc(-x * std::sqrt(0.5)); }, -3.0f,
+       1e30f, 16.0},
+      {"Silu", Silu, [](double x) { return x / (1.0 + std::exp(-x)); }, -87.0f, 1e30f, 3.5},
+      {"Sin", Sin, [](double x) { return std::sin(x); }, -1e4f, 1e4f, 2.5},
+      {"Cos", Cos, [](double x) { return std::cos(x); }, -1e4f, 1e4f, 2.5},
+  };
+}
+
+// The vector isas, Isa::kScalar being the <cmath> functions.
+std::vector<Isa> SupportedIsas() {
+  std::vector<Isa> isas;
+  for (int isa = static_cast<int>(Isa::kSse2); isa <= static_cast<int>(MaxIsa()); ++isa) {
+    isas.push_back(static_cast<Isa>(isa));
+  }
+  return isas;
+}
+
+double Ulp(double value) {
+  const float abs_value = std::abs(static_cast<float>(value));
+  if (abs_value < std::numeric_limits<float>::min()) {
+    return std::numeric_limits<float>::denorm_min();
+  }
+  int exponent = 0;
+  std::frexp(abs_value, &exponent);
+  return std::ldexp(1.0, exponent - std::numeric_limits<float>::digits);
+}
+
+uint32_t Bits(float x) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &x, sizeof(float));
+  return bits;
+}
+
+// Every 997th float in [min_x, max_x].
+std::vector<float> SampleInputs(float min_x, float max_x) {
+  std::vector<float> inputs;
+  for (uint64_t bits = 0; bits <= std::numeric_limits<uint32_t>::max(); bits += 997) {
+    const uint32_t bits32 = static_cast<uint32_t>(bits);
+    float x = 0;
+    std::memcpy(&x, &bits32, sizeof(float));
+    if (x >= min_x && x <= max_x) { inputs.push_back(x); }
+  }
+  return inputs;
+}
+
+TEST(VectorizedMath, Accuracy) {
+  for (const FuncCase& func_case : FuncCases()) {
+    const std::vector<float> x = SampleInputs(func_case.min_x, func_case.max_x);
+    std::vector<float> y(x.size());
+    for (Isa isa : SupportedIsas()) {
+      func_case.func(isa, x.data(), y.data(), x.size());
+      for (size_t i = 0; i < x.size(); ++i) {
+        const double expected = func_case.reference(x[i]);
+        if (std::isinf(static_cast<float>(expected))) {
+          ASSERT_EQ(y[i], static_cast<float>(expected)) << func_case.name << "(" << x[i] << ")";
+          continue;
+        }
+        // The subnormal results of the funcs other than Exp are allowed to be flushed.
+        if (func_case.name != "Exp" && std::abs(expected) < std::numeric_limits<float>::min()) {
+          ASSERT_LE(std::abs(y[i]), std::numeric_limits<float>::min());
+          continue;
+        }
+        ASSERT_LE(std::abs(y[i] - expected) / Ulp(expected), func_case.max_ulp)
+            << func_case.name << "(" << x[i] << ") = " << y[i] << ", expected " << expected
+            << ", isa " << static_cast<int>(isa);
+      }
+    }
+  }
+}
+
+TEST(VectorizedMath, SpecialValues) {
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const std::vector<float> x = {0.0f, -0.0f, inf, -inf, nan, 1e-40f, 1e30f, -1e30f};
+  std::vector<float> y(x.size());
+  std::vector<float> expected(x.size());
+  for (const FuncCase& func_case : FuncCases()) {
+    for (size_t i = 0; i < x.size(); ++i) {
+      expected[i] = static_cast<float>(func_case.reference(x[i]));
+    }
+    for (Isa isa : SupportedIsas()) {
+      func_case.func(isa, x.data(), y.data(), x.size());
+      for (size_t i = 0; i < x.size(); ++i) {
+        if (std::isnan(expected[i])) {
+          ASSERT_TRUE(std::isnan(y[i])) << func_case.name << "(" << x[i] << ") = " << y[i];
+        } else if (expected[i] == 0 || std::isinf(expected[i])) {
+          ASSERT_EQ(y[i], expected[i]) << func_case.name << "(" << x[i] << ")";
+          ASSERT_EQ(std::signbit(y[i]), std::signbit(expected[i]))
+              << func_case.name << "(" << x[i] << ")";
+        } else {
+          ASSERT_NEAR(y[i], expected[i],
+                      std::max(std::abs(expected[i]) * 1e-6f,
+                               std::numeric_limits<float>::denorm_min()))
+              << func_case.name << "(" << x[i] << ")";
+        }
+      }
+    }
+  }
+}
+
+TEST(VectorizedMath, TailAndInPlace) {
+  for (const FuncCase& func_case : FuncCases()) {
+    for (Isa isa : SupportedIsas()) {
+      for (int64_t n = 0; n <= 40; ++n) {
+        std::vector<float> x(n);
+        for (int64_t i = 0; i < n; ++i) { x[i] = 0.37f * i - 5.0f; }
+        std::vector<float> y(n);
+        std::vector<float> in_place = x;
+        func_case.func(isa, x.data(), y.data(), n);
+        func_case.func(isa, in_place.data(), in_place.data(), n);
+        for (int64_t i = 0; i < n; ++i) {
+          std::vector<float> one = {x[i]};
+          func_case.func(isa, one.data(), one.data(), 1);
+          ASSERT_EQ(Bits(y[i]), Bits(one[0])) << func_case.name << " n " << n << " i " << i;
+          ASSERT_EQ(Bits(in_place[i]), Bits(y[i])) << func_case.name << " n " << n << " i " << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(VectorizedMath, Bfloat16) {
+  const int64_t n = 1000;
+  std::vector<bfloat16> x(n);
+  std::vector<float> x_float(n);
+  for (int64_t i = 0; i < n; ++i) {
+    x[i] = static_cast<bfloat16>(0.01f * i - 5.0f);
+    x_float[i] = static_cast<float>(x[i]);
+  }
+  std::vector<bfloat16> y(n);
+  std::vector<float> y_float(n);
+  Gelu(x.data(), y.data(), n);
+  Gelu(x_float.data(), y_float.data(), n);
+  for (int64_t i = 0; i < n; ++i) {
+    ASSERT_EQ(static_cast<float>(y[i]), static_cast<float>(static_cast<bfloat16>(y_float[i])));
+  }
+}
+
+// Prints the throughput of every isa against the <cmath> loop, only run when
+// ONEFLOW_TEST_VECTORIZED_MATH_BENCHMARK is set.
+TEST(VectorizedMath, Throughput) {
+  if (std::getenv("ONEFLOW_TEST_VECTORIZED_MATH_BENCHMARK") == nullptr) {
+    GTEST_SKIP() << "benchmark only";
+  }
+  const int64_t n = 1 << 20;
+  const int num_iters = 10;
+  std::vector<float> x(n);
+  std::vector<float> y(n);
+  for (int64_t i = 0; i < n; ++i) { x[i] = 0.005f * (i % 2000) - 5.0f; }
+  std::vector<Isa> isas = SupportedIsas();
+  isas.insert(isas.begin(), Isa::kScalar);
+  for (const FuncCase& func_case : FuncCases()) {
+    std::string line = func_case.name;
+    for (Isa isa : isas) {
+      const auto start = std::chrono::steady_clock::now();
+      for (int iter = 0; iter < num_iters; ++iter) { func_case.func(isa, x.data(), y.data(), n); }
+      const double seconds =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      line += " isa" + std::to_string(static_cast<int>(isa)) + " "
+              + std::to_string(static_cast<int64_t>(num_iters * n / seconds / 1e6)) + " Melem/s";
+    }
+    std::cout << line << std::endl;
+  }
+}
+
+}  // namespace
+
+}  // namespace vectorized_math
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
@@ -53,6 +53,8 @@ void TestElementwiseBroadcastBinary(DeviceManagerRegistry* registry,
   bool is_broadcast = false;
   bool left_scalar = false;
   bool right_scalar = false;
+  bool left_row = false;
+  bool right_column = false;
   if (test_type == 0) {
     // do nothing
   } else if (test_type == 1) {
@@ -61,25 +63,29 @@ void TestElementwiseBroadcastBinary(DeviceManagerRegistry* registry,
     left_scalar = true;
   } else if (test_type == 3) {
     right_scalar = true;
+  } else if (test_type == 4) {
+    left_row = true;
+  } else if (test_type == 5) {
+    right_column = true;
   } else {
     UNIMPLEMENTED();
   }
-  const int a_dim0 = left_scalar ? 1 : broadcast_dim0;
-  const int a_dim1 = left_scalar ? 1 : broadcast_dim1;
+  const int a_dim0 = (left_scalar || left_row) ? 1 : broadcast_dim0;
+  const int a_dim1 = (left_scalar || left_row) ? 1 : broadcast_dim1;
   const int a_dim2 = left_scalar ? 1 : broadcast_dim2;
   const int a_dim3 = left_scalar ? 1 : (is_broadcast ? 1 : broadcast_dim3);
   const int b_dim0 = right_scalar ? 1 : broadcast_dim0;
   const int b_dim1 = right_scalar ? 1 : (is_broadcast ? 1 : broadcast_dim1);
-  const int b_dim2 = right_scalar ? 1 : broadcast_dim2;
-  const int b_dim3 = right_scalar ? 1 : broadcast_dim3;
-  const int a_broadcast0 = left_scalar ? broadcast_dim0 : 1;
-  const int a_broadcast1 = left_scalar ? broadcast_dim1 : 1;
+  const int b_dim2 = (right_scalar || right_column) ? 1 : broadcast_dim2;
+  const int b_dim3 = (right_scalar || right_column) ? 1 : broadcast_dim3;
+  const int a_broadcast0 = (left_scalar || left_row) ? broadcast_dim0 : 1;
+  const int a_broadcast1 = (left_scalar || left_row) ? broadcast_dim1 : 1;
   const int a_broadcast2 = left_scalar ? broadcast_dim2 : 1;
   const int a_broadcast3 = left_scalar ? broadcast_dim3 : (is_broadcast ? broadcast_dim3 : 1);
   const int b_broadcast0 = right_scalar ? broadcast_dim0 : 1;
   const int b_broadcast1 = right_scalar ? broadcast_dim1 : (is_broadcast ? broadcast_dim1 : 1);
-  const int b_broadcast2 = right_scalar ? broadcast_dim2 : 1;
-  const int b_broadcast3 = right_scalar ? broadcast_dim3 : 1;
+  const int b_broadcast2 = (right_scalar || right_column) ? broadcast_dim2 : 1;
+  const int b_broadcast3 = (right_scalar || right_column) ? broadcast_dim3 : 1;
   const Eigen::array<int, 4> a_broadcast = {a_broadcast0, a_broadcast1, a_broadcast2, a_broadcast3};
   const Eigen::array<int, 4> b_broadcast = {b_broadcast0, b_broadcast1, b_broadcast2, b_broadcast3};
   Eigen::Tensor<Src, 4, Eigen::RowMajor> a(a_dim0, a_dim1, a_dim2, a_dim3);
@@ -201,6 +207,10 @@ void TestElementwiseBroadcastBinary(DeviceManagerRegistry* registry,
       registry, device_types, 2);
   TestElementwiseBroadcastBinary<binary_op, src_data_type, Src, dst_data_type, Dst>(
       registry, device_types, 3);
+  TestElementwiseBroadcastBinary<binary_op, src_data_type, Src, dst_data_type, Dst>(
+      registry, device_types, 4);
+  TestElementwiseBroadcastBinary<binary_op, src_data_type, Src, dst_data_type, Dst>(
+      registry, device_types, 5);
 }
 
 template<BinaryOp binary_op>
@@ -94,8 +94,37 @@ void TestCast(DeviceManagerRegistry* registry, const std::set<DeviceType>& devic
   TestCast<DataType::kFloat16, Eigen::half>(registry, device_types, elem_cnt);
 }
 
+template<DataType src_data_type, typename Src, DataType dst_data_type, typename Dst>
+void TestCpuBFloat16Cast(DeviceManagerRegistry* registry, const std::vector<Src>& src,
+                         const std::vector<Dst>& expected) {
+  auto device = registry->GetDevice(DeviceType::kCPU, 0);
+  ep::test::StreamGuard stream(device.get());
+  std::unique_ptr<Cast> cast =
+      NewPrimitive<CastFactory>(DeviceType::kCPU, src_data_type, dst_data_type);
+  ASSERT_TRUE(cast.operator bool());
+  std::vector<Dst> dst(src.size());
+  cast->Launch(stream.stream(), src.data(), dst.data(), src.size());
+  CHECK_JUST(stream.stream()->Sync());
+  for (size_t i = 0; i < src.size(); ++i) {
+    ASSERT_EQ(static_cast<float>(dst.at(i)), static_cast<float>(expected.at(i)));
+  }
+}
+
 }  // namespace
 
+TEST_F(PrimitiveTest, TestCpuBFloat16Cast) {
+  // 1 + 2^-8 is a tie and rounds to even, 1 + 3 * 2^-8 rounds up
+  const std::vector<float> values = {0.0f, 1.0f, -2.5f, 1.00390625f, 1.01171875f, 65536.0f};
+  const std::vector<bfloat16> rounded = {
+      bfloat16::FromBits(0x0000), bfloat16::FromBits(0x3F80), bfloat16::FromBits(0xC020),
+      bfloat16::FromBits(0x3F80), bfloat16::FromBits(0x3F82), bfloat16::FromBits(0x4780)};
+  TestCpuBFloat16Cast<DataType::kFloat, float, DataType::kBFloat16, bfloat16>(
+      &device_manager_registry_, values, rounded);
+  const std::vector<float> widened = {0.0f, 1.0f, -2.5f, 1.0f, 1.015625f, 65536.0f};
+  TestCpuBFloat16Cast<DataType::kBFloat16, bfloat16, DataType::kFloat, float>(
+      &device_manager_registry_, rounded, widened);
+}
+
 TEST_F(PrimitiveTest, TestCast) {
   std::vector<int> elem_cnts = {1024, 3193, 5765};
   for (int i = 0; i < elem_cnts.size(); ++i) {
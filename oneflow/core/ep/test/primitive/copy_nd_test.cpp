@@ -31,7 +31,7 @@ namespace {
 
 template<DataType data_type, typename T>
 void TestCopyNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
-                int64_t num_dims) {
+                int64_t num_dims, int64_t min_dim) {
   std::vector<int64_t> src_dims(num_dims, 0);
   std::vector<int64_t> src_pos(num_dims, 0);
   std::vector<int64_t> dst_pos(num_dims, 0);
@@ -40,7 +40,7 @@ void TestCopyNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& dev
   int64_t src_elem = 1;
   int64_t dst_elem = 1;
   for (int i = 0; i < num_dims; ++i) {
-    int64_t rand_dim = 8 + std::rand() % 32;
+    int64_t rand_dim = min_dim + std::rand() % 32;
     int64_t rand_pos = std::rand() % 16;
     src_dims.at(i) = rand_dim;
     dst_pos.at(i) = rand_pos;
@@ -89,14 +89,25 @@ void TestCopyNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& dev
 
 TEST_F(PrimitiveTest, TestCopyNd) {
   for (int i = 1; i < 6; ++i) {
-    TestCopyNd<DataType::kDouble, double>(&device_manager_registry_, available_device_types_, i);
-    TestCopyNd<DataType::kFloat, float>(&device_manager_registry_, available_device_types_, i);
-    TestCopyNd<DataType::kInt8, int8_t>(&device_manager_registry_, available_device_types_, i);
-    TestCopyNd<DataType::kInt32, int32_t>(&device_manager_registry_, available_device_types_, i);
-    TestCopyNd<DataType::kInt64, int64_t>(&device_manager_registry_, available_device_types_, i);
+    TestCopyNd<DataType::kDouble, double>(&device_manager_registry_, available_device_types_, i,
+                                          8);
+    TestCopyNd<DataType::kFloat, float>(&device_manager_registry_, available_device_types_, i, 8);
+    TestCopyNd<DataType::kInt8, int8_t>(&device_manager_registry_, available_device_types_, i, 8);
+    TestCopyNd<DataType::kInt32, int32_t>(&device_manager_registry_, available_device_types_, i,
+                                          8);
+    TestCopyNd<DataType::kInt64, int64_t>(&device_manager_registry_, available_device_types_, i,
+                                          8);
   }
 }
 
+TEST_F(PrimitiveTest, TestCopyNdLargeExtent) {
+  // extents spanning several parallel chunks of the CPU copy, in one long row and in many rows
+  TestCopyNd<DataType::kFloat, float>(&device_manager_registry_, available_device_types_, 1,
+                                      100000);
+  TestCopyNd<DataType::kFloat, float>(&device_manager_registry_, available_device_types_, 2, 300);
+  TestCopyNd<DataType::kInt8, int8_t>(&device_manager_registry_, available_device_types_, 3, 64);
+}
+
 }  // namespace test
 
 }  // namespace primitive
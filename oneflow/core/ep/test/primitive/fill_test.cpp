@@ -41,11 +41,6 @@ template<DataType data_type, typename T>
 void TestFill(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types, size_t n) {
   const size_t vector_size = n * sizeof(T);
   for (const auto& device_type : device_types) {
-#ifdef WITH_CUDA
-#if CUDA_VERSION >= 11000
-    if (device_type == DeviceType::kCPU && data_type == DataType::kBFloat16) { continue; }
-#endif  // CUDA_VERSION >= 11000
-#endif  // WITH_CUDA
     auto device = registry->GetDevice(device_type, 0);
     ep::test::DeviceMemoryGuard device_mem(device.get(), vector_size);
     ep::test::PinnedMemoryGuard host_mem(device.get(), vector_size);
@@ -125,6 +125,9 @@ TEST_F(PrimitiveTest, TestBatchPermute) {
   const int32_t dims2[2] = {10, 3};
   const int32_t dims3[2] = {31, 4};
   const int32_t dims4[2] = {6, 8};
+  // larger than one tile of the CPU transpose
+  const int32_t dims5[2] = {67, 45};
+  const int32_t dims6[2] = {33, 130};
 
   TestPermute2D<float, DataType::kFloat, 2>(&device_manager_registry_, available_device_types_,
                                             dims0, permutation_list);
@@ -136,6 +139,10 @@ TEST_F(PrimitiveTest, TestBatchPermute) {
                                               dims3, permutation_list);
   TestPermute2D<Eigen::half, DataType::kFloat16, 2>(
       &device_manager_registry_, available_device_types_, dims4, permutation_list);
+  TestPermute2D<float, DataType::kFloat, 2>(&device_manager_registry_, available_device_types_,
+                                            dims5, permutation_list);
+  TestPermute2D<double, DataType::kDouble, 2>(&device_manager_registry_, available_device_types_,
+                                              dims6, permutation_list);
 }
 
 TEST_F(PrimitiveTest, TestPermute) {
@@ -149,6 +156,7 @@ TEST_F(PrimitiveTest, TestPermute) {
   const int32_t dims2[3] = {10, 3, 2};
   const int32_t dims3[3] = {3, 7, 2};
   const int32_t dims4[3] = {8, 2, 5};
+  const int32_t dims5[3] = {3, 37, 70};
 
   TestPermute3D<float, DataType::kFloat, 3>(&device_manager_registry_, available_device_types_,
                                             dims0, permutation_list0);
@@ -160,6 +168,8 @@ TEST_F(PrimitiveTest, TestPermute) {
                                               dims3, permutation_list3);
   TestPermute3D<Eigen::half, DataType::kFloat16, 3>(
       &device_manager_registry_, available_device_types_, dims4, permutation_list4);
+  TestPermute3D<float, DataType::kFloat, 3>(&device_manager_registry_, available_device_types_,
+                                            dims5, permutation_list0);
 }
 
 }  // namespace test
@@ -341,9 +341,10 @@ Maybe<void> InstructionsBuilder::LocalCallOpKernel(
     const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
     const one::EagerBlobObjectListPtr& input_eager_blob_objects,
     const one::EagerBlobObjectListPtr& output_eager_blob_objects,
+    const std::shared_ptr<one::LocalTensorInferResult>& local_tensor_infer_result,
     const one::OpExprInterpContext& ctx, Symbol<Stream> stream) {
   return LocalCallOpKernel(opkernel, input_eager_blob_objects, output_eager_blob_objects, nullptr,
-                           ctx, stream);
+                           local_tensor_infer_result, ctx, stream);
 }
 
 Maybe<void> InstructionsBuilder::LocalCallOpKernel(
@@ -352,12 +353,23 @@ Maybe<void> InstructionsBuilder::LocalCallOpKernel(
     const one::EagerBlobObjectListPtr& output_eager_blob_objects,
     const std::shared_ptr<const one::ConsistentTensorInferResult>& consistent_tensor_infer_result,
     const one::OpExprInterpContext& ctx, Symbol<Stream> stream) {
+  return LocalCallOpKernel(opkernel, input_eager_blob_objects, output_eager_blob_objects,
+                           consistent_tensor_infer_result, nullptr, ctx, stream);
+}
+
+Maybe<void> InstructionsBuilder::LocalCallOpKernel(
+    const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
+    const one::EagerBlobObjectListPtr& input_eager_blob_objects,
+    const one::EagerBlobObjectListPtr& output_eager_blob_objects,
+    const std::shared_ptr<const one::ConsistentTensorInferResult>& consistent_tensor_infer_result,
+    const std::shared_ptr<one::LocalTensorInferResult>& local_tensor_infer_result,
+    const one::OpExprInterpContext& ctx, Symbol<Stream> stream) {
   const auto& parallel_desc_sym = JUST(Placement4Device(stream->device())).shared_from_symbol();
   JUST(SoftSyncStream(output_eager_blob_objects, stream));
   JUST(SoftSyncStream(input_eager_blob_objects, stream));
   auto phy_instr_operand = JUST(vm::LocalCallOpKernelPhyInstrOperand::New(
       opkernel, input_eager_blob_objects, output_eager_blob_objects, consistent_tensor_infer_result,
-      ctx, *one::CurrentDevVmDepObjectConsumeMode()));
+      local_tensor_infer_result, ctx, *one::CurrentDevVmDepObjectConsumeMode()));
   const auto& instruction_name = JUST(StreamRoleSwitch<GetCallInstructionName>(
       stream->stream_role(), stream->device()->enum_type()));
   auto instruction = intrusive::make_shared<vm::InstructionMsg>(
@@ -122,10 +122,12 @@ class InstructionsBuilder : public std::enable_shared_from_this<InstructionsBuil
       const std::shared_ptr<Scope>& scope,
       const std::function<std::string(const std::string&)>& StrSetter);
 
-  Maybe<void> LocalCallOpKernel(const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
-                                const one::EagerBlobObjectListPtr& input_eager_blob_objects,
-                                const one::EagerBlobObjectListPtr& output_eager_blob_objects,
-                                const one::OpExprInterpContext& ctx, Symbol<Stream> stream);
+  Maybe<void> LocalCallOpKernel(
+      const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
+      const one::EagerBlobObjectListPtr& input_eager_blob_objects,
+      const one::EagerBlobObjectListPtr& output_eager_blob_objects,
+      const std::shared_ptr<one::LocalTensorInferResult>& local_tensor_infer_result,
+      const one::OpExprInterpContext& ctx, Symbol<Stream> stream);
 
   Maybe<void> LocalCallOpKernel(
       const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
@@ -135,6 +137,14 @@ class InstructionsBuilder : public std::enable_shared_from_this<InstructionsBuil
       const one::OpExprInterpContext& ctx, Symbol<Stream> stream);
 
  private:
+  Maybe<void> LocalCallOpKernel(
+      const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
+      const one::EagerBlobObjectListPtr& input_eager_blob_objects,
+      const one::EagerBlobObjectListPtr& output_eager_blob_objects,
+      const std::shared_ptr<const one::ConsistentTensorInferResult>& consistent_tensor_infer_result,
+      const std::shared_ptr<one::LocalTensorInferResult>& local_tensor_infer_result,
+      const one::OpExprInterpContext& ctx, Symbol<Stream> stream);
+
   Maybe<void> SoftSyncStream(const one::EagerBlobObjectListPtr& eager_blob_objects,
                              Symbol<Stream> stream);
   Maybe<void> SoftSyncStream(
@@ -0,0 +1,85 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_impl.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace oneflow {
+namespace one {
+
+size_t InputLocalTensorMeta::hash_value() const {
+  size_t hash_value = std::hash<Shape>()(shape_);
+  HashCombine(&hash_value, std::hash<Stride>()(stride_));
+  HashCombine(&hash_value, static_cast<size_t>(data_type_));
+  HashCombine(&hash_value, static_cast<size_t>(is_dynamic_));
+  HashCombine(&hash_value, std::hash<Symbol<Device>>()(device_));
+  return hash_value;
+}
+
+bool InputLocalTensorMeta::operator==(const InputLocalTensorMeta& other) const {
+  return this->shape_ == other.shape_ && this->stride_ == other.stride_
+         && this->data_type_ == other.data_type_ && this->is_dynamic_ == other.is_dynamic_
+         && this->device_ == other.device_;
+}
+
+bool LocalTensorMetaInferArgs::operator==(const LocalTensorMetaInferArgs& other) const {
+  return this->hash_value_ == other.hash_value_ && this->default_device_ == other.default_device_
+         && this->attrs_ == other.attrs_
+         && this->input_local_tensor_metas_ == other.input_local_tensor_metas_;
+}
+
+Maybe<LocalTensorMetaInferArgs> LocalTensorMetaInferArgs::New(const AttrMap& attrs,
+                                                              Symbol<Device> default_device,
+                                                              const TensorTuple& input_tensors) {
+  std::shared_ptr<LocalTensorMetaInferArgs> infer_args(new LocalTensorMetaInferArgs());
+  infer_args->attrs_ = attrs;
+  infer_args->default_device_ = default_device;
+  JUST(infer_args->InitInputLocalTensorMetas(input_tensors));
+  return infer_args;
+}
+
+Maybe<void> LocalTensorMetaInferArgs::InitInputLocalTensorMetas(const TensorTuple& input_tensors) {
+  hash_value_ = std::hash<AttrMap>()(attrs_);
+  HashCombine(&hash_value_, std::hash<Symbol<Device>>()(default_device_));
+  input_local_tensor_metas_.reserve(input_tensors.size());
+  for (int i = 0; i < input_tensors.size(); ++i) {
+    auto* tensor_impl = JUST(input_tensors.at(i)->mut_eager_mirrored_tensor_impl());
+    input_local_tensor_metas_.emplace_back(*tensor_impl->tensor_meta(),
+                                           JUST(input_tensors.at(i)->device()));
+    HashCombine(&hash_value_, input_local_tensor_metas_.back().hash_value());
+  }
+  return Maybe<void>::Ok();
+}
+
+std::shared_ptr<LocalTensorInferResult> LocalTensorInferCache::Find(
+    const LocalTensorMetaInferArgs& infer_args) const {
+  const auto& iter = cache_.find(infer_args);
+  if (iter == cache_.end()) { return nullptr; }
+  return iter->second;
+}
+
+void LocalTensorInferCache::Insert(const LocalTensorMetaInferArgs& infer_args,
+                                   const std::shared_ptr<LocalTensorInferResult>& result) {
+  static const int64_t max_size = EnvInteger<ONEFLOW_EAGER_LOCAL_INFER_CACHE_SIZE>();
+  // ops called with ever-changing shapes would grow the cache without bound, start over instead.
+  // The results still referenced by in-flight instructions are kept alive by them.
+  if (cache_.size() >= max_size) { cache_.clear(); }
+  cache_.emplace(infer_args, result);
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,189 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_LOCAL_TENSOR_INFER_CACHE_H_
+#define ONEFLOW_CORE_FRAMEWORK_LOCAL_TENSOR_INFER_CACHE_H_
+
+#include <atomic>
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/shape.h"
+#include "oneflow/core/common/stride.h"
+#include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/framework/attr_map.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/stream.h"
+#include "oneflow/core/framework/tensor_meta.h"
+
+namespace oneflow {
+
+// Set to false to re-infer the output tensor metas of every eager mirrored op call.
+DEFINE_ENV_BOOL(ONEFLOW_EAGER_ENABLE_LOCAL_INFER_CACHE, true);
+// The cache of an op expr is dropped once it holds this many signatures.
+DEFINE_ENV_INTEGER(ONEFLOW_EAGER_LOCAL_INFER_CACHE_SIZE, 128);
+
+namespace user_op {
+
+class OpKernel;
+
+}  // namespace user_op
+
+namespace one {
+
+class StatefulLocalOpKernel;
+class TensorTuple;
+
+// Holds copies instead of pointers of the shape and stride: the shape of a tensor may be modified
+// in place after the call (e.g. by ops with dynamic outputs), which must not change a cache key.
+// The device of every input is part of the key, the device and stream infer fn of an op may
+// depend on any of them.
+class InputLocalTensorMeta final {
+ public:
+  InputLocalTensorMeta() : data_type_(kInvalidDataType), is_dynamic_(false) {}
+  InputLocalTensorMeta(const TensorMeta& tensor_meta, Symbol<Device> device)
+      : shape_(tensor_meta.shape()),
+        stride_(tensor_meta.stride()),
+        data_type_(tensor_meta.data_type()),
+        is_dynamic_(tensor_meta.is_dynamic()),
+        device_(device) {}
+  InputLocalTensorMeta(const InputLocalTensorMeta&) = default;
+  InputLocalTensorMeta(InputLocalTensorMeta&&) = default;
+  ~InputLocalTensorMeta() = default;
+
+  size_t hash_value() const;
+  bool operator==(const InputLocalTensorMeta& other) const;
+
+ private:
+  Shape shape_;
+  Stride stride_;
+  DataType data_type_;
+  bool is_dynamic_;
+  Symbol<Device> device_;
+};
+
+class LocalTensorMetaInferArgs final {
+ public:
+  LocalTensorMetaInferArgs(const LocalTensorMetaInferArgs&) = default;
+  LocalTensorMetaInferArgs(LocalTensorMetaInferArgs&&) = default;
+  ~LocalTensorMetaInferArgs() = default;
+
+  const AttrMap& attrs() const { return attrs_; }
+  Symbol<Device> default_device() const { return default_device_; }
+
+  size_t hash_value() const { return hash_value_; }
+
+  bool operator==(const LocalTensorMetaInferArgs& other) const;
+
+  static Maybe<LocalTensorMetaInferArgs> New(const AttrMap& attrs, Symbol<Device> default_device,
+                                             const TensorTuple& input_tensors);
+
+ private:
+  LocalTensorMetaInferArgs() = default;
+  Maybe<void> InitInputLocalTensorMetas(const TensorTuple& input_tensors);
+
+  AttrMap attrs_;
+  Symbol<Device> default_device_;
+  std::vector<InputLocalTensorMeta> input_local_tensor_metas_;
+  size_t hash_value_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+namespace std {
+
+template<>
+struct hash<oneflow::one::InputLocalTensorMeta> final {
+  size_t operator()(const oneflow::one::InputLocalTensorMeta& val) const {
+    return val.hash_value();
+  }
+};
+
+template<>
+struct hash<oneflow::one::LocalTensorMetaInferArgs> final {
+  size_t operator()(const oneflow::one::LocalTensorMetaInferArgs& val) const {
+    return val.hash_value();
+  }
+};
+
+}  // namespace std
+
+namespace oneflow {
+namespace one {
+
+// Everything the eager mirrored interpreter and the vm derive from a call signature. The output
+// tensor metas, devices and stream are filled when the result is created. The chosen kernel and
+// the tmp buffer size are filled by the first instruction built from this result.
+class LocalTensorInferResult final {
+ public:
+  LocalTensorInferResult() : op_kernel_(nullptr), need_temp_storage_(false), tmp_buffer_size_(-1) {}
+  LocalTensorInferResult(const LocalTensorInferResult&) = delete;
+  LocalTensorInferResult(LocalTensorInferResult&&) = delete;
+  ~LocalTensorInferResult() = default;
+
+  const std::vector<MirroredTensorMeta>& output_tensor_metas() const {
+    return output_tensor_metas_;
+  }
+  std::vector<MirroredTensorMeta>* mut_output_tensor_metas() { return &output_tensor_metas_; }
+
+  const Symbol<Stream>& stream() const { return stream_; }
+  void set_stream(const Symbol<Stream>& stream) { stream_ = stream; }
+
+  const std::shared_ptr<StatefulLocalOpKernel>& opkernel() const { return opkernel_; }
+  void set_opkernel(const std::shared_ptr<StatefulLocalOpKernel>& opkernel) {
+    opkernel_ = opkernel;
+  }
+
+  // Accessed by the main thread only.
+  const user_op::OpKernel* op_kernel() const { return op_kernel_; }
+  bool need_temp_storage() const { return need_temp_storage_; }
+  void set_op_kernel(const user_op::OpKernel* op_kernel, bool need_temp_storage) {
+    op_kernel_ = op_kernel;
+    need_temp_storage_ = need_temp_storage;
+  }
+
+  // Accessed by the scheduler thread only, -1 before the first inference.
+  int64_t tmp_buffer_size() const { return tmp_buffer_size_.load(std::memory_order_acquire); }
+  void set_tmp_buffer_size(int64_t size) {
+    tmp_buffer_size_.store(size, std::memory_order_release);
+  }
+
+ private:
+  std::vector<MirroredTensorMeta> output_tensor_metas_;
+  Symbol<Stream> stream_;
+  std::shared_ptr<StatefulLocalOpKernel> opkernel_;
+  const user_op::OpKernel* op_kernel_;
+  bool need_temp_storage_;
+  std::atomic<int64_t> tmp_buffer_size_;
+};
+
+class LocalTensorInferCache final {
+ public:
+  LocalTensorInferCache() = default;
+
+  // Returns nullptr on miss.
+  std::shared_ptr<LocalTensorInferResult> Find(const LocalTensorMetaInferArgs& infer_args) const;
+
+  void Insert(const LocalTensorMetaInferArgs& infer_args,
+              const std::shared_ptr<LocalTensorInferResult>& result);
+
+ private:
+  HashMap<LocalTensorMetaInferArgs, std::shared_ptr<LocalTensorInferResult>> cache_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_LOCAL_TENSOR_INFER_CACHE_H_
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/framework/op_interpreter.h"
 #include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
 #include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
 #include "oneflow/core/framework/scope_util.h"
 #include "oneflow/core/framework/session_util.h"
 #include "oneflow/core/framework/symbol_storage_util.h"
@@ -81,6 +82,15 @@ std::vector<TensorMeta*>* ThreadLocalDefaultOutputMutTensorMetas(int64_t size) {
   return &ptr_vec;
 }
 
+// The tensor metas of the outputs of ops with dynamic shapes (e.g. argwhere) are refreshed when
+// their shapes are synced, they can not be used as a cache key before that.
+bool AllShapesSynced(const EagerBlobObjectList& eager_blob_objects) {
+  for (const auto& eager_blob_object : eager_blob_objects) {
+    if (!eager_blob_object->is_shape_synced()) { return false; }
+  }
+  return true;
+}
+
 }  // namespace
 
 Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& inputs,
@@ -117,30 +127,73 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
   Symbol<Stream> stream;
   bool need_check_mem_case = true;
 
-  // Infer devices
-  if (!user_op_expr.has_device_and_stream_infer_fn()) {
-    stream = GetDefaultStreamByDevice(default_device);
+  static const bool infer_cache_enabled = EnvBool<ONEFLOW_EAGER_ENABLE_LOCAL_INFER_CACHE>();
+  const bool use_infer_cache = infer_cache_enabled && AllShapesSynced(*input_eager_blob_objects);
+  std::shared_ptr<const LocalTensorMetaInferArgs> infer_args;
+  std::shared_ptr<LocalTensorInferResult> infer_result;
+  if (use_infer_cache) {
+    infer_args = JUST(LocalTensorMetaInferArgs::New(attrs, default_device, inputs));
+    infer_result = user_op_expr.mut_local_tensor_infer_cache()->Find(*infer_args);
+  }
+  if (infer_result) {
+    // Reuse the devices, stream and tensor metas inferred by the first call with the same
+    // signature.
+    need_check_mem_case = !user_op_expr.has_device_and_stream_infer_fn();
+    stream = infer_result->stream();
     for (int i = 0; i < outputs->size(); i++) {
+      const auto& cached_tensor_meta = infer_result->output_tensor_metas().at(i);
       auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
-      *JUST(tensor_impl->mut_device()) = default_device;
+      *JUST(tensor_impl->mut_device()) = cached_tensor_meta.device();
+      TensorMeta* output_tensor_meta = output_tensor_metas->at(i);
+      *output_tensor_meta->mut_shape() = cached_tensor_meta.shape();
+      *output_tensor_meta->mut_stride() = cached_tensor_meta.stride();
+      output_tensor_meta->set_dtype(cached_tensor_meta.dtype());
+      output_tensor_meta->set_is_dynamic(cached_tensor_meta.is_dynamic());
     }
   } else {
-    need_check_mem_case = false;
-    stream = JUST(user_op_expr.InferDeviceAndStream(attrs, inputs, outputs));
-  }
+    // Infer devices
+    if (!user_op_expr.has_device_and_stream_infer_fn()) {
+      stream = GetDefaultStreamByDevice(default_device);
+      for (int i = 0; i < outputs->size(); i++) {
+        auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
+        *JUST(tensor_impl->mut_device()) = default_device;
+      }
+    } else {
+      need_check_mem_case = false;
+      stream = JUST(user_op_expr.InferDeviceAndStream(attrs, inputs, outputs));
+    }
 
-  // Infer shapes and dtypes
-  const auto& device_tag = stream->device()->type();
-  JUST(user_op_expr.InferPhysicalTensorDesc(
-      attrs, device_tag,
-      [&](int32_t i) -> const TensorMeta* {
-        return CHECK_JUST(TensorImpl4Tensor(inputs[i]))->mut_tensor_meta();
-      },
-      [&](int32_t i) -> TensorMeta* {
-        // using thread_local TensorMeta pointer if inplace.
-        // using tensor_impl TensorMeta pointer if not inplace.
-        return output_tensor_metas->at(i);
-      }));
+    // Infer shapes and dtypes
+    const auto& device_tag = stream->device()->type();
+    JUST(user_op_expr.InferPhysicalTensorDesc(
+        attrs, device_tag,
+        [&](int32_t i) -> const TensorMeta* {
+          return CHECK_JUST(TensorImpl4Tensor(inputs[i]))->mut_tensor_meta();
+        },
+        [&](int32_t i) -> TensorMeta* {
+          // using thread_local TensorMeta pointer if inplace.
+          // using tensor_impl TensorMeta pointer if not inplace.
+          return output_tensor_metas->at(i);
+        }));
+
+    if (use_infer_cache) {
+      infer_result = std::make_shared<LocalTensorInferResult>();
+      auto* cached_tensor_metas = infer_result->mut_output_tensor_metas();
+      cached_tensor_metas->reserve(outputs->size());
+      for (int i = 0; i < outputs->size(); i++) {
+        // copy the shape and stride, the output tensor may change them in place later
+        const TensorMeta& tensor_meta = *output_tensor_metas->at(i);
+        const auto& device = JUST(TensorImpl4Tensor(outputs->at(i)))->device();
+        cached_tensor_metas->emplace_back(std::make_shared<const Shape>(tensor_meta.shape()),
+                                          std::make_shared<const Stride>(tensor_meta.stride()),
+                                          tensor_meta.dtype(), device, 0);
+        cached_tensor_metas->back().set_is_dynamic(tensor_meta.is_dynamic());
+      }
+      infer_result->set_stream(stream);
+      infer_result->set_opkernel(JUST(user_op_expr.MutKernel4Stream(stream)));
+      user_op_expr.mut_local_tensor_infer_cache()->Insert(*infer_args, infer_result);
+    }
+  }
 
   const bool pin_memory = ctx.pin_memory.value_or(false);
   for (int i = 0; i < output_eager_blob_objects->size(); i++) {
@@ -167,7 +220,12 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
     }
   }
 
-  const auto& kernel = JUST(user_op_expr.MutKernel4Stream(stream));
+  std::shared_ptr<StatefulLocalOpKernel> kernel;
+  if (infer_result) {
+    kernel = infer_result->opkernel();
+  } else {
+    kernel = JUST(user_op_expr.MutKernel4Stream(stream));
+  }
   kernel->set_need_check_mem_case(need_check_mem_case);
 
   for (int64_t index : kernel->output_tuple_indexes4mut2_obns()) {
@@ -176,7 +234,7 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
 
   JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
     return builder->LocalCallOpKernel(kernel, input_eager_blob_objects, output_eager_blob_objects,
-                                      ctx, stream);
+                                      infer_result, ctx, stream);
   }));
   return Maybe<void>::Ok();
 }
@@ -470,10 +470,21 @@ class TensorDotFunctor {
   }
 };
 
+// cublas_fused_mlp and fused_matmul_bias_add_relu_dropout run on CPU for float and double, on
+// CUDA they need the cuBLASLt relu aux epilogue of CUDA 11.6.
+bool FusedMLPSupported(DeviceType device_type, DataType data_type) {
+  if (device_type == DeviceType::kCPU) {
+    return data_type == DataType::kFloat || data_type == DataType::kDouble;
+  }
+#if CUDA_VERSION >= 11060
+  if (device_type == DeviceType::kCUDA) { return true; }
+#endif  // CUDA_VERSION >= 11060
+  return false;
+}
+
 class FusedMLPFunctor {
  public:
   FusedMLPFunctor() {
-#if CUDA_VERSION >= 11060
     fused_op_.resize(kMaxInputCount /*the maximum number of inputs*/);
     for (int n = 1; n < fused_op_.size(); ++n) {
       fused_op_[n] = CHECK_JUST(one::OpBuilder("cublas_fused_mlp")
@@ -485,7 +496,6 @@ class FusedMLPFunctor {
                                     .Output("hidden", n)
                                     .Build());
     }
-#endif
   }
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x, const TensorTuple& weights,
                            const TensorTuple& biases, bool skip_final_activation) const {
@@ -523,7 +533,6 @@ class FusedMLPFunctor {
       k = n;
     }
 
-#if CUDA_VERSION >= 11060
     DeviceType device_type{};
     if (x->is_consistent()) {
       device_type = JUST(x->parallel_desc())->device_type();
@@ -531,7 +540,8 @@ class FusedMLPFunctor {
       device_type = JUST(x->device())->enum_type();
     }
 
-    if ((device_type == DeviceType::kCUDA) && (weight_size <= kMaxInputCount)
+    if (FusedMLPSupported(device_type, x->dtype()->data_type())
+        && (weight_size <= kMaxInputCount)
         && (!ParseBooleanFromEnv("ONEFLOW_FUNCTOR_DISABLE_FUSED_MLP", false))) {
       TensorTuple input(2 * weight_size + 1);
       input[0] = x;
@@ -542,7 +552,6 @@ class FusedMLPFunctor {
       JUST(attrs.SetAttr<bool>("skip_final_activation", skip_final_activation));
       return OpInterpUtil::Dispatch<Tensor>(*fused_op_[weight_size], input, attrs);
     }
-#endif  // CUDA_VERSION >= 11060
 
     // Fall back to Naive matmul + bias_add + relu
     std::shared_ptr<one::Tensor> out = x;
@@ -562,15 +571,12 @@ class FusedMLPFunctor {
   }
 
  private:
-#if CUDA_VERSION >= 11060
   std::vector<std::shared_ptr<OpExpr>> fused_op_;
-#endif
 };
 
 class FusedMatmulBiasAddReluDropoutFunctor {
  public:
   FusedMatmulBiasAddReluDropoutFunctor() {
-#if CUDA_VERSION >= 11060
     fused_op_.resize(kMaxInputCount /*the maximum number of inputs*/);
     for (int n = 1; n < fused_op_.size(); ++n) {
       fused_op_[n] = CHECK_JUST(one::OpBuilder("fused_matmul_bias_add_relu_dropout")
@@ -582,7 +588,6 @@ class FusedMatmulBiasAddReluDropoutFunctor {
                                     .Output("hidden", n)
                                     .Build());
     }
-#endif
   }
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x, const TensorTuple& weights,
                            const TensorTuple& biases, bool skip_final_activation,
@@ -625,7 +630,6 @@ class FusedMatmulBiasAddReluDropoutFunctor {
       k = n;
     }
 
-#if CUDA_VERSION >= 11060
     DeviceType device_type{};
     if (x->is_consistent()) {
       device_type = JUST(x->parallel_desc())->device_type();
@@ -633,7 +637,8 @@ class FusedMatmulBiasAddReluDropoutFunctor {
       device_type = JUST(x->device())->enum_type();
     }
 
-    if ((device_type == DeviceType::kCUDA) && (weight_size <= kMaxInputCount)
+    if (FusedMLPSupported(device_type, x->dtype()->data_type())
+        && (weight_size <= kMaxInputCount)
         && (!ParseBooleanFromEnv("ONEFLOW_FUNCTOR_DISABLE_FUSED_MLP", false))) {
       TensorTuple input(2 * weight_size + 1);
       input[0] = x;
@@ -645,7 +650,6 @@ class FusedMatmulBiasAddReluDropoutFunctor {
       return OpInterpUtil::Dispatch<Tensor>(*fused_op_[weight_size], input,
                                             OpExprInterpContext(attrs, dropout_state));
     }
-#endif  // CUDA_VERSION >= 11060
 
     // Fall back to Naive matmul + bias_add + relu + dropout
     std::shared_ptr<one::Tensor> out = x;
@@ -670,9 +674,7 @@ class FusedMatmulBiasAddReluDropoutFunctor {
   }
 
  private:
-#if CUDA_VERSION >= 11060
   std::vector<std::shared_ptr<OpExpr>> fused_op_;
-#endif
 };
 
 class LayerNormFunctor {
@@ -2750,6 +2752,74 @@ class FusedScaleMaskSoftmaxDropoutFunctor {
   std::shared_ptr<OpExpr> fused_scale_mask_softmax_dropout_op_;
 };
 
+class FusedMultiHeadAttentionFunctor {
+ public:
+  FusedMultiHeadAttentionFunctor() {
+    random_mask_like_op_ =
+        CHECK_JUST(one::OpBuilder("random_mask_like").Input("like").Output("out").Build());
+    // Indexed by [has_key_padding_mask][has_dropout_mask].
+    for (int has_key_padding_mask = 0; has_key_padding_mask < 2; ++has_key_padding_mask) {
+      for (int has_dropout_mask = 0; has_dropout_mask < 2; ++has_dropout_mask) {
+        one::OpBuilder builder("fused_multi_head_attention");
+        builder.Input("query").Input("key").Input("value");
+        if (has_key_padding_mask) { builder.Input("key_padding_mask"); }
+        if (has_dropout_mask) { builder.Input("dropout_mask"); }
+        ops_[has_key_padding_mask][has_dropout_mask] =
+            CHECK_JUST(builder.Output("out").Output("softmax_lse").Build());
+      }
+    }
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& query,
+                           const std::shared_ptr<one::Tensor>& key,
+                           const std::shared_ptr<one::Tensor>& value,
+                           const Optional<one::Tensor>& key_padding_mask, const bool& causal,
+                           const float& scale, const float& dropout_rate, const bool& training,
+                           const Optional<one::Generator>& generator) const {
+    const int64_t num_axes = query->ndim();
+    CHECK_GE_OR_RETURN(num_axes, 3)
+        << Error::RuntimeError() << "fused_multi_head_attention expects query of shape "
+        << "(..., seq_len, head_size), but got " << query->shape()->ToString();
+    float rate = dropout_rate;
+    if (!training) { rate = 0.0; }
+    CHECK_OR_RETURN(rate >= 0.0 && rate < 1.0)
+        << Error::RuntimeError() << "dropout_rate should be in [0, 1), but got " << rate;
+
+    TensorTuple inputs{query, key, value};
+    if (key_padding_mask.has_value()) { inputs.emplace_back(JUST(key_padding_mask)); }
+    float dropout_scale = 1.0;
+    if (rate > 0.0) {
+      CHECK_OR_RETURN(query->is_local())
+          << Error::RuntimeError() << "fused_multi_head_attention only supports dropout on "
+          << "local tensors";
+      // The dropout mask is drawn once and fed to both the forward and the backward kernels.
+      DimVector dim_vec(query->shape()->dim_vec().begin(), query->shape()->dim_vec().end() - 1);
+      dim_vec.emplace_back(key->shape()->At(num_axes - 2));
+      const auto& like =
+          JUST(functional::Empty(Shape(dim_vec), DType::Bool(), JUST(query->device()), false));
+      const auto gen = generator.value_or(JUST(one::DefaultAutoGenerator()));
+      MutableAttrMap random_mask_like_attrs;
+      JUST(random_mask_like_attrs.SetAttr<float>("rate", rate));
+      JUST(random_mask_like_attrs.SetAttr<int64_t>("seed", gen->current_seed()));
+      const auto& random_mask_like_state = std::make_shared<RandomMaskLikeKernelState>(gen);
+      inputs.emplace_back(JUST(OpInterpUtil::Dispatch<Tensor>(
+          *random_mask_like_op_, {like},
+          OpExprInterpContext(random_mask_like_attrs, random_mask_like_state))));
+      dropout_scale = 1.0 / (1.0 - rate);
+    }
+
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<float>("scale", scale));
+    JUST(attrs.SetAttr<bool>("causal", causal));
+    JUST(attrs.SetAttr<float>("dropout_scale", dropout_scale));
+    const auto& op = ops_[key_padding_mask.has_value()][rate > 0.0];
+    return JUST(OpInterpUtil::Dispatch<TensorTuple>(*op, inputs, attrs))->at(0);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> random_mask_like_op_;
+  std::shared_ptr<OpExpr> ops_[2][2];
+};
+
 class CtcGreedyDecoderFunctor {
  public:
   CtcGreedyDecoderFunctor() {
@@ -3409,6 +3479,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::FusedBiasAddDropoutFunctor>("FusedBiasAddDropout");
   m.add_functor<impl::FusedScaleMaskSoftmaxFunctor>("FusedScaleMaskSoftmax");
   m.add_functor<impl::FusedScaleMaskSoftmaxDropoutFunctor>("FusedScaleMaskSoftmaxDropout");
+  m.add_functor<impl::FusedMultiHeadAttentionFunctor>("FusedMultiHeadAttention");
   m.add_functor<impl::FusedScaleTrilSoftmaxMaskScaleFunctor>("FusedScaleTrilSoftmaxMaskScale");
   m.add_functor<impl::FusedScaleTrilFunctor>("FusedScaleTril");
   m.add_functor<impl::CtcGreedyDecoderFunctor>("CtcGreedyDecoder");
@@ -934,6 +934,43 @@ class FusedScaleMaskSoftmaxDropoutGradFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class FusedMultiHeadAttentionGradFunctor {
+ public:
+  FusedMultiHeadAttentionGradFunctor() {
+    // Indexed by [has_key_padding_mask][has_dropout_mask].
+    for (int has_key_padding_mask = 0; has_key_padding_mask < 2; ++has_key_padding_mask) {
+      for (int has_dropout_mask = 0; has_dropout_mask < 2; ++has_dropout_mask) {
+        one::OpBuilder builder("fused_multi_head_attention_grad");
+        builder.Input("query").Input("key").Input("value").Input("out").Input("softmax_lse");
+        builder.Input("out_grad");
+        if (has_key_padding_mask) { builder.Input("key_padding_mask"); }
+        if (has_dropout_mask) { builder.Input("dropout_mask"); }
+        ops_[has_key_padding_mask][has_dropout_mask] = CHECK_JUST(
+            builder.Output("query_grad").Output("key_grad").Output("value_grad").Build());
+      }
+    }
+  }
+  Maybe<TensorTuple> operator()(
+      const std::shared_ptr<one::Tensor>& query, const std::shared_ptr<one::Tensor>& key,
+      const std::shared_ptr<one::Tensor>& value, const std::shared_ptr<one::Tensor>& out,
+      const std::shared_ptr<one::Tensor>& softmax_lse, const std::shared_ptr<one::Tensor>& out_grad,
+      const Optional<one::Tensor>& key_padding_mask, const Optional<one::Tensor>& dropout_mask,
+      const bool& causal, const float& scale, const float& dropout_scale) const {
+    TensorTuple inputs{query, key, value, out, softmax_lse, out_grad};
+    if (key_padding_mask.has_value()) { inputs.emplace_back(JUST(key_padding_mask)); }
+    if (dropout_mask.has_value()) { inputs.emplace_back(JUST(dropout_mask)); }
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<float>("scale", scale));
+    JUST(attrs.SetAttr<bool>("causal", causal));
+    JUST(attrs.SetAttr<float>("dropout_scale", dropout_scale));
+    const auto& op = ops_[key_padding_mask.has_value()][dropout_mask.has_value()];
+    return OpInterpUtil::Dispatch<TensorTuple>(*op, inputs, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> ops_[2][2];
+};
+
 class CublasBiasAddReluMatmulGradFunctor {
  public:
   CublasBiasAddReluMatmulGradFunctor() {
@@ -1143,6 +1180,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       "FusedScaleTrilSoftmaxMaskScaleGrad");
   m.add_functor<impl::FusedScaleMaskSoftmaxGradFunctor>("FusedScaleMaskSoftmaxGrad");
   m.add_functor<impl::FusedScaleMaskSoftmaxDropoutGradFunctor>("FusedScaleMaskSoftmaxDropoutGrad");
+  m.add_functor<impl::FusedMultiHeadAttentionGradFunctor>("FusedMultiHeadAttentionGrad");
   m.add_functor<impl::CublasBiasAddReluMatmulGradFunctor>("CublasBiasAddReluMatmulGrad");
   m.add_functor<impl::CublasMatmulBiasAddGradFunctor>("CublasMatmulBiasAddGrad");
   m.add_functor<impl::FusedReluDropoutGradFunctor>("FusedReluDropoutGrad");
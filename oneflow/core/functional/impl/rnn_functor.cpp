@@ -202,8 +202,27 @@ static Maybe<std::vector<CellParams>> gather_params(const TensorTuple& params, b
   return result;
 }
 
+// The fused cell kernels cover CUDA, and float and double on CPU.
+Maybe<bool> use_fused_cell(const std::shared_ptr<one::Tensor>& input) {
+  DeviceType input_device{};
+  if (input->is_consistent()) {
+    input_device = JUST(input->parallel_desc())->device_type();
+  } else {
+    input_device = JUST(input->device())->enum_type();
+  }
+  if (input_device == DeviceType::kCUDA) { return true; }
+  const DataType data_type = input->dtype()->data_type();
+  return input_device == DeviceType::kCPU
+         && (data_type == DataType::kFloat || data_type == DataType::kDouble);
+}
+
 template<typename nonlinearity, typename cell_params>
 struct SimpleCell {
+  static Maybe<Tensor> project_input(const std::shared_ptr<one::Tensor>& input,
+                                     const cell_params& params) {
+    return params.linear_ih(input);
+  }
+
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& input,
                            const std::shared_ptr<one::Tensor>& hidden, const cell_params& params,
                            bool pre_compute_input = false) const {
@@ -221,20 +240,19 @@ struct SimpleCell {
 
 template<typename cell_params>
 struct GRUCell {
+  // The fused cells add the input bias in their kernels, so it is left out of the projection.
+  static Maybe<Tensor> project_input(const std::shared_ptr<one::Tensor>& input,
+                                     const cell_params& params) {
+    if (JUST(use_fused_cell(input))) { return params.matmul_ih(input); }
+    return params.linear_ih(input);
+  }
+
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& input,
                            const std::shared_ptr<one::Tensor>& hidden, const cell_params& params,
                            bool pre_compute_input = false) const {
-    DeviceType input_device{};
-    if (input->is_consistent()) {
-      input_device = JUST(input->parallel_desc())->device_type();
-    } else {
-      input_device = JUST(input->device())->enum_type();
-    }
-
-    if (input_device == DeviceType::kCUDA) {
-      CHECK_OR_RETURN(!pre_compute_input);
-
-      std::shared_ptr<one::Tensor> igates = JUST(params.matmul_ih(input));
+    if (JUST(use_fused_cell(input))) {
+      std::shared_ptr<one::Tensor> igates = input;
+      if (!pre_compute_input) { igates = JUST(params.matmul_ih(input)); }
       std::shared_ptr<one::Tensor> hgates = JUST(params.matmul_hh(hidden));
 
       std::shared_ptr<TensorTuple> result =
@@ -271,23 +289,22 @@ struct GRUCell {
 
 template<typename cell_params>
 struct LSTMCell {
+  // The fused cells add the input bias in their kernels, so it is left out of the projection.
+  static Maybe<Tensor> project_input(const std::shared_ptr<one::Tensor>& input,
+                                     const cell_params& params) {
+    if (JUST(use_fused_cell(input))) { return params.matmul_ih(input); }
+    return params.linear_ih(input);
+  }
+
   Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& input,
                                 const one::TensorTuple& hidden, const cell_params& params,
                                 bool pre_compute_input = false) const {
     const std::shared_ptr<Tensor>& hx = hidden[0];
     const std::shared_ptr<Tensor>& cx = hidden[1];
 
-    DeviceType input_device{};
-    if (input->is_consistent()) {
-      input_device = JUST(input->parallel_desc())->device_type();
-    } else {
-      input_device = JUST(input->device())->enum_type();
-    }
-
-    if (input_device == DeviceType::kCUDA) {
-      CHECK_OR_RETURN(!pre_compute_input);
-
-      std::shared_ptr<one::Tensor> igates = JUST(params.matmul_ih(input));
+    if (JUST(use_fused_cell(input))) {
+      std::shared_ptr<one::Tensor> igates = input;
+      if (!pre_compute_input) { igates = JUST(params.matmul_ih(input)); }
       std::shared_ptr<one::Tensor> hgates = JUST(params.matmul_hh(hx));
 
       std::shared_ptr<TensorTuple> result =
@@ -323,6 +340,22 @@ struct LSTMCell {
   }
 };
 
+// Projects the inputs of all the timesteps with one matmul rather than one per timestep, in the
+// layout the cell expects when pre_compute_input is set. The timesteps may differ in batch size.
+template<typename cell_type>
+Maybe<TensorTuple> project_inputs(const TensorTuple& inputs, const CellParams& params) {
+  std::shared_ptr<one::Tensor> projected =
+      JUST(cell_type::project_input(JUST(functional::Concat(inputs, 0)), params));
+  auto outputs = std::make_shared<TensorTuple>(inputs.size());
+  int64_t offset = 0;
+  for (int32_t i = 0; i < inputs.size(); ++i) {
+    const int64_t batch_size = inputs[i]->shape()->At(0);
+    (*outputs)[i] = JUST(functional::Narrow(projected, 0, offset, batch_size));
+    offset += batch_size;
+  }
+  return outputs;
+}
+
 class RnnTanhCellFunctor {
  public:
   RnnTanhCellFunctor() {}
@@ -672,8 +705,10 @@ Maybe<TensorTuple> _rnn_impl(const std::shared_ptr<one::Tensor>& input,
       // forward direction
       std::shared_ptr<one::Tensor> fw_hidden = (*rnn_hiddens)[l * 2];
       auto& fw_cell_param = (*rnn_params)[l * 2];
+      std::shared_ptr<TensorTuple> fw_inputs =
+          JUST(project_inputs<cell_type>(*rnn_inputs, fw_cell_param));
       for (int32_t i = 0; i < rnn_inputs->size(); ++i) {
-        fw_hidden = JUST(cell_type{}((*rnn_inputs)[i], fw_hidden, fw_cell_param));
+        fw_hidden = JUST(cell_type{}((*fw_inputs)[i], fw_hidden, fw_cell_param, true));
         (*fw_outputs)[i] = fw_hidden;
       }
       final_hiddens.emplace_back(fw_hidden);
@@ -681,8 +716,10 @@ Maybe<TensorTuple> _rnn_impl(const std::shared_ptr<one::Tensor>& input,
       // reverse direction
       std::shared_ptr<one::Tensor> bw_hidden = (*rnn_hiddens)[l * 2 + 1];
       auto& bw_cell_param = (*rnn_params)[l * 2 + 1];
+      std::shared_ptr<TensorTuple> bw_inputs =
+          JUST(project_inputs<cell_type>(*rnn_inputs, bw_cell_param));
       for (int32_t i = rnn_inputs->size() - 1; i >= 0; i--) {
-        bw_hidden = JUST(cell_type{}((*rnn_inputs)[i], bw_hidden, bw_cell_param));
+        bw_hidden = JUST(cell_type{}((*bw_inputs)[i], bw_hidden, bw_cell_param, true));
         (*bw_outputs)[i] = bw_hidden;
       }
       final_hiddens.emplace_back(bw_hidden);
@@ -704,8 +741,10 @@ Maybe<TensorTuple> _rnn_impl(const std::shared_ptr<one::Tensor>& input,
     for (int32_t l = 0; l < num_layers; ++l) {
       std::shared_ptr<one::Tensor> hidden = (*rnn_hiddens)[l];
       auto& cell_param = (*rnn_params)[l];
+      std::shared_ptr<TensorTuple> layer_inputs =
+          JUST(project_inputs<cell_type>(*rnn_inputs, cell_param));
       for (int32_t i = 0; i < rnn_inputs->size(); ++i) {
-        hidden = JUST(cell_type{}((*rnn_inputs)[i], hidden, cell_param));
+        hidden = JUST(cell_type{}((*layer_inputs)[i], hidden, cell_param, true));
         (*rnn_inputs)[i] = hidden;
       }
       final_hiddens.emplace_back(hidden);
@@ -795,6 +834,8 @@ Maybe<TensorTuple> _rnn_pack_sequence_impl(const std::shared_ptr<one::Tensor>& i
       int64_t last_batch_size = batch_sizes_vec[0];
       std::shared_ptr<one::Tensor> fw_hidden = (*rnn_hiddens)[l * 2];
       auto& fw_cell_param = (*rnn_params)[l * 2];
+      std::shared_ptr<TensorTuple> fw_inputs =
+          JUST(project_inputs<cell_type>(*rnn_inputs, fw_cell_param));
 
       TensorTuple fw_final_hiddens_for_single_layer;
       for (int32_t i = 0; i < num_steps; ++i) {
@@ -806,7 +847,7 @@ Maybe<TensorTuple> _rnn_pack_sequence_impl(const std::shared_ptr<one::Tensor>& i
           fw_hidden = JUST(functional::Narrow(fw_hidden, 0, 0, last_batch_size - dec));
         }
         last_batch_size = batch_size;
-        fw_hidden = JUST(cell_type{}((*rnn_inputs)[i], fw_hidden, fw_cell_param));
+        fw_hidden = JUST(cell_type{}((*fw_inputs)[i], fw_hidden, fw_cell_param, true));
         (*fw_outputs)[i] = fw_hidden;
       }
       fw_final_hiddens_for_single_layer.emplace_back(fw_hidden);
@@ -819,6 +860,8 @@ Maybe<TensorTuple> _rnn_pack_sequence_impl(const std::shared_ptr<one::Tensor>& i
       std::shared_ptr<one::Tensor> bw_hidden =
           JUST(functional::Narrow((*rnn_hiddens)[l * 2 + 1], 0, 0, last_batch_size));
       auto& bw_cell_param = (*rnn_params)[l * 2 + 1];
+      std::shared_ptr<TensorTuple> bw_inputs =
+          JUST(project_inputs<cell_type>(*rnn_inputs, bw_cell_param));
       // Here the situation is similar to that above, except we start out with
       // the smallest batch size (and a small set of hidden states we actually use),
       // and progressively expand the hidden states, as we move backwards over the
@@ -835,7 +878,7 @@ Maybe<TensorTuple> _rnn_pack_sequence_impl(const std::shared_ptr<one::Tensor>& i
           bw_hidden = JUST(functional::Concat(*tmp, 0));
         }
         last_batch_size = batch_size;
-        bw_hidden = JUST(cell_type{}((*rnn_inputs)[i], bw_hidden, bw_cell_param));
+        bw_hidden = JUST(cell_type{}((*bw_inputs)[i], bw_hidden, bw_cell_param, true));
         (*bw_outputs)[i] = bw_hidden;
       }
 
@@ -870,6 +913,8 @@ Maybe<TensorTuple> _rnn_pack_sequence_impl(const std::shared_ptr<one::Tensor>& i
       int64_t last_batch_size = batch_sizes_vec[0];
       std::shared_ptr<one::Tensor> hidden = (*rnn_hiddens)[l];
       auto& cell_param = (*rnn_params)[l];
+      std::shared_ptr<TensorTuple> layer_inputs =
+          JUST(project_inputs<cell_type>(*rnn_inputs, cell_param));
       TensorTuple final_hiddens_for_single_layer;
       for (int32_t i = 0; i < num_steps; ++i) {
         const int64_t batch_size = batch_sizes_vec[i];
@@ -880,7 +925,7 @@ Maybe<TensorTuple> _rnn_pack_sequence_impl(const std::shared_ptr<one::Tensor>& i
           hidden = JUST(functional::Narrow(hidden, 0, 0, last_batch_size - dec));
         }
         last_batch_size = batch_size;
-        hidden = JUST(cell_type{}((*rnn_inputs)[i], hidden, cell_param));
+        hidden = JUST(cell_type{}((*layer_inputs)[i], hidden, cell_param, true));
         (*rnn_inputs)[i] = hidden;
       }
       final_hiddens_for_single_layer.emplace_back(hidden);
@@ -971,9 +1016,11 @@ Maybe<TensorTuple> _lstm_impl(const std::shared_ptr<one::Tensor>& input, const o
       (*lstm_cell_out)[0] = (*layer_hxs)[l * 2];
       (*lstm_cell_out)[1] = (*layer_cxs)[l * 2];
       auto& fw_cell_param = (*rnn_params)[l * 2];
+      std::shared_ptr<TensorTuple> fw_inputs =
+          JUST(project_inputs<LSTMCell<CellParams>>(*rnn_inputs, fw_cell_param));
       for (int32_t i = 0; i < rnn_inputs->size(); ++i) {
         lstm_cell_out =
-            JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, fw_cell_param));
+            JUST(LSTMCell<CellParams>{}((*fw_inputs)[i], *lstm_cell_out, fw_cell_param, true));
         (*fw_outputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy.emplace_back((*lstm_cell_out)[0]);
@@ -983,9 +1030,11 @@ Maybe<TensorTuple> _lstm_impl(const std::shared_ptr<one::Tensor>& input, const o
       (*lstm_cell_out)[0] = (*layer_hxs)[l * 2 + 1];
       (*lstm_cell_out)[1] = (*layer_cxs)[l * 2 + 1];
       auto& bw_cell_param = (*rnn_params)[l * 2 + 1];
+      std::shared_ptr<TensorTuple> bw_inputs =
+          JUST(project_inputs<LSTMCell<CellParams>>(*rnn_inputs, bw_cell_param));
       for (int32_t i = rnn_inputs->size() - 1; i >= 0; i--) {
         lstm_cell_out =
-            JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, bw_cell_param));
+            JUST(LSTMCell<CellParams>{}((*bw_inputs)[i], *lstm_cell_out, bw_cell_param, true));
         (*bw_outputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy.emplace_back((*lstm_cell_out)[0]);
@@ -1010,10 +1059,13 @@ Maybe<TensorTuple> _lstm_impl(const std::shared_ptr<one::Tensor>& input, const o
 
     for (int32_t l = 0; l < num_layers; ++l) {
       auto& cell_param = (*rnn_params)[l];
+      std::shared_ptr<TensorTuple> layer_inputs =
+          JUST(project_inputs<LSTMCell<CellParams>>(*rnn_inputs, cell_param));
       (*lstm_cell_out)[0] = (*layer_hxs)[l];
       (*lstm_cell_out)[1] = (*layer_cxs)[l];
       for (int32_t i = 0; i < rnn_inputs->size(); ++i) {
-        lstm_cell_out = JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, cell_param));
+        lstm_cell_out =
+            JUST(LSTMCell<CellParams>{}((*layer_inputs)[i], *lstm_cell_out, cell_param, true));
         (*rnn_inputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy.emplace_back((*lstm_cell_out)[0]);
@@ -1101,6 +1153,8 @@ Maybe<TensorTuple> _lstm_pack_sequence_impl(const std::shared_ptr<one::Tensor>&
       (*lstm_cell_out)[0] = (*layer_hxs)[l * 2];
       (*lstm_cell_out)[1] = (*layer_cxs)[l * 2];
       auto& fw_cell_param = (*rnn_params)[l * 2];
+      std::shared_ptr<TensorTuple> fw_inputs =
+          JUST(project_inputs<LSTMCell<CellParams>>(*rnn_inputs, fw_cell_param));
 
       TensorTuple final_hy_for_single_layer;
       TensorTuple final_cy_for_single_layer;
@@ -1120,7 +1174,7 @@ Maybe<TensorTuple> _lstm_pack_sequence_impl(const std::shared_ptr<one::Tensor>&
         }
         last_batch_size = batch_size;
         lstm_cell_out =
-            JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, fw_cell_param));
+            JUST(LSTMCell<CellParams>{}((*fw_inputs)[i], *lstm_cell_out, fw_cell_param, true));
         (*fw_outputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy_for_single_layer.emplace_back((*lstm_cell_out)[0]);
@@ -1138,6 +1192,8 @@ Maybe<TensorTuple> _lstm_pack_sequence_impl(const std::shared_ptr<one::Tensor>&
           JUST(functional::Narrow((*layer_cxs)[l * 2 + 1], 0, 0, last_batch_size));
 
       auto& bw_cell_param = (*rnn_params)[l * 2 + 1];
+      std::shared_ptr<TensorTuple> bw_inputs =
+          JUST(project_inputs<LSTMCell<CellParams>>(*rnn_inputs, bw_cell_param));
 
       for (int64_t i = num_steps - 1; i >= 0; --i) {
         const int64_t batch_size = batch_sizes_vec[i];
@@ -1158,7 +1214,7 @@ Maybe<TensorTuple> _lstm_pack_sequence_impl(const std::shared_ptr<one::Tensor>&
         }
         last_batch_size = batch_size;
         lstm_cell_out =
-            JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, bw_cell_param));
+            JUST(LSTMCell<CellParams>{}((*bw_inputs)[i], *lstm_cell_out, bw_cell_param, true));
         (*bw_outputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy.emplace_back((*lstm_cell_out)[0]);
@@ -1189,6 +1245,8 @@ Maybe<TensorTuple> _lstm_pack_sequence_impl(const std::shared_ptr<one::Tensor>&
       (*lstm_cell_out)[0] = (*layer_hxs)[l];
       (*lstm_cell_out)[1] = (*layer_cxs)[l];
       auto& cell_param = (*rnn_params)[l];
+      std::shared_ptr<TensorTuple> layer_inputs =
+          JUST(project_inputs<LSTMCell<CellParams>>(*rnn_inputs, cell_param));
       TensorTuple final_hy_for_single_layer;
       TensorTuple final_cy_for_single_layer;
       for (int32_t i = 0; i < num_steps; ++i) {
@@ -1206,7 +1264,8 @@ Maybe<TensorTuple> _lstm_pack_sequence_impl(const std::shared_ptr<one::Tensor>&
               JUST(functional::Narrow((*lstm_cell_out)[1], 0, 0, last_batch_size - dec));
         }
         last_batch_size = batch_size;
-        lstm_cell_out = JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, cell_param));
+        lstm_cell_out =
+            JUST(LSTMCell<CellParams>{}((*layer_inputs)[i], *lstm_cell_out, cell_param, true));
         (*rnn_inputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy_for_single_layer.emplace_back((*lstm_cell_out)[0]);
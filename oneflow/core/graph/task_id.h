@@ -57,6 +57,9 @@ TaskId DecodeTaskIdFromInt64(int64_t);
 
 int64_t MachineId4ActorId(int64_t actor_id);
 int64_t ThrdId4ActorId(int64_t actor_id);
+// Task indices are generated densely per stream, so this is a compact index among the actors
+// sharing a thread.
+TaskId::task_index_t TaskIndex4ActorId(int64_t actor_id);
 
 }  // namespace oneflow
 
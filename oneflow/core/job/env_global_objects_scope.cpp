@@ -47,6 +47,7 @@ limitations under the License.
 #include "oneflow/core/kernel/blob_access_checker_kernel_observer.h"
 #include "oneflow/core/kernel/profiler_kernel_observer.h"
 #include "oneflow/core/embedding/embedding_manager.h"
+#include "oneflow/core/profiler/metrics.h"
 #ifdef WITH_RDMA
 #include "oneflow/core/platform/include/ibv.h"
 #endif  // WITH_RDMA
@@ -214,6 +215,7 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
     Global<KernelObserver>::SetAllocated(new ChainKernelObserver(kernel_observers));
   }
   TensorBufferPool::New();
+  Global<profiler::MetricsExporter>::New();
   return Maybe<void>::Ok();
 }
 
@@ -221,6 +223,7 @@ EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
   VLOG(2) << "Try to close env global objects scope." << std::endl;
   OF_ENV_BARRIER();
   if (is_normal_exit_.has_value() && !CHECK_JUST(is_normal_exit_)) { return; }
+  Global<profiler::MetricsExporter>::Delete();
   TensorBufferPool::Delete();
   Global<KernelObserver>::Delete();
   if (!Global<ResourceDesc, ForSession>::Get()->enable_dry_run()) {
@@ -14,13 +14,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
-#ifdef WITH_CUDA
-
 #include "oneflow/core/job_rewriter/auto_mixed_precision_lists.h"
 
 #include <algorithm>
 
+#ifdef WITH_CUDA
 #include "oneflow/core/device/cuda_util.h"
+#endif  // WITH_CUDA
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/job_rewriter/job_pass.h"
 #include "oneflow/core/job_rewriter/pass_util.h"
@@ -53,17 +53,30 @@ bool FindInNoCastRegisry(const std::string& op_type, const OpArg& op_arg) {
   return false;
 }
 
-std::function<bool(OpNode*)> MakePredicatorIsAllowedToRunWithHalf(const OpGraph& op_graph) {
+DeviceType DeviceType4MixedPrecisionDataType(DataType mixed_precision_data_type) {
+  if (mixed_precision_data_type == DataType::kFloat16) {
+    return DeviceType::kCUDA;
+  } else if (mixed_precision_data_type == DataType::kBFloat16) {
+    return DeviceType::kCPU;
+  } else {
+    UNIMPLEMENTED() << "AutoMixedPrecision does not support " << mixed_precision_data_type;
+    return DeviceType::kInvalidDevice;
+  }
+}
+
+std::function<bool(OpNode*)> MakePredicatorIsAllowedToRunWithHalf(
+    const OpGraph& op_graph, DataType mixed_precision_data_type) {
+  const DeviceType device_type = DeviceType4MixedPrecisionDataType(mixed_precision_data_type);
   auto allowed_set = std::make_shared<HashSet<OpNode*>>();
   op_graph.ForEachNode([&](OpNode* node) {
-    if (node->parallel_desc().device_type() != DeviceType::kCUDA) { return; }
+    if (node->parallel_desc().device_type() != device_type) { return; }
     if (node->op().output_bns().size() > 0) { INSERT_CHECK(allowed_set->insert(node)); }
   });
   return [allowed_set](OpNode* node) -> bool { return IsKeyFound(*allowed_set, node); };
 }
 
-void InsertCastOpImpl(bool f2h, const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
-                      JobBuilder* job_builder) {
+void InsertCastOpImpl(bool f2h, DataType mixed_precision_data_type, const OpGraph& op_graph,
+                      const HashSet<OpNode*>& white_set, JobBuilder* job_builder) {
   HashSet<OpEdge*> white_set_edges;
   {
     std::function<const std::unordered_set<OpEdge*>&(OpNode*)> Node2Edges =
@@ -104,7 +117,7 @@ void InsertCastOpImpl(bool f2h, const OpGraph& op_graph, const HashSet<OpNode*>&
     if (blob_desc.data_type() != DataType::kFloat) { continue; }
 
     std::string cast_suffix = f2h ? "-cast_f2h" : "-cast_h2f";
-    DataType cast_data_type = f2h ? DataType::kFloat16 : DataType::kFloat;
+    DataType cast_data_type = f2h ? mixed_precision_data_type : DataType::kFloat;
     auto cast_op = user_op::UserOpConfWrapperBuilder(ReplaceSlashToDash4Lbn(lbn) + cast_suffix)
                        .Op("cast")
                        .Input("in", lbn)
@@ -157,11 +170,19 @@ void InsertCastOpImpl(bool f2h, const OpGraph& op_graph, const HashSet<OpNode*>&
 class AutoMixedPrecision final : public JobPass {
  public:
   OF_DISALLOW_COPY_AND_MOVE(AutoMixedPrecision);
-  AutoMixedPrecision()
-      : white_list_(AutoMixedPrecisionLists::WhiteList()),
+  AutoMixedPrecision() : AutoMixedPrecision(DataType::kFloat16) {}
+  explicit AutoMixedPrecision(DataType mixed_precision_data_type)
+      : mixed_precision_data_type_(mixed_precision_data_type),
+        white_list_(mixed_precision_data_type == DataType::kBFloat16
+                        ? AutoMixedPrecisionLists::CpuBFloat16WhiteList()
+                        : AutoMixedPrecisionLists::WhiteList()),
         black_list_(AutoMixedPrecisionLists::BlackList()),
-        gray_list_(AutoMixedPrecisionLists::GrayList()),
-        clear_list_(AutoMixedPrecisionLists::ClearList()) {}
+        gray_list_(mixed_precision_data_type == DataType::kBFloat16
+                       ? AutoMixedPrecisionLists::CpuBFloat16GrayList()
+                       : AutoMixedPrecisionLists::GrayList()),
+        clear_list_(mixed_precision_data_type == DataType::kBFloat16
+                        ? AutoMixedPrecisionLists::CpuBFloat16ClearList()
+                        : AutoMixedPrecisionLists::ClearList()) {}
   ~AutoMixedPrecision() = default;
 
   bool IsEnabled(const JobPassCtx& ctx) const {
@@ -174,6 +195,10 @@ class AutoMixedPrecision final : public JobPass {
     if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
     const OpGraph op_graph(*job);
     JobBuilder job_builder(job);
+    const DataType mixed_precision_data_type = ctx->job_desc().mixed_precision_data_type();
+    if (mixed_precision_data_type != mixed_precision_data_type_) {
+      return AutoMixedPrecision(mixed_precision_data_type).Apply(op_graph, &job_builder);
+    }
     return Apply(op_graph, &job_builder);
   }
 
@@ -188,6 +213,7 @@ class AutoMixedPrecision final : public JobPass {
   void InsertCastOp(const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
                     JobBuilder* job_builder) const;
 
+  const DataType mixed_precision_data_type_;
   const AMPList& white_list_;
   const AMPList& black_list_;
   const AMPList& gray_list_;
@@ -195,7 +221,17 @@ class AutoMixedPrecision final : public JobPass {
 };
 
 Maybe<void> AutoMixedPrecision::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
-  CHECK_GE(CUDA_VERSION, 10000);
+  if (mixed_precision_data_type_ == DataType::kFloat16) {
+#ifdef WITH_CUDA
+    CHECK_GE(CUDA_VERSION, 10000);
+#else
+    // float16 AMP used to be compiled out of the builds without CUDA, keep the jobs enabling it
+    // running in float32 there.
+    LOG(WARNING) << "float16 AutoMixedPrecision requires CUDA, it is skipped in this build. Set "
+                    "the mixed precision data type to bfloat16 for CPU mixed precision.";
+    return Maybe<void>::Ok();
+#endif  // WITH_CUDA
+  }
   CHECK(GlobalJobDesc().DefaultDataType() == DataType::kFloat);
 
   VerifyAMPList(white_list_);
@@ -213,7 +249,8 @@ Maybe<void> AutoMixedPrecision::Apply(const OpGraph& op_graph, JobBuilder* job_b
   VLOG(3) << "BlackSet include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(black_set, OpName4Node);
 
-  auto IsAllowedToRunWithHalf = MakePredicatorIsAllowedToRunWithHalf(op_graph);
+  auto IsAllowedToRunWithHalf =
+      MakePredicatorIsAllowedToRunWithHalf(op_graph, mixed_precision_data_type_);
   FillWhiteSet(op_graph, IsAllowedToRunWithHalf, black_set, &white_set);
   VLOG(3) << "WhiteSet Before Propagate include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(white_set, OpName4Node);
@@ -305,8 +342,8 @@ void AutoMixedPrecision::PropagateWhiteThroughClearNodes(
 
 void AutoMixedPrecision::InsertCastOp(const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
                                       JobBuilder* job_builder) const {
-  InsertCastOpImpl(true, op_graph, white_set, job_builder);
-  InsertCastOpImpl(false, op_graph, white_set, job_builder);
+  InsertCastOpImpl(true, mixed_precision_data_type_, op_graph, white_set, job_builder);
+  InsertCastOpImpl(false, mixed_precision_data_type_, op_graph, white_set, job_builder);
 }
 
 REGISTER_JOB_PASS("AutoMixedPrecision", AutoMixedPrecision);
@@ -343,5 +380,3 @@ REGISTER_NO_CAST_REGISTRY("normalization_add_relu", "beta", 0)
 }  // namespace
 
 }  // namespace oneflow
-
-#endif  // WITH_CUDA
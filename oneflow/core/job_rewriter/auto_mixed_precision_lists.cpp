@@ -106,4 +106,20 @@ const AMPList& AutoMixedPrecisionLists::ClearList() {
   return clear_list;
 }
 
+const AMPList& AutoMixedPrecisionLists::CpuBFloat16WhiteList() {
+  static AMPList white_list = {"matmul", "batch_matmul", "broadcast_matmul", "amp_white_identity"};
+  return white_list;
+}
+
+const AMPList& AutoMixedPrecisionLists::CpuBFloat16GrayList() {
+  static AMPList gray_list = {"softmax"};
+  return gray_list;
+}
+
+const AMPList& AutoMixedPrecisionLists::CpuBFloat16ClearList() {
+  static AMPList clear_list = {"reshape",     "transpose", "identity", "flatten",
+                               "expand_dims", "squeeze",   "narrow"};
+  return clear_list;
+}
+
 }  // namespace oneflow
@@ -30,6 +30,11 @@ class AutoMixedPrecisionLists final {
   static const AMPList& BlackList();
   static const AMPList& GrayList();
   static const AMPList& ClearList();
+
+  // Ops whose CPU kernels (including the ones of their grad ops) support bfloat16
+  static const AMPList& CpuBFloat16WhiteList();
+  static const AMPList& CpuBFloat16GrayList();
+  static const AMPList& CpuBFloat16ClearList();
 };
 
 }  // namespace oneflow
@@ -0,0 +1,190 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace {
+
+std::function<bool(const OpNode* op_node)> MakePredicatorIsSafeToDelete(const OpGraph& op_graph) {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    for (const std::string& ctrl_in_op_name : op_node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(ctrl_in_op_name);
+    }
+  });
+  return [=](const OpNode* op_node) {
+    if (op_node->out_edges().size() > 1) { return false; }
+    if (!op_node->op().op_conf().ctrl_in_op_name().empty()) { return false; }
+    if (ctrl_in_op_names.find(op_node->op().op_conf().name()) != ctrl_in_op_names.end()) {
+      return false;
+    }
+    return true;
+  };
+}
+
+bool IsUserOpWithTypeName(const OperatorConf& op_conf, const std::string& op_type_name) {
+  return op_conf.has_user_conf() && op_conf.user_conf().op_type_name() == op_type_name;
+};
+
+// The producer of the input, or nullptr when the input does not come from a user op.
+const OpNode* ProducerOfInput(const OpNode* op_node, const std::string& lbn) {
+  const LogicalBlobId lbi = GenLogicalBlobId(lbn);
+  for (const OpEdge* edge : op_node->in_edges()) {
+    if (edge->src_node()->op().op_name() == lbi.op_name()) { return edge->src_node(); }
+  }
+  return nullptr;
+}
+
+bool IsPlainBatchMatmul(const user_op::UserOpConfWrapper& conf) {
+  return !conf.has_input("_add_to_output", 0) && !conf.attr<bool>("transpose_a");
+}
+
+// Whether the transpose only swaps the last two axes, the other axes stay in place.
+bool IsTransposeOfLastTwoAxes(const user_op::UserOpConfWrapper& conf) {
+  const auto& perm = conf.attr<std::vector<int32_t>>("perm");
+  const int32_t num_axes = perm.size();
+  if (num_axes < 3) { return false; }
+  for (int32_t i = 0; i < num_axes - 2; ++i) {
+    if (perm.at(i) != i) { return false; }
+  }
+  return perm.at(num_axes - 2) == num_axes - 1 && perm.at(num_axes - 1) == num_axes - 2;
+}
+
+bool GetScalarOperand(const user_op::UserOpConfWrapper& conf, double* operand) {
+  if (conf.attr<bool>("has_int_operand")) {
+    *operand = static_cast<double>(conf.attr<int64_t>("int_operand"));
+  } else if (conf.attr<bool>("has_float_operand")) {
+    *operand = conf.attr<double>("float_operand");
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Rewrites the unfused attention on CPU
+//   batch_matmul(q, k^T, alpha) -> [scalar_mul | scalar_div] -> softmax -> batch_matmul(p, v)
+// into fused_multi_head_attention, where k^T is either transpose_b of the first batch_matmul or a
+// transpose of the last two axes. The pass runs before autograd, so the training graphs get the
+// fused grad op as well.
+class FuseMultiHeadAttentionPass final : public JobPass {
+ public:
+  FuseMultiHeadAttentionPass() = default;
+  ~FuseMultiHeadAttentionPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_fuse_multi_head_attention();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+Maybe<void> FuseMultiHeadAttentionPass::Apply(const OpGraph& op_graph,
+                                              JobBuilder* job_builder) const {
+  const auto IsSafeToDelete = MakePredicatorIsSafeToDelete(op_graph);
+  std::vector<OperatorConf> delete_ops;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    if (!IsUserOpWithTypeName(op_node->op().op_conf(), "softmax")) { return; }
+    if (op_node->parallel_desc().device_type() != DeviceType::kCPU) { return; }
+    if (!IsSafeToDelete(op_node) || op_node->out_edges().size() != 1) { return; }
+    const user_op::UserOpConfWrapper softmax_conf(op_node->op().op_conf());
+    const DataType data_type =
+        op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(softmax_conf.input("in", 0))).data_type();
+    if (data_type != DataType::kFloat && data_type != DataType::kDouble) { return; }
+
+    // softmax -> batch_matmul(p, v)
+    const OpNode* value_matmul_node = op_node->SoleOutEdge()->dst_node();
+    if (!IsUserOpWithTypeName(value_matmul_node->op().op_conf(), "batch_matmul")) { return; }
+    const user_op::UserOpConfWrapper value_matmul_conf(value_matmul_node->op().op_conf());
+    if (!IsPlainBatchMatmul(value_matmul_conf) || value_matmul_conf.attr<bool>("transpose_b")
+        || value_matmul_conf.attr<double>("alpha") != 1.0
+        || value_matmul_conf.input("a", 0) != softmax_conf.output("out", 0)) {
+      return;
+    }
+
+    // [scalar_mul | scalar_div] -> softmax
+    double scale = 1.0;
+    std::vector<OperatorConf> fused_ops{op_node->op().op_conf()};
+    const OpNode* score_node = ProducerOfInput(op_node, softmax_conf.input("in", 0));
+    if (score_node == nullptr) { return; }
+    for (const std::string& scalar_op_type_name : {"scalar_mul", "scalar_div"}) {
+      if (!IsUserOpWithTypeName(score_node->op().op_conf(), scalar_op_type_name)) { continue; }
+      if (!IsSafeToDelete(score_node)) { return; }
+      const user_op::UserOpConfWrapper scalar_conf(score_node->op().op_conf());
+      double operand = 1.0;
+      if (!GetScalarOperand(scalar_conf, &operand)) { return; }
+      scale = scalar_op_type_name == "scalar_mul" ? operand : 1.0 / operand;
+      fused_ops.emplace_back(score_node->op().op_conf());
+      score_node = ProducerOfInput(score_node, scalar_conf.input("in", 0));
+      if (score_node == nullptr) { return; }
+      break;
+    }
+
+    // batch_matmul(q, k^T, alpha)
+    if (!IsUserOpWithTypeName(score_node->op().op_conf(), "batch_matmul")) { return; }
+    if (!IsSafeToDelete(score_node)) { return; }
+    const user_op::UserOpConfWrapper score_matmul_conf(score_node->op().op_conf());
+    if (!IsPlainBatchMatmul(score_matmul_conf)) { return; }
+    scale *= score_matmul_conf.attr<double>("alpha");
+    fused_ops.emplace_back(score_node->op().op_conf());
+    std::string key_lbn = score_matmul_conf.input("b", 0);
+    if (!score_matmul_conf.attr<bool>("transpose_b")) {
+      const OpNode* transpose_node = ProducerOfInput(score_node, key_lbn);
+      if (transpose_node == nullptr
+          || !IsUserOpWithTypeName(transpose_node->op().op_conf(), "transpose")) {
+        return;
+      }
+      const user_op::UserOpConfWrapper transpose_conf(transpose_node->op().op_conf());
+      if (!IsTransposeOfLastTwoAxes(transpose_conf)) { return; }
+      key_lbn = transpose_conf.input("input", 0);
+      // The transposed key may feed other consumers, it is kept in that case.
+      if (IsSafeToDelete(transpose_node)) {
+        fused_ops.emplace_back(transpose_node->op().op_conf());
+      }
+    }
+
+    for (const OperatorConf& op_conf : fused_ops) { delete_ops.emplace_back(op_conf); }
+    user_op::UserOpConfWrapperBuilder fused_op_builder(value_matmul_node->op().op_name());
+    fused_op_builder.OpTypeName("fused_multi_head_attention")
+        .Input("query", score_matmul_conf.input("a", 0))
+        .Input("key", key_lbn)
+        .Input("value", value_matmul_conf.input("b", 0))
+        .Attr<float>("scale", static_cast<float>(scale))
+        .Attr<bool>("causal", false)
+        .Attr<float>("dropout_scale", 1.0)
+        .Output("out")
+        .Output("softmax_lse");
+
+    OperatorConf new_op_conf = value_matmul_node->op().op_conf();
+    *new_op_conf.mutable_user_conf() = fused_op_builder.Build().op_conf().user_conf();
+    job_builder->MutOpsOnlyOnce({new_op_conf});
+  });
+  job_builder->DelOps(delete_ops);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("FuseMultiHeadAttentionPass", FuseMultiHeadAttentionPass);
+
+}  // namespace oneflow
@@ -610,10 +610,11 @@ void Actor::AsyncSendEORDMsgForAllProducedRegstDesc() {
     CHECK(!pair.second.empty());
     const RtRegstDesc* regst_desc = pair.second.front()->regst_desc();
     AddCallback([regst_desc]() {
+      std::vector<ActorMsg> msgs;
       for (int64_t consumer : regst_desc->consumers_actor_id()) {
-        Global<ActorMsgBus>::Get()->SendMsg(
-            ActorMsg::BuildEordMsg(consumer, regst_desc->regst_desc_id()));
+        msgs.emplace_back(ActorMsg::BuildEordMsg(consumer, regst_desc->regst_desc_id()));
       }
+      Global<ActorMsgBus>::Get()->SendMsgs(msgs);
     });
   }
 }
@@ -687,11 +688,9 @@ Regst* Actor::GetNaiveCurWriteable(int64_t regst_desc_id) const {
 
 void Actor::AsyncSendQueuedMsg() {
   if (!async_msg_queue_.empty()) {
-    std::deque<ActorMsg> msgs;
+    std::vector<ActorMsg> msgs;
     msgs.swap(async_msg_queue_);
-    AddCallback([msgs]() {
-      for (const ActorMsg& msg : msgs) { Global<ActorMsgBus>::Get()->SendMsg(msg); }
-    });
+    AddCallback([msgs]() { Global<ActorMsgBus>::Get()->SendMsgs(msgs); });
   }
 }
 
@@ -18,14 +18,30 @@ limitations under the License.
 #include "oneflow/core/job/id_manager.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/profiler/metrics.h"
 
 namespace oneflow {
 
+namespace {
+
+profiler::Counter* ActorMsgsCounter(bool local) {
+  static profiler::Counter* local_counter = profiler::MetricsRegistry::Get()->GetOrCreateCounter(
+      "oneflow_actor_msgs_total", "Actor messages sent by the message bus.", "route=\"local\"");
+  static profiler::Counter* comm_net_counter =
+      profiler::MetricsRegistry::Get()->GetOrCreateCounter(
+          "oneflow_actor_msgs_total", "Actor messages sent by the message bus.",
+          "route=\"comm_net\"");
+  return local ? local_counter : comm_net_counter;
+}
+
+}  // namespace
+
 void ActorMsgBus::SendMsg(const ActorMsg& msg) {
   int64_t dst_machine_id = MachineId4ActorId(msg.dst_actor_id());
   if (dst_machine_id == GlobalProcessCtx::Rank()) {
     SendMsgWithoutCommNet(msg);
   } else {
+    ActorMsgsCounter(false)->Increment();
     if (msg.IsDataRegstMsgToConsumer()) {
       int64_t comm_net_sequence;
       {
@@ -46,9 +62,39 @@ void ActorMsgBus::SendMsg(const ActorMsg& msg) {
   }
 }
 
+void ActorMsgBus::SendMsgs(const std::vector<ActorMsg>& msgs) {
+  if (msgs.size() == 1) {
+    SendMsg(msgs.front());
+    return;
+  }
+  const int64_t rank = GlobalProcessCtx::Rank();
+  // most msgs go to a few threads, a linear search beats a hash map here
+  std::vector<std::pair<int64_t, std::vector<ActorMsg>>> thrd_id7msgs;
+  for (const ActorMsg& msg : msgs) {
+    if (MachineId4ActorId(msg.dst_actor_id()) != rank) {
+      SendMsg(msg);
+      continue;
+    }
+    const int64_t thrd_id = ThrdId4ActorId(msg.dst_actor_id());
+    auto it = std::find_if(thrd_id7msgs.begin(), thrd_id7msgs.end(),
+                           [thrd_id](const auto& pair) { return pair.first == thrd_id; });
+    if (it == thrd_id7msgs.end()) {
+      thrd_id7msgs.emplace_back(thrd_id, std::vector<ActorMsg>());
+      it = thrd_id7msgs.end() - 1;
+    }
+    it->second.emplace_back(msg);
+  }
+  for (const auto& pair : thrd_id7msgs) {
+    ActorMsgsCounter(true)->Increment(pair.second.size());
+    Global<ThreadMgr>::Get()->GetThrd(pair.first)->EnqueueActorMsg(pair.second.cbegin(),
+                                                                   pair.second.cend());
+  }
+}
+
 void ActorMsgBus::SendMsgWithoutCommNet(const ActorMsg& msg) {
   CHECK_EQ(MachineId4ActorId(msg.dst_actor_id()), GlobalProcessCtx::Rank());
   int64_t thrd_id = ThrdId4ActorId(msg.dst_actor_id());
+  ActorMsgsCounter(true)->Increment();
   Global<ThreadMgr>::Get()->GetThrd(thrd_id)->EnqueueActorMsg(msg);
 }
 
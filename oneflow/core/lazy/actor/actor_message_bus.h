@@ -27,6 +27,9 @@ class ActorMsgBus final {
   ~ActorMsgBus() = default;
 
   void SendMsg(const ActorMsg& msg);
+  // Sends msgs in order of each destination actor, the msgs to local actors are enqueued to every
+  // destination thread at once.
+  void SendMsgs(const std::vector<ActorMsg>& msgs);
   void SendMsgWithoutCommNet(const ActorMsg& msg);
 
  private:
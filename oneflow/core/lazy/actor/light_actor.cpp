@@ -457,9 +457,8 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
     ResetState();
     thread_->EnqueueActorMsg(sync_post_act_msgs_.cbegin(), sync_post_act_msgs_.cend());
     if (!async_post_act_msgs_.empty()) {
-      actor_ctx_->AddCallback([this]() {
-        for (const auto& msg : async_post_act_msgs_) { Global<ActorMsgBus>::Get()->SendMsg(msg); }
-      });
+      actor_ctx_->AddCallback(
+          [this]() { Global<ActorMsgBus>::Get()->SendMsgs(async_post_act_msgs_); });
     }
   }
 
@@ -490,10 +489,11 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
       if (state.regst_type != RegstType::kProduced) { continue; }
       const RtRegstDesc* regst_desc = state.regst->regst_desc();
       actor_ctx_->AddCallback([regst_desc]() {
+        std::vector<ActorMsg> msgs;
         for (int64_t consumer : regst_desc->consumers_actor_id()) {
-          Global<ActorMsgBus>::Get()->SendMsg(
-              ActorMsg::BuildEordMsg(consumer, regst_desc->regst_desc_id()));
+          msgs.emplace_back(ActorMsg::BuildEordMsg(consumer, regst_desc->regst_desc_id()));
         }
+        Global<ActorMsgBus>::Get()->SendMsgs(msgs);
       });
     }
   }
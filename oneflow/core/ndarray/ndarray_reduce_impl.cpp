@@ -17,26 +17,290 @@ limitations under the License.
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/ndarray/ndarray_reduce_impl.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
-#define SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(struct_name)                                        \
-  template<typename T, template<typename> class binary_func>                                   \
-  struct struct_name<DeviceType::kCPU, T, binary_func> final {                                 \
-    using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;                        \
-    static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {       \
-      return false;                                                                            \
-    }                                                                                          \
-    static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,                       \
-                       const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) { \
-      UNIMPLEMENTED();                                                                         \
-    }                                                                                          \
+namespace {
+
+// elements per partial task, the default grain of CpuStream::ParallelFor
+constexpr int64_t kTaskGrainSize = ep::CpuStream::kParallelForDefaultGrain;
+constexpr int64_t kColBlockSize = 256;
+// upper bound on the tasks that produce partial results
+constexpr int64_t kMaxNumPartialTasks = 256;
+
+int64_t DivUp(int64_t x, int64_t y) { return (x + y - 1) / y; }
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value, T>::type KahanSum(const T* x, int64_t n) {
+  T sum = GetZeroVal<T>();
+  T compensation = GetZeroVal<T>();
+  for (int64_t i = 0; i < n; ++i) {
+    const T y = x[i] - compensation;
+    const T t = sum + y;
+    compensation = (t - sum) - y;
+    sum = t;
+  }
+  return sum;
+}
+
+template<typename T>
+typename std::enable_if<!std::is_floating_point<T>::value, T>::type KahanSum(const T* x,
+                                                                              int64_t n) {
+  UNIMPLEMENTED();
+  return GetZeroVal<T>();
+}
+
+template<typename T, template<typename> class binary_func>
+struct IsFloatingSum final {
+  static constexpr bool value = false;
+};
+
+template<typename T>
+struct IsFloatingSum<T, BinaryFuncSum> final {
+  static constexpr bool value = std::is_floating_point<T>::value;
+};
+
+template<typename T, template<typename> class binary_func>
+bool UseKahanSum() {
+  static const bool use_kahan_sum = EnvBool<ONEFLOW_CPU_REDUCE_SUM_USE_KAHAN>();
+  return IsFloatingSum<T, binary_func>::value && use_kahan_sum;
+}
+
+// Reduces a contiguous run into kNumLanes independent accumulators, which the compiler keeps in
+// SIMD registers, and combines the lanes at the end. For sums this is also a shallow pairwise
+// summation.
+template<typename T, template<typename> class binary_func>
+T ReduceContiguous(const T* x, int64_t n, bool use_kahan_sum) {
+  if (use_kahan_sum) { return KahanSum(x, n); }
+  constexpr int64_t kNumLanes = 8;
+  T lanes[kNumLanes];
+  for (int64_t lane = 0; lane < kNumLanes; ++lane) {
+    lanes[lane] = UnitOfBinaryFunc<T, binary_func>::Val();
+  }
+  int64_t i = 0;
+  for (; i + kNumLanes <= n; i += kNumLanes) {
+    for (int64_t lane = 0; lane < kNumLanes; ++lane) {
+      lanes[lane] = binary_func<T>::Invoke(lanes[lane], x[i + lane]);
+    }
+  }
+  for (; i < n; ++i) { lanes[0] = binary_func<T>::Invoke(lanes[0], x[i]); }
+  T reduced = lanes[0];
+  for (int64_t lane = 1; lane < kNumLanes; ++lane) {
+    reduced = binary_func<T>::Invoke(reduced, lanes[lane]);
+  }
+  return reduced;
+}
+
+template<typename T, template<typename> class binary_func, typename RetT>
+void FillUnit(const XpuVarNdarray<RetT>& y) {
+  const int64_t elem_cnt = y.shape().ElemNum();
+  for (int64_t i = 0; i < elem_cnt; ++i) {
+    y.ptr()[i] = static_cast<RetT>(UnitOfBinaryFunc<T, binary_func>::Val());
   }
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayScalarReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixRowReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixColReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeXZReduce);
-#undef SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL
+}
+
+// acc[j] = binary_func(acc[j], x[i * stride + j]) for the num_rows x num_cols block at x
+template<typename T, template<typename> class binary_func>
+void ReduceRowsInto(const T* x, int64_t num_rows, int64_t num_cols, int64_t stride, T* acc) {
+  for (int64_t j = 0; j < num_cols; ++j) { acc[j] = UnitOfBinaryFunc<T, binary_func>::Val(); }
+  for (int64_t i = 0; i < num_rows; ++i) {
+    const T* row = x + i * stride;
+    for (int64_t j = 0; j < num_cols; ++j) { acc[j] = binary_func<T>::Invoke(acc[j], row[j]); }
+  }
+}
+
+}  // namespace
+
+// The partial results of the parallel reductions are kept in tmp_storage, which has the size of x
+// like for NdarrayDefaultReduce and may be x itself. Each task writes its partial result over the
+// first element it reduced, after reducing its part of x, so that the tasks never overwrite the
+// elements of the other ones.
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayScalarReduce<DeviceType::kCPU, T, binary_func> final {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {
+    return y.shape().ElemNum() == 1;
+  }
+
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                     const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t elem_cnt = x.shape().ElemNum();
+    if (elem_cnt == 0) {
+      FillUnit<T, binary_func>(y);
+      return;
+    }
+    const bool use_kahan_sum = UseKahanSum<T, binary_func>();
+    // a fixed partition, so that the result does not depend on the number of threads
+    const int64_t chunk_size = DivUp(
+        elem_cnt, std::min(DivUp(elem_cnt, kTaskGrainSize), kMaxNumPartialTasks));
+    const int64_t num_chunks = DivUp(elem_cnt, chunk_size);
+    T* partials = tmp_storage.ptr();
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, num_chunks,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t offset = i * chunk_size;
+            const int64_t n = std::min(chunk_size, elem_cnt - offset);
+            partials[offset] =
+                ReduceContiguous<T, binary_func>(x.ptr() + offset, n, use_kahan_sum);
+          }
+        },
+        1);
+    // gathered in place, the sources i * chunk_size are never below the destinations i
+    for (int64_t i = 1; i < num_chunks; ++i) { partials[i] = partials[i * chunk_size]; }
+    *y.ptr() =
+        static_cast<RetT>(ReduceContiguous<T, binary_func>(partials, num_chunks, use_kahan_sum));
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixRowReduce<DeviceType::kCPU, T, binary_func> final {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1;
+  }
+
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                     const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t num_rows = x.shape().At(0);
+    const int64_t num_cols = x.shape().At(1);
+    const bool use_kahan_sum = UseKahanSum<T, binary_func>();
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, num_rows,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            y.ptr()[i] = static_cast<RetT>(ReduceContiguous<T, binary_func>(
+                x.ptr() + i * num_cols, num_cols, use_kahan_sum));
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(num_cols));
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixColReduce<DeviceType::kCPU, T, binary_func> final {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1);
+  }
+
+  // Columns are reduced kColBlockSize at a time with contiguous inner loops. When there are too
+  // few column blocks to keep the threads busy the rows are split too, into partial results that
+  // are combined afterwards.
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                     const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    if (y.shape().ElemNum() == 0) { return; }
+    if (x.shape().ElemNum() == 0) {
+      FillUnit<T, binary_func>(y);
+      return;
+    }
+    auto* cpu_stream = stream->As<ep::CpuStream>();
+    const int64_t num_rows = x.shape().At(0);
+    const int64_t num_cols = x.shape().At(1);
+    const int64_t num_col_blocks = DivUp(num_cols, kColBlockSize);
+    const int64_t row_chunk_size = DivUp(
+        num_rows, std::max<int64_t>(std::min(DivUp(num_rows * std::min(num_cols, kColBlockSize),
+                                                   kTaskGrainSize),
+                                             kMaxNumPartialTasks / num_col_blocks),
+                                    1));
+    const int64_t num_row_chunks = DivUp(num_rows, row_chunk_size);
+    // the partial results of a row chunk go to its first row
+    T* partials = tmp_storage.ptr();
+    cpu_stream->ParallelFor(
+        0, num_row_chunks * num_col_blocks,
+        [&](int64_t begin, int64_t end) {
+          T acc[kColBlockSize];
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t row = task / num_col_blocks * row_chunk_size;
+            const int64_t col = task % num_col_blocks * kColBlockSize;
+            const int64_t n = std::min(kColBlockSize, num_cols - col);
+            ReduceRowsInto<T, binary_func>(x.ptr() + row * num_cols + col,
+                                           std::min(row_chunk_size, num_rows - row), n, num_cols,
+                                           acc);
+            std::copy(acc, acc + n, partials + row * num_cols + col);
+          }
+        },
+        1);
+    cpu_stream->ParallelFor(0, num_cols, [&](int64_t begin, int64_t end) {
+      for (int64_t j = begin; j < end; ++j) {
+        T reduced = partials[j];
+        for (int64_t i = 1; i < num_row_chunks; ++i) {
+          reduced = binary_func<T>::Invoke(reduced, partials[i * row_chunk_size * num_cols + j]);
+        }
+        y.ptr()[j] = static_cast<RetT>(reduced);
+      }
+    });
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeXZReduce<DeviceType::kCPU, T, binary_func> final {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1) && y.shape().At(2) == 1;
+  }
+
+  // Each task reduces a chunk of x for one y, the chunks of the same y are combined afterwards.
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                     const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    if (y.shape().ElemNum() == 0) { return; }
+    if (x.shape().ElemNum() == 0) {
+      FillUnit<T, binary_func>(y);
+      return;
+    }
+    auto* cpu_stream = stream->As<ep::CpuStream>();
+    const int64_t dim_x = x.shape().At(0);
+    const int64_t dim_y = x.shape().At(1);
+    const int64_t dim_z = x.shape().At(2);
+    const bool use_kahan_sum = UseKahanSum<T, binary_func>();
+    const int64_t x_chunk_size = DivUp(
+        dim_x, std::max<int64_t>(std::min(DivUp(dim_x * dim_z, kTaskGrainSize),
+                                          kMaxNumPartialTasks / dim_y),
+                                 1));
+    const int64_t num_x_chunks = DivUp(dim_x, x_chunk_size);
+    // the partial result of a chunk for y[j] goes to x[chunk * x_chunk_size][j][0]
+    T* partials = tmp_storage.ptr();
+    const auto PartialOffset = [&](int64_t chunk, int64_t j) {
+      return (chunk * x_chunk_size * dim_y + j) * dim_z;
+    };
+    cpu_stream->ParallelFor(
+        0, num_x_chunks * dim_y,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t chunk = task / dim_y;
+            const int64_t j = task % dim_y;
+            const int64_t x_end = std::min((chunk + 1) * x_chunk_size, dim_x);
+            T reduced = UnitOfBinaryFunc<T, binary_func>::Val();
+            for (int64_t i = chunk * x_chunk_size; i < x_end; ++i) {
+              reduced = binary_func<T>::Invoke(
+                  reduced, ReduceContiguous<T, binary_func>(x.ptr() + (i * dim_y + j) * dim_z,
+                                                            dim_z, use_kahan_sum));
+            }
+            partials[PartialOffset(chunk, j)] = reduced;
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(x_chunk_size * dim_z));
+    for (int64_t j = 0; j < dim_y; ++j) {
+      T reduced = partials[PartialOffset(0, j)];
+      for (int64_t chunk = 1; chunk < num_x_chunks; ++chunk) {
+        reduced = binary_func<T>::Invoke(reduced, partials[PartialOffset(chunk, j)]);
+      }
+      y.ptr()[j] = static_cast<RetT>(reduced);
+    }
+  }
+};
 
 #define INSTANTIATE_NDARRAY_REDUCE_IMPL(dtype, binary_func)                                       \
   template struct NdarrayScalarReduce<DeviceType::kCPU, OF_PP_PAIR_FIRST(dtype), binary_func>;    \
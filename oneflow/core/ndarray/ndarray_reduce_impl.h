@@ -21,9 +21,14 @@ limitations under the License.
 #include "oneflow/core/common/switch_func.h"
 #include "oneflow/core/ndarray/xpu_ndarray_assign.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/common/env_var/env_var.h"
 
 namespace oneflow {
 
+// Use Kahan compensated summation for floating point sums on CPU. It is slower than the default
+// lane-wise summation but its error does not grow with the number of elements.
+DEFINE_ENV_BOOL(ONEFLOW_CPU_REDUCE_SUM_USE_KAHAN, false);
+
 #define DECLARE_NDARRAY_REDUCE_IMPL(struct_name)                                       \
   template<DeviceType device_type, typename T, template<typename> class binary_func>   \
   struct struct_name final {                                                           \
@@ -0,0 +1,246 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/metrics.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+std::string WithLabels(const std::string& name, const std::string& labels) {
+  if (labels.empty()) { return name; }
+  return name + "{" + labels + "}";
+}
+
+std::string WithLabels(const std::string& name, const std::string& labels,
+                       const std::string& extra_label) {
+  if (labels.empty()) { return name + "{" + extra_label + "}"; }
+  return name + "{" + labels + "," + extra_label + "}";
+}
+
+}  // namespace
+
+size_t ThisThreadMetricsShard() {
+  static std::atomic<size_t> next_shard(0);
+  static thread_local const size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumMetricsShards;
+  return shard;
+}
+
+Counter::Counter() {
+  for (auto& shard : shards_) { shard.value.store(0, std::memory_order_relaxed); }
+}
+
+int64_t Counter::Value() const {
+  int64_t value = 0;
+  for (const auto& shard : shards_) { value += shard.value.load(std::memory_order_relaxed); }
+  return value;
+}
+
+int64_t HistogramSnapshot::Quantile(double q) const {
+  if (count == 0) { return 0; }
+  const int64_t rank = std::max<int64_t>(static_cast<int64_t>(q * count + 0.5), 1);
+  int64_t cumulative = 0;
+  for (size_t i = 0; i < bucket_counts.size(); ++i) {
+    cumulative += bucket_counts[i];
+    if (cumulative >= rank) { return static_cast<int64_t>(Histogram::BucketUpperBound(i)); }
+  }
+  return static_cast<int64_t>(Histogram::BucketUpperBound(bucket_counts.size() - 1));
+}
+
+Histogram::Histogram() {
+  for (auto& shard : shards_) {
+    for (auto& bucket_count : shard.bucket_counts) {
+      bucket_count.store(0, std::memory_order_relaxed);
+    }
+    shard.sum.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t Histogram::BucketUpperBound(int64_t index) {
+  if (index < kNumSubBuckets) { return static_cast<uint64_t>(index); }
+  const int shift = static_cast<int>(index / kNumSubBuckets) - 1;
+  const uint64_t lower = static_cast<uint64_t>(kNumSubBuckets + index % kNumSubBuckets) << shift;
+  return lower + ((static_cast<uint64_t>(1) << shift) - 1);
+}
+
+HistogramSnapshot Histogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  snapshot.bucket_counts.resize(kNumBuckets, 0);
+  for (const auto& shard : shards_) {
+    for (int64_t i = 0; i < kNumBuckets; ++i) {
+      const int64_t bucket_count = shard.bucket_counts[i].load(std::memory_order_relaxed);
+      snapshot.bucket_counts[i] += bucket_count;
+      snapshot.count += bucket_count;
+    }
+    snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+MetricsRegistry* MetricsRegistry::Get() {
+  static MetricsRegistry* registry = new MetricsRegistry();
+  return registry;
+}
+
+MetricsRegistry::Family* MetricsRegistry::GetOrCreateFamily(const std::string& name,
+                                                            const std::string& help,
+                                                            MetricType type) {
+  auto iter = name2family_.find(name);
+  if (iter == name2family_.end()) {
+    iter = name2family_.emplace(name, Family()).first;
+    iter->second.type = type;
+    iter->second.help = help;
+  }
+  CHECK_EQ(iter->second.type, type) << "metric " << name << " is registered with another type";
+  return &iter->second;
+}
+
+Counter* MetricsRegistry::GetOrCreateCounter(const std::string& name, const std::string& help,
+                                             const std::string& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& counter = GetOrCreateFamily(name, help, kCounter)->counters[labels];
+  if (!counter) { counter.reset(new Counter()); }
+  return counter.get();
+}
+
+Gauge* MetricsRegistry::GetOrCreateGauge(const std::string& name, const std::string& help,
+                                         const std::string& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& gauge = GetOrCreateFamily(name, help, kGauge)->gauges[labels];
+  if (!gauge) { gauge.reset(new Gauge()); }
+  return gauge.get();
+}
+
+Histogram* MetricsRegistry::GetOrCreateHistogram(const std::string& name, const std::string& help,
+                                                 const std::string& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& histogram = GetOrCreateFamily(name, help, kHistogram)->histograms[labels];
+  if (!histogram) { histogram.reset(new Histogram()); }
+  return histogram.get();
+}
+
+std::string MetricsRegistry::DumpPrometheusText() const {
+  std::ostringstream ss;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const auto& pair : name2family_) {
+    const std::string& name = pair.first;
+    const Family& family = pair.second;
+    ss << "# HELP " << name << " " << family.help << "\n";
+    if (family.type == kCounter) {
+      ss << "# TYPE " << name << " counter\n";
+      for (const auto& labels7counter : family.counters) {
+        ss << WithLabels(name, labels7counter.first) << " " << labels7counter.second->Value()
+           << "\n";
+      }
+    } else if (family.type == kGauge) {
+      ss << "# TYPE " << name << " gauge\n";
+      for (const auto& labels7gauge : family.gauges) {
+        ss << WithLabels(name, labels7gauge.first) << " " << labels7gauge.second->Value() << "\n";
+      }
+    } else {
+      ss << "# TYPE " << name << " histogram\n";
+      for (const auto& labels7histogram : family.histograms) {
+        const std::string& labels = labels7histogram.first;
+        const HistogramSnapshot snapshot = labels7histogram.second->Snapshot();
+        // Only the non-empty buckets are rendered, the bounds of all buckets are fixed so the
+        // series stay comparable across exports.
+        int64_t cumulative = 0;
+        for (int64_t i = 0; i < Histogram::kNumBuckets; ++i) {
+          if (snapshot.bucket_counts[i] == 0) { continue; }
+          cumulative += snapshot.bucket_counts[i];
+          ss << WithLabels(name + "_bucket", labels,
+                           "le=\"" + std::to_string(Histogram::BucketUpperBound(i)) + "\"")
+             << " " << cumulative << "\n";
+        }
+        ss << WithLabels(name + "_bucket", labels, "le=\"+Inf\"") << " " << snapshot.count
+           << "\n";
+        ss << WithLabels(name + "_sum", labels) << " " << snapshot.sum << "\n";
+        ss << WithLabels(name + "_count", labels) << " " << snapshot.count << "\n";
+      }
+    }
+  }
+  return ss.str();
+}
+
+MetricsExporter::MetricsExporter()
+    : export_file_(GetStringFromEnv("ONEFLOW_METRICS_EXPORT_FILE", "")),
+      interval_ms_(ParseIntegerFromEnv("ONEFLOW_METRICS_EXPORT_INTERVAL_MS", 10000)),
+      shutting_down_(false) {
+  CHECK_GT(interval_ms_, 0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!export_file_.empty()) { StartThreadIfNot(); }
+}
+
+MetricsExporter::~MetricsExporter() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  cond_.notify_all();
+  if (thread_.joinable()) { thread_.join(); }
+}
+
+void MetricsExporter::AddCallback(const std::function<void(const std::string&)>& callback) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  callbacks_.emplace_back(callback);
+  StartThreadIfNot();
+}
+
+void MetricsExporter::StartThreadIfNot() {
+  if (thread_.joinable()) { return; }
+  thread_ = std::thread([this]() {
+    bool shutting_down = false;
+    while (!shutting_down) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                       [this]() { return shutting_down_; });
+        shutting_down = shutting_down_;
+      }
+      Export();
+    }
+  });
+}
+
+void MetricsExporter::Export() {
+  std::vector<std::function<void(const std::string&)>> callbacks;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    callbacks = callbacks_;
+  }
+  const std::string text = MetricsRegistry::Get()->DumpPrometheusText();
+  if (!export_file_.empty()) {
+    // Written aside and renamed, so the readers never see a partially written file.
+    const std::string tmp_file = export_file_ + ".tmp";
+    {
+      std::ofstream ofs(tmp_file, std::ios::trunc);
+      ofs << text;
+    }
+    if (std::rename(tmp_file.c_str(), export_file_.c_str()) != 0) {
+      LOG(WARNING) << "failed to export metrics to " << export_file_;
+    }
+  }
+  for (const auto& callback : callbacks) { callback(text); }
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
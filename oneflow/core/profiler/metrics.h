@@ -0,0 +1,214 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_METRICS_H_
+#define ONEFLOW_CORE_PROFILER_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+// Metrics are always on, unlike the ranges and events of the profiler. Updating a metric is a
+// relaxed atomic add on a shard owned by the calling thread, so the hot paths only pay for the
+// add. Metrics are registered once, callers cache the returned pointer, e.g.
+//
+//   static Counter* counter = MetricsRegistry::Get()->GetOrCreateCounter("name", "help");
+//   counter->Increment();
+
+constexpr size_t kNumMetricsShards = 8;
+constexpr size_t kMetricsCacheLineSize = 64;
+
+// The shard of the calling thread, threads are assigned to shards round robin.
+size_t ThisThreadMetricsShard();
+
+inline int64_t MetricsNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+class Counter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Counter);
+  Counter();
+  ~Counter() = default;
+
+  void Increment(int64_t n = 1) {
+    shards_[ThisThreadMetricsShard()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+  int64_t Value() const;
+
+ private:
+  // Padded instead of aligned: new does not honor over-alignment before C++17, and two values
+  // kMetricsCacheLineSize bytes apart never share a cache line either way.
+  struct Shard {
+    std::atomic<int64_t> value;
+    char padding[kMetricsCacheLineSize - sizeof(std::atomic<int64_t>)];
+  };
+  std::array<Shard, kNumMetricsShards> shards_;
+};
+
+class Gauge final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Gauge);
+  Gauge() : value_(0) {}
+  ~Gauge() = default;
+
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+  int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_;
+};
+
+struct HistogramSnapshot {
+  std::vector<int64_t> bucket_counts;
+  int64_t count = 0;
+  int64_t sum = 0;
+
+  // The upper bound of the bucket holding the q-th quantile, 0 if empty.
+  int64_t Quantile(double q) const;
+};
+
+// A log-linear histogram of non-negative values in the style of HdrHistogram: values below
+// 2^kSubBucketBits get their own buckets, every larger power of two is split into
+// 2^kSubBucketBits buckets, so the relative error of a bucket bound is below 1 / 2^kSubBucketBits.
+class Histogram final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Histogram);
+  Histogram();
+  ~Histogram() = default;
+
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int64_t kNumSubBuckets = 1 << kSubBucketBits;
+  static constexpr int64_t kNumBuckets = kNumSubBuckets * (64 - kSubBucketBits + 1);
+
+  static int64_t BucketIndex(uint64_t value) {
+    if (value < kNumSubBuckets) { return static_cast<int64_t>(value); }
+    const int exponent = 63 - __builtin_clzll(value);
+    const int shift = exponent - kSubBucketBits;
+    return kNumSubBuckets * (shift + 1) + static_cast<int64_t>((value >> shift) - kNumSubBuckets);
+  }
+  // The largest value of a bucket.
+  static uint64_t BucketUpperBound(int64_t index);
+
+  void Record(int64_t value) {
+    Shard* shard = &shards_[ThisThreadMetricsShard()];
+    const uint64_t v = value < 0 ? 0 : static_cast<uint64_t>(value);
+    shard->bucket_counts[BucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+    shard->sum.fetch_add(static_cast<int64_t>(v), std::memory_order_relaxed);
+  }
+  HistogramSnapshot Snapshot() const;
+
+ private:
+  struct Shard {
+    std::array<std::atomic<int64_t>, kNumBuckets> bucket_counts;
+    std::atomic<int64_t> sum;
+    char padding[kMetricsCacheLineSize];
+  };
+  std::array<Shard, kNumMetricsShards> shards_;
+};
+
+// Records the nanoseconds from its construction to its destruction.
+class HistogramTimer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HistogramTimer);
+  explicit HistogramTimer(Histogram* histogram)
+      : histogram_(histogram), start_ns_(MetricsNowNs()) {}
+  ~HistogramTimer() { histogram_->Record(MetricsNowNs() - start_ns_); }
+
+ private:
+  Histogram* histogram_;
+  int64_t start_ns_;
+};
+
+// Names and help strings follow the Prometheus conventions, e.g. "oneflow_vm_instructions_total".
+// `labels` is the rendered label set without braces, e.g. `device="cuda"`, metrics of the same
+// name and different labels share one help string and type.
+class MetricsRegistry final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MetricsRegistry);
+  ~MetricsRegistry() = default;
+
+  // Never destructed, metrics may be updated by threads alive during static destruction.
+  static MetricsRegistry* Get();
+
+  Counter* GetOrCreateCounter(const std::string& name, const std::string& help,
+                              const std::string& labels = "");
+  Gauge* GetOrCreateGauge(const std::string& name, const std::string& help,
+                          const std::string& labels = "");
+  Histogram* GetOrCreateHistogram(const std::string& name, const std::string& help,
+                                  const std::string& labels = "");
+
+  // Renders all metrics in the Prometheus text exposition format.
+  std::string DumpPrometheusText() const;
+
+ private:
+  MetricsRegistry() = default;
+
+  enum MetricType { kCounter, kGauge, kHistogram };
+  struct Family {
+    MetricType type;
+    std::string help;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+  };
+  Family* GetOrCreateFamily(const std::string& name, const std::string& help, MetricType type);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family> name2family_;
+};
+
+// Periodically exports the metrics to the file named by ONEFLOW_METRICS_EXPORT_FILE and to the
+// added callbacks, every ONEFLOW_METRICS_EXPORT_INTERVAL_MS milliseconds. The metrics are exported
+// once more on destruction.
+class MetricsExporter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MetricsExporter);
+  MetricsExporter();
+  ~MetricsExporter();
+
+  void AddCallback(const std::function<void(const std::string&)>& callback);
+
+ private:
+  // Requires mutex_ held.
+  void StartThreadIfNot();
+  void Export();
+
+  std::string export_file_;
+  int64_t interval_ms_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool shutting_down_;
+  std::vector<std::function<void(const std::string&)>> callbacks_;
+  std::thread thread_;
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_METRICS_H_
@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/metrics.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+TEST(Metrics, counter_from_many_threads) {
+  Counter* counter = MetricsRegistry::Get()->GetOrCreateCounter("test_counter_total", "test");
+  ASSERT_EQ(counter, MetricsRegistry::Get()->GetOrCreateCounter("test_counter_total", "test"));
+  const int num_threads = 16;
+  const int num_increments = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([counter]() {
+      for (int j = 0; j < num_increments; ++j) { counter->Increment(); }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  ASSERT_EQ(counter->Value(), num_threads * num_increments);
+}
+
+TEST(Metrics, histogram_buckets) {
+  for (uint64_t value : {0UL, 1UL, 7UL, 8UL, 9UL, 15UL, 16UL, 1000UL, 123456789UL, ~0UL}) {
+    const int64_t index = Histogram::BucketIndex(value);
+    ASSERT_LT(index, Histogram::kNumBuckets);
+    ASSERT_LE(value, Histogram::BucketUpperBound(index));
+    if (index > 0) { ASSERT_GT(value, Histogram::BucketUpperBound(index - 1)); }
+  }
+  Histogram histogram;
+  for (int64_t i = 1; i <= 1000; ++i) { histogram.Record(i); }
+  const HistogramSnapshot snapshot = histogram.Snapshot();
+  ASSERT_EQ(snapshot.count, 1000);
+  ASSERT_EQ(snapshot.sum, 500500);
+  const int64_t median = snapshot.Quantile(0.5);
+  ASSERT_GE(median, 500);
+  ASSERT_LE(median, 500 + 500 / Histogram::kNumSubBuckets);
+}
+
+TEST(Metrics, prometheus_text) {
+  MetricsRegistry::Get()->GetOrCreateGauge("test_gauge", "a test gauge", "device=\"cpu\"")->Set(3);
+  MetricsRegistry::Get()->GetOrCreateHistogram("test_latency_ns", "a test histogram")->Record(5);
+  const std::string text = MetricsRegistry::Get()->DumpPrometheusText();
+  ASSERT_NE(text.find("# TYPE test_gauge gauge\n"), std::string::npos);
+  ASSERT_NE(text.find("test_gauge{device=\"cpu\"} 3\n"), std::string::npos);
+  ASSERT_NE(text.find("test_latency_ns_bucket{le=\"5\"} 1\n"), std::string::npos);
+  ASSERT_NE(text.find("test_latency_ns_bucket{le=\"+Inf\"} 1\n"), std::string::npos);
+  ASSERT_NE(text.find("test_latency_ns_sum 5\n"), std::string::npos);
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -21,12 +21,15 @@ limitations under the License.
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/core/stream/include/stream_context.h"
 #include "oneflow/core/framework/to_string.h"
+#include "oneflow/core/graph/task_id.h"
 
 namespace oneflow {
 
 Thread::Thread(const StreamId& stream_id) : thrd_id_(EncodeStreamIdToInt64(stream_id)) {
   local_msg_queue_enabled_ = ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_LOCAL_MESSAGE_QUEUE", true);
   light_actor_enabled_ = ParseBooleanFromEnv("ONEFLOW_ACTOR_ENABLE_LIGHT_ACTOR", true);
+  batched_msg_dispatch_enabled_ =
+      ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_BATCHED_MESSAGE_DISPATCH", true);
   StreamContext* stream_ctx =
       NewObj<int, StreamContext, const StreamId&>(stream_id.device_id().device_type(), stream_id);
   stream_ctx_.reset(stream_ctx);
@@ -52,35 +55,76 @@ void Thread::AddTask(const TaskProto& task) {
 }
 
 void Thread::PollMsgChannel() {
+  std::vector<ActorMsg> msgs;
   while (true) {
     if (local_msg_queue_.empty()) {
       CHECK_EQ(msg_channel_.ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
     }
-    ActorMsg msg = std::move(local_msg_queue_.front());
-    local_msg_queue_.pop();
-    if (msg.msg_type() == ActorMsgType::kCmdMsg) {
-      if (msg.actor_cmd() == ActorCmd::kStopThread) {
-        CHECK(id2actor_ptr_.empty())
-            << " RuntimeError! Thread: " << thrd_id_
-            << " NOT empty when stop with actor num: " << id2actor_ptr_.size();
-        break;
-      } else if (msg.actor_cmd() == ActorCmd::kConstructActor) {
-        ConstructActor(msg.dst_actor_id());
-        continue;
-      } else {
-        // do nothing
-      }
+    // messages sent by the actors of this thread during dispatching go to local_msg_queue_ and are
+    // handled in the next round
+    msgs.clear();
+    while (!local_msg_queue_.empty()) {
+      msgs.emplace_back(std::move(local_msg_queue_.front()));
+      local_msg_queue_.pop();
     }
-    int64_t actor_id = msg.dst_actor_id();
-    auto actor_it = id2actor_ptr_.find(actor_id);
-    CHECK(actor_it != id2actor_ptr_.end());
-    int process_msg_ret = actor_it->second.second->ProcessMsg(msg);
+    if (!DispatchMsgs(&msgs)) { break; }
+  }
+}
+
+bool Thread::DispatchMsgs(std::vector<ActorMsg>* msgs) {
+  auto IsThreadCmdMsg = [](const ActorMsg& msg) {
+    return msg.msg_type() == ActorMsgType::kCmdMsg
+           && (msg.actor_cmd() == ActorCmd::kStopThread
+               || msg.actor_cmd() == ActorCmd::kConstructActor);
+  };
+  auto segment_begin = msgs->begin();
+  while (true) {
+    // thread cmd msgs split the batch into segments which are dispatched in order
+    auto segment_end = std::find_if(segment_begin, msgs->end(), IsThreadCmdMsg);
+    if (batched_msg_dispatch_enabled_ && segment_end - segment_begin > 1) {
+      // group the msgs by destination actor, the sort is stable so the msgs to one actor keep
+      // their order
+      std::stable_sort(segment_begin, segment_end, [](const ActorMsg& lhs, const ActorMsg& rhs) {
+        return lhs.dst_actor_id() < rhs.dst_actor_id();
+      });
+    }
+    auto run_begin = segment_begin;
+    while (run_begin != segment_end) {
+      const int64_t actor_id = run_begin->dst_actor_id();
+      auto run_end = std::find_if(run_begin + 1, segment_end, [actor_id](const ActorMsg& msg) {
+        return msg.dst_actor_id() != actor_id;
+      });
+      DispatchMsgsToActor(run_begin, run_end);
+      run_begin = run_end;
+    }
+    if (segment_end == msgs->end()) { return true; }
+    if (segment_end->actor_cmd() == ActorCmd::kStopThread) {
+      CHECK(id2actor_ptr_.empty()) << " RuntimeError! Thread: " << thrd_id_
+                                   << " NOT empty when stop with actor num: "
+                                   << id2actor_ptr_.size();
+      return false;
+    }
+    ConstructActor(segment_end->dst_actor_id());
+    segment_begin = segment_end + 1;
+  }
+}
+
+void Thread::DispatchMsgsToActor(std::vector<ActorMsg>::const_iterator first,
+                                 std::vector<ActorMsg>::const_iterator last) {
+  const int64_t actor_id = first->dst_actor_id();
+  ActorBase* actor = GetActor(actor_id);
+  for (auto it = first; it != last; ++it) {
+    CHECK(actor != nullptr) << "Thread " << thrd_id_ << " received msg for deconstructed actor "
+                            << actor_id;
+    int process_msg_ret = actor->ProcessMsg(*it);
     if (process_msg_ret == 1) {
       VLOG(3) << "thread " << thrd_id_ << " deconstruct actor " << actor_id;
       auto job_id_it = id2job_id_.find(actor_id);
       const int64_t job_id = job_id_it->second;
       id2job_id_.erase(job_id_it);
-      id2actor_ptr_.erase(actor_it);
+      index2actor_.at(TaskIndex4ActorId(actor_id)) = nullptr;
+      CHECK_EQ(id2actor_ptr_.erase(actor_id), 1);
+      actor = nullptr;
       Global<RuntimeCtx>::Get()->DecreaseCounter(GetRunningActorCountKeyByJobId(job_id));
     } else {
       CHECK_EQ(process_msg_ret, 0);
@@ -88,6 +132,13 @@ void Thread::PollMsgChannel() {
   }
 }
 
+ActorBase* Thread::GetActor(int64_t actor_id) const {
+  const size_t index = TaskIndex4ActorId(actor_id);
+  ActorBase* actor = index < index2actor_.size() ? index2actor_[index] : nullptr;
+  CHECK(actor != nullptr) << "Thread " << thrd_id_ << " has no actor " << actor_id;
+  return actor;
+}
+
 void Thread::ConstructActor(int64_t actor_id) {
   std::unique_lock<std::mutex> lck(id2task_mtx_);
   auto task_it = id2task_.find(actor_id);
@@ -104,6 +155,11 @@ void Thread::ConstructActor(int64_t actor_id) {
     VLOG(3) << "Thread " << thrd_id_ << " construct LightActor " << TaskType_Name(task.task_type())
             << " " << actor_id;
   }
+  CHECK_EQ(ThrdId4ActorId(actor_id), thrd_id_);
+  const size_t index = TaskIndex4ActorId(actor_id);
+  if (index >= index2actor_.size()) { index2actor_.resize(index + 1, nullptr); }
+  CHECK(index2actor_[index] == nullptr);
+  index2actor_[index] = actor_ptr.get();
   CHECK(id2actor_ptr_.emplace(actor_id, std::make_pair(std::move(actor_ctx), std::move(actor_ptr)))
             .second);
   CHECK(id2job_id_.emplace(actor_id, task.job_id()).second);
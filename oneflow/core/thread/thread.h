@@ -50,7 +50,7 @@ class Thread {
     if (UseLocalMsgQueue()) {
       for (auto it = first; it != last; ++it) { local_msg_queue_.push(*it); }
     } else {
-      for (auto it = first; it != last; ++it) { msg_channel_.Send(*it); }
+      msg_channel_.SendMany(first, last);
     }
   }
 
@@ -59,6 +59,11 @@ class Thread {
 
  private:
   void ConstructActor(int64_t actor_id);
+  // Returns false once kStopThread has been received.
+  bool DispatchMsgs(std::vector<ActorMsg>* msgs);
+  void DispatchMsgsToActor(std::vector<ActorMsg>::const_iterator first,
+                           std::vector<ActorMsg>::const_iterator last);
+  ActorBase* GetActor(int64_t actor_id) const;
 
   inline bool UseLocalMsgQueue() const {
     return local_msg_queue_enabled_ && std::this_thread::get_id() == actor_thread_.get_id();
@@ -71,11 +76,14 @@ class Thread {
   Channel<ActorMsg> msg_channel_;
   HashMap<int64_t, std::pair<std::unique_ptr<ActorContext>, std::unique_ptr<ActorBase>>>
       id2actor_ptr_;
+  // indexed by TaskIndex4ActorId, nullptr for the slots without a living actor
+  std::vector<ActorBase*> index2actor_;
   HashMap<int64_t, int64_t> id2job_id_;
   std::queue<ActorMsg> local_msg_queue_;
   bool local_msg_queue_enabled_;
   int64_t thrd_id_;
   bool light_actor_enabled_;
+  bool batched_msg_dispatch_enabled_;
   std::unique_ptr<StreamContext> stream_ctx_;
 };
 
@@ -17,6 +17,7 @@ limitations under the License.
 #ifdef WITH_CUDA
 
 #include "oneflow/core/vm/bin_allocator.h"
+#include "oneflow/core/profiler/metrics.h"
 #include <iostream>
 #include <cmath>
 
@@ -31,6 +32,18 @@ inline bool IsAlignedSize(size_t size, size_t alignment) { return size % alignme
 
 static const size_t kPieceSplitThreshold = 128 << 20;  // 128MiB
 
+profiler::Gauge* ReservedBytesGauge() {
+  static profiler::Gauge* gauge = profiler::MetricsRegistry::Get()->GetOrCreateGauge(
+      "oneflow_vm_allocator_reserved_bytes", "Bytes held by the bin allocators from the backends.");
+  return gauge;
+}
+
+profiler::Gauge* AllocatedBytesGauge() {
+  static profiler::Gauge* gauge = profiler::MetricsRegistry::Get()->GetOrCreateGauge(
+      "oneflow_vm_allocator_allocated_bytes", "Bytes of the pieces in use of the bin allocators.");
+  return gauge;
+}
+
 }  // namespace
 
 BinAllocator::BinAllocator(size_t alignment, std::unique_ptr<Allocator>&& backend)
@@ -53,6 +66,7 @@ BinAllocator::BinAllocator(size_t alignment, std::unique_ptr<Allocator>&& backen
 }
 
 BinAllocator::~BinAllocator() {
+  ReservedBytesGauge()->Add(-static_cast<int64_t>(total_memory_bytes_));
   if (total_memory_bytes_ == 0) {
     CHECK_EQ(mem_ptr2block_.size(), 0);
     return;
@@ -184,6 +198,7 @@ bool BinAllocator::AllocateBlockToExtendTotalMem(size_t aligned_size) {
 
   // extend sucess
   total_memory_bytes_ += final_allocate_bytes;
+  ReservedBytesGauge()->Add(final_allocate_bytes);
 
   Piece* piece = AllocatePiece();
   piece->size = final_allocate_bytes;
@@ -222,6 +237,7 @@ bool BinAllocator::DeallocateFreeBlockForGarbageCollection() {
   }
 
   total_memory_bytes_ -= total_free_bytes;
+  ReservedBytesGauge()->Add(-static_cast<int64_t>(total_free_bytes));
 
   if (total_free_bytes > 0) {
     VLOG(3) << "BinAllocator try deallocate free block for garbage collection. "
@@ -280,6 +296,7 @@ void BinAllocator::Allocate(char** mem_ptr, std::size_t size) {
   }
   CHECK_NOTNULL(piece->ptr);
   CHECK(ptr2piece_.find(piece->ptr) != ptr2piece_.end());
+  AllocatedBytesGauge()->Add(piece->size);
   *mem_ptr = piece->ptr;
 }
 
@@ -293,6 +310,7 @@ void BinAllocator::Deallocate(char* mem_ptr, std::size_t size) {
   CHECK_NOTNULL(piece);
   CHECK_EQ(piece->ptr, mem_ptr);
   CHECK(!piece->is_free);
+  AllocatedBytesGauge()->Add(-static_cast<int64_t>(piece->size));
 
   piece->is_free = true;
 
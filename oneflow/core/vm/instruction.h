@@ -178,9 +178,11 @@ class Instruction final : public intrusive::Base {
   const InEdgeList& in_edges() const { return in_edges_; }
   const OutEdgeList& out_edges() const { return out_edges_; }
   const DependenceAccessList& access_list() const { return access_list_; }
+  int64_t lively_begin_ns() const { return lively_begin_ns_; }
 
   // Setters
   void set_stream(Stream* val) { stream_ = val; }
+  void set_lively_begin_ns(int64_t val) { lively_begin_ns_ = val; }
   void clear_stream() { stream_ = nullptr; }
   Stream* mut_stream() { return stream_; }
   InstructionMsg* mut_instr_msg() { return CHECK_NOTNULL(instr_msg_.Mutable()); }
@@ -211,6 +213,7 @@ class Instruction final : public intrusive::Base {
         instr_msg_(),
         parallel_desc_(),
         stream_(),
+        lively_begin_ns_(0),
         access_list_(),
         in_edges_(),
         out_edges_(),
@@ -225,6 +228,8 @@ class Instruction final : public intrusive::Base {
   intrusive::shared_ptr<InstructionMsg> instr_msg_;
   std::shared_ptr<const ParallelDesc> parallel_desc_;
   Stream* stream_;
+  // when the instruction is pushed to the lively instruction list
+  int64_t lively_begin_ns_;
   // lists
   DependenceAccessList access_list_;
   InEdgeList in_edges_;
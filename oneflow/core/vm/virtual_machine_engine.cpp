@@ -25,6 +25,7 @@ limitations under the License.
 #include "oneflow/core/job/parallel_desc.h"
 #include "oneflow/core/platform/include/pthread_fork.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/metrics.h"
 #include "oneflow/core/common/cpp_attribute.h"
 #include "oneflow/core/common/global.h"
 #include "oneflow/core/common/foreign_lock_helper.h"
@@ -33,6 +34,16 @@ limitations under the License.
 namespace oneflow {
 namespace vm {
 
+namespace {
+
+profiler::Gauge* LivelyInstructionsGauge() {
+  static profiler::Gauge* gauge = profiler::MetricsRegistry::Get()->GetOrCreateGauge(
+      "oneflow_vm_lively_instructions", "Instructions received and not yet finished by the vm.");
+  return gauge;
+}
+
+}  // namespace
+
 void VirtualMachineEngine::ReleaseInstruction(Instruction* instruction) {
   OF_PROFILER_RANGE_GUARD("R:" + instruction->instr_msg().DebugName());
   auto* access_list = instruction->mut_access_list();
@@ -74,6 +85,10 @@ void VirtualMachineEngine::HandleLocalPending() {
       new_instruction_list.Erase(instruction);
     }
   }
+  static profiler::Gauge* pending_gauge = profiler::MetricsRegistry::Get()->GetOrCreateGauge(
+      "oneflow_vm_pending_instruction_msgs",
+      "Instruction messages moved to the scheduler and not yet made into instructions.");
+  pending_gauge->Set(local_pending_msg_list().size());
 }
 
 namespace {
@@ -146,7 +161,13 @@ std::string VirtualMachineEngine::GetLivelyInstructionListDebugString(int64_t de
 }
 
 void VirtualMachineEngine::LivelyInstructionListPushBack(Instruction* instruction) {
+  static profiler::Counter* instructions_counter =
+      profiler::MetricsRegistry::Get()->GetOrCreateCounter("oneflow_vm_instructions_total",
+                                                           "Instructions received by the vm.");
   ++total_inserted_instruction_cnt_;
+  instructions_counter->Increment();
+  LivelyInstructionsGauge()->Add(1);
+  instruction->set_lively_begin_ns(profiler::MetricsNowNs());
   mut_lively_instruction_list()->PushBack(instruction);
 }
 
@@ -167,7 +188,13 @@ void VirtualMachineEngine::HandleLocalProbe() {
 
 intrusive::shared_ptr<Instruction> VirtualMachineEngine::LivelyInstructionListErase(
     Instruction* instruction, const ScheduleCtx& schedule_ctx) {
+  static profiler::Histogram* latency_histogram =
+      profiler::MetricsRegistry::Get()->GetOrCreateHistogram(
+          "oneflow_vm_instruction_latency_ns",
+          "Nanoseconds from an instruction received by the vm to its release.");
   ++total_erased_instruction_cnt_;
+  LivelyInstructionsGauge()->Add(-1);
+  latency_histogram->Record(profiler::MetricsNowNs() - instruction->lively_begin_ns());
   return mut_lively_instruction_list()->Erase(instruction);
 }
 
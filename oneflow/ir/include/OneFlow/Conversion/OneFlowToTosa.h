@@ -25,6 +25,10 @@ namespace oneflow {
 
 std::unique_ptr<mlir::Pass> createLowerOneFlowToTosaPass();
 
+// Whether the op is lowered to TOSA ops which fuse into loop nests, the elementwise, normalization,
+// softmax, reduction and reshaping ops. matmul, conv and pooling are left to their kernels.
+bool IsCodegenFusibleOp(mlir::Operation* op);
+
 }  // namespace oneflow
 
 }  // namespace mlir
@@ -81,6 +81,120 @@ Value CreateBNOp(Location loc, ConversionPatternRewriter& rewriter, Value output
   return batch_norm;
 };
 
+Value CreateReshape(Location loc, ConversionPatternRewriter& rewriter, Value input,
+                    ArrayRef<int64_t> shape) {
+  const auto input_type = input.getType().cast<RankedTensorType>();
+  if (input_type.getShape() == shape) { return input; }
+  return rewriter.create<tosa::ReshapeOp>(
+      loc, RankedTensorType::get(shape, input_type.getElementType()), input,
+      rewriter.getI64ArrayAttr(shape));
+}
+
+// TOSA only broadcasts between operands of the same rank, the operand of a lower rank gets
+// leading dims of 1 the way OneFlow broadcasts.
+Value CreateReshapeToRank(Location loc, ConversionPatternRewriter& rewriter, Value input,
+                          int64_t rank) {
+  const auto input_type = input.getType().cast<RankedTensorType>();
+  if (input_type.getRank() >= rank) { return input; }
+  SmallVector<int64_t> shape(rank - input_type.getRank(), 1);
+  shape.append(input_type.getShape().begin(), input_type.getShape().end());
+  return CreateReshape(loc, rewriter, input, shape);
+}
+
+// A constant of shape [1] * rank, to be broadcast against the tensors of the rank.
+Value CreateScalarConst(Location loc, ConversionPatternRewriter& rewriter, Type element_type,
+                        int64_t rank, double value) {
+  const auto type = RankedTensorType::get(SmallVector<int64_t>(rank, 1), element_type);
+  Attribute attr;
+  if (element_type.isa<FloatType>()) {
+    attr = rewriter.getFloatAttr(element_type, value);
+  } else {
+    attr = rewriter.getIntegerAttr(element_type, static_cast<int64_t>(value));
+  }
+  return rewriter.create<tosa::ConstOp>(loc, type, DenseElementsAttr::get(type, attr));
+}
+
+Value CreateMul(Location loc, ConversionPatternRewriter& rewriter, Value x, Value y) {
+  return rewriter.create<tosa::MulOp>(loc, x.getType(), x, y, /* shift */ 0);
+}
+
+// The TOSA reductions keep the reduced axis as 1.
+template<typename TosaReduceOp>
+Value CreateReduce(Location loc, ConversionPatternRewriter& rewriter, Value input, int64_t axis) {
+  const auto input_type = input.getType().cast<RankedTensorType>();
+  SmallVector<int64_t> shape(input_type.getShape().begin(), input_type.getShape().end());
+  shape[axis] = 1;
+  return rewriter.create<TosaReduceOp>(loc,
+                                       RankedTensorType::get(shape, input_type.getElementType()),
+                                       input, rewriter.getI64IntegerAttr(axis));
+}
+
+// softmax and log_softmax along the last axis. The input is viewed as a matrix, so the reductions
+// stay within the ranks TOSA supports.
+Value CreateSoftmax(Location loc, ConversionPatternRewriter& rewriter, Value input, bool log) {
+  const auto input_type = input.getType().cast<RankedTensorType>();
+  const int64_t cols = input_type.getShape().back();
+  const int64_t rows = input_type.getNumElements() / cols;
+  auto x = CreateReshape(loc, rewriter, input, {rows, cols});
+  const auto x_type = x.getType();
+  auto max = CreateReduce<tosa::ReduceMaxOp>(loc, rewriter, x, 1);
+  Value diff = rewriter.create<tosa::SubOp>(loc, x_type, x, max);
+  Value exp = rewriter.create<tosa::ExpOp>(loc, x_type, diff);
+  auto sum = CreateReduce<tosa::ReduceSumOp>(loc, rewriter, exp, 1);
+  Value out;
+  if (log) {
+    Value log_sum = rewriter.create<tosa::LogOp>(loc, sum.getType(), sum);
+    out = rewriter.create<tosa::SubOp>(loc, x_type, diff, log_sum);
+  } else {
+    Value inv_sum = rewriter.create<tosa::ReciprocalOp>(loc, sum.getType(), sum);
+    out = CreateMul(loc, rewriter, exp, inv_sum);
+  }
+  return CreateReshape(loc, rewriter, out, input_type.getShape());
+}
+
+// gelu(x) = x * Phi(x), the erf of Phi is approximated by Abramowitz and Stegun 7.1.26 of which
+// the absolute error is below 1.5e-7, TOSA has no erf.
+Value CreateGelu(Location loc, ConversionPatternRewriter& rewriter, Value x) {
+  const auto type = x.getType().cast<RankedTensorType>();
+  const auto element_type = type.getElementType();
+  auto constant = [&](double value) {
+    return CreateScalarConst(loc, rewriter, element_type, type.getRank(), value);
+  };
+  // z = |x| / sqrt(2), t = 1 / (1 + p * z)
+  Value abs = rewriter.create<tosa::AbsOp>(loc, type, x);
+  auto z = CreateMul(loc, rewriter, abs, constant(0.70710678118654752440));
+  Value t = rewriter.create<tosa::AddOp>(
+      loc, type, CreateMul(loc, rewriter, z, constant(0.3275911)), constant(1.0));
+  t = rewriter.create<tosa::ReciprocalOp>(loc, type, t);
+  // q = 1 - erf(z) = t * (a1 + t * (a2 + t * (a3 + t * (a4 + t * a5)))) * exp(-z^2)
+  Value poly = constant(1.061405429);
+  for (double a : {-1.453152027, 1.421413741, -0.284496736, 0.254829592}) {
+    poly = rewriter.create<tosa::AddOp>(loc, type, CreateMul(loc, rewriter, poly, t), constant(a));
+  }
+  poly = CreateMul(loc, rewriter, poly, t);
+  Value neg_square = rewriter.create<tosa::NegateOp>(loc, type, CreateMul(loc, rewriter, z, z));
+  auto half_q = CreateMul(
+      loc, rewriter,
+      CreateMul(loc, rewriter, poly, rewriter.create<tosa::ExpOp>(loc, type, neg_square)),
+      constant(0.5));
+  // Phi(x) = 1 - q / 2 for x >= 0, q / 2 otherwise
+  Value non_negative = rewriter.create<tosa::GreaterEqualOp>(
+      loc, RankedTensorType::get(type.getShape(), rewriter.getI1Type()), x, constant(0.0));
+  Value cdf = rewriter.create<tosa::SelectOp>(
+      loc, type, non_negative, rewriter.create<tosa::SubOp>(loc, type, constant(1.0), half_q),
+      half_q);
+  return CreateMul(loc, rewriter, x, cdf);
+}
+
+Value CreateBiasAdd(Location loc, ConversionPatternRewriter& rewriter, Type output_type, Value a,
+                    Value b, int64_t axis) {
+  const auto rank = a.getType().cast<RankedTensorType>().getRank();
+  if (axis < 0) { axis += rank; }
+  SmallVector<int64_t> shape(rank, 1);
+  shape[axis] = b.getType().cast<RankedTensorType>().getDimSize(0);
+  return rewriter.create<tosa::AddOp>(loc, output_type, a, CreateReshape(loc, rewriter, b, shape));
+}
+
 struct ScalarMulByTensorOpLowering final : public OpConversionPattern<ScalarMulByTensorOp> {
  public:
   using OpConversionPattern<ScalarMulByTensorOp>::OpConversionPattern;
@@ -562,6 +676,335 @@ struct Conv2DOpLowering final : public OpConversionPattern<Conv2DOp> {
   }
 };
 
+template<typename OpType, typename TosaOpType>
+struct UnaryOpLowering final : public OpConversionPattern<OpType> {
+ public:
+  using OpConversionPattern<OpType>::OpConversionPattern;
+  LogicalResult matchAndRewrite(OpType op, typename OpType::Adaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOpWithNewOp<TosaOpType>(op, op->getResultTypes().front(), op->getOperand(0));
+    return success();
+  }
+};
+
+template<typename OpType, typename TosaOpType>
+struct BroadcastBinaryOpLowering final : public OpConversionPattern<OpType> {
+ public:
+  using OpConversionPattern<OpType>::OpConversionPattern;
+  LogicalResult matchAndRewrite(OpType op, typename OpType::Adaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op->getResultTypes().front().template cast<RankedTensorType>();
+    auto loc = op->getLoc();
+    auto x = CreateReshapeToRank(loc, rewriter, op->getOperand(0), output.getRank());
+    auto y = CreateReshapeToRank(loc, rewriter, op->getOperand(1), output.getRank());
+    rewriter.replaceOpWithNewOp<TosaOpType>(op, output, x, y);
+    return success();
+  }
+};
+
+struct BroadcastMulOpLowering final : public OpConversionPattern<BroadcastMulOp> {
+ public:
+  using OpConversionPattern<BroadcastMulOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(BroadcastMulOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op.z().getType().cast<RankedTensorType>();
+    auto loc = op->getLoc();
+    auto x = CreateReshapeToRank(loc, rewriter, op.x(), output.getRank());
+    auto y = CreateReshapeToRank(loc, rewriter, op.y(), output.getRank());
+    rewriter.replaceOpWithNewOp<tosa::MulOp>(op, output, x, y, /* shift */ 0);
+    return success();
+  }
+};
+
+struct BroadcastDivOpLowering final : public OpConversionPattern<BroadcastDivOp> {
+ public:
+  using OpConversionPattern<BroadcastDivOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(BroadcastDivOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op.z().getType().cast<RankedTensorType>();
+    auto loc = op->getLoc();
+    auto x = CreateReshapeToRank(loc, rewriter, op.x(), output.getRank());
+    auto y = CreateReshapeToRank(loc, rewriter, op.y(), output.getRank());
+    // tosa.div is integer only
+    if (output.getElementType().isa<FloatType>()) {
+      Value reciprocal = rewriter.create<tosa::ReciprocalOp>(loc, y.getType(), y);
+      rewriter.replaceOpWithNewOp<tosa::MulOp>(op, output, x, reciprocal, /* shift */ 0);
+    } else {
+      rewriter.replaceOpWithNewOp<tosa::DivOp>(op, output, x, y);
+    }
+    return success();
+  }
+};
+
+struct SqrtOpLowering final : public OpConversionPattern<SqrtOp> {
+ public:
+  using OpConversionPattern<SqrtOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(SqrtOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op.y().getType();
+    Value rsqrt = rewriter.create<tosa::RsqrtOp>(op->getLoc(), output, op.x());
+    rewriter.replaceOpWithNewOp<tosa::ReciprocalOp>(op, output, rsqrt);
+    return success();
+  }
+};
+
+struct SquareOpLowering final : public OpConversionPattern<SquareOp> {
+ public:
+  using OpConversionPattern<SquareOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(SquareOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOp(op, {CreateMul(op->getLoc(), rewriter, op.x(), op.x())});
+    return success();
+  }
+};
+
+struct SiluOpLowering final : public OpConversionPattern<SiluOp> {
+ public:
+  using OpConversionPattern<SiluOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(SiluOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    Value sigmoid = rewriter.create<tosa::SigmoidOp>(op->getLoc(), op.out().getType(), op.in());
+    rewriter.replaceOp(op, {CreateMul(op->getLoc(), rewriter, op.in(), sigmoid)});
+    return success();
+  }
+};
+
+template<typename OpType>
+double GetScalarOperand(OpType op) {
+  if (op.has_float_operand()) { return op.float_operand().convertToDouble(); }
+  return static_cast<double>(op.int_operand());
+}
+
+struct ScalarAddOpLowering final : public OpConversionPattern<ScalarAddOp> {
+ public:
+  using OpConversionPattern<ScalarAddOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(ScalarAddOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op.out().getType().cast<RankedTensorType>();
+    auto scalar = CreateScalarConst(op->getLoc(), rewriter, output.getElementType(),
+                                    output.getRank(), GetScalarOperand(op));
+    rewriter.replaceOpWithNewOp<tosa::AddOp>(op, output, op.in(), scalar);
+    return success();
+  }
+};
+
+struct ScalarMulOpLowering final : public OpConversionPattern<ScalarMulOp> {
+ public:
+  using OpConversionPattern<ScalarMulOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(ScalarMulOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op.out().getType().cast<RankedTensorType>();
+    auto scalar = CreateScalarConst(op->getLoc(), rewriter, output.getElementType(),
+                                    output.getRank(), GetScalarOperand(op));
+    rewriter.replaceOpWithNewOp<tosa::MulOp>(op, output, op.in(), scalar, /* shift */ 0);
+    return success();
+  }
+};
+
+struct ScalarDivOpLowering final : public OpConversionPattern<ScalarDivOp> {
+ public:
+  using OpConversionPattern<ScalarDivOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(ScalarDivOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op.out().getType().cast<RankedTensorType>();
+    const auto element_type = output.getElementType();
+    auto loc = op->getLoc();
+    if (element_type.isa<FloatType>()) {
+      auto scalar = CreateScalarConst(loc, rewriter, element_type, output.getRank(),
+                                      1.0 / GetScalarOperand(op));
+      rewriter.replaceOpWithNewOp<tosa::MulOp>(op, output, op.in(), scalar, /* shift */ 0);
+    } else {
+      auto scalar = CreateScalarConst(loc, rewriter, element_type, output.getRank(),
+                                      GetScalarOperand(op));
+      rewriter.replaceOpWithNewOp<tosa::DivOp>(op, output, op.in(), scalar);
+    }
+    return success();
+  }
+};
+
+struct ScalarPowOpLowering final : public OpConversionPattern<ScalarPowOp> {
+ public:
+  using OpConversionPattern<ScalarPowOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(ScalarPowOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op.out().getType().cast<RankedTensorType>();
+    auto loc = op->getLoc();
+    const double exponent = GetScalarOperand(op);
+    if (exponent == 2.0) {
+      rewriter.replaceOp(op, {CreateMul(loc, rewriter, op.in(), op.in())});
+      return success();
+    }
+    auto scalar =
+        CreateScalarConst(loc, rewriter, output.getElementType(), output.getRank(), exponent);
+    rewriter.replaceOpWithNewOp<tosa::PowOp>(op, output, op.in(), scalar);
+    return success();
+  }
+};
+
+struct SoftmaxOpLowering final : public OpConversionPattern<SoftmaxOp> {
+ public:
+  using OpConversionPattern<SoftmaxOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(SoftmaxOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOp(op, {CreateSoftmax(op->getLoc(), rewriter, op.in(), /* log */ false)});
+    return success();
+  }
+};
+
+struct LogSoftmaxOpLowering final : public OpConversionPattern<LogSoftmaxOp> {
+ public:
+  using OpConversionPattern<LogSoftmaxOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(LogSoftmaxOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOp(op, {CreateSoftmax(op->getLoc(), rewriter, op.in(), /* log */ true)});
+    return success();
+  }
+};
+
+struct LayerNormOpLowering final : public OpConversionPattern<LayerNormOp> {
+ public:
+  using OpConversionPattern<LayerNormOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(LayerNormOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    auto loc = op->getLoc();
+    const auto x_type = op.x().getType().cast<RankedTensorType>();
+    const auto element_type = x_type.getElementType();
+    int64_t begin_norm_axis = op.begin_norm_axis();
+    if (begin_norm_axis < 0) { begin_norm_axis += x_type.getRank(); }
+    int64_t cols = 1;
+    for (auto dim = begin_norm_axis; dim < x_type.getRank(); ++dim) {
+      cols *= x_type.getDimSize(dim);
+    }
+    const int64_t rows = x_type.getNumElements() / cols;
+    // mean and variance of the rows of x viewed as a matrix
+    auto x = CreateReshape(loc, rewriter, op.x(), {rows, cols});
+    auto inv_cols = CreateScalarConst(loc, rewriter, element_type, 2, 1.0 / cols);
+    auto mean = CreateMul(loc, rewriter, CreateReduce<tosa::ReduceSumOp>(loc, rewriter, x, 1),
+                          inv_cols);
+    Value diff = rewriter.create<tosa::SubOp>(loc, x.getType(), x, mean);
+    auto square_sum =
+        CreateReduce<tosa::ReduceSumOp>(loc, rewriter, CreateMul(loc, rewriter, diff, diff), 1);
+    auto epsilon = CreateScalarConst(loc, rewriter, element_type, 2,
+                                     op.epsilon().convertToDouble());
+    Value variance = rewriter.create<tosa::AddOp>(loc, mean.getType(),
+                                                  CreateMul(loc, rewriter, square_sum, inv_cols),
+                                                  epsilon);
+    Value inv_variance = rewriter.create<tosa::RsqrtOp>(loc, mean.getType(), variance);
+    auto y = CreateReshape(loc, rewriter, CreateMul(loc, rewriter, diff, inv_variance),
+                           x_type.getShape());
+    // gamma and beta are of the trailing dims of x from begin_params_axis
+    if (auto gamma = op.gamma()) {
+      y = CreateMul(loc, rewriter, y, CreateReshapeToRank(loc, rewriter, gamma, x_type.getRank()));
+    }
+    if (auto beta = op.beta()) {
+      y = rewriter.create<tosa::AddOp>(loc, x_type, y,
+                                       CreateReshapeToRank(loc, rewriter, beta, x_type.getRank()));
+    }
+    auto shape_of = [](Value value) { return value.getType().cast<RankedTensorType>().getShape(); };
+    auto mean_out = CreateReshape(loc, rewriter, mean, shape_of(op.mean()));
+    auto inv_variance_out = CreateReshape(loc, rewriter, inv_variance, shape_of(op.inv_variance()));
+    rewriter.replaceOp(op, {y, mean_out, inv_variance_out});
+    return success();
+  }
+};
+
+struct BiasAddOpLowering final : public OpConversionPattern<BiasAddOp> {
+ public:
+  using OpConversionPattern<BiasAddOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(BiasAddOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOp(op, {CreateBiasAdd(op->getLoc(), rewriter, op.out().getType(), op.a(),
+                                          op.b(), op.axis())});
+    return success();
+  }
+};
+
+struct GeluOpLowering final : public OpConversionPattern<GeluOp> {
+ public:
+  using OpConversionPattern<GeluOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(GeluOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOp(op, {CreateGelu(op->getLoc(), rewriter, op.in())});
+    return success();
+  }
+};
+
+struct FusedBiasAddGeluOpLowering final : public OpConversionPattern<FusedBiasAddGeluOp> {
+ public:
+  using OpConversionPattern<FusedBiasAddGeluOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(FusedBiasAddGeluOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    auto loc = op->getLoc();
+    auto bias_add = CreateBiasAdd(loc, rewriter, op.out().getType(), op.a(), op.b(), op.axis());
+    rewriter.replaceOp(op, {CreateGelu(loc, rewriter, bias_add)});
+    return success();
+  }
+};
+
+struct TransposeOpLowering final : public OpConversionPattern<TransposeOp> {
+ public:
+  using OpConversionPattern<TransposeOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(TransposeOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    SmallVector<int32_t> perms;
+    for (auto perm : op.perm().getValue()) { perms.push_back(perm.cast<IntegerAttr>().getSInt()); }
+    auto loc = op->getLoc();
+    rewriter.replaceOp(op, {CreateTranspose(loc, rewriter, op.input(), perms)});
+    return success();
+  }
+};
+
+// reshape, expand_dims and squeeze, the result type has the shape.
+template<typename OpType>
+struct ReshapeLikeOpLowering final : public OpConversionPattern<OpType> {
+ public:
+  using OpConversionPattern<OpType>::OpConversionPattern;
+  LogicalResult matchAndRewrite(OpType op, typename OpType::Adaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const auto output = op->getResultTypes().front().template cast<RankedTensorType>();
+    rewriter.replaceOpWithNewOp<tosa::ReshapeOp>(op, output, op->getOperand(0),
+                                                 rewriter.getI64ArrayAttr(output.getShape()));
+    return success();
+  }
+};
+
+template<typename OpType, typename TosaReduceOp>
+struct ReduceOpLowering final : public OpConversionPattern<OpType> {
+ public:
+  using OpConversionPattern<OpType>::OpConversionPattern;
+  LogicalResult matchAndRewrite(OpType op, typename OpType::Adaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    auto loc = op->getLoc();
+    Value reduced = op.input_tensor();
+    const auto rank = reduced.getType().template cast<RankedTensorType>().getRank();
+    for (auto axis_attr : op.axis().getValue()) {
+      int64_t axis = axis_attr.template cast<IntegerAttr>().getSInt();
+      if (axis < 0) { axis += rank; }
+      reduced = CreateReduce<TosaReduceOp>(loc, rewriter, reduced, axis);
+    }
+    // the reduced axes are kept as 1 by TOSA and dropped without keepdims
+    const auto output = op.output_tensor().getType().template cast<RankedTensorType>();
+    rewriter.replaceOp(op, {CreateReshape(loc, rewriter, reduced, output.getShape())});
+    return success();
+  }
+};
+
+bool IsCodegenFusibleOp(Operation* op) {
+  if (llvm::isa<CastOp, ScalarMulByTensorOp, ReluOp, BroadcastAddOp, Add2Op, SigmoidV2Op, TanhOp,
+                ExpOp, LogOp, RsqrtOp, AbsOp, NegativeOp, ReciprocalOp, SqrtOp, SquareOp, SiluOp,
+                BroadcastSubOp, BroadcastMaximumOp, BroadcastMinimumOp, BroadcastMulOp,
+                BroadcastDivOp, ScalarAddOp, ScalarMulOp, ScalarDivOp, ScalarPowOp, SoftmaxOp,
+                LogSoftmaxOp, LayerNormOp, NormalizationInferenceOp, BiasAddOp, GeluOp,
+                FusedBiasAddGeluOp, TransposeOp, ReshapeOp, ExpandDimsOp, SqueezeOp>(op)) {
+    return true;
+  }
+  // the TOSA reductions take up to 4-D tensors
+  if (llvm::isa<ReduceSumOp, ReduceMaxOp, ReduceMinOp>(op)) {
+    return op->getOperand(0).getType().cast<RankedTensorType>().getRank() <= 4;
+  }
+  return false;
+}
+
 namespace {
 struct OneFlowLoweringToTosaPass : public LowerOneFlowToTosaPassBase<OneFlowLoweringToTosaPass> {
   void runOnOperation() override;
@@ -596,6 +1039,24 @@ void OneFlowLoweringToTosaPass::runOnOperation() {
            MatmulOpLowering, BroadcastAddOpLowering, JobLowering, ReturnOpLowering, InputOpLowering,
            OutputOpLowering, NormalizationOpLowering, NormalizationInferenceOpLowering>(
           typeConverter, context);
+  patterns.add<UnaryOpLowering<SigmoidV2Op, tosa::SigmoidOp>, UnaryOpLowering<TanhOp, tosa::TanhOp>,
+               UnaryOpLowering<ExpOp, tosa::ExpOp>, UnaryOpLowering<LogOp, tosa::LogOp>,
+               UnaryOpLowering<RsqrtOp, tosa::RsqrtOp>, UnaryOpLowering<AbsOp, tosa::AbsOp>,
+               UnaryOpLowering<NegativeOp, tosa::NegateOp>,
+               UnaryOpLowering<ReciprocalOp, tosa::ReciprocalOp>, SqrtOpLowering, SquareOpLowering,
+               SiluOpLowering>(typeConverter, context);
+  patterns.add<BroadcastBinaryOpLowering<BroadcastSubOp, tosa::SubOp>,
+               BroadcastBinaryOpLowering<BroadcastMaximumOp, tosa::MaximumOp>,
+               BroadcastBinaryOpLowering<BroadcastMinimumOp, tosa::MinimumOp>,
+               BroadcastMulOpLowering, BroadcastDivOpLowering, ScalarAddOpLowering,
+               ScalarMulOpLowering, ScalarDivOpLowering, ScalarPowOpLowering>(typeConverter,
+                                                                              context);
+  patterns.add<SoftmaxOpLowering, LogSoftmaxOpLowering, LayerNormOpLowering, BiasAddOpLowering,
+               GeluOpLowering, FusedBiasAddGeluOpLowering, TransposeOpLowering,
+               ReshapeLikeOpLowering<ReshapeOp>, ReshapeLikeOpLowering<ExpandDimsOp>,
+               ReshapeLikeOpLowering<SqueezeOp>, ReduceOpLowering<ReduceSumOp, tosa::ReduceSumOp>,
+               ReduceOpLowering<ReduceMaxOp, tosa::ReduceMaxOp>,
+               ReduceOpLowering<ReduceMinOp, tosa::ReduceMinOp>>(typeConverter, context);
   if (failed(applyPartialConversion(getOperation(), target, std::move(patterns)))) {
     getOperation()->dump();
     signalPassFailure();
@@ -19,6 +19,8 @@ limitations under the License.
 #include "OneFlow/Passes.h"
 #include "OneFlow/OneFlowSupport.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "mlir-c/BuiltinAttributes.h"
 #include "mlir/IR/Attributes.h"
@@ -34,7 +36,9 @@ limitations under the License.
 #include "mlir/Conversion/ReconcileUnrealizedCasts/ReconcileUnrealizedCasts.h"
 #include "mlir/Conversion/FuncToLLVM/ConvertFuncToLLVMPass.h"
 #include "mlir/Conversion/TosaToLinalg/TosaToLinalg.h"
+#include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Affine/Passes.h"
 #include "mlir/Dialect/Linalg/Passes.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/Passes.h"
@@ -59,7 +63,6 @@ limitations under the License.
 #include "oneflow/core/framework/variable_tensor_mgr.h"
 
 #ifdef WITH_MLIR_CUDA_CODEGEN
-#include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
 #include "mlir/Conversion/GPUCommon/GPUCommonPass.h"
 #include "mlir/Conversion/GPUToNVVM/GPUToNVVMPass.h"
 #include "mlir/Dialect/GPU/Passes.h"
@@ -727,6 +730,119 @@ struct AutoNhwcEliminateRedundantTransposePattern : public mlir::OpRewritePatter
   }
 };
 
+// The fused trees are only outlined on a single device, the mlir_jit op runs its function on whole
+// tensors and only has the broadcast signature.
+bool IsOutlinableOnCpu(Operation* op) {
+  if (!op->hasTrait<OpTrait::IsOpConfCompatible>() || !op->getParentOfType<Job>()) {
+    return false;
+  }
+  if (OpTrait::IsOpConfCompatible<void>::getDeviceTag(op).getValue() != "cpu") { return false; }
+  if (auto hierarchy = OpTrait::IsOpConfCompatible<void>::getHierarchy(op)) {
+    for (auto dim : hierarchy.getValue()) {
+      if (dim.cast<IntegerAttr>().getValue().getSExtValue() != 1) { return false; }
+    }
+  }
+  if (!IsCodegenFusibleOp(op)) { return false; }
+  // the data types of the mlir_jit kernels
+  auto is_supported = [](Type type) {
+    auto tensor = type.dyn_cast<RankedTensorType>();
+    if (!tensor || !tensor.hasStaticShape() || tensor.getRank() == 0
+        || tensor.getNumElements() == 0) {
+      return false;
+    }
+    const auto element_type = tensor.getElementType();
+    return element_type.isF32() || element_type.isF64() || element_type.isSignlessInteger(32)
+           || element_type.isSignlessInteger(64);
+  };
+  return llvm::all_of(op->getOperandTypes(), is_supported)
+         && llvm::all_of(op->getResultTypes(), is_supported);
+}
+
+// Outlines a tree of the CPU ops the codegen fuses into loop nests, e.g. softmax(x * scale + mask),
+// to a jit function. The ops of the tree except the root are only used within the tree, so the
+// function is called at the place of the root and the tree is free of cycles.
+struct OutlineCpuFusibleOpsPattern : public RewritePattern {
+  explicit OutlineCpuFusibleOpsPattern(mlir::MLIRContext* context)
+      : RewritePattern(MatchAnyOpTypeTag(), /*benefit=*/0, context) {}
+  LogicalResult matchAndRewrite(Operation* root, PatternRewriter& rewriter) const override {
+    if (!IsOutlinableOnCpu(root)) { return failure(); }
+    const auto device_name = OpTrait::IsOpConfCompatible<void>::getDeviceName(root);
+    auto is_fusible_with_root = [&](Operation* op) {
+      return op->getBlock() == root->getBlock() && IsOutlinableOnCpu(op)
+             && OpTrait::IsOpConfCompatible<void>::getDeviceName(op) == device_name;
+    };
+    // the tree is rooted at the user if it is the only one
+    if (!root->use_empty()) {
+      Operation* user = *root->getUsers().begin();
+      if (is_fusible_with_root(user)
+          && llvm::all_of(root->getUsers(), [&](Operation* other) { return other == user; })) {
+        return failure();
+      }
+    }
+    llvm::SmallPtrSet<Operation*, 8> fused{root};
+    SmallVector<Operation*, 8> candidates;
+    auto add_producers = [&](Operation* op) {
+      for (auto operand : op->getOperands()) {
+        auto producer = operand.getDefiningOp();
+        if (producer && !fused.contains(producer) && !llvm::is_contained(candidates, producer)) {
+          candidates.push_back(producer);
+        }
+      }
+    };
+    add_producers(root);
+    while (!candidates.empty()) {
+      // the latest first, all the users of a candidate within the tree are visited before it
+      auto latest =
+          std::max_element(candidates.begin(), candidates.end(),
+                           [](Operation* a, Operation* b) { return a->isBeforeInBlock(b); });
+      Operation* op = *latest;
+      candidates.erase(latest);
+      if (!is_fusible_with_root(op)) { continue; }
+      if (!llvm::all_of(op->getUsers(), [&](Operation* user) { return fused.contains(user); })) {
+        continue;
+      }
+      fused.insert(op);
+      add_producers(op);
+    }
+    // a single op is served by its kernel
+    if (fused.size() < 2) { return failure(); }
+
+    SmallVector<Operation*, 4> ops(fused.begin(), fused.end());
+    llvm::sort(ops, [](Operation* a, Operation* b) { return a->isBeforeInBlock(b); });
+    llvm::SetVector<Value> operands;
+    for (auto op : ops) {
+      for (auto operand : op->getOperands()) {
+        if (!fused.contains(operand.getDefiningOp())) { operands.insert(operand); }
+      }
+    }
+    SmallVector<Value, 4> results(root->getResults().begin(), root->getResults().end());
+    auto op_name_of = [](Operation* op) {
+      return op->getAttrOfType<StringAttr>(OpTrait::IsOpConfCompatible<void>::getOpNameAttr())
+          .getValue()
+          .str();
+    };
+    // op names are unique and the trees are disjoint, so are the first and the root of a tree
+    SmallString<16> tempBuffer;
+    const std::string op_name =
+        sanitizeIdentifier(op_name_of(ops.front()) + "__FUSE__" + op_name_of(root), tempBuffer)
+            .str();
+    NamedAttrList attributes =
+        GetJitOpAttributes(rewriter, op_name, operands.size(), results.size(), root);
+    auto function = GetOrInsertFuncOp(rewriter, root->getLoc(), op_name,
+                                      operands.getArrayRef(), results, ops);
+    if (!function) { return failure(); }
+    rewriter.setInsertionPoint(root);
+    auto created =
+        rewriter.create<MlirJitOp>(root->getLoc(), function, attributes, operands.getArrayRef());
+    if (failed(DumpAssembly(rewriter, created))) { return failure(); }
+    rewriter.replaceOp(root, created->getResults());
+    for (auto op : llvm::reverse(ops)) {
+      if (op != root) { rewriter.eraseOp(op); }
+    }
+    return success();
+  }
+};
+
 void BroadcastMulOp::getCanonicalizationPatterns(RewritePatternSet& results, MLIRContext* context) {
   results.insert<BroadcastMulToScalarMulPattern>(context);
 }
@@ -749,8 +865,22 @@ void AddLowerToLinalgMemRefPasses(PassManager& pm) {
 LogicalResult LowerModuleToLLVM(mlir::MLIRContext* context, ModuleOp module) {
   mlir::PassManager pm(context);
   AddLowerToLinalgMemRefPasses(pm);
-  pm.addNestedPass<func::FuncOp>(createConvertLinalgToLoopsPass());  // convert-linalg-to-loops
-  pm.addNestedPass<func::FuncOp>(createConvertSCFToCFPass());        // convert-scf-to-cf
+  // The elementwise ops are fused on tensors, the loop nests of the reductions of softmax and
+  // layer_norm are fused with their elementwise consumers here, which turns most of the
+  // intermediate buffers into scalars.
+  pm.addNestedPass<func::FuncOp>(
+      createConvertLinalgToAffineLoopsPass());  // convert-linalg-to-affine-loops
+  pm.addNestedPass<func::FuncOp>(createLoopFusionPass());               // affine-loop-fusion
+  pm.addNestedPass<func::FuncOp>(createAffineScalarReplacementPass());  // affine-scalrep
+  pm.addNestedPass<func::FuncOp>(
+      createAffineLoopInvariantCodeMotionPass());  // affine-loop-invariant-code-motion
+  pm.addPass(createLowerAffinePass());             // lower-affine
+  pm.addPass(createCanonicalizerPass());           // canonicalize
+  pm.addPass(createCSEPass());                     // cse
+  // the buffers left are freed at the end of the function
+  pm.addNestedPass<func::FuncOp>(
+      bufferization::createBufferDeallocationPass());           // buffer-deallocation
+  pm.addNestedPass<func::FuncOp>(createConvertSCFToCFPass());  // convert-scf-to-cf
   pm.addPass(createConvertLinalgToLLVMPass());                       // convert-linalg-to-llvm
   pm.addPass(createMemRefToLLVMPass());                              // convert-memref-to-llvm
   pm.addPass(createConvertFuncToLLVMPass());                         // convert-func-to-llvm
@@ -789,6 +919,7 @@ LogicalResult LowerModuleToCUDALLVM(mlir::MLIRContext* context, ModuleOp module)
 
 void populateFuserPasses(::mlir::RewritePatternSet& patterns) {
   patterns.add<MulCastPattern>(patterns.getContext());
+  patterns.add<OutlineCpuFusibleOpsPattern>(patterns.getContext());
 }
 
 void populateFuserForExistingOp(::mlir::RewritePatternSet& patterns) {
@@ -18,12 +18,27 @@ limitations under the License.
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/ExecutionEngine/MemRefUtils.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
 #include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
+#include "mlir/Target/LLVMIR/Export.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include <dlfcn.h>
+#include <unistd.h>
 #include "OneFlow/OneFlowDialect.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/common/switch_func.h"
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job/version.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/ir/include/OneFlow/Passes.h"
@@ -40,33 +55,102 @@ const SharedLibs* SharedLibPaths() { return MutSharedLibPaths(); }
 
 namespace {
 
+Maybe<DataType> GetDataTypeFromMlirType(mlir::Type type) {
+  if (type.isF32()) { return DataType::kFloat; }
+  if (type.isF64()) { return DataType::kDouble; }
+  if (type.isSignlessInteger(32)) { return DataType::kInt32; }
+  if (type.isSignlessInteger(64)) { return DataType::kInt64; }
+  UNIMPLEMENTED_THEN_RETURN() << "unsupported MLIR type of mlir_jit";
+}
+
+// The argument and result types of the outlined function held by the assembly of a mlir_jit op.
+struct MlirJitSignature {
+  std::vector<Shape> arg_shapes;
+  std::vector<Shape> result_shapes;
+  std::vector<DataType> result_data_types;
+};
+
+Maybe<Shape> GetStaticShapeFromMlirType(mlir::Type type) {
+  auto tensor_type = type.dyn_cast<mlir::RankedTensorType>();
+  CHECK_OR_RETURN(tensor_type && tensor_type.hasStaticShape())
+      << "mlir_jit only takes tensors of static shapes";
+  return Shape(DimVector(tensor_type.getShape().begin(), tensor_type.getShape().end()));
+}
+
+Maybe<MlirJitSignature> ParseMlirJitSignature(const std::string& op_name,
+                                              const std::string& mlir_assembly) {
+  mlir::DialectRegistry registry;
+  registry.insert<mlir::oneflow::OneFlowDialect, mlir::func::FuncDialect>();
+  mlir::MLIRContext mlir_ctx(registry);
+  auto module = mlir::parseSourceString<mlir::ModuleOp>(mlir_assembly, &mlir_ctx);
+  CHECK_OR_RETURN(!!module) << "fail to parse MLIR, op: " << op_name;
+  auto funcs = module->getOps<mlir::func::FuncOp>();
+  CHECK_OR_RETURN(!funcs.empty()) << "no function in MLIR, op: " << op_name;
+  const auto function_type = (*funcs.begin()).getFunctionType();
+  MlirJitSignature signature;
+  for (auto type : function_type.getInputs()) {
+    signature.arg_shapes.emplace_back(*JUST(GetStaticShapeFromMlirType(type)));
+  }
+  for (auto type : function_type.getResults()) {
+    signature.result_shapes.emplace_back(*JUST(GetStaticShapeFromMlirType(type)));
+    signature.result_data_types.emplace_back(
+        JUST(GetDataTypeFromMlirType(type.cast<mlir::RankedTensorType>().getElementType())));
+  }
+  return signature;
+}
+
+// Signatures are shared by the ops of the same assembly, the inference runs once per op and
+// parallel configuration, parsing the assembly every time is slow for large fused trees.
+Maybe<const MlirJitSignature&> GetMlirJitSignature(const std::string& op_name,
+                                                   const std::string& mlir_assembly) {
+  static std::mutex mutex;
+  // Never destructed like the engines, see GetOrCreateMlirJitEngine.
+  static auto* assembly2signature = new HashMap<std::string, std::unique_ptr<MlirJitSignature>>();
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = assembly2signature->find(mlir_assembly);
+  if (it == assembly2signature->end()) {
+    auto signature = std::make_unique<MlirJitSignature>(
+        *JUST(ParseMlirJitSignature(op_name, mlir_assembly)));
+    it = assembly2signature->emplace(mlir_assembly, std::move(signature)).first;
+  }
+  return *it->second;
+}
+
+// The results of the mlir_jit op are the ones of the outlined function held by the assembly. The
+// function is compiled for the static shapes of its arguments, so the op only has the broadcast
+// signature and its physical shapes are the logical ones.
+Maybe<void> InferMlirJitOutputs(user_op::InferContext* ctx, bool infer_shape) {
+  const MlirJitSignature& signature =
+      JUST(GetMlirJitSignature(ctx->op_name(), ctx->Attr<std::string>("mlir_assembly")));
+  CHECK_EQ_OR_RETURN(signature.arg_shapes.size(), ctx->inputs().size());
+  CHECK_EQ_OR_RETURN(signature.result_shapes.size(), ctx->outputs().size());
+  for (size_t i = 0; i < signature.result_shapes.size(); ++i) {
+    if (infer_shape) { *ctx->OutputShape("out", i) = signature.result_shapes.at(i); }
+    *ctx->OutputDType("out", i) = signature.result_data_types.at(i);
+  }
+  if (infer_shape) {
+    for (size_t i = 0; i < signature.arg_shapes.size(); ++i) {
+      CHECK_EQ_OR_RETURN(ctx->InputShape("in", i), signature.arg_shapes.at(i))
+          << "mlir_jit is compiled for the shapes in its assembly, op: " << ctx->op_name();
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
 REGISTER_USER_OP("mlir_jit")
     .Attr<std::string>("mlir_assembly")
     .Input("in")
     .Output("out")
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
-      // TODO: infer shape by extracting Ops from mlir_assembly
-      CHECK_EQ(ctx->inputs().size(), 2);
-      CHECK_EQ(ctx->outputs().size(), 1);
-      const Shape& in_shape = ctx->InputShape("in", 0);
-      Shape* out_shape = ctx->OutputShape("out", 0);
-      *out_shape = in_shape;
-      *ctx->OutputDType("out", 0) = ctx->InputDType("in", 1);
-      return Maybe<void>::Ok();
+      return InferMlirJitOutputs(ctx, /*infer_shape=*/true);
     })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
-      const user_op::TensorDesc& in_tensor = ctx->LogicalTensorDesc4InputArgNameAndIndex("in", 0);
-      FOR_RANGE(int64_t, i, 0, in_tensor.shape().NumAxes()) {
-        ctx->NewBuilder()
-            .Split(user_op::OpArg("in", 0), i)
-            .Split(user_op::OpArg("out", 0), i)
-            .Build();
-      }
+      // The kernels run the function on whole tensors, see InferMlirJitOutputs.
+      ctx->NewBuilder().Broadcast(ctx->inputs()).Broadcast(ctx->outputs()).Build();
       return Maybe<void>::Ok();
     })
     .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
-      *ctx->OutputDType("out", 0) = ctx->InputDType("in", 0);
-      return Maybe<void>::Ok();
+      return InferMlirJitOutputs(ctx, /*infer_shape=*/false);
     });
 
 using OpaqueMemRefDescriptor = std::shared_ptr<void>;
@@ -132,68 +216,269 @@ llvm::SmallVector<OpaqueMemRefDescriptor> GetMLIRCInterfaceArgs(
   return args;
 }
 
-void WithMlirContext(
-    user_op::KernelComputeContext* ctx, const llvm::SmallVector<llvm::StringRef, 4>& ext_libs,
-    const std::function<mlir::OwningOpRef<mlir::ModuleOp>(mlir::MLIRContext* mlir_ctx)>& parse,
-    const std::function<void(mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module)>& lower) {
+// 0 to 3, the level of both the LLVM IR optimization and the machine code generation.
+int64_t MlirJitOptLevel() {
+  static const int64_t opt_level = ParseIntegerFromEnv("ONEFLOW_MLIR_JIT_OPT_LEVEL", 3);
+  return opt_level;
+}
+
+llvm::CodeGenOpt::Level CodeGenOptLevel(int64_t opt_level) {
+  switch (opt_level) {
+    case 0: return llvm::CodeGenOpt::None;
+    case 1: return llvm::CodeGenOpt::Less;
+    case 2: return llvm::CodeGenOpt::Default;
+    default: return llvm::CodeGenOpt::Aggressive;
+  }
+}
+
+using LowerFn = std::function<void(mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module)>;
+
+// The engine compiles lazily and refers to the transformer and the target machine while compiling,
+// so they are kept alive together.
+struct MlirJitEngine {
+  std::unique_ptr<llvm::TargetMachine> target_machine;
+  std::function<llvm::Error(llvm::Module*)> transformer;
+  std::unique_ptr<mlir::ExecutionEngine> engine;
+};
+
+// Identifies the OneFlow build: the git version, and the path and modification time of the library
+// holding the lowering passes, which also tell apart local builds without a git version.
+std::string OneFlowBuildId() {
+  std::string build_id = GetOneFlowGitVersion();
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void*>(&OneFlowBuildId), &info) != 0 && info.dli_fname != nullptr) {
+    llvm::sys::fs::file_status status;
+    if (!llvm::sys::fs::status(info.dli_fname, status)) {
+      build_id += std::string(" ") + info.dli_fname + " "
+                  + std::to_string(llvm::sys::toTimeT(status.getLastModificationTime()));
+    }
+  }
+  return build_id;
+}
+
+// The on-disk cache keeps the LLVM IR translated from the lowered module in
+// ONEFLOW_MLIR_JIT_CACHE_DIR, named by the hash of the key. The key is stored aside to tell
+// collisions apart, it includes the OneFlow build, the LLVM version and the host target, so that
+// an upgrade or another machine never picks up IR lowered by a different toolchain.
+class MlirJitDiskCache final {
+ public:
+  explicit MlirJitDiskCache(const std::string& key) : key_(key) {
+    const std::string dir = GetStringFromEnv("ONEFLOW_MLIR_JIT_CACHE_DIR", "");
+    if (dir.empty()) { return; }
+    const std::string name = std::to_string(std::hash<std::string>()(key));
+    bitcode_path_ = JoinPath(dir, name + ".bc");
+    key_path_ = JoinPath(dir, name + ".key");
+  }
+
+  bool enabled() const { return !bitcode_path_.empty(); }
+
+  // Returns nullptr on miss. An entry whose bitcode does not load is removed, the caller compiles
+  // the module again and stores a new one.
+  std::unique_ptr<llvm::MemoryBuffer> Load() const {
+    if (!enabled()) { return nullptr; }
+    auto key_or_error = llvm::MemoryBuffer::getFile(key_path_);
+    if (!key_or_error || key_or_error.get()->getBuffer() != key_) { return nullptr; }
+    auto bitcode_or_error = llvm::MemoryBuffer::getFile(bitcode_path_);
+    if (!bitcode_or_error) { return nullptr; }
+    llvm::LLVMContext llvm_ctx;
+    auto llvm_module_or_error =
+        llvm::parseBitcodeFile(bitcode_or_error.get()->getMemBufferRef(), llvm_ctx);
+    if (!llvm_module_or_error) {
+      LOG(WARNING) << "fail to load the MLIR JIT cache entry " << bitcode_path_
+                   << ", it is removed and compiled again, "
+                   << llvm::toString(llvm_module_or_error.takeError());
+      llvm::sys::fs::remove(key_path_);
+      llvm::sys::fs::remove(bitcode_path_);
+      return nullptr;
+    }
+    return std::move(bitcode_or_error.get());
+  }
+
+  void Store(const llvm::Module& llvm_module) const {
+    if (!enabled()) { return; }
+    CHECK(!llvm::sys::fs::create_directories(llvm::sys::path::parent_path(bitcode_path_)))
+        << "fail to create MLIR JIT cache directory for " << bitcode_path_;
+    // Written aside and renamed, concurrent processes may share the directory.
+    const std::string tmp_suffix = ".tmp" + std::to_string(getpid());
+    {
+      std::error_code ec;
+      llvm::raw_fd_ostream os(bitcode_path_ + tmp_suffix, ec);
+      CHECK(!ec) << "fail to write " << bitcode_path_ << ", error: " << ec.message();
+      llvm::WriteBitcodeToFile(llvm_module, os);
+    }
+    {
+      std::error_code ec;
+      llvm::raw_fd_ostream os(key_path_ + tmp_suffix, ec);
+      CHECK(!ec) << "fail to write " << key_path_ << ", error: " << ec.message();
+      os << key_;
+    }
+    // The key goes last, a partially stored entry never matches.
+    CHECK(!llvm::sys::fs::rename(bitcode_path_ + tmp_suffix, bitcode_path_));
+    CHECK(!llvm::sys::fs::rename(key_path_ + tmp_suffix, key_path_));
+  }
+
+ private:
+  std::string key_;
+  std::string bitcode_path_;
+  std::string key_path_;
+};
+
+std::shared_ptr<MlirJitEngine> CreateMlirJitEngine(const std::string& key,
+                                                   const std::string& op_name,
+                                                   const std::string& mlir_assembly,
+                                                   const LowerFn& lower) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  const int64_t opt_level = MlirJitOptLevel();
+  auto jit_engine = std::make_shared<MlirJitEngine>();
+  // detectHost enables all the features of the host CPU.
+  auto tm_builder_or_error = llvm::orc::JITTargetMachineBuilder::detectHost();
+  CHECK(!!tm_builder_or_error) << "fail to detect host, "
+                               << llvm::toString(tm_builder_or_error.takeError());
+  tm_builder_or_error->setCodeGenOptLevel(CodeGenOptLevel(opt_level));
+  auto tm_or_error = tm_builder_or_error->createTargetMachine();
+  CHECK(!!tm_or_error) << "fail to create target machine, "
+                       << llvm::toString(tm_or_error.takeError());
+  jit_engine->target_machine = std::move(tm_or_error.get());
+  jit_engine->transformer = mlir::makeOptimizingTransformer(
+      opt_level, /*sizeLevel=*/0, /*targetMachine=*/jit_engine->target_machine.get());
+
   mlir::DialectRegistry registry;
   registry
       .insert<mlir::oneflow::OneFlowDialect, mlir::func::FuncDialect, mlir::memref::MemRefDialect,
               mlir::tosa::TosaDialect, mlir::linalg::LinalgDialect>();
   mlir::registerLLVMDialectTranslation(registry);
   mlir::MLIRContext mlir_ctx(registry);
-  mlir::OwningOpRef<mlir::ModuleOp> module = parse(&mlir_ctx);
-  CHECK(!!module) << "fail to parse MLIR, op: " << ctx->op_name();
-  if (ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
-  llvm::InitializeNativeTarget();
-  llvm::InitializeNativeTargetAsmPrinter();
-  lower(&mlir_ctx, *module);
-  if (ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
-  if (ParseBooleanFromEnv("ONEFLOW_MLIR_DUMP_IR", false)) {
-    std::string mlir;
-    llvm::raw_string_ostream os_mlir(mlir);
-    module->print(os_mlir);
-    TeePersistentLogStream::Create(JoinPath("jit", ctx->op_name() + ".mlir"))->Write(mlir);
+
+  const llvm::TargetMachine& target_machine = *jit_engine->target_machine;
+  const MlirJitDiskCache disk_cache(
+      "OneFlow " + OneFlowBuildId() + "\nLLVM " + LLVM_VERSION_STRING + "\n"
+      + target_machine.getTargetTriple().str() + " " + target_machine.getTargetCPU().str() + " "
+      + target_machine.getTargetFeatureString().str() + "\n" + key);
+  std::unique_ptr<llvm::MemoryBuffer> cached_bitcode = disk_cache.Load();
+  mlir::OwningOpRef<mlir::ModuleOp> module;
+  if (cached_bitcode) {
+    // The module is not used, the LLVM IR is loaded by the module builder.
+    module = mlir::ModuleOp::create(mlir::UnknownLoc::get(&mlir_ctx));
+  } else {
+    module = mlir::parseSourceString<mlir::ModuleOp>(mlir_assembly, &mlir_ctx);
+    CHECK(!!module) << "fail to parse MLIR, op: " << op_name;
+    if (ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
+    lower(&mlir_ctx, *module);
+    if (ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
+    if (ParseBooleanFromEnv("ONEFLOW_MLIR_DUMP_IR", false)) {
+      std::string mlir;
+      llvm::raw_string_ostream os_mlir(mlir);
+      module->print(os_mlir);
+      TeePersistentLogStream::Create(JoinPath("jit", op_name + ".mlir"))->Write(mlir);
+    }
   }
+  auto build_llvm_module = [&](auto module_op,
+                               llvm::LLVMContext& llvm_ctx) -> std::unique_ptr<llvm::Module> {
+    if (cached_bitcode) {
+      auto llvm_module_or_error =
+          llvm::parseBitcodeFile(cached_bitcode->getMemBufferRef(), llvm_ctx);
+      // Checked when the entry was loaded.
+      CHECK(!!llvm_module_or_error) << llvm::toString(llvm_module_or_error.takeError());
+      return std::move(llvm_module_or_error.get());
+    }
+    auto llvm_module = mlir::translateModuleToLLVMIR(module_op, llvm_ctx);
+    CHECK(llvm_module) << "fail to translate MLIR to LLVM IR, op: " << op_name;
+    disk_cache.Store(*llvm_module);
+    return llvm_module;
+  };
 
+  llvm::SmallVector<llvm::StringRef, 4> ext_libs(
+      {SharedLibPaths()->begin(), SharedLibPaths()->end()});
   mlir::ExecutionEngineOptions jitOptions;
-  jitOptions.transformer = {};
-  jitOptions.jitCodeGenOptLevel = llvm::None;
+  jitOptions.llvmModuleBuilder = build_llvm_module;
+  jitOptions.transformer = jit_engine->transformer;
+  jitOptions.jitCodeGenOptLevel = CodeGenOptLevel(opt_level);
   jitOptions.sharedLibPaths = ext_libs;
 
   auto jit_or_error = mlir::ExecutionEngine::create(*module, jitOptions);
   CHECK(!!jit_or_error) << "failed to create JIT exe engine, "
                         << llvm::toString(jit_or_error.takeError());
-  auto jit = std::move(jit_or_error.get());
+  jit_engine->engine = std::move(jit_or_error.get());
+  // Compile now instead of at the first invocation.
+  auto func_or_error = jit_engine->engine->lookupPacked(GetMLIRCInterface(op_name));
+  CHECK(!!func_or_error) << "fail to compile " << op_name << ", "
+                         << llvm::toString(func_or_error.takeError());
+  return jit_engine;
+}
+
+// Engines are shared by the kernels of the same op name, assembly, lowering and opt level.
+std::shared_ptr<MlirJitEngine> GetOrCreateMlirJitEngine(const std::string& lowering,
+                                                        const std::string& op_name,
+                                                        const std::string& mlir_assembly,
+                                                        const LowerFn& lower) {
+  static std::mutex mutex;
+  // Never destructed, LLVM may be torn down before the static destructors of this library run.
+  static auto* key2engine = new HashMap<std::string, std::shared_ptr<MlirJitEngine>>();
+  const std::string key = lowering + "\n" + std::to_string(MlirJitOptLevel()) + "\n" + op_name
+                          + "\n" + mlir_assembly;
+  // Compiling under the lock, the same module is never compiled twice.
+  std::unique_lock<std::mutex> lock(mutex);
+  auto it = key2engine->find(key);
+  if (it == key2engine->end()) {
+    it = key2engine->emplace(key, CreateMlirJitEngine(key, op_name, mlir_assembly, lower)).first;
+  }
+  return it->second;
+}
+
+void InvokeMlirJitEngine(user_op::KernelComputeContext* ctx, const MlirJitEngine& jit_engine) {
   llvm::SmallVector<OpaqueMemRefDescriptor> args /* args must outlive JIT invocation */ =
       GetMLIRCInterfaceArgs(ctx);
   llvm::SmallVector<void*> packed_args{};
   for (auto& arg /* arg must be a reference*/ : args) { packed_args.push_back(&arg); }
-  auto error = jit->invokePacked(GetMLIRCInterface(ctx->op_name()), packed_args);
+  auto error = jit_engine.engine->invokePacked(GetMLIRCInterface(ctx->op_name()), packed_args);
   CHECK(!error) << "fail to invoke jit engine, error: " << llvm::toString(std::move(error));
 }
 
+class MlirJitKernelCache final : public user_op::OpKernelCache {
+ public:
+  explicit MlirJitKernelCache(const std::shared_ptr<MlirJitEngine>& jit_engine)
+      : jit_engine_(jit_engine) {}
+  ~MlirJitKernelCache() override = default;
+
+  const MlirJitEngine& jit_engine() const { return *jit_engine_; }
+
+ private:
+  std::shared_ptr<MlirJitEngine> jit_engine_;
+};
+
+void InitMlirJitKernelCache(user_op::KernelCacheContext* ctx, int8_t flag,
+                            std::shared_ptr<user_op::OpKernelCache>* cache_ptr,
+                            const std::string& lowering, const LowerFn& lower) {
+  // The engine depends on the attrs only, the shapes are passed at invocation.
+  if (*cache_ptr != nullptr && (flag & user_op::OpKernelCache::kAttrNotChanged)) { return; }
+  *cache_ptr = std::make_shared<MlirJitKernelCache>(GetOrCreateMlirJitEngine(
+      lowering, ctx->op_name(), ctx->Attr<std::string>("mlir_assembly"), lower));
+}
+
 template<typename T>
 class MlirJitCpuKernel final : public user_op::OpKernel {
  public:
   MlirJitCpuKernel() = default;
   ~MlirJitCpuKernel() = default;
 
- private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    llvm::SmallVector<llvm::StringRef, 4> ext_libs(
-        {SharedLibPaths()->begin(), SharedLibPaths()->end()});
-    WithMlirContext(
-        ctx, ext_libs,
-        [&ctx](mlir::MLIRContext* mlir_ctx) {
-          return mlir::parseSourceString<mlir::ModuleOp>(ctx->Attr<std::string>("mlir_assembly"),
-                                                         mlir_ctx);
-        },
-        [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
+  void InitOpKernelCacheWithFlags(
+      user_op::KernelCacheContext* ctx, int8_t flag,
+      std::shared_ptr<user_op::OpKernelCache>* cache_ptr) const override {
+    InitMlirJitKernelCache(
+        ctx, flag, cache_ptr, "cpu", [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
           CHECK(mlir::succeeded(mlir::oneflow::LowerModuleToLLVM(mlir_ctx, module)))
               << "fail to lower OneFlow to LLVM";
         });
   }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState*,
+               const user_op::OpKernelCache* cache) const override {
+    const auto* jit_cache = dynamic_cast<const MlirJitKernelCache*>(cache);
+    CHECK_NOTNULL(jit_cache);
+    InvokeMlirJitEngine(ctx, jit_cache->jit_engine());
+  }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
@@ -222,21 +507,23 @@ class MlirJitGpuKernel final : public user_op::OpKernel {
   MlirJitGpuKernel() = default;
   ~MlirJitGpuKernel() = default;
 
- private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    llvm::SmallVector<llvm::StringRef, 4> ext_libs(
-        {SharedLibPaths()->begin(), SharedLibPaths()->end()});
-    WithMlirContext(
-        ctx, ext_libs,
-        [&ctx](mlir::MLIRContext* mlir_ctx) {
-          return mlir::parseSourceString<mlir::ModuleOp>(ctx->Attr<std::string>("mlir_assembly"),
-                                                         mlir_ctx);
-        },
-        [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
+  void InitOpKernelCacheWithFlags(
+      user_op::KernelCacheContext* ctx, int8_t flag,
+      std::shared_ptr<user_op::OpKernelCache>* cache_ptr) const override {
+    InitMlirJitKernelCache(
+        ctx, flag, cache_ptr, "cuda", [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
           CHECK(mlir::succeeded(mlir::oneflow::LowerModuleToCUDALLVM(mlir_ctx, module)))
               << "fail to lower OneFlow to CUDA LLVM";
         });
   }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState*,
+               const user_op::OpKernelCache* cache) const override {
+    const auto* jit_cache = dynamic_cast<const MlirJitKernelCache*>(cache);
+    CHECK_NOTNULL(jit_cache);
+    InvokeMlirJitEngine(ctx, jit_cache->jit_engine());
+  }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
@@ -340,3 +340,142 @@ oneflow.job @test_bn_infer(
     } : (tensor<1x64x112x112xf32>, tensor<64xf32>, tensor<64xf32>, tensor<64xf32>, tensor<64xf32>) -> tensor<1x64x112x112xf32>
     oneflow.return %y: tensor<1x64x112x112xf32>
 }
+
+
+//CHECK-LABEL: test_scalar_add
+//CHECK: [[V0:%.+]] = "tosa.const"() {value = dense<2.000000e+00> : tensor<1x1xf32>} : () -> tensor<1x1xf32>
+//CHECK: [[V1:%.+]] = "tosa.add"(%arg0, [[V0]]) : (tensor<4x8xf32>, tensor<1x1xf32>) -> tensor<4x8xf32>
+//CHECK: return [[V1]] : tensor<4x8xf32>
+oneflow.job @test_scalar_add(%arg0: tensor<4x8xf32>) -> tensor<4x8xf32>
+{
+    %res = "oneflow.scalar_add"(%arg0)
+    {
+        device_name = ["@0:0"],
+        device_tag = "cpu",
+        float_operand = 2.000000e+00 : f64,
+        has_float_operand = true,
+        has_int_operand = false,
+        hierarchy = [1],
+        int_operand = 0 : si64,
+        op_name = "",
+        output_lbns = [""],
+        scope_symbol_id = 4611686018431234047 : i64
+    } : (tensor<4x8xf32>) -> tensor<4x8xf32>
+    oneflow.return %res : tensor<4x8xf32>
+}
+
+
+//CHECK-LABEL: test_bias_add
+//CHECK: [[V0:%.+]] = "tosa.reshape"(%arg1) {new_shape = [1, 8]} : (tensor<8xf32>) -> tensor<1x8xf32>
+//CHECK: [[V1:%.+]] = "tosa.add"(%arg0, [[V0]]) : (tensor<4x8xf32>, tensor<1x8xf32>) -> tensor<4x8xf32>
+//CHECK: return [[V1]] : tensor<4x8xf32>
+oneflow.job @test_bias_add(%arg0: tensor<4x8xf32>, %arg1: tensor<8xf32>) -> tensor<4x8xf32>
+{
+    %res = "oneflow.bias_add"(%arg0, %arg1)
+    {
+        axis = 1 : si32,
+        device_name = ["@0:0"],
+        device_tag = "cpu",
+        hierarchy = [1],
+        op_name = "",
+        output_lbns = [""],
+        scope_symbol_id = 4611686018431234047 : i64
+    } : (tensor<4x8xf32>, tensor<8xf32>) -> tensor<4x8xf32>
+    oneflow.return %res : tensor<4x8xf32>
+}
+
+
+//CHECK-LABEL: test_softmax
+//CHECK: [[V0:%.+]] = "tosa.reshape"(%arg0) {new_shape = [8, 16]} : (tensor<2x4x16xf32>) -> tensor<8x16xf32>
+//CHECK: [[V1:%.+]] = "tosa.reduce_max"([[V0]]) {axis = 1 : i64} : (tensor<8x16xf32>) -> tensor<8x1xf32>
+//CHECK: [[V2:%.+]] = "tosa.sub"([[V0]], [[V1]]) : (tensor<8x16xf32>, tensor<8x1xf32>) -> tensor<8x16xf32>
+//CHECK: [[V3:%.+]] = "tosa.exp"([[V2]]) : (tensor<8x16xf32>) -> tensor<8x16xf32>
+//CHECK: [[V4:%.+]] = "tosa.reduce_sum"([[V3]]) {axis = 1 : i64} : (tensor<8x16xf32>) -> tensor<8x1xf32>
+//CHECK: [[V5:%.+]] = "tosa.reciprocal"([[V4]]) : (tensor<8x1xf32>) -> tensor<8x1xf32>
+//CHECK: [[V6:%.+]] = "tosa.mul"([[V3]], [[V5]]) {shift = 0 : i32} : (tensor<8x16xf32>, tensor<8x1xf32>) -> tensor<8x16xf32>
+//CHECK: [[V7:%.+]] = "tosa.reshape"([[V6]]) {new_shape = [2, 4, 16]} : (tensor<8x16xf32>) -> tensor<2x4x16xf32>
+//CHECK: return [[V7]] : tensor<2x4x16xf32>
+oneflow.job @test_softmax(%arg0: tensor<2x4x16xf32>) -> tensor<2x4x16xf32>
+{
+    %res = "oneflow.softmax"(%arg0)
+    {
+        device_name = ["@0:0"],
+        device_tag = "cpu",
+        hierarchy = [1],
+        op_name = "",
+        output_lbns = [""],
+        scope_symbol_id = 4611686018431234047 : i64
+    } : (tensor<2x4x16xf32>) -> tensor<2x4x16xf32>
+    oneflow.return %res : tensor<2x4x16xf32>
+}
+
+
+//CHECK-LABEL: test_gelu
+//CHECK: "tosa.abs"
+//CHECK: "tosa.exp"
+//CHECK: "tosa.greater_equal"
+//CHECK: "tosa.select"
+//CHECK: [[V0:%.+]] = "tosa.mul"(%arg0, {{%.+}}) {shift = 0 : i32} : (tensor<4x8xf32>, tensor<4x8xf32>) -> tensor<4x8xf32>
+//CHECK: return [[V0]] : tensor<4x8xf32>
+oneflow.job @test_gelu(%arg0: tensor<4x8xf32>) -> tensor<4x8xf32>
+{
+    %res = "oneflow.gelu"(%arg0)
+    {
+        device_name = ["@0:0"],
+        device_tag = "cpu",
+        hierarchy = [1],
+        op_name = "",
+        output_lbns = [""],
+        scope_symbol_id = 4611686018431234047 : i64
+    } : (tensor<4x8xf32>) -> tensor<4x8xf32>
+    oneflow.return %res : tensor<4x8xf32>
+}
+
+
+//CHECK-LABEL: test_reduce_sum
+//CHECK: [[V0:%.+]] = "tosa.reduce_sum"(%arg0) {axis = 1 : i64} : (tensor<4x8xf32>) -> tensor<4x1xf32>
+//CHECK: [[V1:%.+]] = "tosa.reshape"([[V0]]) {new_shape = [4]} : (tensor<4x1xf32>) -> tensor<4xf32>
+//CHECK: return [[V1]] : tensor<4xf32>
+oneflow.job @test_reduce_sum(%arg0: tensor<4x8xf32>) -> tensor<4xf32>
+{
+    %res = "oneflow.reduce_sum"(%arg0)
+    {
+        axis = [1 : si32],
+        device_name = ["@0:0"],
+        device_tag = "cpu",
+        hierarchy = [1],
+        keepdims = false,
+        op_name = "",
+        output_lbns = [""],
+        scope_symbol_id = 4611686018431234047 : i64
+    } : (tensor<4x8xf32>) -> tensor<4xf32>
+    oneflow.return %res : tensor<4xf32>
+}
+
+
+//CHECK-LABEL: test_layer_norm
+//CHECK: "tosa.reduce_sum"
+//CHECK: "tosa.rsqrt"
+//CHECK: [[V0:%.+]] = "tosa.reshape"(%arg1) {new_shape = [1, 1, 16]} : (tensor<16xf32>) -> tensor<1x1x16xf32>
+//CHECK: "tosa.mul"({{%.+}}, [[V0]])
+//CHECK: [[V1:%.+]] = "tosa.reshape"(%arg2) {new_shape = [1, 1, 16]} : (tensor<16xf32>) -> tensor<1x1x16xf32>
+//CHECK: "tosa.add"({{%.+}}, [[V1]])
+oneflow.job @test_layer_norm(%arg0: tensor<2x4x16xf32>, %arg1: tensor<16xf32>, %arg2: tensor<16xf32>) -> tensor<2x4x16xf32>
+{
+    %y, %mean, %inv_variance = "oneflow.layer_norm"(%arg0, %arg2, %arg1)
+    {
+        begin_norm_axis = 2 : si64,
+        begin_params_axis = 2 : si64,
+        center = true,
+        device_name = ["@0:0"],
+        device_tag = "cpu",
+        epsilon = 1.000000e-05 : f64,
+        hierarchy = [1],
+        op_name = "",
+        operand_segment_sizes = dense<1> : vector<3xi32>,
+        output_lbns = ["", "", ""],
+        scale = true,
+        scope_symbol_id = 4611686018431234047 : i64
+    } : (tensor<2x4x16xf32>, tensor<16xf32>, tensor<16xf32>) -> (tensor<2x4x16xf32>, tensor<2x4xf32>, tensor<2x4xf32>)
+    oneflow.return %y : tensor<2x4x16xf32>
+}
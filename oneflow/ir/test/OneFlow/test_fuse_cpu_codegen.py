@@ -0,0 +1,89 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# RUN: python3 %s | FileCheck %s
+# CHECK: __FUSE__
+
+import os
+import time
+import unittest
+import numpy as np
+
+os.environ["ONEFLOW_MLIR_ENABLE_ROUND_TRIP"] = "1"
+os.environ["ONEFLOW_MLIR_ENABLE_CODEGEN_FUSERS"] = "1"
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class BlockModule(flow.nn.Module):
+    def __init__(self, hidden):
+        super().__init__()
+        self.layer_norm = flow.nn.LayerNorm(hidden)
+        self.bias = flow.nn.Parameter(flow.randn(hidden))
+
+    def forward(self, x, mask):
+        scores = flow.softmax(x * 0.125 + mask, dim=-1)
+        y = self.layer_norm(scores)
+        y = flow.gelu(flow._C.bias_add(y, self.bias, axis=2))
+        return y, y.sum(dim=-1)
+
+
+class BlockGraph(flow.nn.Graph):
+    def __init__(self, module):
+        super().__init__()
+        self.fw = module
+
+    def build(self, x, mask):
+        return self.fw(x, mask)
+
+
+def _run(test_case, shape):
+    module = BlockModule(shape[-1])
+    module.eval()
+    x = flow.randn(*shape)
+    mask = flow.randn(*shape)
+    graph = BlockGraph(module)
+    y_lazy, sum_lazy = graph(x, mask)
+    y_eager, sum_eager = module(x, mask)
+    test_case.assertTrue(
+        np.allclose(y_lazy.numpy(), y_eager.numpy(), rtol=1e-4, atol=1e-5)
+    )
+    test_case.assertTrue(
+        np.allclose(sum_lazy.numpy(), sum_eager.numpy(), rtol=1e-4, atol=1e-4)
+    )
+    return module, graph, x, mask
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFuseCpuCodegen(oneflow.unittest.TestCase):
+    def test_fuse_cpu_block(test_case):
+        _run(test_case, (2, 4, 16))
+
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_CPU_CODEGEN_BENCHMARK"), "benchmark only"
+    )
+    def test_fuse_cpu_block_benchmark(test_case):
+        module, graph, x, mask = _run(test_case, (32, 128, 768))
+        for fn, name in [(module, "eager"), (graph, "graph")]:
+            fn(x, mask)
+            start = time.perf_counter()
+            for _ in range(20):
+                fn(x, mask)[0].numpy()
+            print(name, (time.perf_counter() - start) / 20 * 1000, "ms")
+
+
+if __name__ == "__main__":
+    unittest.main()
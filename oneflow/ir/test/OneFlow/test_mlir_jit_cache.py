@@ -0,0 +1,122 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# RUN: python3 %s | FileCheck %s
+# CHECK: jit
+
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+import numpy as np
+
+cache_dir = tempfile.mkdtemp()
+os.environ["ONEFLOW_MLIR_ENABLE_ROUND_TRIP"] = "1"
+os.environ["ONEFLOW_MLIR_ENABLE_CODEGEN_FUSERS"] = "1"
+os.environ["ONEFLOW_MLIR_JIT_CACHE_DIR"] = cache_dir
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class CastModule(flow.nn.Module):
+    def forward(self, x, scale):
+        return x.to(dtype=flow.float32) * scale
+
+
+class CastGraph(flow.nn.Graph):
+    def __init__(self, module):
+        super().__init__()
+        self.fw = module
+
+    def build(self, x, scale):
+        return self.fw(x, scale)
+
+
+def _run_graph_and_save(path):
+    scale = flow.tensor([7.7], dtype=flow.float32)
+    x = flow.tensor(np.arange(-5, 5).reshape(2, 5), dtype=flow.int64)
+    np.save(path, CastGraph(CastModule())(x, scale).numpy())
+
+
+def _run_graph_in_new_process(test_case, cache_dir):
+    # a new process has no engine in memory, so it can only get one from the disk cache
+    path = os.path.join(tempfile.mkdtemp(), "y.npy")
+    env = dict(os.environ, ONEFLOW_MLIR_JIT_CACHE_DIR=cache_dir)
+    output = subprocess.run(
+        [sys.executable, __file__, "--run-graph", path],
+        env=env,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+    )
+    print(output.stdout.decode())
+    test_case.assertEqual(output.returncode, 0)
+    expected = np.arange(-5, 5).reshape(2, 5).astype(np.float32) * np.float32(7.7)
+    test_case.assertTrue(np.allclose(np.load(path), expected))
+
+
+def _bitcode_files(cache_dir):
+    paths = [
+        os.path.join(cache_dir, name)
+        for name in os.listdir(cache_dir)
+        if name.endswith(".bc")
+    ]
+    return {path: (os.stat(path).st_ino, os.stat(path).st_mtime_ns) for path in paths}
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestMlirJitCache(oneflow.unittest.TestCase):
+    def test_jit_cache(test_case):
+        module = CastModule()
+        scale = flow.tensor([7.7], dtype=flow.float32)
+        x = flow.tensor(np.random.randint(-10, 10, (2, 5)), dtype=flow.int64)
+        # kernels of the same op name and assembly share one engine
+        for _ in range(2):
+            graph = CastGraph(module)
+            for _ in range(3):
+                y_lazy = graph(x, scale)
+                test_case.assertTrue(
+                    np.allclose(y_lazy.numpy(), module(x, scale).numpy())
+                )
+        names = os.listdir(cache_dir)
+        test_case.assertTrue(any(name.endswith(".bc") for name in names))
+        test_case.assertTrue(any(name.endswith(".key") for name in names))
+        test_case.assertFalse(any(".tmp" in name for name in names))
+
+    def test_jit_disk_cache(test_case):
+        cache_dir = tempfile.mkdtemp()
+        _run_graph_in_new_process(test_case, cache_dir)
+        stored = _bitcode_files(cache_dir)
+        test_case.assertTrue(len(stored) > 0)
+        # the second process loads the entries instead of storing them again
+        _run_graph_in_new_process(test_case, cache_dir)
+        test_case.assertEqual(_bitcode_files(cache_dir), stored)
+        # a broken entry is removed and compiled again
+        for path in stored:
+            with open(path, "wb") as f:
+                f.write(b"broken")
+        _run_graph_in_new_process(test_case, cache_dir)
+        for path in _bitcode_files(cache_dir):
+            with open(path, "rb") as f:
+                test_case.assertNotEqual(f.read(), b"broken")
+        test_case.assertFalse(any(".tmp" in name for name in os.listdir(cache_dir)))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) == 3 and sys.argv[1] == "--run-graph":
+        _run_graph_and_save(sys.argv[2])
+    else:
+        unittest.main()
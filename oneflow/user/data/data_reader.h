@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/user/data/dataset.h"
 #include "oneflow/user/data/parser.h"
 #include "oneflow/core/common/buffer.h"
+#include "oneflow/core/profiler/metrics.h"
 
 namespace oneflow {
 
@@ -66,8 +67,16 @@ class DataReader {
 
  private:
   BatchType FetchBatchData() {
+    // The wait is the time the kernel stalls on the load thread, near zero if loading keeps up.
+    static profiler::Histogram* wait_histogram =
+        profiler::MetricsRegistry::Get()->GetOrCreateHistogram(
+            "oneflow_data_reader_fetch_wait_ns",
+            "Nanoseconds the data reader kernels wait for a loaded batch.");
     BatchType batch;
-    CHECK_EQ(batch_buffer_.Pull(&batch), BufferStatus::kBufferStatusSuccess);
+    {
+      profiler::HistogramTimer timer(wait_histogram);
+      CHECK_EQ(batch_buffer_.Pull(&batch), BufferStatus::kBufferStatusSuccess);
+    }
     return batch;
   }
 
@@ -0,0 +1,382 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+// Time every applicable algorithm the first time a problem size is seen and reuse the fastest one,
+// otherwise pick the first applicable algorithm in a fixed order of preference.
+DEFINE_ENV_BOOL(ONEFLOW_CPU_CONV_ENABLE_AUTOTUNE, true);
+// Winograd F(4x4, 3x3) saves more multiplications than F(2x2, 3x3) but its transforms amplify the
+// float rounding error by an order of magnitude, so it is opt-in.
+DEFINE_ENV_BOOL(ONEFLOW_CPU_CONV_ENABLE_WINOGRAD_F4X4, false);
+// Forces the algorithm, given by its ConvCpuAlgorithm value, whenever it applies to the problem,
+// e.g. to test or benchmark one algorithm. -1 leaves the choice to the kernel.
+DEFINE_ENV_INTEGER(ONEFLOW_CPU_CONV_ALGORITHM, -1);
+
+// Im2col-free algorithms of the CPU convolution kernel, all of them work on a single NCHW image
+// with groups == 1.
+enum class ConvCpuAlgorithm : int32_t {
+  kIm2ColGemm = 0,
+  kDirect1x1 = 1,
+  kWinogradF2x2K3x3 = 2,
+  kWinogradF4x4K3x3 = 3,
+  kBlockedNCHWc = 4,
+};
+
+struct Conv2dCpuParams {
+  int64_t channels;
+  int64_t height;
+  int64_t width;
+  int64_t filters;
+  int64_t out_height;
+  int64_t out_width;
+  int64_t kernel_h;
+  int64_t kernel_w;
+  int64_t stride_h;
+  int64_t stride_w;
+  int64_t dilation_h;
+  int64_t dilation_w;
+  int64_t padding_h;
+  int64_t padding_w;
+};
+
+namespace conv_cpu {
+
+// Winograd minimal filtering F(m x m, 3 x 3), see "Fast Algorithms for Convolutional Neural
+// Networks" (Lavin & Gray). Tiles of (m + 2) x (m + 2) input pixels produce m x m output pixels.
+template<int kOutTile>
+struct WinogradMatrices;
+
+template<>
+struct WinogradMatrices<2> {
+  static constexpr int kTile = 4;
+  static double BT(int i, int j) {
+    static const double kBT[4][4] = {
+        {1, 0, -1, 0}, {0, 1, 1, 0}, {0, -1, 1, 0}, {0, 1, 0, -1}};
+    return kBT[i][j];
+  }
+  static double G(int i, int j) {
+    static const double kG[4][3] = {{1, 0, 0}, {0.5, 0.5, 0.5}, {0.5, -0.5, 0.5}, {0, 0, 1}};
+    return kG[i][j];
+  }
+  static double AT(int i, int j) {
+    static const double kAT[2][4] = {{1, 1, 1, 0}, {0, 1, -1, -1}};
+    return kAT[i][j];
+  }
+};
+
+template<>
+struct WinogradMatrices<4> {
+  static constexpr int kTile = 6;
+  static double BT(int i, int j) {
+    static const double kBT[6][6] = {{4, 0, -5, 0, 1, 0},  {0, -4, -4, 1, 1, 0},
+                                     {0, 4, -4, -1, 1, 0}, {0, -2, -1, 2, 1, 0},
+                                     {0, 2, -1, -2, 1, 0}, {0, 4, 0, -5, 0, 1}};
+    return kBT[i][j];
+  }
+  static double G(int i, int j) {
+    static const double kG[6][3] = {{1.0 / 4, 0, 0},
+                                    {-1.0 / 6, -1.0 / 6, -1.0 / 6},
+                                    {-1.0 / 6, 1.0 / 6, -1.0 / 6},
+                                    {1.0 / 24, 1.0 / 12, 1.0 / 6},
+                                    {1.0 / 24, -1.0 / 12, 1.0 / 6},
+                                    {0, 0, 1}};
+    return kG[i][j];
+  }
+  static double AT(int i, int j) {
+    static const double kAT[4][6] = {
+        {1, 1, 1, 1, 1, 0}, {0, 1, -1, 2, -2, 0}, {0, 1, 1, 4, 4, 0}, {0, 1, -1, 8, -8, 1}};
+    return kAT[i][j];
+  }
+};
+
+// y = L * x * L^T, with L of rows x cols and x of cols x cols
+template<typename T, int rows, int cols, typename L>
+void WinogradSandwich(const L& l, const T* x, T* y) {
+  T tmp[rows][cols];
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      T sum = 0;
+      for (int k = 0; k < cols; ++k) { sum += static_cast<T>(l(i, k)) * x[k * cols + j]; }
+      tmp[i][j] = sum;
+    }
+  }
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < rows; ++j) {
+      T sum = 0;
+      for (int k = 0; k < cols; ++k) { sum += tmp[i][k] * static_cast<T>(l(j, k)); }
+      y[i * rows + j] = sum;
+    }
+  }
+}
+
+}  // namespace conv_cpu
+
+template<typename T, int kOutTile>
+struct WinogradConvCpuUtil final {
+  static constexpr int kTile = conv_cpu::WinogradMatrices<kOutTile>::kTile;
+  static constexpr int kTileSize = kTile * kTile;
+
+  static bool IsApplicable(const Conv2dCpuParams& params) {
+    return params.kernel_h == 3 && params.kernel_w == 3 && params.stride_h == 1
+           && params.stride_w == 1 && params.dilation_h == 1 && params.dilation_w == 1;
+  }
+
+  static int64_t NumTiles(const Conv2dCpuParams& params) {
+    return RoundUp(params.out_height) * RoundUp(params.out_width);
+  }
+
+  // transformed weight U: [kTileSize, filters, channels]
+  static int64_t WeightElemCnt(const Conv2dCpuParams& params) {
+    return kTileSize * params.filters * params.channels;
+  }
+
+  // transformed input V: [kTileSize, channels, tiles], products M: [kTileSize, filters, tiles]
+  static int64_t ImageTmpElemCnt(const Conv2dCpuParams& params) {
+    return kTileSize * (params.channels + params.filters) * NumTiles(params);
+  }
+
+  static void TransformWeight(ep::CpuStream* stream, const Conv2dCpuParams& params,
+                              const T* weight, T* transformed_weight) {
+    using Matrices = conv_cpu::WinogradMatrices<kOutTile>;
+    const int64_t num_filters = params.filters;
+    const int64_t num_channels = params.channels;
+    stream->ParallelFor(
+        0, num_filters * num_channels,
+        [&](int64_t begin, int64_t end) {
+          T u[kTileSize];
+          for (int64_t i = begin; i < end; ++i) {
+            conv_cpu::WinogradSandwich<T, kTile, 3>(Matrices::G, weight + i * 9, u);
+            for (int xi = 0; xi < kTileSize; ++xi) {
+              transformed_weight[xi * num_filters * num_channels + i] = u[xi];
+            }
+          }
+        },
+        1);
+  }
+
+  static void Forward(ep::CpuStream* stream, const Conv2dCpuParams& params,
+                      const T* transformed_weight, const T* in, const T* bias, T* tmp, T* out) {
+    using Matrices = conv_cpu::WinogradMatrices<kOutTile>;
+    const int64_t num_tiles_w = RoundUp(params.out_width);
+    const int64_t num_tiles = NumTiles(params);
+    T* transformed_in = tmp;
+    T* products = tmp + kTileSize * params.channels * num_tiles;
+
+    stream->ParallelFor(
+        0, params.channels,
+        [&](int64_t begin, int64_t end) {
+          T d[kTileSize];
+          T v[kTileSize];
+          for (int64_t c = begin; c < end; ++c) {
+            const T* in_channel = in + c * params.height * params.width;
+            for (int64_t tile = 0; tile < num_tiles; ++tile) {
+              const int64_t h_start = (tile / num_tiles_w) * kOutTile - params.padding_h;
+              const int64_t w_start = (tile % num_tiles_w) * kOutTile - params.padding_w;
+              for (int i = 0; i < kTile; ++i) {
+                const int64_t h = h_start + i;
+                for (int j = 0; j < kTile; ++j) {
+                  const int64_t w = w_start + j;
+                  d[i * kTile + j] = (h >= 0 && h < params.height && w >= 0 && w < params.width)
+                                         ? in_channel[h * params.width + w]
+                                         : static_cast<T>(0);
+                }
+              }
+              conv_cpu::WinogradSandwich<T, kTile, kTile>(Matrices::BT, d, v);
+              for (int xi = 0; xi < kTileSize; ++xi) {
+                transformed_in[(xi * params.channels + c) * num_tiles + tile] = v[xi];
+              }
+            }
+          }
+        },
+        1);
+
+    // M[xi] = U[xi] * V[xi]
+    FOR_RANGE(int64_t, xi, 0, kTileSize) {
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          stream, CblasNoTrans, CblasNoTrans, params.filters, num_tiles, params.channels,
+          static_cast<T>(1), transformed_weight + xi * params.filters * params.channels,
+          transformed_in + xi * params.channels * num_tiles, static_cast<T>(0),
+          products + xi * params.filters * num_tiles);
+    }
+
+    stream->ParallelFor(
+        0, params.filters,
+        [&](int64_t begin, int64_t end) {
+          T m[kTileSize];
+          T y[kOutTile * kOutTile];
+          for (int64_t f = begin; f < end; ++f) {
+            T* out_channel = out + f * params.out_height * params.out_width;
+            const T bias_value = bias == nullptr ? static_cast<T>(0) : bias[f];
+            for (int64_t tile = 0; tile < num_tiles; ++tile) {
+              for (int xi = 0; xi < kTileSize; ++xi) {
+                m[xi] = products[(xi * params.filters + f) * num_tiles + tile];
+              }
+              conv_cpu::WinogradSandwich<T, kOutTile, kTile>(Matrices::AT, m, y);
+              const int64_t h_start = (tile / num_tiles_w) * kOutTile;
+              const int64_t w_start = (tile % num_tiles_w) * kOutTile;
+              for (int i = 0; i < kOutTile && h_start + i < params.out_height; ++i) {
+                for (int j = 0; j < kOutTile && w_start + j < params.out_width; ++j) {
+                  out_channel[(h_start + i) * params.out_width + w_start + j] =
+                      y[i * kOutTile + j] + bias_value;
+                }
+              }
+            }
+          }
+        },
+        1);
+  }
+
+ private:
+  static int64_t RoundUp(int64_t size) { return (size + kOutTile - 1) / kOutTile; }
+};
+
+// Direct convolution on channel-blocked tensors: activations are reordered to
+// [channels / kBlock, height, width, kBlock] and weights to
+// [filters / kBlock, channels / kBlock, kernel_h, kernel_w, kBlock(in), kBlock(out)], so the
+// innermost loop is a contiguous kBlock-wide multiply-add the compiler can vectorize.
+template<typename T>
+struct BlockedNCHWcConvCpuUtil final {
+  static constexpr int64_t kBlock = 8;
+
+  static int64_t WeightElemCnt(const Conv2dCpuParams& params) {
+    return NumBlocks(params.filters) * NumBlocks(params.channels) * params.kernel_h
+           * params.kernel_w * kBlock * kBlock;
+  }
+
+  static int64_t ImageTmpElemCnt(const Conv2dCpuParams& params) {
+    return NumBlocks(params.channels) * params.height * params.width * kBlock
+           + NumBlocks(params.filters) * params.out_height * params.out_width * kBlock;
+  }
+
+  static void TransformWeight(ep::CpuStream* stream, const Conv2dCpuParams& params,
+                              const T* weight, T* blocked_weight) {
+    const int64_t num_channel_blocks = NumBlocks(params.channels);
+    const int64_t kernel_size = params.kernel_h * params.kernel_w;
+    stream->ParallelFor(
+        0, NumBlocks(params.filters),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t fb = begin; fb < end; ++fb) {
+            T* dst = blocked_weight + fb * num_channel_blocks * kernel_size * kBlock * kBlock;
+            FOR_RANGE(int64_t, cb, 0, num_channel_blocks) {
+              FOR_RANGE(int64_t, r, 0, kernel_size) {
+                FOR_RANGE(int64_t, ci, 0, kBlock) {
+                  FOR_RANGE(int64_t, fi, 0, kBlock) {
+                    const int64_t f = fb * kBlock + fi;
+                    const int64_t c = cb * kBlock + ci;
+                    *(dst++) = (f < params.filters && c < params.channels)
+                                   ? weight[(f * params.channels + c) * kernel_size + r]
+                                   : static_cast<T>(0);
+                  }
+                }
+              }
+            }
+          }
+        },
+        1);
+  }
+
+  static void Forward(ep::CpuStream* stream, const Conv2dCpuParams& params,
+                      const T* blocked_weight, const T* in, const T* bias, T* tmp, T* out) {
+    const int64_t num_channel_blocks = NumBlocks(params.channels);
+    const int64_t num_filter_blocks = NumBlocks(params.filters);
+    const int64_t in_size = params.height * params.width;
+    const int64_t out_size = params.out_height * params.out_width;
+    T* blocked_in = tmp;
+    T* blocked_out = tmp + num_channel_blocks * in_size * kBlock;
+
+    stream->ParallelFor(
+        0, num_channel_blocks,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t cb = begin; cb < end; ++cb) {
+            T* dst = blocked_in + cb * in_size * kBlock;
+            FOR_RANGE(int64_t, i, 0, in_size) {
+              FOR_RANGE(int64_t, ci, 0, kBlock) {
+                const int64_t c = cb * kBlock + ci;
+                dst[i * kBlock + ci] =
+                    c < params.channels ? in[c * in_size + i] : static_cast<T>(0);
+              }
+            }
+          }
+        },
+        1);
+
+    const int64_t kernel_size = params.kernel_h * params.kernel_w;
+    stream->ParallelFor(
+        0, num_filter_blocks * params.out_height,
+        [&](int64_t begin, int64_t end) {
+          T acc[kBlock];
+          for (int64_t idx = begin; idx < end; ++idx) {
+            const int64_t fb = idx / params.out_height;
+            const int64_t oh = idx % params.out_height;
+            const T* fb_weight =
+                blocked_weight + fb * num_channel_blocks * kernel_size * kBlock * kBlock;
+            T* dst = blocked_out + (fb * params.out_height + oh) * params.out_width * kBlock;
+            FOR_RANGE(int64_t, ow, 0, params.out_width) {
+              std::fill(acc, acc + kBlock, static_cast<T>(0));
+              FOR_RANGE(int64_t, kh, 0, params.kernel_h) {
+                const int64_t ih = oh * params.stride_h - params.padding_h + kh * params.dilation_h;
+                if (ih < 0 || ih >= params.height) { continue; }
+                FOR_RANGE(int64_t, kw, 0, params.kernel_w) {
+                  const int64_t iw =
+                      ow * params.stride_w - params.padding_w + kw * params.dilation_w;
+                  if (iw < 0 || iw >= params.width) { continue; }
+                  FOR_RANGE(int64_t, cb, 0, num_channel_blocks) {
+                    const T* x =
+                        blocked_in + ((cb * params.height + ih) * params.width + iw) * kBlock;
+                    const T* w = fb_weight
+                                 + (cb * kernel_size + kh * params.kernel_w + kw) * kBlock * kBlock;
+                    for (int64_t ci = 0; ci < kBlock; ++ci) {
+                      const T x_value = x[ci];
+                      for (int64_t fi = 0; fi < kBlock; ++fi) {
+                        acc[fi] += x_value * w[ci * kBlock + fi];
+                      }
+                    }
+                  }
+                }
+              }
+              std::copy(acc, acc + kBlock, dst + ow * kBlock);
+            }
+          }
+        },
+        1);
+
+    stream->ParallelFor(
+        0, params.filters,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t f = begin; f < end; ++f) {
+            const T* src = blocked_out + (f / kBlock) * out_size * kBlock + f % kBlock;
+            const T bias_value = bias == nullptr ? static_cast<T>(0) : bias[f];
+            T* dst = out + f * out_size;
+            FOR_RANGE(int64_t, i, 0, out_size) { dst[i] = src[i * kBlock] + bias_value; }
+          }
+        },
+        1);
+  }
+
+ private:
+  static int64_t NumBlocks(int64_t size) { return (size + kBlock - 1) / kBlock; }
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
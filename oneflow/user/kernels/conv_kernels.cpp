@@ -13,11 +13,14 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <chrono>
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/ops/nn_util.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/ep/include/primitive/add.h"
+#include "oneflow/user/kernels/cpu_packed_weight_util.h"
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -293,6 +296,39 @@ struct ConvKernelUtil final {
   }
 };
 
+// Keeps the weight transformed by a Winograd or blocked NCHWc algorithm and reuses it while the
+// key (problem and algorithm) and the weight address stay the same. Only used when the weights are
+// declared frozen, see ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE.
+template<typename T>
+class ConvTransformedWeightCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ConvTransformedWeightCache);
+  ConvTransformedWeightCache() = default;
+  ~ConvTransformedWeightCache() = default;
+
+  // TransformFn: void(T* transformed_weight), fills elem_cnt elements
+  template<typename TransformFn>
+  std::shared_ptr<const std::vector<T>> Get(const std::vector<int64_t>& key, const void* weight,
+                                            int64_t elem_cnt, const TransformFn& transform_fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (key != key_ || weight != transformed_from_) {
+      // a new buffer, concurrent launches keep running on the one they took
+      auto transformed_weight = std::make_shared<std::vector<T>>(elem_cnt);
+      transform_fn(transformed_weight->data());
+      transformed_weight_ = std::move(transformed_weight);
+      key_ = key;
+      transformed_from_ = weight;
+    }
+    return transformed_weight_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<int64_t> key_;
+  const void* transformed_from_ = nullptr;
+  std::shared_ptr<const std::vector<T>> transformed_weight_;
+};
+
 template<typename T>
 struct ConvOpKernelCache final : public user_op::OpKernelCache {
   Im2ColFunc<T> im2col_func_ = nullptr;
@@ -310,8 +346,148 @@ struct ConvOpKernelCache final : public user_op::OpKernelCache {
   enum CBLAS_TRANSPOSE is_out_diff_need_trans_ = CblasNoTrans;
   int32_t idx_offset_{};
   bool is_dynamic_{};
+
+  // forward algorithms applicable to this problem, in the order of preference without autotuning
+  std::vector<ConvCpuAlgorithm> algorithms_;
+  Conv2dCpuParams params_2d_{};
+  // identifies the problem size, attrs and data type
+  std::vector<int64_t> problem_key_;
+  // only set for the forward kernel
+  std::shared_ptr<ConvTransformedWeightCache<T>> transformed_weight_cache_;
+
+#ifdef WITH_ONEDNN
+  // only set for the forward kernel of float
+  std::shared_ptr<OneDnnPackedWeightCache> packed_weight_cache_;
+#endif  // WITH_ONEDNN
 };
 
+Shape Gen5DShape(const Shape& shape, int32_t idx_offset) {
+  DimVector ret_vec(shape.dim_vec());
+  int32_t ndims = ret_vec.size() - 2;
+  ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
+  return Shape(ret_vec);
+}
+
+std::vector<int32_t> Gen3DVec(const std::vector<int32_t>& origin_vec) {
+  std::vector<int32_t> ret_vec = origin_vec;
+  ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), 1);
+  return ret_vec;
+}
+
+std::vector<int32_t> Gen3DPadding(const std::vector<int32_t>& padding_before) {
+  std::vector<int32_t> ret_vec;
+  FOR_RANGE(uint8_t, dim, 0, 3) {
+    int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
+    if (index < 0) {
+      ret_vec.emplace_back(0);
+    } else {
+      ret_vec.emplace_back(padding_before.at(index));
+    }
+  }
+  return ret_vec;
+}
+
+// Fills `params` if the problem is a 2d (or 1d) convolution of channels_first layout.
+bool GetConv2dCpuParams(const Shape& in_5d_shape, const Shape& weight_5d_shape,
+                        const Shape& out_5d_shape, int32_t idx_offset,
+                        const std::vector<int32_t>& strides_3d,
+                        const std::vector<int32_t>& dilation_rate_3d,
+                        const std::vector<int32_t>& padding_before_3d, Conv2dCpuParams* params) {
+  if (idx_offset != 2 || in_5d_shape.At(2) != 1 || weight_5d_shape.At(2) != 1) { return false; }
+  params->channels = in_5d_shape.At(1);
+  params->height = in_5d_shape.At(3);
+  params->width = in_5d_shape.At(4);
+  params->filters = out_5d_shape.At(1);
+  params->out_height = out_5d_shape.At(3);
+  params->out_width = out_5d_shape.At(4);
+  params->kernel_h = weight_5d_shape.At(3);
+  params->kernel_w = weight_5d_shape.At(4);
+  params->stride_h = strides_3d.at(1);
+  params->stride_w = strides_3d.at(2);
+  params->dilation_h = dilation_rate_3d.at(1);
+  params->dilation_w = dilation_rate_3d.at(2);
+  params->padding_h = padding_before_3d.at(1);
+  params->padding_w = padding_before_3d.at(2);
+  return true;
+}
+
+bool IsConv1x1WithoutPadding(const Shape& weight_5d_shape, int32_t idx_offset,
+                             const std::vector<int32_t>& strides_3d,
+                             const std::vector<int32_t>& padding_before_3d) {
+  const int64_t kernel_size =
+      idx_offset == 2 ? weight_5d_shape.Count(2) : weight_5d_shape.Count(1, 4);
+  return kernel_size == 1
+         && std::all_of(strides_3d.cbegin(), strides_3d.cend(), [](int32_t v) { return v == 1; })
+         && std::all_of(padding_before_3d.cbegin(), padding_before_3d.cend(),
+                        [](int32_t v) { return v == 0; });
+}
+
+// Number of elements of tmp_buffer needed by the im2col-free algorithm, the transformed weight
+// comes first and is followed by the per-image workspace.
+int64_t ConvCpuAlgorithmTmpElemCnt(ConvCpuAlgorithm algorithm, const Conv2dCpuParams& params) {
+  switch (algorithm) {
+    case ConvCpuAlgorithm::kWinogradF2x2K3x3:
+      return WinogradConvCpuUtil<float, 2>::WeightElemCnt(params)
+             + WinogradConvCpuUtil<float, 2>::ImageTmpElemCnt(params);
+    case ConvCpuAlgorithm::kWinogradF4x4K3x3:
+      return WinogradConvCpuUtil<float, 4>::WeightElemCnt(params)
+             + WinogradConvCpuUtil<float, 4>::ImageTmpElemCnt(params);
+    case ConvCpuAlgorithm::kBlockedNCHWc:
+      return BlockedNCHWcConvCpuUtil<float>::WeightElemCnt(params)
+             + BlockedNCHWcConvCpuUtil<float>::ImageTmpElemCnt(params);
+    default: return 0;
+  }
+}
+
+std::vector<ConvCpuAlgorithm> GetConvCpuAlgorithms(const Shape& weight_5d_shape,
+                                                   int32_t idx_offset,
+                                                   const std::vector<int32_t>& strides_3d,
+                                                   const std::vector<int32_t>& padding_before_3d,
+                                                   bool has_params_2d,
+                                                   const Conv2dCpuParams& params_2d) {
+  std::vector<ConvCpuAlgorithm> algorithms;
+  if (IsConv1x1WithoutPadding(weight_5d_shape, idx_offset, strides_3d, padding_before_3d)) {
+    algorithms.emplace_back(ConvCpuAlgorithm::kDirect1x1);
+  }
+  const bool is_winograd_applicable =
+      has_params_2d && WinogradConvCpuUtil<float, 2>::IsApplicable(params_2d);
+  if (is_winograd_applicable) { algorithms.emplace_back(ConvCpuAlgorithm::kWinogradF2x2K3x3); }
+  algorithms.emplace_back(ConvCpuAlgorithm::kIm2ColGemm);
+  const int64_t forced_algorithm = EnvInteger<ONEFLOW_CPU_CONV_ALGORITHM>();
+  if (is_winograd_applicable
+      && (EnvBool<ONEFLOW_CPU_CONV_ENABLE_WINOGRAD_F4X4>()
+          || forced_algorithm == static_cast<int64_t>(ConvCpuAlgorithm::kWinogradF4x4K3x3))) {
+    algorithms.emplace_back(ConvCpuAlgorithm::kWinogradF4x4K3x3);
+  }
+  if (has_params_2d) { algorithms.emplace_back(ConvCpuAlgorithm::kBlockedNCHWc); }
+  for (ConvCpuAlgorithm algorithm : algorithms) {
+    if (static_cast<int64_t>(algorithm) == forced_algorithm) { return {algorithm}; }
+  }
+  return algorithms;
+}
+
+size_t InferConvCpuAlgorithmsTmpSize(user_op::InferContext* ctx, size_t elem_size) {
+  const int32_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+  const Shape in_5d_shape = Gen5DShape(ctx->InputTensorDesc("in", 0).shape(), idx_offset);
+  const Shape weight_5d_shape = Gen5DShape(ctx->InputTensorDesc("weight", 0).shape(), idx_offset);
+  const Shape out_5d_shape = Gen5DShape(ctx->OutputTensorDesc("out", 0)->shape(), idx_offset);
+  const std::vector<int32_t> strides_3d = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
+  const std::vector<int32_t> dilation_rate_3d =
+      Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
+  const std::vector<int32_t> padding_before_3d =
+      Gen3DPadding(ctx->Attr<std::vector<int32_t>>("padding_before"));
+  Conv2dCpuParams params_2d{};
+  const bool has_params_2d =
+      GetConv2dCpuParams(in_5d_shape, weight_5d_shape, out_5d_shape, idx_offset, strides_3d,
+                         dilation_rate_3d, padding_before_3d, &params_2d);
+  int64_t tmp_elem_cnt = 0;
+  for (ConvCpuAlgorithm algorithm : GetConvCpuAlgorithms(
+           weight_5d_shape, idx_offset, strides_3d, padding_before_3d, has_params_2d, params_2d)) {
+    tmp_elem_cnt = std::max(tmp_elem_cnt, ConvCpuAlgorithmTmpElemCnt(algorithm, params_2d));
+  }
+  return tmp_elem_cnt * elem_size;
+}
+
 template<typename T>
 std::shared_ptr<ConvOpKernelCache<T>> CreateConvOpKernelCache(user_op::KernelCacheContext* ctx,
                                                               const std::string& in_name,
@@ -334,12 +510,6 @@ std::shared_ptr<ConvOpKernelCache<T>> CreateConvOpKernelCache(user_op::KernelCac
     cache->idx_offset_ = 1;
   }
 
-  auto Gen5DShape = [](const Shape& shape, int32_t idx_offset) -> Shape {
-    DimVector ret_vec(shape.dim_vec());
-    int32_t ndims = ret_vec.size() - 2;
-    ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
-    return Shape(ret_vec);
-  };
   const auto* in_tensor = ctx->TensorDesc4ArgNameAndIndex(in_name, 0);
   const auto& in_shape = in_tensor->shape();
   cache->in_5d_shape_ = Gen5DShape(in_shape, cache->idx_offset_);
@@ -348,32 +518,390 @@ std::shared_ptr<ConvOpKernelCache<T>> CreateConvOpKernelCache(user_op::KernelCac
   cache->weight_5d_shape_ =
       Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(), cache->idx_offset_);
 
-  auto Gen3DVec = [](const std::vector<int32_t>& origin_vec) -> std::vector<int32_t> {
-    std::vector<int32_t> ret_vec = origin_vec;
-    ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), 1);
-    return ret_vec;
-  };
   cache->strides_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
   cache->dilation_rate_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
   cache->is_dynamic_ = ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->is_dynamic();
-  const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
-  FOR_RANGE(uint8_t, dim, 0, 3) {
-    int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
-    if (index < 0) {
-      cache->padding_before_3d_.emplace_back(0);
-    } else {
-      cache->padding_before_3d_.emplace_back(padding_before.at(index));
-    }
+  cache->padding_before_3d_ = Gen3DPadding(ctx->Attr<std::vector<int32_t>>("padding_before"));
+
+  const bool has_params_2d = GetConv2dCpuParams(
+      cache->in_5d_shape_, cache->weight_5d_shape_, cache->out_5d_shape_, cache->idx_offset_,
+      cache->strides_3d_, cache->dilation_rate_3d_, cache->padding_before_3d_, &cache->params_2d_);
+  cache->algorithms_ =
+      GetConvCpuAlgorithms(cache->weight_5d_shape_, cache->idx_offset_, cache->strides_3d_,
+                           cache->padding_before_3d_, has_params_2d, cache->params_2d_);
+
+  for (const Shape* shape :
+       {&cache->in_5d_shape_, &cache->weight_5d_shape_, &cache->out_5d_shape_}) {
+    cache->problem_key_.insert(cache->problem_key_.end(), shape->dim_vec().begin(),
+                               shape->dim_vec().end());
+  }
+  for (const std::vector<int32_t>* vec :
+       {&cache->strides_3d_, &cache->dilation_rate_3d_, &cache->padding_before_3d_}) {
+    cache->problem_key_.insert(cache->problem_key_.end(), vec->begin(), vec->end());
   }
+  cache->problem_key_.push_back(cache->idx_offset_);
+  cache->problem_key_.push_back(GetDataType<T>::value);
 
   return cache;
 }
 
+#ifdef WITH_ONEDNN
+
+// Logical dims of an activation or a weight in oneDNN order, i.e. N/O, C/I, then D, H, W.
+dnnl::memory::dims OneDnnConvDims(const ShapeView& shape, bool channels_first) {
+  const int64_t num_axes = shape.NumAxes();
+  dnnl::memory::dims dims(num_axes);
+  dims[0] = shape.At(0);
+  if (channels_first) {
+    for (int64_t i = 1; i < num_axes; ++i) { dims[i] = shape.At(i); }
+  } else {
+    dims[1] = shape.At(num_axes - 1);
+    for (int64_t i = 2; i < num_axes; ++i) { dims[i] = shape.At(i - 1); }
+  }
+  return dims;
+}
+
+// NOTE: the activation tags double as weight tags, e.g. nchw == oihw and nhwc == ohwi.
+dnnl::memory::format_tag OneDnnConvFormatTag(int64_t num_axes, bool channels_first) {
+  if (num_axes == 3) {
+    return channels_first ? dnnl::memory::format_tag::ncw : dnnl::memory::format_tag::nwc;
+  } else if (num_axes == 4) {
+    return channels_first ? dnnl::memory::format_tag::nchw : dnnl::memory::format_tag::nhwc;
+  } else if (num_axes == 5) {
+    return channels_first ? dnnl::memory::format_tag::ncdhw : dnnl::memory::format_tag::ndhwc;
+  } else {
+    UNIMPLEMENTED();
+    return dnnl::memory::format_tag::undef;
+  }
+}
+
+template<typename T>
+dnnl::primitive NewOneDnnPackedWeightConv(dnnl::engine* onednn_engine,
+                                          const ConvOpKernelCache<T>& conv_cache,
+                                          const ShapeView& in_shape, const ShapeView& weight_shape,
+                                          const ShapeView& out_shape, bool has_bias,
+                                          dnnl::memory::desc* weight_md,
+                                          dnnl::memory::desc* packed_weight_md) {
+  const auto data_type = dnnl::memory::data_type::f32;
+  const bool channels_first = conv_cache.idx_offset_ == 2;
+  const int64_t num_axes = in_shape.NumAxes();
+  const int64_t ndims = num_axes - 2;
+  const dnnl::memory::format_tag tag = OneDnnConvFormatTag(num_axes, channels_first);
+  const dnnl::memory::dims weight_dims = OneDnnConvDims(weight_shape, channels_first);
+  const dnnl::memory::desc in_md(OneDnnConvDims(in_shape, channels_first), data_type, tag);
+  const dnnl::memory::desc out_md(OneDnnConvDims(out_shape, channels_first), data_type, tag);
+  const dnnl::memory::desc any_weight_md(weight_dims, data_type, dnnl::memory::format_tag::any);
+  *weight_md = dnnl::memory::desc(weight_dims, data_type, tag);
+
+  dnnl::memory::dims strides(ndims);
+  dnnl::memory::dims dilates(ndims);
+  dnnl::memory::dims padding(ndims);
+  for (int64_t i = 0; i < ndims; ++i) {
+    const int64_t idx_3d = 3 - ndims + i;
+    strides[i] = conv_cache.strides_3d_.at(idx_3d);
+    // oneDNN counts the holes between taps, i.e. dilation 1 means no dilation in oneflow
+    dilates[i] = conv_cache.dilation_rate_3d_.at(idx_3d) - 1;
+    padding[i] = conv_cache.padding_before_3d_.at(idx_3d);
+  }
+  // oneflow pads symmetrically, see CalcConvOut
+  dnnl::convolution_forward::desc conv_desc(
+      dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_direct, in_md,
+      any_weight_md, out_md, strides, dilates, padding, padding);
+  if (has_bias) {
+    const dnnl::memory::desc bias_md({weight_dims[0]}, data_type, dnnl::memory::format_tag::x);
+    conv_desc = dnnl::convolution_forward::desc(
+        dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_direct, in_md,
+        any_weight_md, bias_md, out_md, strides, dilates, padding, padding);
+  }
+  dnnl::convolution_forward::primitive_desc conv_pd(conv_desc, *onednn_engine);
+  *packed_weight_md = conv_pd.weights_desc();
+  return dnnl::convolution_forward(conv_pd);
+}
+
+template<typename T>
+void LaunchPackedWeightConv(ep::Stream* stream, const ConvOpKernelCache<T>& conv_cache,
+                            const user_op::Tensor* in, const user_op::Tensor* weight,
+                            const user_op::Tensor* bias, user_op::Tensor* out) {
+  std::vector<int64_t> key = conv_cache.problem_key_;
+  key.push_back(bias != nullptr);
+  const bool channels_first = conv_cache.idx_offset_ == 2;
+  const int64_t num_axes = in->shape().NumAxes();
+  conv_cache.packed_weight_cache_->Launch(
+      stream, key, weight->dptr(),
+      [&](dnnl::engine* onednn_engine, dnnl::memory::desc* weight_md,
+          dnnl::memory::desc* packed_weight_md) {
+        return NewOneDnnPackedWeightConv<T>(onednn_engine, conv_cache, in->shape(),
+                                            weight->shape(), out->shape(), bias != nullptr,
+                                            weight_md, packed_weight_md);
+      },
+      [&](dnnl::engine* onednn_engine) {
+        const auto data_type = dnnl::memory::data_type::f32;
+        const dnnl::memory::format_tag tag = OneDnnConvFormatTag(num_axes, channels_first);
+        const dnnl::memory::desc in_md(OneDnnConvDims(in->shape(), channels_first), data_type,
+                                       tag);
+        const dnnl::memory::desc out_md(OneDnnConvDims(out->shape(), channels_first), data_type,
+                                        tag);
+        std::unordered_map<int, dnnl::memory> args;
+        args.emplace(DNNL_ARG_SRC,
+                     dnnl::memory(in_md, *onednn_engine, const_cast<void*>(in->dptr())));
+        args.emplace(DNNL_ARG_DST, dnnl::memory(out_md, *onednn_engine, out->mut_dptr()));
+        if (bias != nullptr) {
+          const dnnl::memory::desc bias_md({bias->shape().At(0)}, data_type,
+                                           dnnl::memory::format_tag::x);
+          args.emplace(DNNL_ARG_BIAS,
+                       dnnl::memory(bias_md, *onednn_engine, const_cast<void*>(bias->dptr())));
+        }
+        return args;
+      });
+}
+
+#endif  // WITH_ONEDNN
+
 template<typename T>
 void InitBiasMulBuf(T* dptr, int64_t num) {
   for (int64_t i = 0; i < num; ++i) { dptr[i] = 1; }
 }
 
+template<typename T>
+void ConvIm2ColGemmForward(ep::Stream* stream, const ConvOpKernelCache<T>& conv_cache,
+                           const user_op::Tensor* in, const user_op::Tensor* weight,
+                           const user_op::Tensor* bias, user_op::Tensor* tmp_buffer,
+                           user_op::Tensor* out) {
+  T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
+  const int32_t idx_offset = conv_cache.idx_offset_;
+  const int64_t out_spatial_size = conv_cache.out_5d_shape_.Count(idx_offset, idx_offset + 3);
+
+  bool is_bias_mul_inited = false;
+  for (int64_t i = 0; i < in->shape().At(0); ++i) {
+    conv_cache.im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_cache.in_5d_shape_),
+                            ShapeView(conv_cache.weight_5d_shape_),
+                            ShapeView(conv_cache.out_5d_shape_), conv_cache.strides_3d_.data(),
+                            conv_cache.dilation_rate_3d_.data(),
+                            conv_cache.padding_before_3d_.data(), col_buf_dptr);
+
+    // channels first: out = weight * col_buf
+    // channels last:  out = (weight * col_buf)(T)
+    conv_cache.forward_func_(stream, CblasNoTrans, CblasNoTrans,
+                             conv_cache.weight_5d_shape_.At(0),     // filter
+                             out_spatial_size,                      // od * oh * ow
+                             conv_cache.weight_5d_shape_.Count(1),  // ci * kd * kh * kw
+                             static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, static_cast<T>(0),
+                             GetImgMutDptr<T>(out, i));
+
+    if (bias != nullptr) {
+      int64_t num_of_col_buf = CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
+      T* bias_mul_dptr = col_buf_dptr + num_of_col_buf;
+      if (!is_bias_mul_inited) {
+        InitBiasMulBuf(bias_mul_dptr, out_spatial_size);
+        is_bias_mul_inited = true;
+      }
+
+      // channels first:  out += bias * bias_mul
+      // channels last:   out += (bias * bias_mul)(T)
+      conv_cache.forward_func_(stream, CblasNoTrans, CblasNoTrans,
+                               conv_cache.weight_5d_shape_.At(0),  // filter
+                               out_spatial_size,                   // od * oh * ow
+                               1,                                  // 1
+                               static_cast<T>(1), bias->dptr<T>(), bias_mul_dptr,
+                               static_cast<T>(1), GetImgMutDptr<T>(out, i));
+    }
+  }
+}
+
+template<typename T>
+void AddConvBias(ep::CpuStream* stream, const ConvOpKernelCache<T>& conv_cache,
+                 const user_op::Tensor* bias, user_op::Tensor* out) {
+  const int32_t idx_offset = conv_cache.idx_offset_;
+  const int64_t num_filters = conv_cache.weight_5d_shape_.At(0);
+  const int64_t out_spatial_size = conv_cache.out_5d_shape_.Count(idx_offset, idx_offset + 3);
+  const int64_t num_rows = out->shape().elem_cnt() / num_filters;
+  const T* bias_ptr = bias->dptr<T>();
+  T* out_ptr = out->mut_dptr<T>();
+  if (idx_offset == 2) {
+    // [n * filter, od * oh * ow]
+    stream->ParallelFor(0, out->shape().At(0) * num_filters, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T bias_value = bias_ptr[i % num_filters];
+        T* row = out_ptr + i * out_spatial_size;
+        FOR_RANGE(int64_t, j, 0, out_spatial_size) { row[j] += bias_value; }
+      }
+    });
+  } else {
+    // [n * od * oh * ow, filter]
+    stream->ParallelFor(0, num_rows, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        T* row = out_ptr + i * num_filters;
+        FOR_RANGE(int64_t, j, 0, num_filters) { row[j] += bias_ptr[j]; }
+      }
+    });
+  }
+}
+
+// A 1x1 convolution with unit strides and no padding is a plain GEMM on the input, no column
+// buffer is needed.
+template<typename T>
+void ConvDirect1x1Forward(ep::Stream* stream, const ConvOpKernelCache<T>& conv_cache,
+                          const user_op::Tensor* in, const user_op::Tensor* weight,
+                          const user_op::Tensor* bias, user_op::Tensor* out) {
+  const int32_t idx_offset = conv_cache.idx_offset_;
+  const int64_t num_filters = conv_cache.weight_5d_shape_.At(0);
+  const int64_t num_channels = conv_cache.weight_5d_shape_.Count(1);
+  const int64_t spatial_size = conv_cache.out_5d_shape_.Count(idx_offset, idx_offset + 3);
+  if (idx_offset == 2) {
+    // out[i] = weight * in[i]
+    for (int64_t i = 0; i < in->shape().At(0); ++i) {
+      conv_cache.forward_func_(stream, CblasNoTrans, CblasNoTrans, num_filters, spatial_size,
+                               num_channels, static_cast<T>(1), weight->dptr<T>(),
+                               GetImgDptr<T>(in, i), static_cast<T>(0), GetImgMutDptr<T>(out, i));
+    }
+  } else {
+    // the whole batch at once: out = (weight * in(T))(T)
+    conv_cache.forward_func_(stream, CblasNoTrans, CblasTrans, num_filters,
+                             in->shape().At(0) * spatial_size, num_channels, static_cast<T>(1),
+                             weight->dptr<T>(), in->dptr<T>(), static_cast<T>(0),
+                             out->mut_dptr<T>());
+  }
+  if (bias != nullptr) { AddConvBias<T>(stream->As<ep::CpuStream>(), conv_cache, bias, out); }
+}
+
+// Winograd and blocked NCHWc: transform the weight, then run image by image. By default the weight
+// is transformed into tmp_buffer on every launch, a pass over the weight writing WeightElemCnt
+// elements (16x or 36x the 3x3 weight for Winograd F2x2 and F4x4), which is noticeable next to
+// a small batch. Frozen weights, see ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE, are transformed once
+// and kept in the kernel cache.
+template<typename T, typename ConvUtil>
+void ConvTransformedWeightForward(ep::Stream* stream, ConvCpuAlgorithm algorithm,
+                                  const ConvOpKernelCache<T>& conv_cache,
+                                  const user_op::Tensor* in, const user_op::Tensor* weight,
+                                  const user_op::Tensor* bias, user_op::Tensor* tmp_buffer,
+                                  user_op::Tensor* out) {
+  const Conv2dCpuParams& params = conv_cache.params_2d_;
+  const int64_t weight_elem_cnt = ConvUtil::WeightElemCnt(params);
+  CHECK_GE(tmp_buffer->shape().elem_cnt(),
+           (weight_elem_cnt + ConvUtil::ImageTmpElemCnt(params)) * sizeof(T));
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  T* image_tmp = tmp_buffer->mut_dptr<T>() + weight_elem_cnt;
+  const auto transform = [&](T* transformed_weight) {
+    ConvUtil::TransformWeight(cpu_stream, params, weight->dptr<T>(), transformed_weight);
+  };
+  std::shared_ptr<const std::vector<T>> cached_weight;
+  const T* transformed_weight = tmp_buffer->mut_dptr<T>();
+  if (conv_cache.transformed_weight_cache_ && EnvBool<ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE>()) {
+    std::vector<int64_t> key = conv_cache.problem_key_;
+    key.push_back(static_cast<int64_t>(algorithm));
+    cached_weight = conv_cache.transformed_weight_cache_->Get(key, weight->dptr(), weight_elem_cnt,
+                                                              transform);
+    transformed_weight = cached_weight->data();
+  } else {
+    transform(tmp_buffer->mut_dptr<T>());
+  }
+  const T* bias_ptr = bias == nullptr ? nullptr : bias->dptr<T>();
+  for (int64_t i = 0; i < in->shape().At(0); ++i) {
+    ConvUtil::Forward(cpu_stream, params, transformed_weight, GetImgDptr<T>(in, i), bias_ptr,
+                      image_tmp, GetImgMutDptr<T>(out, i));
+  }
+}
+
+template<typename T>
+void LaunchConvCpuAlgorithm(ConvCpuAlgorithm algorithm, ep::Stream* stream,
+                            const ConvOpKernelCache<T>& conv_cache, const user_op::Tensor* in,
+                            const user_op::Tensor* weight, const user_op::Tensor* bias,
+                            user_op::Tensor* tmp_buffer, user_op::Tensor* out) {
+  switch (algorithm) {
+    case ConvCpuAlgorithm::kIm2ColGemm:
+      ConvIm2ColGemmForward<T>(stream, conv_cache, in, weight, bias, tmp_buffer, out);
+      break;
+    case ConvCpuAlgorithm::kDirect1x1:
+      ConvDirect1x1Forward<T>(stream, conv_cache, in, weight, bias, out);
+      break;
+    case ConvCpuAlgorithm::kWinogradF2x2K3x3:
+      ConvTransformedWeightForward<T, WinogradConvCpuUtil<T, 2>>(stream, algorithm, conv_cache, in,
+                                                                 weight, bias, tmp_buffer, out);
+      break;
+    case ConvCpuAlgorithm::kWinogradF4x4K3x3:
+      ConvTransformedWeightForward<T, WinogradConvCpuUtil<T, 4>>(stream, algorithm, conv_cache, in,
+                                                                 weight, bias, tmp_buffer, out);
+      break;
+    case ConvCpuAlgorithm::kBlockedNCHWc:
+      ConvTransformedWeightForward<T, BlockedNCHWcConvCpuUtil<T>>(stream, algorithm, conv_cache, in,
+                                                                  weight, bias, tmp_buffer, out);
+      break;
+    default: UNIMPLEMENTED();
+  }
+}
+
+// Algorithms picked by the autotuner, shared by all the conv kernels of the process.
+class ConvCpuAlgorithmRegistry final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ConvCpuAlgorithmRegistry);
+  ~ConvCpuAlgorithmRegistry() = default;
+
+  static ConvCpuAlgorithmRegistry* Get() {
+    static ConvCpuAlgorithmRegistry registry;
+    return &registry;
+  }
+
+  bool Find(const std::vector<int64_t>& key, ConvCpuAlgorithm* algorithm) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = key2algorithm_.find(key);
+    if (it == key2algorithm_.end()) { return false; }
+    *algorithm = it->second;
+    return true;
+  }
+
+  void Insert(const std::vector<int64_t>& key, ConvCpuAlgorithm algorithm) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    key2algorithm_[key] = algorithm;
+  }
+
+ private:
+  ConvCpuAlgorithmRegistry() = default;
+
+  std::mutex mutex_;
+  std::map<std::vector<int64_t>, ConvCpuAlgorithm> key2algorithm_;
+};
+
+template<typename T>
+ConvCpuAlgorithm SelectConvCpuAlgorithm(ep::Stream* stream, const ConvOpKernelCache<T>& conv_cache,
+                                        const user_op::Tensor* in, const user_op::Tensor* weight,
+                                        const user_op::Tensor* bias, user_op::Tensor* tmp_buffer,
+                                        user_op::Tensor* out) {
+  // the env vars may have changed since tmp_buffer was sized
+  const int64_t tmp_buffer_size = tmp_buffer->shape().elem_cnt();
+  std::vector<ConvCpuAlgorithm> algorithms;
+  for (ConvCpuAlgorithm algorithm : conv_cache.algorithms_) {
+    if (ConvCpuAlgorithmTmpElemCnt(algorithm, conv_cache.params_2d_) * sizeof(T)
+        <= tmp_buffer_size) {
+      algorithms.emplace_back(algorithm);
+    }
+  }
+  CHECK(!algorithms.empty());
+  if (algorithms.size() == 1 || !EnvBool<ONEFLOW_CPU_CONV_ENABLE_AUTOTUNE>()) {
+    return algorithms.front();
+  }
+  ConvCpuAlgorithm algorithm = algorithms.front();
+  if (ConvCpuAlgorithmRegistry::Get()->Find(conv_cache.problem_key_, &algorithm)
+      && std::find(algorithms.cbegin(), algorithms.cend(), algorithm) != algorithms.cend()) {
+    return algorithm;
+  }
+  // the first round warms up caches and the thread pool
+  constexpr int kNumRounds = 2;
+  std::vector<double> elapsed(algorithms.size(), std::numeric_limits<double>::max());
+  FOR_RANGE(int, round, 0, kNumRounds) {
+    FOR_RANGE(size_t, i, 0, algorithms.size()) {
+      const auto start = std::chrono::steady_clock::now();
+      LaunchConvCpuAlgorithm<T>(algorithms.at(i), stream, conv_cache, in, weight, bias,
+                                tmp_buffer, out);
+      const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+      elapsed.at(i) = std::min(elapsed.at(i), duration.count());
+    }
+  }
+  algorithm = algorithms.at(std::min_element(elapsed.cbegin(), elapsed.cend()) - elapsed.cbegin());
+  VLOG(2) << "conv cpu algorithm " << static_cast<int32_t>(algorithm) << " is selected";
+  ConvCpuAlgorithmRegistry::Get()->Insert(conv_cache.problem_key_, algorithm);
+  return algorithm;
+}
+
 template<typename T, size_t NDims>
 class ConvCpuKernel final : public user_op::OpKernel {
  public:
@@ -382,9 +910,31 @@ class ConvCpuKernel final : public user_op::OpKernel {
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 
-  std::shared_ptr<user_op::OpKernelCache> InitOpKernelCache(
-      user_op::KernelCacheContext* ctx) const override {
-    return CreateConvOpKernelCache<T>(ctx, "in", "out", "weight");
+  void InitOpKernelCacheWithFlags(
+      user_op::KernelCacheContext* ctx, int8_t flag,
+      std::shared_ptr<user_op::OpKernelCache>* cache_ptr) const override {
+    std::shared_ptr<ConvOpKernelCache<T>> conv_cache =
+        CreateConvOpKernelCache<T>(ctx, "in", "out", "weight");
+    // NOTE: the transformed weights survive re-initializations as well, they are keyed on the
+    // problem, the algorithm and the weight address.
+    const auto* old_cache = dynamic_cast<const ConvOpKernelCache<T>*>(cache_ptr->get());
+    if (old_cache != nullptr && old_cache->transformed_weight_cache_) {
+      conv_cache->transformed_weight_cache_ = old_cache->transformed_weight_cache_;
+    } else {
+      conv_cache->transformed_weight_cache_ = std::make_shared<ConvTransformedWeightCache<T>>();
+    }
+#ifdef WITH_ONEDNN
+    if (std::is_same<T, float>::value) {
+      // NOTE: the packed weights survive re-initializations, the packed-weight cache checks the
+      // problem size and the weight address on every launch.
+      if (old_cache != nullptr && old_cache->packed_weight_cache_) {
+        conv_cache->packed_weight_cache_ = old_cache->packed_weight_cache_;
+      } else {
+        conv_cache->packed_weight_cache_ = std::make_shared<OneDnnPackedWeightCache>();
+      }
+    }
+#endif  // WITH_ONEDNN
+    *cache_ptr = conv_cache;
   }
 
  private:
@@ -398,74 +948,42 @@ class ConvCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
-    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
-
-    bool is_bias_mul_inited = false;
-    for (int64_t i = 0; i < in->shape().At(0); ++i) {
-      conv_cache->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_cache->in_5d_shape_),
-                               ShapeView(conv_cache->weight_5d_shape_),
-                               ShapeView(conv_cache->out_5d_shape_), conv_cache->strides_3d_.data(),
-                               conv_cache->dilation_rate_3d_.data(),
-                               conv_cache->padding_before_3d_.data(), col_buf_dptr);
-
-      // channels first: out = weight * col_buf
-      // channels last:  out = (weight * col_buf)(T)
-      int32_t idx_offset = conv_cache->idx_offset_;
-      conv_cache->forward_func_(
-          ctx->stream(), CblasNoTrans, CblasNoTrans,
-          conv_cache->weight_5d_shape_.At(0),                           // filter
-          conv_cache->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-          conv_cache->weight_5d_shape_.Count(1),                        // ci * kd * kh * kw
-          static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, static_cast<T>(0),
-          GetImgMutDptr<T>(out, i));
-
-      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
-      if (bias != nullptr) {
-        int64_t num_of_col_buf = CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
-        int64_t num_of_bias_mul =
-            (tmp_buffer->shape().elem_cnt() - num_of_col_buf * sizeof(T)) / sizeof(T);
-        CHECK_GT(num_of_bias_mul, 0);
-        T* bias_mul_dptr = col_buf_dptr + num_of_col_buf;
-        if (!is_bias_mul_inited) {
-          InitBiasMulBuf(bias_mul_dptr, num_of_bias_mul);
-          is_bias_mul_inited = true;
-        }
-
-        // channels first:  out += bias * bias_mul
-        // channels last:   out += (bias * bias_mul)(T)
-        conv_cache->forward_func_(
-            ctx->stream(), CblasNoTrans, CblasNoTrans,
-            conv_cache->weight_5d_shape_.At(0),                           // filter
-            conv_cache->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-            1,                                                            // 1
-            static_cast<T>(1), bias->dptr<T>(), bias_mul_dptr, static_cast<T>(1),
-            GetImgMutDptr<T>(out, i));
-      }
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+#ifdef WITH_ONEDNN
+    if (conv_cache->packed_weight_cache_ && CpuPackedWeightCacheEnabled()) {
+      LaunchPackedWeightConv<T>(ctx->stream(), *conv_cache, in, weight, bias, out);
+      return;
     }
+#endif  // WITH_ONEDNN
+
+    const ConvCpuAlgorithm algorithm =
+        SelectConvCpuAlgorithm<T>(ctx->stream(), *conv_cache, in, weight, bias, tmp_buffer, out);
+    LaunchConvCpuAlgorithm<T>(algorithm, ctx->stream(), *conv_cache, in, weight, bias, tmp_buffer,
+                              out);
   }
 };
 
-#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                         \
-  REGISTER_USER_KERNEL(#op_name)                                                            \
-      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                           \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
-                       && (user_op::HobAttr<int32_t>("groups") == 1)                        \
-                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))     \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
-        size_t tmp_buffer_size = 0;                                                         \
-        const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();                   \
-        const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();               \
-                                                                                            \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
-        tmp_buffer_size +=                                                                  \
-            CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype);       \
-        bool has_bias = ctx->has_input("bias", 0);                                          \
-        if (has_bias) {                                                                     \
-          int64_t bias_mul_cnt = 1;                                                         \
-          for (int i = 0; i < ndims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); } \
-          tmp_buffer_size += bias_mul_cnt * sizeof(dtype);                                  \
-        }                                                                                   \
-        return tmp_buffer_size;                                                             \
+#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                          \
+  REGISTER_USER_KERNEL(#op_name)                                                             \
+      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                            \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                        \
+                       && (user_op::HobAttr<int32_t>("groups") == 1)                         \
+                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))      \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                          \
+        size_t tmp_buffer_size = 0;                                                          \
+        const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();                    \
+        const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();                \
+                                                                                             \
+        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));               \
+        tmp_buffer_size +=                                                                   \
+            CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype);        \
+        bool has_bias = ctx->has_input("bias", 0);                                           \
+        if (has_bias) {                                                                      \
+          int64_t bias_mul_cnt = 1;                                                          \
+          for (int i = 0; i < ndims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); }  \
+          tmp_buffer_size += bias_mul_cnt * sizeof(dtype);                                   \
+        }                                                                                    \
+        return std::max(tmp_buffer_size, InferConvCpuAlgorithmsTmpSize(ctx, sizeof(dtype))); \
       })
 
 REGISTER_CONV_KERNEL(conv1d, float, 1);
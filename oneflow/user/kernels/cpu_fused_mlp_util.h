@@ -0,0 +1,123 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CPU_FUSED_MLP_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CPU_FUSED_MLP_UTIL_H_
+
+#include <random>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+
+namespace oneflow {
+
+namespace cpu_fused_mlp {
+
+// The aux bitmask has the layout of the cuBLASLt relu aux, every row holds aux_ld / 32 int32 words
+// and bit (col % 32) of word (col / 32) is set when element col passes the relu (and dropout).
+constexpr int64_t kAuxBitsPerWord = 32;
+// The gemm of a layer is issued in row blocks whose output fits in L2, the bias/activation
+// epilogue then runs on each block while it is still cached.
+constexpr int64_t kEpilogueBlockBytes = 256 * 1024;
+
+inline int64_t RowBlockSize(int64_t cols, size_t elem_size) {
+  return std::max<int64_t>(kEpilogueBlockBytes / std::max<int64_t>(cols * elem_size, 1), 1);
+}
+
+inline std::unique_ptr<ep::primitive::Matmul> NewMatmulPrimitive(
+    DataType data_type, ep::primitive::BlasTransposeType transpose_a,
+    ep::primitive::BlasTransposeType transpose_b) {
+  return ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(DeviceType::kCPU, data_type,
+                                                                   transpose_a, transpose_b);
+}
+
+// Fills the aux words of `rows` rows with dropout keep bits drawn in row-major order, so the mask
+// only depends on the generator and not on the thread partition of the epilogue.
+template<typename Engine>
+void FillDropoutKeepBits(int64_t rows, int64_t cols, int64_t aux_words, float rate,
+                         Engine* engine, int32_t* aux) {
+  std::uniform_real_distribution<float> random_distribution(0.0f, 1.0f);
+  for (int64_t row = 0; row < rows; ++row) {
+    int32_t* aux_row = aux + row * aux_words;
+    for (int64_t word = 0; word < aux_words; ++word) {
+      const int64_t col_begin = word * kAuxBitsPerWord;
+      const int64_t col_end = std::min(col_begin + kAuxBitsPerWord, cols);
+      uint32_t bits = 0;
+      for (int64_t col = col_begin; col < col_end; ++col) {
+        // uniform_real_distribution draws from [0, 1), so >= keeps exactly 1 - rate.
+        bits |= static_cast<uint32_t>(random_distribution(*engine) >= rate) << (col - col_begin);
+      }
+      aux_row[word] = static_cast<int32_t>(bits);
+    }
+  }
+}
+
+// y[row] = act(y[row] + bias) for the rows [row_begin, row_end) of y (rows x cols). With relu
+// the activation bits are written to aux, with dropout the keep bits already in aux are combined
+// with them and the kept values are multiplied by scale. aux may be nullptr if neither is set.
+template<typename T, bool relu, bool dropout>
+void BiasAddActivationRows(int64_t row_begin, int64_t row_end, int64_t cols, int64_t aux_words,
+                           const T* bias, T scale, T* y, int32_t* aux) {
+  for (int64_t row = row_begin; row < row_end; ++row) {
+    T* y_row = y + row * cols;
+    if (!relu && !dropout) {
+      for (int64_t col = 0; col < cols; ++col) { y_row[col] += bias[col]; }
+      continue;
+    }
+    int32_t* aux_row = aux + row * aux_words;
+    for (int64_t word = 0; word < aux_words; ++word) {
+      const int64_t col_begin = word * kAuxBitsPerWord;
+      const int64_t col_end = std::min(col_begin + kAuxBitsPerWord, cols);
+      const uint32_t keep_bits = dropout ? static_cast<uint32_t>(aux_row[word]) : ~0U;
+      uint32_t bits = 0;
+      for (int64_t col = col_begin; col < col_end; ++col) {
+        const T v = y_row[col] + bias[col];
+        const bool pass = (!relu || v > static_cast<T>(0))
+                          && ((keep_bits >> (col - col_begin)) & 1U) != 0;
+        y_row[col] = pass ? (dropout ? v * scale : v) : static_cast<T>(0);
+        bits |= static_cast<uint32_t>(pass) << (col - col_begin);
+      }
+      aux_row[word] = static_cast<int32_t>(bits);
+    }
+  }
+}
+
+// y = act(x * weight^T + bias), x: (m, k), weight: (n, k), y: (m, n), see BiasAddActivationRows.
+// dropout keep bits are drawn from `engine` block by block before the epilogue of the block.
+template<typename T, bool relu, bool dropout, typename Engine>
+void DenseForward(ep::CpuStream* stream, ep::primitive::Matmul* matmul, int64_t m, int64_t n,
+                  int64_t k, int64_t aux_words, const T* x, const T* weight, const T* bias,
+                  float rate, float scale, Engine* engine, T* y, int32_t* aux) {
+  const int64_t block_rows = RowBlockSize(n, sizeof(T));
+  for (int64_t block_begin = 0; block_begin < m; block_begin += block_rows) {
+    const int64_t rows = std::min(block_rows, m - block_begin);
+    T* y_block = y + block_begin * n;
+    int32_t* aux_block = aux == nullptr ? nullptr : aux + block_begin * aux_words;
+    matmul->Launch(stream, rows, n, k, 1.0, x + block_begin * k, weight, 0.0, y_block);
+    if (dropout) { FillDropoutKeepBits(rows, n, aux_words, rate, engine, aux_block); }
+    stream->ParallelFor(
+        0, rows,
+        [&](int64_t begin, int64_t end) {
+          BiasAddActivationRows<T, relu, dropout>(begin, end, n, aux_words, bias,
+                                                  static_cast<T>(scale), y_block, aux_block);
+        },
+        ep::CpuStream::ParallelForRowGrain(n));
+  }
+}
+
+}  // namespace cpu_fused_mlp
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CPU_FUSED_MLP_UTIL_H_
@@ -0,0 +1,122 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CPU_GATHER_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CPU_GATHER_UTIL_H_
+
+#include <algorithm>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace cpu_gather {
+
+// rows are fetched kPrefetchDistance iterations ahead of their use
+constexpr int64_t kPrefetchDistance = 8;
+constexpr int64_t kCacheLineSize = 64;
+constexpr int64_t kMaxPrefetchBytesPerRow = 512;
+
+inline void PrefetchRow(const void* row, int64_t row_bytes) {
+#if defined(__GNUC__)
+  const char* ptr = static_cast<const char*>(row);
+  const int64_t num_bytes = std::min(row_bytes, kMaxPrefetchBytesPerRow);
+  for (int64_t offset = 0; offset < num_bytes; offset += kCacheLineSize) {
+    __builtin_prefetch(ptr + offset, /*rw=*/0, /*locality=*/0);
+  }
+#endif  // defined(__GNUC__)
+}
+
+// out[i] = *get_row(i) for i in [0, num_rows), each row has row_size elements. The row is zeroed
+// when get_row returns nullptr.
+template<typename T, typename GetRow>
+void GatherRows(ep::CpuStream* stream, int64_t num_rows, int64_t row_size, const GetRow& get_row,
+                T* out) {
+  const int64_t row_bytes = row_size * sizeof(T);
+  stream->ParallelFor(
+      0, num_rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          if (i + kPrefetchDistance < end) {
+            const T* next = get_row(i + kPrefetchDistance);
+            if (next != nullptr) { PrefetchRow(next, row_bytes); }
+          }
+          const T* from = get_row(i);
+          T* to = out + i * row_size;
+          if (from != nullptr) {
+            std::memcpy(to, from, row_bytes);
+          } else {
+            std::memset(to, 0, row_bytes);
+          }
+        }
+      },
+      ep::CpuStream::ParallelForRowGrain(row_size));
+}
+
+// Bytes of the tmp buffer ScatterAddRows needs for num_indices positions.
+inline size_t ScatterAddRowsTmpSize(int64_t num_indices) {
+  return (2 * num_indices + 1) * sizeof(int64_t);
+}
+
+// dst[indices[i]] += src[i] for every i whose index is not skip_index. The positions are sorted by
+// index and then by position, so each destination row is written by exactly one thread and the
+// rows are added in their original order, the result is deterministic. After a destination row is
+// done on_row(dst_row, count) is called with the number of rows added to it. The positions and the
+// segment offsets are kept in tmp_buf, which holds ScatterAddRowsTmpSize(num_indices) bytes.
+template<typename T, typename IndexType, typename OnRow>
+void ScatterAddRows(ep::CpuStream* stream, const IndexType* indices, int64_t num_indices,
+                    int64_t row_size, IndexType skip_index, const T* src, T* dst, void* tmp_buf,
+                    const OnRow& on_row) {
+  int64_t* positions = static_cast<int64_t*>(tmp_buf);
+  int64_t* segment_offsets = positions + num_indices;
+  int64_t num_positions = 0;
+  for (int64_t i = 0; i < num_indices; ++i) {
+    if (indices[i] != skip_index) { positions[num_positions++] = i; }
+  }
+  std::sort(positions, positions + num_positions, [&](int64_t a, int64_t b) {
+    return indices[a] < indices[b] || (indices[a] == indices[b] && a < b);
+  });
+  int64_t num_segments = 0;
+  for (int64_t i = 0; i < num_positions; ++i) {
+    if (i == 0 || indices[positions[i]] != indices[positions[i - 1]]) {
+      segment_offsets[num_segments++] = i;
+    }
+  }
+  segment_offsets[num_segments] = num_positions;
+  const int64_t row_bytes = row_size * sizeof(T);
+  stream->ParallelFor(
+      0, num_segments,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t segment = begin; segment < end; ++segment) {
+          const int64_t segment_begin = segment_offsets[segment];
+          const int64_t segment_end = segment_offsets[segment + 1];
+          T* to = dst + indices[positions[segment_begin]] * row_size;
+          for (int64_t i = segment_begin; i < segment_end; ++i) {
+            if (i + kPrefetchDistance < segment_end) {
+              PrefetchRow(src + positions[i + kPrefetchDistance] * row_size, row_bytes);
+            }
+            const T* from = src + positions[i] * row_size;
+            for (int64_t j = 0; j < row_size; ++j) { to[j] += from[j]; }
+          }
+          on_row(to, segment_end - segment_begin);
+        }
+      },
+      ep::CpuStream::ParallelForRowGrain(row_size));
+}
+
+}  // namespace cpu_gather
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CPU_GATHER_UTIL_H_
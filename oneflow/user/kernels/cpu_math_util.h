@@ -0,0 +1,85 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CPU_MATH_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CPU_MATH_UTIL_H_
+
+#include <algorithm>
+#include <cmath>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace cpu_math {
+
+// columns reduced together by one thread, the partial sums of a slice stay in registers or L1
+constexpr int64_t kColsPerSlice = 64;
+
+template<typename T>
+T Sigmoid(T x) {
+  return static_cast<T>(1) / (static_cast<T>(1) + std::exp(-x));
+}
+
+// Dot products accumulate into independent lanes so the compiler can keep them in one vector
+// register instead of serializing on a single scalar sum.
+constexpr int64_t kDotLanes = 8;
+
+template<typename T>
+T Dot(const T* x, const T* y, int64_t n) {
+  T lanes[kDotLanes] = {};
+  int64_t i = 0;
+  for (; i + kDotLanes <= n; i += kDotLanes) {
+    for (int64_t k = 0; k < kDotLanes; ++k) { lanes[k] += x[i + k] * y[i + k]; }
+  }
+  T sum = 0;
+  for (int64_t k = 0; k < kDotLanes; ++k) { sum += lanes[k]; }
+  for (; i < n; ++i) { sum += x[i] * y[i]; }
+  return sum;
+}
+
+// Runs fn(col_begin, width) over the column slices of a (rows x cols) reduction, threads own
+// disjoint slices so the column sums need no atomics.
+template<typename F>
+void ForEachColumnSlice(ep::CpuStream* stream, int64_t rows, int64_t cols, const F& fn) {
+  const int64_t num_slices = (cols + kColsPerSlice - 1) / kColsPerSlice;
+  stream->ParallelFor(
+      0, num_slices,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t slice = begin; slice < end; ++slice) {
+          const int64_t col_begin = slice * kColsPerSlice;
+          fn(col_begin, std::min(kColsPerSlice, cols - col_begin));
+        }
+      },
+      ep::CpuStream::ParallelForRowGrain(rows * kColsPerSlice));
+}
+
+// sum = reduce_sum(x, axis=0) of a (rows x cols) x
+template<typename T>
+void ColumnSum(ep::CpuStream* stream, int64_t rows, int64_t cols, const T* x, T* sum) {
+  ForEachColumnSlice(stream, rows, cols, [&](int64_t col_begin, int64_t width) {
+    T slice_sum[kColsPerSlice] = {};
+    for (int64_t row = 0; row < rows; ++row) {
+      const T* x_row = x + row * cols + col_begin;
+      for (int64_t i = 0; i < width; ++i) { slice_sum[i] += x_row[i]; }
+    }
+    std::copy(slice_sum, slice_sum + width, sum + col_begin);
+  });
+}
+
+}  // namespace cpu_math
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CPU_MATH_UTIL_H_
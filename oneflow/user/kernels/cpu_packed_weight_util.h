@@ -0,0 +1,100 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CPU_PACKED_WEIGHT_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CPU_PACKED_WEIGHT_UTIL_H_
+
+#include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/ep/common/onednn.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include <mutex>
+
+namespace oneflow {
+
+// Declares the weights of CPU matmul and convolution kernels frozen, e.g. in inference. The kernels
+// then reorder each weight once into the blocked layout preferred by oneDNN and reuse the packed
+// copy for as long as the weight keeps its address, and so do the convolutions run by Winograd or
+// blocked NCHWc with their transformed weights. Weights updated in place are not packed again,
+// and neither is the `b` operand of a matmul that is an activation reusing a freed buffer, so only
+// enable this when every such operand is a weight that no longer changes.
+DEFINE_ENV_BOOL(ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE, false);
+
+#ifdef WITH_ONEDNN
+
+inline bool CpuPackedWeightCacheEnabled() {
+  return ep::primitive::OneDnnIsEnabled() && EnvBool<ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE>();
+}
+
+// Holds a oneDNN primitive created with `format_tag::any` weights and a copy of the weights
+// reordered into the layout picked by the primitive. The primitive is re-created whenever `key`
+// changes and the weights are packed again whenever their address changes, see
+// ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE. The lock only covers the check and the refresh, a
+// refresh packs into a new buffer so that concurrent launches keep running on the one they took.
+class OneDnnPackedWeightCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OneDnnPackedWeightCache);
+  OneDnnPackedWeightCache() = default;
+  ~OneDnnPackedWeightCache() = default;
+
+  // NewPrimitiveFn: dnnl::primitive(dnnl::engine*, dnnl::memory::desc* weight_md,
+  //                                 dnnl::memory::desc* packed_weight_md)
+  // ArgsFn:         std::unordered_map<int, dnnl::memory>(dnnl::engine*), without DNNL_ARG_WEIGHTS
+  template<typename NewPrimitiveFn, typename ArgsFn>
+  void Launch(ep::Stream* stream, const std::vector<int64_t>& key, const void* weight,
+              const NewPrimitiveFn& new_primitive_fn, const ArgsFn& args_fn) {
+    stream->As<ep::CpuStream>()->onednn_executor()->Launch(
+        [&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
+          dnnl::primitive primitive;
+          dnnl::memory packed_weight;
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (onednn_engine != engine_ || key != key_) {
+              primitive_ = new_primitive_fn(onednn_engine, &weight_md_, &packed_weight_md_);
+              engine_ = onednn_engine;
+              key_ = key;
+              packed_from_ = nullptr;
+            }
+            if (weight != packed_from_) {
+              dnnl::memory weight_mem(weight_md_, *onednn_engine, const_cast<void*>(weight));
+              packed_weight_ = dnnl::memory(packed_weight_md_, *onednn_engine);
+              dnnl::reorder(weight_mem, packed_weight_)
+                  .execute(*onednn_stream, weight_mem, packed_weight_);
+              packed_from_ = weight;
+            }
+            primitive = primitive_;
+            packed_weight = packed_weight_;
+          }
+          std::unordered_map<int, dnnl::memory> args = args_fn(onednn_engine);
+          args.emplace(DNNL_ARG_WEIGHTS, packed_weight);
+          primitive.execute(*onednn_stream, args);
+        });
+  }
+
+ private:
+  std::mutex mutex_;
+  dnnl::engine* engine_ = nullptr;
+  std::vector<int64_t> key_;
+  dnnl::primitive primitive_;
+  dnnl::memory::desc weight_md_;
+  dnnl::memory::desc packed_weight_md_;
+  dnnl::memory packed_weight_;
+  const void* packed_from_ = nullptr;
+};
+
+#endif  // WITH_ONEDNN
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CPU_PACKED_WEIGHT_UTIL_H_
@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/cpu_fused_mlp_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// Zeroes the elements of d_grad (rows x cols) whose aux bit is not set and adds the column sums
+// of the result to d_bias. Threads own disjoint 32-column slices, one aux word per row each, so
+// d_bias is accumulated without any reduction across threads.
+template<typename T>
+void DReluAndBiasGrad(ep::CpuStream* stream, int64_t rows, int64_t cols, int64_t aux_words,
+                      const int32_t* aux, T* d_grad, T* d_bias) {
+  constexpr int64_t kBits = cpu_fused_mlp::kAuxBitsPerWord;
+  const int64_t col_words = (cols + kBits - 1) / kBits;
+  stream->ParallelFor(
+      0, col_words,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t word = begin; word < end; ++word) {
+          const int64_t col_begin = word * kBits;
+          const int64_t width = std::min(kBits, cols - col_begin);
+          T sum[kBits] = {};
+          for (int64_t row = 0; row < rows; ++row) {
+            const uint32_t bits = static_cast<uint32_t>(aux[row * aux_words + word]);
+            T* d_grad_row = d_grad + row * cols + col_begin;
+            for (int64_t i = 0; i < width; ++i) {
+              const T v = ((bits >> i) & 1U) != 0 ? d_grad_row[i] : static_cast<T>(0);
+              d_grad_row[i] = v;
+              sum[i] += v;
+            }
+          }
+          for (int64_t i = 0; i < width; ++i) { d_bias[col_begin + i] += sum[i]; }
+        }
+      },
+      ep::CpuStream::ParallelForRowGrain(rows * kBits));
+}
+
+template<typename T>
+class CpuBiasAddReluMatmulGradKernel final : public user_op::OpKernel {
+ public:
+  CpuBiasAddReluMatmulGradKernel() = default;
+  ~CpuBiasAddReluMatmulGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    /*
+    d_grad = drelu(alpha * dy matmul weight), d_bias = reduce_sum(d_grad, axis=0)
+    dy: (m, n), weight: (n, k), aux: relu bitmask of d_grad.
+    The gemm is issued in row blocks, the drelu and the bias grad consume each block while it is
+    still cached.
+    */
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* aux = ctx->Tensor4ArgNameAndIndex("aux", 0);
+    user_op::Tensor* d_bias = ctx->Tensor4ArgNameAndIndex("d_bias", 0);
+    user_op::Tensor* d_grad = ctx->Tensor4ArgNameAndIndex("d_grad", 0);
+    const double alpha = ctx->Attr<double>("alpha");
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    auto matmul =
+        cpu_fused_mlp::NewMatmulPrimitive(dy->data_type(), ep::primitive::BlasTransposeType::N,
+                                          ep::primitive::BlasTransposeType::N);
+    CHECK(matmul);
+
+    const int64_t m = dy->shape().At(0);
+    const int64_t n = dy->shape().At(1);
+    const int64_t k = weight->shape().At(1);
+    const int64_t aux_words = aux->shape().At(1);
+    T* d_bias_ptr = d_bias->mut_dptr<T>();
+    std::fill(d_bias_ptr, d_bias_ptr + k, static_cast<T>(0));
+    const int64_t block_rows = cpu_fused_mlp::RowBlockSize(k, sizeof(T));
+    for (int64_t block_begin = 0; block_begin < m; block_begin += block_rows) {
+      const int64_t rows = std::min(block_rows, m - block_begin);
+      T* d_grad_block = d_grad->mut_dptr<T>() + block_begin * k;
+      matmul->Launch(ctx->stream(), rows, k, n, alpha, dy->dptr<T>() + block_begin * n,
+                     weight->dptr(), 0.0, d_grad_block);
+      DReluAndBiasGrad<T>(cpu_stream, rows, k, aux_words,
+                          aux->dptr<int32_t>() + block_begin * aux_words, d_grad_block,
+                          d_bias_ptr);
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_BIAS_ADD_RELU_MATMUL_GRAD_KERNEL(dtype)          \
+  REGISTER_USER_KERNEL("cublas_bias_add_relu_matmul_grad")            \
+      .SetCreateFn<CpuBiasAddReluMatmulGradKernel<dtype>>()           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("weight", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_BIAS_ADD_RELU_MATMUL_GRAD_KERNEL(float)
+REGISTER_CPU_BIAS_ADD_RELU_MATMUL_GRAD_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/cpu_fused_mlp_util.h"
+#include "oneflow/user/kernels/cpu_math_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class CpuMatmulBiasAddGradKernel final : public user_op::OpKernel {
+ public:
+  CpuMatmulBiasAddGradKernel() = default;
+  ~CpuMatmulBiasAddGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    /*
+    dy: (m, n), x: (m, k)
+    w_grad = dy(transpose) matmul x: (n, k), b_grad = reduce_sum(dy, axis=0): (n)
+    */
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* w_grad = ctx->Tensor4ArgNameAndIndex("w_grad", 0);
+    user_op::Tensor* b_grad = ctx->Tensor4ArgNameAndIndex("b_grad", 0);
+    const int64_t m = dy->shape().At(0);
+    const int64_t n = dy->shape().At(1);
+    const int64_t k = x->shape().At(1);
+    auto matmul =
+        cpu_fused_mlp::NewMatmulPrimitive(dy->data_type(), ep::primitive::BlasTransposeType::T,
+                                          ep::primitive::BlasTransposeType::N);
+    CHECK(matmul);
+    matmul->Launch(ctx->stream(), n, k, m, 1.0, dy->dptr(), x->dptr(), 0.0, w_grad->mut_dptr());
+    cpu_math::ColumnSum<T>(ctx->stream()->As<ep::CpuStream>(), m, n, dy->dptr<T>(),
+                           b_grad->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_MATMUL_BIAS_ADD_GRAD_KERNEL(dtype)               \
+  REGISTER_USER_KERNEL("cublas_matmul_bias_add_grad")                 \
+      .SetCreateFn<CpuMatmulBiasAddGradKernel<dtype>>()               \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_MATMUL_BIAS_ADD_GRAD_KERNEL(float)
+REGISTER_CPU_MATMUL_BIAS_ADD_GRAD_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
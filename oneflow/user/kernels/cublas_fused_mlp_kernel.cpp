@@ -0,0 +1,91 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/cpu_fused_mlp_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class CpuFusedMLPKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedMLPKernel() = default;
+  ~CpuFusedMLPKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    /*
+    Every layer is out = relu(in matmul weight(transpose) + bias), the gemm of a layer is issued in
+    row blocks and the bias add and relu (and its aux bitmask) are applied to each block right
+    after its gemm, see cpu_fused_mlp::DenseForward.
+    */
+    const int32_t weight_size = ctx->input_size("weights");
+    const int32_t bias_size = ctx->input_size("biases");
+    CHECK_EQ(weight_size, bias_size) << "The number of weight and bias is not equal!. ";
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const bool skip_final_activation = ctx->Attr<bool>("skip_final_activation");
+    auto matmul =
+        cpu_fused_mlp::NewMatmulPrimitive(x->data_type(), ep::primitive::BlasTransposeType::N,
+                                          ep::primitive::BlasTransposeType::T);
+    CHECK(matmul);
+
+    const int64_t m = x->shape().At(0);
+    int64_t k = x->shape().At(1);
+    const T* in_ptr = x->dptr<T>();
+    for (int32_t idx = 0; idx < weight_size; idx++) {
+      const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weights", idx);
+      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("biases", idx);
+      user_op::Tensor* cublas_aux = ctx->Tensor4ArgNameAndIndex("cublas_aux", idx);
+      const int64_t n = weight->shape().At(0);
+      const int64_t aux_words = cublas_aux->shape().At(1);
+      const bool is_last_layer = idx == weight_size - 1;
+      T* y_ptr = is_last_layer ? ctx->Tensor4ArgNameAndIndex("out", 0)->mut_dptr<T>()
+                               : ctx->Tensor4ArgNameAndIndex("hidden", idx)->mut_dptr<T>();
+      if (is_last_layer && skip_final_activation) {
+        cpu_fused_mlp::DenseForward<T, /*relu=*/false, /*dropout=*/false, std::mt19937>(
+            cpu_stream, matmul.get(), m, n, k, aux_words, in_ptr, weight->dptr<T>(),
+            bias->dptr<T>(), /*rate=*/0.0f, /*scale=*/1.0f, /*engine=*/nullptr, y_ptr,
+            /*aux=*/nullptr);
+      } else {
+        cpu_fused_mlp::DenseForward<T, /*relu=*/true, /*dropout=*/false, std::mt19937>(
+            cpu_stream, matmul.get(), m, n, k, aux_words, in_ptr, weight->dptr<T>(),
+            bias->dptr<T>(), /*rate=*/0.0f, /*scale=*/1.0f, /*engine=*/nullptr, y_ptr,
+            cublas_aux->mut_dptr<int32_t>());
+      }
+      // Set hidden_layer as next layer's input.
+      in_ptr = y_ptr;
+      k = n;
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_MLP_KERNEL(dtype)                          \
+  REGISTER_USER_KERNEL("cublas_fused_mlp")                            \
+      .SetCreateFn<CpuFusedMLPKernel<dtype>>()                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_FUSED_MLP_KERNEL(float)
+REGISTER_CPU_FUSED_MLP_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,518 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/embedding/hash_functions.cuh"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kNumUniqueShards = 64;
+constexpr int64_t kUniqueChunkSize = 4096;
+
+int64_t NumUniqueChunks(int64_t num_keys) {
+  return (num_keys + kUniqueChunkSize - 1) / kUniqueChunkSize;
+}
+
+// Scratch of CpuUniqueKeyValuePairs: positions grouped by shard, the first position of every
+// unique key, the open addressing tables with twice the shard size and the per chunk shard counts.
+size_t CpuUniqueWorkspaceBytes(int64_t num_keys) {
+  const int64_t num_chunks = NumUniqueChunks(num_keys);
+  return GetCudaAlignedSize(num_keys * sizeof(int64_t))
+         + GetCudaAlignedSize(num_keys * sizeof(int64_t))
+         + GetCudaAlignedSize(2 * num_keys * sizeof(int64_t))
+         + GetCudaAlignedSize(num_chunks * kNumUniqueShards * sizeof(int64_t))
+         + GetCudaAlignedSize(2 * (kNumUniqueShards + 1) * sizeof(int64_t));
+}
+
+template<typename HASH, typename K>
+size_t HashKey(K key) {
+  return HASH()(static_cast<uint64_t>(key));
+}
+
+/*
+Unique the keys in parallel without atomics. The keys are sharded by hash, every shard is uniqued
+by one thread with a private open addressing table, then the shards are concatenated. Unique keys
+keep the order of their first occurrence within a shard, so the result does not depend on the
+number of threads. The value of a unique key is the value of its first occurrence.
+*/
+template<typename K, typename V, typename IDX, typename HASH>
+void CpuUniqueKeyValuePairs(ep::CpuStream* stream, int64_t num_keys, const K* keys,
+                            const V* values, IDX* num_unique, K* unique_keys, V* unique_values,
+                            IDX* inverse_indices, void* workspace, size_t workspace_bytes,
+                            bool need_process_values) {
+  CHECK_GE(workspace_bytes, CpuUniqueWorkspaceBytes(num_keys));
+  const int64_t num_chunks = NumUniqueChunks(num_keys);
+  char* workspace_ptr = reinterpret_cast<char*>(workspace);
+  int64_t* positions = reinterpret_cast<int64_t*>(workspace_ptr);
+  workspace_ptr += GetCudaAlignedSize(num_keys * sizeof(int64_t));
+  int64_t* first_positions = reinterpret_cast<int64_t*>(workspace_ptr);
+  workspace_ptr += GetCudaAlignedSize(num_keys * sizeof(int64_t));
+  int64_t* tables = reinterpret_cast<int64_t*>(workspace_ptr);
+  workspace_ptr += GetCudaAlignedSize(2 * num_keys * sizeof(int64_t));
+  int64_t* chunk_offsets = reinterpret_cast<int64_t*>(workspace_ptr);
+  workspace_ptr += GetCudaAlignedSize(num_chunks * kNumUniqueShards * sizeof(int64_t));
+  int64_t* shard_offsets = reinterpret_cast<int64_t*>(workspace_ptr);
+  int64_t* shard_unique_offsets = shard_offsets + kNumUniqueShards + 1;
+
+  auto ForEachChunk = [&](const std::function<void(int64_t, int64_t, int64_t*)>& fn) {
+    stream->ParallelFor(
+        0, num_chunks,
+        [&](int64_t chunk_begin, int64_t chunk_end) {
+          for (int64_t chunk = chunk_begin; chunk < chunk_end; ++chunk) {
+            fn(chunk * kUniqueChunkSize, std::min((chunk + 1) * kUniqueChunkSize, num_keys),
+               chunk_offsets + chunk * kNumUniqueShards);
+          }
+        },
+        1);
+  };
+  ForEachChunk([&](int64_t begin, int64_t end, int64_t* counts) {
+    std::fill(counts, counts + kNumUniqueShards, 0);
+    for (int64_t i = begin; i < end; ++i) {
+      counts[HashKey<HASH>(keys[i]) % kNumUniqueShards] += 1;
+    }
+  });
+  int64_t offset = 0;
+  for (int64_t shard = 0; shard < kNumUniqueShards; ++shard) {
+    shard_offsets[shard] = offset;
+    for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+      const int64_t count = chunk_offsets[chunk * kNumUniqueShards + shard];
+      chunk_offsets[chunk * kNumUniqueShards + shard] = offset;
+      offset += count;
+    }
+  }
+  shard_offsets[kNumUniqueShards] = offset;
+  ForEachChunk([&](int64_t begin, int64_t end, int64_t* offsets) {
+    for (int64_t i = begin; i < end; ++i) {
+      positions[offsets[HashKey<HASH>(keys[i]) % kNumUniqueShards]++] = i;
+    }
+  });
+  stream->ParallelFor(
+      0, kNumUniqueShards,
+      [&](int64_t shard_begin, int64_t shard_end) {
+        for (int64_t shard = shard_begin; shard < shard_end; ++shard) {
+          const int64_t begin = shard_offsets[shard];
+          const int64_t shard_size = shard_offsets[shard + 1] - begin;
+          const int64_t capacity = 2 * shard_size;
+          int64_t* table = tables + 2 * begin;
+          int64_t* shard_first_positions = first_positions + begin;
+          std::fill(table, table + capacity, 0);
+          int64_t shard_num_unique = 0;
+          for (int64_t i = begin; i < begin + shard_size; ++i) {
+            const int64_t pos = positions[i];
+            const K key = keys[pos];
+            // The low bits picked the shard, the slot is taken from the remaining ones.
+            int64_t slot = (HashKey<HASH>(key) / kNumUniqueShards) % capacity;
+            while (true) {
+              const int64_t index_plus_one = table[slot];
+              if (index_plus_one == 0) {
+                table[slot] = shard_num_unique + 1;
+                shard_first_positions[shard_num_unique] = pos;
+                inverse_indices[pos] = static_cast<IDX>(shard_num_unique);
+                shard_num_unique += 1;
+                break;
+              } else if (keys[shard_first_positions[index_plus_one - 1]] == key) {
+                inverse_indices[pos] = static_cast<IDX>(index_plus_one - 1);
+                break;
+              }
+              slot += 1;
+              if (slot == capacity) { slot = 0; }
+            }
+          }
+          shard_unique_offsets[shard] = shard_num_unique;
+        }
+      },
+      1);
+  int64_t unique_offset = 0;
+  for (int64_t shard = 0; shard < kNumUniqueShards; ++shard) {
+    const int64_t shard_num_unique = shard_unique_offsets[shard];
+    shard_unique_offsets[shard] = unique_offset;
+    unique_offset += shard_num_unique;
+  }
+  shard_unique_offsets[kNumUniqueShards] = unique_offset;
+  *num_unique = static_cast<IDX>(unique_offset);
+  stream->ParallelFor(
+      0, kNumUniqueShards,
+      [&](int64_t shard_begin, int64_t shard_end) {
+        for (int64_t shard = shard_begin; shard < shard_end; ++shard) {
+          const int64_t begin = shard_offsets[shard];
+          const int64_t unique_begin = shard_unique_offsets[shard];
+          const int64_t shard_num_unique = shard_unique_offsets[shard + 1] - unique_begin;
+          for (int64_t i = 0; i < shard_num_unique; ++i) {
+            const int64_t pos = first_positions[begin + i];
+            unique_keys[unique_begin + i] = keys[pos];
+            if (need_process_values) { unique_values[unique_begin + i] = values[pos]; }
+          }
+          for (int64_t i = begin; i < shard_offsets[shard + 1]; ++i) {
+            inverse_indices[positions[i]] += static_cast<IDX>(unique_begin);
+          }
+        }
+      },
+      1);
+}
+
+template<typename U>
+void GenerateTableIds(ep::CpuStream* stream, int64_t elem_cnt, int32_t num_tables, U* table_ids) {
+  stream->ParallelFor(0, elem_cnt, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) { table_ids[i] = i % num_tables; }
+  });
+}
+
+size_t IdShuffleTmpBufferSize(int64_t num_ids, bool need_gen_table_ids, size_t table_id_size) {
+  const size_t table_ids_bytes = need_gen_table_ids ? num_ids * table_id_size : 0;
+  return GetCudaAlignedSize(table_ids_bytes) + CpuUniqueWorkspaceBytes(num_ids);
+}
+
+// On a single rank the ids need one unique only, the unique ids are the ids of the current rank
+// and their inverse indices are the identity.
+template<typename K, typename U, typename IDX>
+class IdShuffleKernel final : public user_op::OpKernel {
+ public:
+  IdShuffleKernel() = default;
+  ~IdShuffleKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CHECK_EQ(ctx->parallel_ctx().parallel_num(), 1)
+        << "id_shuffle on cpu only supports a single rank";
+    const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
+    user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_num_unique = ctx->Tensor4ArgNameAndIndex("cur_rank_num_unique", 0);
+    user_op::Tensor* cur_rank_unique_ids = ctx->Tensor4ArgNameAndIndex("cur_rank_unique_ids", 0);
+    user_op::Tensor* cur_rank_unique_table_ids =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_table_ids", 0);
+    user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const bool has_table_ids = ctx->has_input("table_ids", 0);
+    const bool need_gen_table_ids = (!has_table_ids && num_tables > 1);
+    const bool need_process_table_ids = (has_table_ids || num_tables > 1);
+    const int64_t num_ids = ids->shape().elem_cnt();
+    CHECK_GE(tmp_buffer->shape().elem_cnt(),
+             IdShuffleTmpBufferSize(num_ids, need_gen_table_ids, sizeof(U)));
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const size_t table_ids_bytes = GetCudaAlignedSize(need_gen_table_ids ? num_ids * sizeof(U) : 0);
+    const U* table_ids_ptr;
+    if (has_table_ids) {
+      const user_op::Tensor* table_ids = ctx->Tensor4ArgNameAndIndex("table_ids", 0);
+      table_ids_ptr = reinterpret_cast<const U*>(table_ids->dptr());
+    } else if (need_gen_table_ids) {
+      U* generated_table_ids = reinterpret_cast<U*>(tmp_buffer->mut_dptr());
+      GenerateTableIds(cpu_stream, num_ids, num_tables, generated_table_ids);
+      table_ids_ptr = generated_table_ids;
+    } else {
+      table_ids_ptr = nullptr;
+    }
+    K* unique_ids_ptr = reinterpret_cast<K*>(cur_rank_unique_ids->mut_dptr());
+    U* unique_table_ids_ptr = reinterpret_cast<U*>(cur_rank_unique_table_ids->mut_dptr());
+    IDX* cur_rank_inverse_indices_ptr =
+        reinterpret_cast<IDX*>(cur_rank_inverse_indices->mut_dptr());
+    IDX* num_unique_ptr = reinterpret_cast<IDX*>(cur_rank_num_unique->mut_dptr());
+    CpuUniqueKeyValuePairs<K, U, IDX, embedding::LocalUniqueHash>(
+        cpu_stream, num_ids, reinterpret_cast<const K*>(ids->dptr()), table_ids_ptr,
+        num_unique_ptr, unique_ids_ptr, unique_table_ids_ptr,
+        reinterpret_cast<IDX*>(inverse_unique_partition_indices->mut_dptr()),
+        tmp_buffer->mut_dptr<char>() + table_ids_bytes,
+        tmp_buffer->shape().elem_cnt() - table_ids_bytes, need_process_table_ids);
+    const int64_t num_unique = *num_unique_ptr;
+    *reinterpret_cast<IDX*>(num_unique_matrix->mut_dptr()) = *num_unique_ptr;
+    // The tails past num_unique are zeroed, so the consumers gathering all rows stay in bounds.
+    const int64_t capacity = cur_rank_unique_ids->shape().elem_cnt();
+    std::fill(unique_ids_ptr + num_unique, unique_ids_ptr + capacity, 0);
+    if (need_process_table_ids) {
+      std::fill(unique_table_ids_ptr + num_unique, unique_table_ids_ptr + capacity, 0);
+    } else {
+      std::fill(unique_table_ids_ptr, unique_table_ids_ptr + capacity, 0);
+    }
+    cpu_stream->ParallelFor(0, capacity, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        cur_rank_inverse_indices_ptr[i] = static_cast<IDX>(i < num_unique ? i : 0);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define ID_DATA_TYPE_SEQ                            \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define TABLE_ID_DATA_TYPE_SEQ                      \
+  OF_PP_MAKE_TUPLE_SEQ(uint8_t, DataType::kUInt8)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int8_t, DataType::kInt8)     \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define IDX_DATA_TYPE_SEQ                           \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_ID_SHUFFLE_KERNEL(k_dtype_pair, table_id_dtype_pair, idx_dtype_pair)         \
+  REGISTER_USER_KERNEL("id_shuffle")                                                              \
+      .SetCreateFn<                                                                               \
+          IdShuffleKernel<OF_PP_PAIR_FIRST(k_dtype_pair), OF_PP_PAIR_FIRST(table_id_dtype_pair),  \
+                          OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                                    \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))                  \
+          && (user_op::HobDataType("cur_rank_unique_table_ids", 0)                                \
+              == OF_PP_PAIR_SECOND(table_id_dtype_pair))                                          \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const user_op::TensorDesc& ids = ctx->InputTensorDesc("ids", 0);                          \
+        const bool has_table_ids = ctx->has_input("table_ids", 0);                                \
+        const int32_t num_tables = ctx->Attr<int32_t>("num_tables");                              \
+        const bool need_gen_table_ids = (!has_table_ids && num_tables > 1);                       \
+        return IdShuffleTmpBufferSize(ids.shape().elem_cnt(), need_gen_table_ids,                 \
+                                      sizeof(OF_PP_PAIR_FIRST(table_id_dtype_pair)));             \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ID_SHUFFLE_KERNEL, ID_DATA_TYPE_SEQ,
+                                 TABLE_ID_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class EmbeddingShuffleKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingShuffleKernel() = default;
+  ~EmbeddingShuffleKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CHECK_EQ(ctx->parallel_ctx().parallel_num(), 1)
+        << "embedding_shuffle on cpu only supports a single rank";
+    const user_op::Tensor* cur_rank_embeddings =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_embeddings", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+    const int64_t embedding_size = cur_rank_embeddings->shape().At(1);
+    const int64_t num_ids = inverse_unique_partition_indices->shape().elem_cnt();
+    CHECK_EQ(embeddings->shape().elem_cnt(), num_ids * embedding_size);
+    const T* cur_rank_embeddings_ptr = cur_rank_embeddings->dptr<T>();
+    const IDX* cur_rank_inverse_indices_ptr =
+        reinterpret_cast<const IDX*>(cur_rank_inverse_indices->dptr());
+    const IDX* inverse_unique_partition_indices_ptr =
+        reinterpret_cast<const IDX*>(inverse_unique_partition_indices->dptr());
+    T* embeddings_ptr = embeddings->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, num_ids,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t row =
+                cur_rank_inverse_indices_ptr[inverse_unique_partition_indices_ptr[i]];
+            std::copy(cur_rank_embeddings_ptr + row * embedding_size,
+                      cur_rank_embeddings_ptr + (row + 1) * embedding_size,
+                      embeddings_ptr + i * embedding_size);
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(embedding_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)                      \
+  REGISTER_USER_KERNEL("embedding_shuffle")                                                      \
+      .SetCreateFn<EmbeddingShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                        \
+                                          OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                   \
+      .SetIsMatchedHob(                                                                          \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
+          && (user_op::HobDataType("cur_rank_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)) \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL, FLOATING_DATA_TYPE_SEQ,
+                                 IDX_DATA_TYPE_SEQ)
+
+size_t EmbeddingGradientShuffleTmpBufferSize(int64_t num_rows, int64_t num_ids) {
+  return GetCudaAlignedSize((num_rows + 1) * sizeof(int64_t))
+         + GetCudaAlignedSize(num_ids * sizeof(int64_t));
+}
+
+// The gradients of every unique row are gathered by a counting sort and then summed by one thread
+// in the order of the ids, which needs no atomics and makes the sums deterministic.
+template<typename T, typename IDX>
+class EmbeddingGradientShuffleKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingGradientShuffleKernel() = default;
+  ~EmbeddingGradientShuffleKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CHECK_EQ(ctx->parallel_ctx().parallel_num(), 1)
+        << "embedding_gradient_shuffle on cpu only supports a single rank";
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    const user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_unique_embedding_grad =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_embedding_grad", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t num_rows = cur_rank_unique_embedding_grad->shape().At(0);
+    const int64_t embedding_size = cur_rank_unique_embedding_grad->shape().At(1);
+    const int64_t num_ids = inverse_unique_partition_indices->shape().elem_cnt();
+    const int64_t num_unique = *reinterpret_cast<const IDX*>(num_unique_matrix->dptr());
+    CHECK_LE(num_unique, num_rows);
+    CHECK_GE(tmp_buffer->shape().elem_cnt(),
+             EmbeddingGradientShuffleTmpBufferSize(num_rows, num_ids));
+    const T* embedding_grad_ptr = embedding_grad->dptr<T>();
+    const IDX* cur_rank_inverse_indices_ptr =
+        reinterpret_cast<const IDX*>(cur_rank_inverse_indices->dptr());
+    const IDX* inverse_unique_partition_indices_ptr =
+        reinterpret_cast<const IDX*>(inverse_unique_partition_indices->dptr());
+    T* unique_grad_ptr = cur_rank_unique_embedding_grad->mut_dptr<T>();
+    int64_t* row_offsets = tmp_buffer->mut_dptr<int64_t>();
+    int64_t* row_ids = reinterpret_cast<int64_t*>(
+        tmp_buffer->mut_dptr<char>() + GetCudaAlignedSize((num_rows + 1) * sizeof(int64_t)));
+    auto RowOf = [&](int64_t i) -> int64_t {
+      return cur_rank_inverse_indices_ptr[inverse_unique_partition_indices_ptr[i]];
+    };
+    std::fill(row_offsets, row_offsets + num_unique + 1, 0);
+    for (int64_t i = 0; i < num_ids; ++i) { row_offsets[RowOf(i) + 1] += 1; }
+    for (int64_t row = 0; row < num_unique; ++row) { row_offsets[row + 1] += row_offsets[row]; }
+    for (int64_t i = 0; i < num_ids; ++i) { row_ids[row_offsets[RowOf(i)]++] = i; }
+    // Filling shifted every offset to the end of its row.
+    for (int64_t row = num_unique; row > 0; --row) { row_offsets[row] = row_offsets[row - 1]; }
+    row_offsets[0] = 0;
+    std::fill(unique_grad_ptr + num_unique * embedding_size,
+              unique_grad_ptr + num_rows * embedding_size, static_cast<T>(0));
+    const int64_t average_row_size = num_unique == 0 ? 1 : num_ids * embedding_size / num_unique;
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, num_unique,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            T* grad_row = unique_grad_ptr + row * embedding_size;
+            std::fill(grad_row, grad_row + embedding_size, static_cast<T>(0));
+            for (int64_t j = row_offsets[row]; j < row_offsets[row + 1]; ++j) {
+              const T* grad = embedding_grad_ptr + row_ids[j] * embedding_size;
+              for (int64_t col = 0; col < embedding_size; ++col) { grad_row[col] += grad[col]; }
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(average_row_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)              \
+  REGISTER_USER_KERNEL("embedding_gradient_shuffle")                                              \
+      .SetCreateFn<EmbeddingGradientShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                 \
+                                                  OF_PP_PAIR_FIRST(idx_dtype_pair)>>()            \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))       \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const user_op::TensorDesc& cur_rank_unique_embedding_grad =                               \
+            ctx->InputTensorDesc("cur_rank_unique_embedding_grad", 0);                            \
+        const user_op::TensorDesc& inverse_unique_partition_indices =                             \
+            ctx->InputTensorDesc("inverse_unique_partition_indices", 0);                          \
+        return EmbeddingGradientShuffleTmpBufferSize(                                             \
+            cur_rank_unique_embedding_grad.shape().At(0),                                         \
+            inverse_unique_partition_indices.shape().elem_cnt());                                 \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+template<typename K, typename V, typename IDX>
+class UniqueKeyValuePairKernel final : public user_op::OpKernel {
+ public:
+  UniqueKeyValuePairKernel() = default;
+  ~UniqueKeyValuePairKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* keys = ctx->Tensor4ArgNameAndIndex("keys", 0);
+    user_op::Tensor* num_unique = ctx->Tensor4ArgNameAndIndex("num_unique", 0);
+    user_op::Tensor* unique_keys = ctx->Tensor4ArgNameAndIndex("unique_keys", 0);
+    user_op::Tensor* unique_values = ctx->Tensor4ArgNameAndIndex("unique_values", 0);
+    user_op::Tensor* inverse_indices = ctx->Tensor4ArgNameAndIndex("inverse_indices", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const bool has_values = ctx->has_input("values", 0);
+    const bool need_values_buffer = (!has_values && num_tables > 1);
+    const int64_t num_keys = keys->shape().elem_cnt();
+    const size_t values_buffer_bytes =
+        need_values_buffer ? GetCudaAlignedSize(num_keys * sizeof(V)) : 0;
+    CHECK_LE(values_buffer_bytes + CpuUniqueWorkspaceBytes(num_keys),
+             tmp_buffer->shape().elem_cnt());
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const V* values_ptr;
+    if (has_values) {
+      const user_op::Tensor* values = ctx->Tensor4ArgNameAndIndex("values", 0);
+      values_ptr = reinterpret_cast<const V*>(values->dptr());
+    } else if (need_values_buffer) {
+      V* values_buffer_ptr = reinterpret_cast<V*>(tmp_buffer->mut_dptr());
+      GenerateTableIds(cpu_stream, num_keys, num_tables, values_buffer_ptr);
+      values_ptr = values_buffer_ptr;
+    } else {
+      values_ptr = nullptr;
+    }
+    const bool need_process_table_ids = (has_values || num_tables > 1);
+    CpuUniqueKeyValuePairs<K, V, IDX, embedding::GlobalUniqueHash>(
+        cpu_stream, num_keys, reinterpret_cast<const K*>(keys->dptr()), values_ptr,
+        reinterpret_cast<IDX*>(num_unique->mut_dptr()),
+        reinterpret_cast<K*>(unique_keys->mut_dptr()),
+        reinterpret_cast<V*>(unique_values->mut_dptr()),
+        reinterpret_cast<IDX*>(inverse_indices->mut_dptr()),
+        tmp_buffer->mut_dptr<char>() + values_buffer_bytes,
+        tmp_buffer->shape().elem_cnt() - values_buffer_bytes, need_process_table_ids);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_UNIQUE_KEY_VALUE_PAIR_KERNEL(k_dtype_pair, value_dtype_pair, idx_dtype_pair) \
+  REGISTER_USER_KERNEL("unique_key_value_pair")                                                   \
+      .SetCreateFn<UniqueKeyValuePairKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                       \
+                                            OF_PP_PAIR_FIRST(value_dtype_pair),                   \
+                                            OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                  \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("keys", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))                 \
+          && (user_op::HobDataType("inverse_indices", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))    \
+          && (user_op::HobDataType("unique_values", 0) == OF_PP_PAIR_SECOND(value_dtype_pair)))   \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const int64_t num_keys = ctx->InputTensorDesc("keys", 0).shape().elem_cnt();              \
+        const int32_t num_tables = ctx->Attr<int32_t>("num_tables");                              \
+        const bool need_values_buffer = (!ctx->has_input("values", 0) && num_tables > 1);         \
+        const size_t values_buffer_bytes =                                                        \
+            need_values_buffer                                                                    \
+                ? GetCudaAlignedSize(num_keys * sizeof(OF_PP_PAIR_FIRST(value_dtype_pair)))       \
+                : 0;                                                                              \
+        return CpuUniqueWorkspaceBytes(num_keys) + values_buffer_bytes;                           \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_UNIQUE_KEY_VALUE_PAIR_KERNEL, ID_DATA_TYPE_SEQ,
+                                 ID_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/ep/include/primitive/memset.h"
 #include "oneflow/user/kernels/embedding_kernel_util.h"
+#include "oneflow/user/kernels/cpu_gather_util.h"
 
 namespace oneflow {
 
@@ -105,9 +106,10 @@ class CpuEmbeddingGradKernel final : public user_op::OpKernel {
         ep::primitive::NewPrimitive<ep::primitive::MemsetFactory>(ctx->device_type());
     CHECK(memset_primitive);
     memset_primitive->Launch(ctx->stream(), dx_buf, 0, dx->shape().Count(0) * sizeof(T));
+    int32_t* tmp_buf = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0)->mut_dptr<int32_t>();
     EmbeddingGradFunctor<DeviceType::kCPU, T, IndexType>()(ctx->stream(), dy_buf, indices_buf,
                                                            dx_buf, padding_idx, scale_grad_by_freq,
-                                                           num_indices, emb_size, emb_dim, nullptr);
+                                                           num_indices, emb_size, emb_dim, tmp_buf);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -133,7 +135,10 @@ class CpuEmbeddingGradKernel final : public user_op::OpKernel {
       .SetIsMatchedHob(                                                                          \
           (user_op::HobDeviceType() == DeviceType::kCPU)                                         \
           && (user_op::HobDataType("weight", 0) == OF_PP_PAIR_SECOND(in_type))                   \
-          && (user_op::HobDataType("indices", 0) == OF_PP_PAIR_SECOND(indices_type)));
+          && (user_op::HobDataType("indices", 0) == OF_PP_PAIR_SECOND(indices_type)))            \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                              \
+        return cpu_gather::ScatterAddRowsTmpSize(ctx->InputShape("indices", 0).elem_cnt());      \
+      });
 
 OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_KERNEL, EMBEDDING_DATA_TYPE_SEQ_CPU,
                                  INDEX_DATA_TYPE_SEQ)
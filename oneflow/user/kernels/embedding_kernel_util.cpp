@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "oneflow/user/kernels/embedding_kernel_util.h"
+#include "oneflow/user/kernels/cpu_gather_util.h"
 
 namespace oneflow {
 
@@ -50,12 +51,11 @@ struct EmbeddingFunctor<DeviceType::kCPU, T, IndexType> final {
                   const int64_t padding_idx, const bool scale_grad_by_freq,
                   const int64_t num_indices, const int64_t emb_size, const int64_t emb_dim) {
     for (int64_t i = 0; i < num_indices; i++) {
-      IndexType indice = indices_buf[i];
-      CHECK(indice >= 0 && indice < emb_size);
-      const T* from = weight_buf + indice * emb_dim;
-      T* to = out_buf + i * emb_dim;
-      std::copy(from, from + emb_dim, to);
+      CHECK(indices_buf[i] >= 0 && indices_buf[i] < emb_size);
     }
+    cpu_gather::GatherRows<T>(
+        stream->As<ep::CpuStream>(), num_indices, emb_dim,
+        [&](int64_t i) { return weight_buf + indices_buf[i] * emb_dim; }, out_buf);
   }
 };
 
@@ -66,25 +66,16 @@ struct EmbeddingGradFunctor<DeviceType::kCPU, T, IndexType> final {
                   const int64_t num_indices, const int64_t emb_size, const int64_t emb_dim,
                   int32_t* tmp_buf) {
     for (int64_t i = 0; i < num_indices; i++) {
-      IndexType indice = indices_buf[i];
-      if (indice != padding_idx) {
-        const T* from = dy_buf + i * emb_dim;
-        T* to = dx_buf + indice * emb_dim;
-        std::transform(from, from + emb_dim, to, to, std::plus<T>());
-      }
-    }
-
-    if (scale_grad_by_freq) {
-      std::vector<IndexType> indice_freq(emb_size, 0);
-      for (int64_t i = 0; i < num_indices; i++) { indice_freq[indices_buf[i]]++; }
-
-      for (int64_t i = 0; i < emb_size; i++) {
-        if (indice_freq[i] > 1) {
-          T* from = dx_buf + i * emb_dim;
-          for (int64_t j = 0; j < emb_dim; j++) { from[j] /= indice_freq[i]; }
-        }
-      }
+      CHECK(indices_buf[i] == padding_idx || (indices_buf[i] >= 0 && indices_buf[i] < emb_size));
     }
+    cpu_gather::ScatterAddRows<T, IndexType>(
+        stream->As<ep::CpuStream>(), indices_buf, num_indices, emb_dim,
+        static_cast<IndexType>(padding_idx), dy_buf, dx_buf, tmp_buf,
+        [&](T* dx_row, int64_t count) {
+          if (scale_grad_by_freq && count > 1) {
+            for (int64_t j = 0; j < emb_dim; j++) { dx_row[j] /= count; }
+          }
+        });
   }
 };
 
@@ -0,0 +1,114 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/user/kernels/cpu_math_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class FusedCrossFeatureInteractionKernel final : public user_op::OpKernel {
+ public:
+  FusedCrossFeatureInteractionKernel() = default;
+  ~FusedCrossFeatureInteractionKernel() = default;
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    /*
+    vector: matmul_result = x matmul weight^T (B, 1), out = x0 * matmul_result + bias + x.
+    matrix: matmul_result = x matmul weight^T (B, E), out = (matmul_result + bias) * x0 + x.
+    The vector mode computes the row dot products in the same pass as the output.
+    */
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* x0 = ctx->Tensor4ArgNameAndIndex("x0", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* matmul_result = ctx->Tensor4ArgNameAndIndex("matmul_result", 0);
+    const std::string& interaction_mode = ctx->Attr<std::string>("interaction_mode");
+    CHECK_EQ(out->shape().NumAxes(), 2);
+    const int64_t batch_size = x->shape().At(0);
+    const int64_t in_size = x->shape().At(1);
+    const int64_t cols = out->shape().At(1);
+    CHECK_EQ(weight->shape().At(1), in_size);
+    const T* x_ptr = x->dptr<T>();
+    const T* x0_ptr = x0->dptr<T>();
+    const T* bias_ptr = bias->dptr<T>();
+    const T* weight_ptr = weight->dptr<T>();
+    T* matmul_result_ptr = matmul_result->mut_dptr<T>();
+    T* out_ptr = out->mut_dptr<T>();
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const int64_t grain_size = ep::CpuStream::ParallelForRowGrain(in_size + cols);
+    if (interaction_mode == "vector") {
+      CHECK_EQ(weight->shape().At(0), 1);
+      cpu_stream->ParallelFor(
+          0, batch_size,
+          [&](int64_t row_begin, int64_t row_end) {
+            for (int64_t row = row_begin; row < row_end; ++row) {
+              const T* x_row = x_ptr + row * in_size;
+              const T* x0_row = x0_ptr + row * cols;
+              T* out_row = out_ptr + row * cols;
+              const T dot = cpu_math::Dot(x_row, weight_ptr, in_size);
+              matmul_result_ptr[row] = dot;
+              for (int64_t col = 0; col < cols; ++col) {
+                out_row[col] = x0_row[col] * dot + bias_ptr[col] + x_row[col];
+              }
+            }
+          },
+          grain_size);
+    } else {
+      CHECK_EQ(weight->shape().At(0), cols);
+      auto matmul = ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(
+          DeviceType::kCPU, x->data_type(), ep::primitive::BlasTransposeType::N,
+          ep::primitive::BlasTransposeType::T);
+      CHECK(matmul);
+      matmul->Launch(ctx->stream(), batch_size, cols, in_size, 1.0, x_ptr, weight_ptr, 0.0,
+                     matmul_result_ptr);
+      cpu_stream->ParallelFor(
+          0, batch_size,
+          [&](int64_t row_begin, int64_t row_end) {
+            for (int64_t row = row_begin; row < row_end; ++row) {
+              const T* matmul_result_row = matmul_result_ptr + row * cols;
+              const T* x_row = x_ptr + row * in_size;
+              const T* x0_row = x0_ptr + row * cols;
+              T* out_row = out_ptr + row * cols;
+              for (int64_t col = 0; col < cols; ++col) {
+                out_row[col] = (matmul_result_row[col] + bias_ptr[col]) * x0_row[col] + x_row[col];
+              }
+            }
+          },
+          grain_size);
+    }
+  }
+};
+
+#define REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_KERNEL(dtype)    \
+  REGISTER_USER_KERNEL("fused_cross_feature_interaction")             \
+      .SetCreateFn<FusedCrossFeatureInteractionKernel<dtype>>()       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_KERNEL(float)
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
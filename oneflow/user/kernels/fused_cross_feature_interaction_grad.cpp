@@ -0,0 +1,195 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/user/kernels/cpu_math_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class FusedCrossFeatureInteractionGradKernel final : public user_op::OpKernel {
+ public:
+  FusedCrossFeatureInteractionGradKernel() = default;
+  ~FusedCrossFeatureInteractionGradKernel() = default;
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    /*
+    dmatmul_result = reduce_sum(dy * x0, axis=1), dx = dmatmul_result matmul weight + dy,
+    dx0 = dy * matmul_result, dw = dmatmul_result^T matmul x, dbias = reduce_sum(dy, axis=0).
+    The row pass computes dmatmul_result, dx and dx0, the column pass dw and dbias.
+    */
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* x0 = ctx->Tensor4ArgNameAndIndex("x0", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* matmul_result = ctx->Tensor4ArgNameAndIndex("matmul_result", 0);
+    user_op::Tensor* dx0 = ctx->Tensor4ArgNameAndIndex("dx0", 0);
+    user_op::Tensor* dw = ctx->Tensor4ArgNameAndIndex("dw", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    user_op::Tensor* dbias = ctx->Tensor4ArgNameAndIndex("dbias", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t batch_size = dy->shape().At(0);
+    const int64_t hidden_size = dy->shape().At(1);
+    CHECK_EQ(weight->shape().At(0), 1);
+    CHECK_EQ(weight->shape().At(1), hidden_size);
+    CHECK_GE(tmp_buffer->shape().elem_cnt(), batch_size * sizeof(T));
+    const T* dy_ptr = dy->dptr<T>();
+    const T* weight_ptr = weight->dptr<T>();
+    const T* x0_ptr = x0->dptr<T>();
+    const T* x_ptr = x->dptr<T>();
+    const T* matmul_result_ptr = matmul_result->dptr<T>();
+    T* dmatmul_result = tmp_buffer->mut_dptr<T>();
+    T* dx0_ptr = dx0->mut_dptr<T>();
+    T* dx_ptr = dx->mut_dptr<T>();
+    T* dw_ptr = dw->mut_dptr<T>();
+    T* dbias_ptr = dbias->mut_dptr<T>();
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(
+        0, batch_size,
+        [&](int64_t row_begin, int64_t row_end) {
+          for (int64_t row = row_begin; row < row_end; ++row) {
+            const int64_t offset = row * hidden_size;
+            const T dmatmul_result_val =
+                cpu_math::Dot(dy_ptr + offset, x0_ptr + offset, hidden_size);
+            const T matmul_result_val = matmul_result_ptr[row];
+            dmatmul_result[row] = dmatmul_result_val;
+            for (int64_t col = 0; col < hidden_size; ++col) {
+              dx_ptr[offset + col] = dmatmul_result_val * weight_ptr[col] + dy_ptr[offset + col];
+              dx0_ptr[offset + col] = dy_ptr[offset + col] * matmul_result_val;
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(hidden_size));
+    cpu_math::ForEachColumnSlice(
+        cpu_stream, batch_size, hidden_size, [&](int64_t col_begin, int64_t width) {
+          T dw_sum[cpu_math::kColsPerSlice] = {};
+          T dbias_sum[cpu_math::kColsPerSlice] = {};
+          for (int64_t row = 0; row < batch_size; ++row) {
+            const int64_t offset = row * hidden_size + col_begin;
+            const T dmatmul_result_val = dmatmul_result[row];
+            for (int64_t i = 0; i < width; ++i) {
+              dw_sum[i] += dmatmul_result_val * x_ptr[offset + i];
+              dbias_sum[i] += dy_ptr[offset + i];
+            }
+          }
+          std::copy(dw_sum, dw_sum + width, dw_ptr + col_begin);
+          std::copy(dbias_sum, dbias_sum + width, dbias_ptr + col_begin);
+        });
+  }
+};
+
+#define REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_V1_GRAD_KERNEL(dtype)              \
+  REGISTER_USER_KERNEL("fused_cross_feature_interaction_v1_grad")                       \
+      .SetCreateFn<FusedCrossFeatureInteractionGradKernel<dtype>>()                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                               \
+        return ctx->InputTensorDesc("dy", 0).shape().At(0) * sizeof(dtype);             \
+      });
+
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_V1_GRAD_KERNEL(float)
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_V1_GRAD_KERNEL(double)
+
+template<typename T>
+class FusedCrossFeatureInteractionV2GradKernel final : public user_op::OpKernel {
+ public:
+  FusedCrossFeatureInteractionV2GradKernel() = default;
+  ~FusedCrossFeatureInteractionV2GradKernel() = default;
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    /*
+    dx0 = (matmul_result + bias) * dy, dmatmul_result = dy * x0,
+    dx = dmatmul_result matmul weight + dy, dw = dmatmul_result^T matmul x,
+    dbias = reduce_sum(dmatmul_result, axis=0).
+    dx is seeded with dy by the row pass, so its matmul accumulates with beta = 1.
+    */
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    const user_op::Tensor* x0 = ctx->Tensor4ArgNameAndIndex("x0", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* matmul_result = ctx->Tensor4ArgNameAndIndex("matmul_result", 0);
+    user_op::Tensor* dx0 = ctx->Tensor4ArgNameAndIndex("dx0", 0);
+    user_op::Tensor* dw = ctx->Tensor4ArgNameAndIndex("dw", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    user_op::Tensor* dbias = ctx->Tensor4ArgNameAndIndex("dbias", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t batch_size = dy->shape().At(0);
+    const int64_t hidden_size = weight->shape().At(0);
+    const int64_t in_size = weight->shape().At(1);
+    CHECK_EQ(dy->shape().At(1), hidden_size);
+    CHECK_EQ(hidden_size, in_size);
+    CHECK_GE(tmp_buffer->shape().elem_cnt(), dy->shape().elem_cnt() * sizeof(T));
+    const T* dy_ptr = dy->dptr<T>();
+    const T* bias_ptr = bias->dptr<T>();
+    const T* x0_ptr = x0->dptr<T>();
+    const T* matmul_result_ptr = matmul_result->dptr<T>();
+    T* dmatmul_result = tmp_buffer->mut_dptr<T>();
+    T* dx0_ptr = dx0->mut_dptr<T>();
+    T* dx_ptr = dx->mut_dptr<T>();
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(
+        0, batch_size,
+        [&](int64_t row_begin, int64_t row_end) {
+          for (int64_t i = row_begin * hidden_size; i < row_end * hidden_size; ++i) {
+            const int64_t col = i % hidden_size;
+            dx0_ptr[i] = (matmul_result_ptr[i] + bias_ptr[col]) * dy_ptr[i];
+            dmatmul_result[i] = dy_ptr[i] * x0_ptr[i];
+            dx_ptr[i] = dy_ptr[i];
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(hidden_size));
+    auto matmul = ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(
+        DeviceType::kCPU, dy->data_type(), ep::primitive::BlasTransposeType::N,
+        ep::primitive::BlasTransposeType::N);
+    CHECK(matmul);
+    matmul->Launch(ctx->stream(), batch_size, in_size, hidden_size, 1.0, dmatmul_result,
+                   weight->dptr(), 1.0, dx_ptr);
+    auto weight_grad_matmul = ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(
+        DeviceType::kCPU, dy->data_type(), ep::primitive::BlasTransposeType::T,
+        ep::primitive::BlasTransposeType::N);
+    CHECK(weight_grad_matmul);
+    weight_grad_matmul->Launch(ctx->stream(), hidden_size, in_size, batch_size, 1.0,
+                               dmatmul_result, x->dptr(), 0.0, dw->mut_dptr());
+    cpu_math::ColumnSum<T>(cpu_stream, batch_size, hidden_size, dmatmul_result,
+                           dbias->mut_dptr<T>());
+  }
+};
+
+#define REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_V2_GRAD_KERNEL(dtype)              \
+  REGISTER_USER_KERNEL("fused_cross_feature_interaction_v2_grad")                       \
+      .SetCreateFn<FusedCrossFeatureInteractionV2GradKernel<dtype>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                               \
+        return ctx->InputTensorDesc("dy", 0).shape().elem_cnt() * sizeof(dtype);        \
+      });
+
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_V2_GRAD_KERNEL(float)
+REGISTER_CPU_FUSED_CROSS_FEATURE_INTERACTION_V2_GRAD_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,301 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/cpu_math_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+void Axpy(T alpha, const T* x, int64_t n, T* y) {
+  for (int64_t i = 0; i < n; ++i) { y[i] += alpha * x[i]; }
+}
+
+// The concatenated features of a sample are addressed through a table of row pointers, so the
+// inputs are never copied into a concatenated buffer.
+template<typename T>
+void FillFeatureRows(const std::vector<const user_op::Tensor*>& features, int64_t sample,
+                     int64_t vector_size, std::vector<const T*>* rows) {
+  int64_t row = 0;
+  for (const user_op::Tensor* feature : features) {
+    const int64_t num_rows = feature->shape().At(1);
+    const T* sample_ptr = feature->dptr<T>() + sample * num_rows * vector_size;
+    for (int64_t i = 0; i < num_rows; ++i) { (*rows)[row++] = sample_ptr + i * vector_size; }
+  }
+}
+
+template<typename T>
+void FillFeatureRows(const std::vector<user_op::Tensor*>& features, int64_t sample,
+                     int64_t vector_size, std::vector<T*>* rows) {
+  int64_t row = 0;
+  for (user_op::Tensor* feature : features) {
+    const int64_t num_rows = feature->shape().At(1);
+    T* sample_ptr = feature->mut_dptr<T>() + sample * num_rows * vector_size;
+    for (int64_t i = 0; i < num_rows; ++i) { (*rows)[row++] = sample_ptr + i * vector_size; }
+  }
+}
+
+int64_t PackedOffset(int64_t row, int64_t offset) { return row * (row - 1 + 2 * offset) / 2; }
+
+template<typename T>
+class FusedDotFeatureInteractionKernel final : public user_op::OpKernel {
+ public:
+  FusedDotFeatureInteractionKernel() = default;
+  ~FusedDotFeatureInteractionKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    std::vector<const user_op::Tensor*> features(ctx->input_size("features"));
+    int64_t features_concated_dim = 0;
+    for (size_t i = 0; i < features.size(); ++i) {
+      features[i] = ctx->Tensor4ArgNameAndIndex("features", i);
+      features_concated_dim += features[i]->shape().At(1);
+    }
+    const int64_t batch_size = out->shape().At(0);
+    const int64_t vector_size = features[0]->shape().At(2);
+    const int64_t out_dim = out->shape().At(1);
+    const int32_t output_padding = ctx->Attr<int32_t>("output_padding");
+    const int64_t offset = ctx->Attr<bool>("self_interaction") ? 1 : 0;
+    const int64_t interaction_dim = PackedOffset(features_concated_dim, offset);
+    int64_t output_concat_end_dim = 0;
+    const T* output_concat_ptr = nullptr;
+    if (ctx->has_input("output_concat", 0)) {
+      const user_op::Tensor* output_concat = ctx->Tensor4ArgNameAndIndex("output_concat", 0);
+      output_concat_end_dim = output_concat->shape().At(1);
+      output_concat_ptr = output_concat->dptr<T>();
+    }
+    CHECK_EQ(out_dim - output_padding, output_concat_end_dim + interaction_dim);
+    T* out_ptr = out->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t sample_begin, int64_t sample_end) {
+          std::vector<const T*> rows(features_concated_dim);
+          for (int64_t sample = sample_begin; sample < sample_end; ++sample) {
+            FillFeatureRows(features, sample, vector_size, &rows);
+            T* sample_out = out_ptr + sample * out_dim;
+            std::copy(output_concat_ptr + sample * output_concat_end_dim,
+                      output_concat_ptr + (sample + 1) * output_concat_end_dim, sample_out);
+            // Only the packed lower triangle of the gram matrix is computed.
+            T* packed = sample_out + output_concat_end_dim;
+            for (int64_t i = 0; i < features_concated_dim; ++i) {
+              T* packed_row = packed + PackedOffset(i, offset);
+              for (int64_t j = 0; j < i + offset; ++j) {
+                packed_row[j] = cpu_math::Dot(rows[i], rows[j], vector_size);
+              }
+            }
+            std::fill(packed + interaction_dim, sample_out + out_dim, static_cast<T>(0));
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(features_concated_dim * features_concated_dim
+                                           * vector_size / 2));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedDotFeatureInteractionPoolingSumKernel final : public user_op::OpKernel {
+ public:
+  FusedDotFeatureInteractionPoolingSumKernel() = default;
+  ~FusedDotFeatureInteractionPoolingSumKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    std::vector<const user_op::Tensor*> features(ctx->input_size("features"));
+    int64_t features_concated_dim = 0;
+    for (size_t i = 0; i < features.size(); ++i) {
+      features[i] = ctx->Tensor4ArgNameAndIndex("features", i);
+      features_concated_dim += features[i]->shape().At(1);
+    }
+    const int64_t batch_size = out->shape().At(0);
+    const int64_t vector_size = out->shape().At(1);
+    T* out_ptr = out->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t sample_begin, int64_t sample_end) {
+          std::vector<const T*> rows(features_concated_dim);
+          std::vector<T> square_sum(vector_size);
+          for (int64_t sample = sample_begin; sample < sample_end; ++sample) {
+            FillFeatureRows(features, sample, vector_size, &rows);
+            T* sum = out_ptr + sample * vector_size;
+            std::fill(sum, sum + vector_size, static_cast<T>(0));
+            std::fill(square_sum.begin(), square_sum.end(), static_cast<T>(0));
+            for (const T* row : rows) {
+              for (int64_t col = 0; col < vector_size; ++col) {
+                sum[col] += row[col];
+                square_sum[col] += row[col] * row[col];
+              }
+            }
+            for (int64_t col = 0; col < vector_size; ++col) {
+              sum[col] = (sum[col] * sum[col] - square_sum[col]) * static_cast<T>(0.5);
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(features_concated_dim * vector_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_KERNEL(dtype)                        \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction")                                 \
+      .SetCreateFn<FusedDotFeatureInteractionKernel<dtype>>()                           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "none"));        \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction")                                 \
+      .SetCreateFn<FusedDotFeatureInteractionPoolingSumKernel<dtype>>()                 \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "sum"));
+
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_KERNEL(float)
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_KERNEL(double)
+
+template<typename T>
+class FusedDotFeatureInteractionGradKernel final : public user_op::OpKernel {
+ public:
+  FusedDotFeatureInteractionGradKernel() = default;
+  ~FusedDotFeatureInteractionGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    std::vector<const user_op::Tensor*> features(ctx->input_size("features"));
+    std::vector<user_op::Tensor*> features_grad(ctx->output_size("features_grad"));
+    int64_t features_concated_dim = 0;
+    for (size_t i = 0; i < features.size(); ++i) {
+      features[i] = ctx->Tensor4ArgNameAndIndex("features", i);
+      features_grad[i] = ctx->Tensor4ArgNameAndIndex("features_grad", i);
+      features_concated_dim += features[i]->shape().At(1);
+    }
+    const int64_t batch_size = dy->shape().At(0);
+    const int64_t vector_size = features[0]->shape().At(2);
+    const int64_t out_dim = dy->shape().At(1);
+    const int64_t offset = ctx->Attr<bool>("self_interaction") ? 1 : 0;
+    T* output_concat_grad_ptr = nullptr;
+    int64_t output_concat_end_dim = 0;
+    if (ctx->has_output("output_concat_grad", 0)) {
+      user_op::Tensor* output_concat_grad = ctx->Tensor4ArgNameAndIndex("output_concat_grad", 0);
+      output_concat_grad_ptr = output_concat_grad->mut_dptr<T>();
+      output_concat_end_dim = output_concat_grad->shape().At(1);
+    }
+    const T* dy_ptr = dy->dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t sample_begin, int64_t sample_end) {
+          std::vector<const T*> rows(features_concated_dim);
+          std::vector<T*> grad_rows(features_concated_dim);
+          for (int64_t sample = sample_begin; sample < sample_end; ++sample) {
+            FillFeatureRows(features, sample, vector_size, &rows);
+            FillFeatureRows(features_grad, sample, vector_size, &grad_rows);
+            const T* sample_dy = dy_ptr + sample * out_dim;
+            std::copy(sample_dy, sample_dy + output_concat_end_dim,
+                      output_concat_grad_ptr + sample * output_concat_end_dim);
+            for (T* grad_row : grad_rows) {
+              std::fill(grad_row, grad_row + vector_size, static_cast<T>(0));
+            }
+            // dx = (G + G^T) x, G being the packed lower triangle of dy, every packed element
+            // contributes to both of its rows.
+            const T* packed = sample_dy + output_concat_end_dim;
+            for (int64_t i = 0; i < features_concated_dim; ++i) {
+              const T* packed_row = packed + PackedOffset(i, offset);
+              for (int64_t j = 0; j < i; ++j) {
+                Axpy(packed_row[j], rows[j], vector_size, grad_rows[i]);
+                Axpy(packed_row[j], rows[i], vector_size, grad_rows[j]);
+              }
+              if (offset == 1) {
+                Axpy(packed_row[i] * static_cast<T>(2), rows[i], vector_size, grad_rows[i]);
+              }
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(features_concated_dim * features_concated_dim
+                                           * vector_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedDotFeatureInteractionPoolingSumGradKernel final : public user_op::OpKernel {
+ public:
+  FusedDotFeatureInteractionPoolingSumGradKernel() = default;
+  ~FusedDotFeatureInteractionPoolingSumGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    std::vector<const user_op::Tensor*> features(ctx->input_size("features"));
+    std::vector<user_op::Tensor*> features_grad(ctx->output_size("features_grad"));
+    int64_t features_concated_dim = 0;
+    for (size_t i = 0; i < features.size(); ++i) {
+      features[i] = ctx->Tensor4ArgNameAndIndex("features", i);
+      features_grad[i] = ctx->Tensor4ArgNameAndIndex("features_grad", i);
+      features_concated_dim += features[i]->shape().At(1);
+    }
+    const int64_t batch_size = dy->shape().At(0);
+    const int64_t vector_size = dy->shape().At(1);
+    const T* dy_ptr = dy->dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t sample_begin, int64_t sample_end) {
+          std::vector<const T*> rows(features_concated_dim);
+          std::vector<T*> grad_rows(features_concated_dim);
+          std::vector<T> sum(vector_size);
+          for (int64_t sample = sample_begin; sample < sample_end; ++sample) {
+            FillFeatureRows(features, sample, vector_size, &rows);
+            FillFeatureRows(features_grad, sample, vector_size, &grad_rows);
+            const T* sample_dy = dy_ptr + sample * vector_size;
+            std::fill(sum.begin(), sum.end(), static_cast<T>(0));
+            for (const T* row : rows) {
+              for (int64_t col = 0; col < vector_size; ++col) { sum[col] += row[col]; }
+            }
+            for (int64_t i = 0; i < features_concated_dim; ++i) {
+              for (int64_t col = 0; col < vector_size; ++col) {
+                grad_rows[i][col] = sample_dy[col] * (sum[col] - rows[i][col]);
+              }
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(features_concated_dim * vector_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_GRAD_KERNEL(dtype)                  \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction_grad")                           \
+      .SetCreateFn<FusedDotFeatureInteractionGradKernel<dtype>>()                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                  \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "none"));       \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction_grad")                           \
+      .SetCreateFn<FusedDotFeatureInteractionPoolingSumGradKernel<dtype>>()            \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                  \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "sum"));
+
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_GRAD_KERNEL(float)
+REGISTER_CPU_FUSED_DOT_FEATURE_INTERACTION_GRAD_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,195 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/cpu_math_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class CpuFusedGruCellKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedGruCellKernel() = default;
+  ~CpuFusedGruCellKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* input_gates = ctx->Tensor4ArgNameAndIndex("input_gates", 0);
+    const user_op::Tensor* hidden_gates = ctx->Tensor4ArgNameAndIndex("hidden_gates", 0);
+    const user_op::Tensor* hx = ctx->Tensor4ArgNameAndIndex("hx", 0);
+    user_op::Tensor* hy = ctx->Tensor4ArgNameAndIndex("hy", 0);
+    user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+
+    const T* input_bias_ptr = nullptr;
+    const T* hidden_bias_ptr = nullptr;
+    if (ctx->has_input("input_bias", 0)) {
+      CHECK(ctx->has_input("hidden_bias", 0));
+      input_bias_ptr = ctx->Tensor4ArgNameAndIndex("input_bias", 0)->dptr<T>();
+      hidden_bias_ptr = ctx->Tensor4ArgNameAndIndex("hidden_bias", 0)->dptr<T>();
+    }
+    const int64_t batch_size = hx->shape().At(0);
+    const int64_t hidden_size = hx->shape().At(hx->shape().NumAxes() - 1);
+    const int64_t gates_size = 3 * hidden_size;
+    const int64_t workspace_size = 5 * hidden_size;
+    const T* input_gates_ptr = input_gates->dptr<T>();
+    const T* hidden_gates_ptr = hidden_gates->dptr<T>();
+    const T* hx_ptr = hx->dptr<T>();
+    T* hy_ptr = hy->mut_dptr<T>();
+    T* workspace_ptr = workspace->mut_dptr<T>();
+
+    // The workspace holds [rg, ig, ng, hx, hn + b2n] for the backward, the pre-activations of rg
+    // and ig are summed into their slots first and activated in place.
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            const T* input_gates_row = input_gates_ptr + row * gates_size;
+            const T* hidden_gates_row = hidden_gates_ptr + row * gates_size;
+            const T* hx_row = hx_ptr + row * hidden_size;
+            T* ws = workspace_ptr + row * workspace_size;
+            T* rg = ws;
+            T* ig = ws + hidden_size;
+            T* ng = ws + 2 * hidden_size;
+            T* ws_hx = ws + 3 * hidden_size;
+            T* hn = ws + 4 * hidden_size;
+            const T* in = input_gates_row + 2 * hidden_size;
+            if (input_bias_ptr != nullptr) {
+              for (int64_t i = 0; i < 2 * hidden_size; ++i) {
+                ws[i] = input_gates_row[i] + hidden_gates_row[i] + input_bias_ptr[i]
+                        + hidden_bias_ptr[i];
+              }
+              for (int64_t i = 0; i < hidden_size; ++i) {
+                ng[i] = in[i] + input_bias_ptr[2 * hidden_size + i];
+                hn[i] =
+                    hidden_gates_row[2 * hidden_size + i] + hidden_bias_ptr[2 * hidden_size + i];
+              }
+            } else {
+              for (int64_t i = 0; i < 2 * hidden_size; ++i) {
+                ws[i] = input_gates_row[i] + hidden_gates_row[i];
+              }
+              std::copy(in, in + hidden_size, ng);
+              std::copy(hidden_gates_row + 2 * hidden_size, hidden_gates_row + gates_size, hn);
+            }
+            std::copy(hx_row, hx_row + hidden_size, ws_hx);
+            T* hy_row = hy_ptr + row * hidden_size;
+            for (int64_t i = 0; i < hidden_size; ++i) {
+              rg[i] = cpu_math::Sigmoid(rg[i]);
+              ig[i] = cpu_math::Sigmoid(ig[i]);
+              ng[i] = std::tanh(ng[i] + rg[i] * hn[i]);
+              hy_row[i] = ng[i] + ig[i] * (hx_row[i] - ng[i]);
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(workspace_size));
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_GRU_CELL_KERNEL(dtype)                                               \
+  REGISTER_USER_KERNEL("fused_gru_cell")                                                        \
+      .SetCreateFn<CpuFusedGruCellKernel<dtype>>()                                              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("hx", 0) == GetDataType<dtype>::value)          \
+                       && (user_op::HobDataType("input_gates", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("hidden_gates", 0) == GetDataType<dtype>::value))
+
+REGISTER_CPU_FUSED_GRU_CELL_KERNEL(float);
+REGISTER_CPU_FUSED_GRU_CELL_KERNEL(double);
+
+template<typename T>
+class CpuFusedGruCellGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedGruCellGradKernel() = default;
+  ~CpuFusedGruCellGradKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* grad_hy = ctx->Tensor4ArgNameAndIndex("grad_hy", 0);
+    const user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+    user_op::Tensor* grad_input_gates = ctx->Tensor4ArgNameAndIndex("grad_input_gates", 0);
+    user_op::Tensor* grad_hidden_gates = ctx->Tensor4ArgNameAndIndex("grad_hidden_gates", 0);
+
+    T* grad_hx_ptr = nullptr;
+    if (ctx->has_output("grad_hx", 0)) {
+      grad_hx_ptr = ctx->Tensor4ArgNameAndIndex("grad_hx", 0)->mut_dptr<T>();
+    }
+    const int64_t batch_size = grad_hy->shape().At(0);
+    const int64_t hidden_size = grad_hy->shape().At(grad_hy->shape().NumAxes() - 1);
+    const int64_t gates_size = 3 * hidden_size;
+    const int64_t workspace_size = 5 * hidden_size;
+    const T* grad_hy_ptr = grad_hy->dptr<T>();
+    const T* workspace_ptr = workspace->dptr<T>();
+    T* grad_input_gates_ptr = grad_input_gates->mut_dptr<T>();
+    T* grad_hidden_gates_ptr = grad_hidden_gates->mut_dptr<T>();
+
+    ep::CpuStream* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            const T* rg = workspace_ptr + row * workspace_size;
+            const T* ig = rg + hidden_size;
+            const T* ng = rg + 2 * hidden_size;
+            const T* hx = rg + 3 * hidden_size;
+            const T* hn = rg + 4 * hidden_size;
+            const T* go = grad_hy_ptr + row * hidden_size;
+            T* grad_input_row = grad_input_gates_ptr + row * gates_size;
+            T* grad_hidden_row = grad_hidden_gates_ptr + row * gates_size;
+            for (int64_t i = 0; i < hidden_size; ++i) {
+              const T gig = go[i] * (hx[i] - ng[i]) * (1 - ig[i]) * ig[i];
+              const T gin = go[i] * (1 - ig[i]) * (1 - ng[i] * ng[i]);
+              const T grg = gin * hn[i] * (1 - rg[i]) * rg[i];
+              grad_input_row[i] = grg;
+              grad_input_row[hidden_size + i] = gig;
+              grad_input_row[2 * hidden_size + i] = gin;
+              grad_hidden_row[i] = grg;
+              grad_hidden_row[hidden_size + i] = gig;
+              grad_hidden_row[2 * hidden_size + i] = gin * rg[i];
+              if (grad_hx_ptr != nullptr) { grad_hx_ptr[row * hidden_size + i] = go[i] * ig[i]; }
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(workspace_size));
+
+    if (ctx->has_output("grad_input_bias", 0) && ctx->has_output("grad_hidden_bias", 0)) {
+      cpu_math::ColumnSum(cpu_stream, batch_size, gates_size, grad_input_gates_ptr,
+                          ctx->Tensor4ArgNameAndIndex("grad_input_bias", 0)->mut_dptr<T>());
+      cpu_math::ColumnSum(cpu_stream, batch_size, gates_size, grad_hidden_gates_ptr,
+                          ctx->Tensor4ArgNameAndIndex("grad_hidden_bias", 0)->mut_dptr<T>());
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_GRU_CELL_GRAD_KERNEL(dtype)                                      \
+  REGISTER_USER_KERNEL("fused_gru_cell_grad")                                               \
+      .SetCreateFn<CpuFusedGruCellGradKernel<dtype>>()                                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
+                       && (user_op::HobDataType("grad_hy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("workspace", 0) == GetDataType<dtype>::value))
+
+REGISTER_CPU_FUSED_GRU_CELL_GRAD_KERNEL(float);
+REGISTER_CPU_FUSED_GRU_CELL_GRAD_KERNEL(double);
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,193 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/cpu_math_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class CpuFusedLstmCellKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedLstmCellKernel() = default;
+  ~CpuFusedLstmCellKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* input_gates = ctx->Tensor4ArgNameAndIndex("input_gates", 0);
+    const user_op::Tensor* hidden_gates = ctx->Tensor4ArgNameAndIndex("hidden_gates", 0);
+    const user_op::Tensor* cx = ctx->Tensor4ArgNameAndIndex("cx", 0);
+    user_op::Tensor* hy = ctx->Tensor4ArgNameAndIndex("hy", 0);
+    user_op::Tensor* cy = ctx->Tensor4ArgNameAndIndex("cy", 0);
+    user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+
+    const T* input_bias_ptr = nullptr;
+    const T* hidden_bias_ptr = nullptr;
+    if (ctx->has_input("input_bias", 0)) {
+      CHECK(ctx->has_input("hidden_bias", 0));
+      input_bias_ptr = ctx->Tensor4ArgNameAndIndex("input_bias", 0)->dptr<T>();
+      hidden_bias_ptr = ctx->Tensor4ArgNameAndIndex("hidden_bias", 0)->dptr<T>();
+    }
+    const int64_t batch_size = cx->shape().At(0);
+    const int64_t hidden_size = cx->shape().At(cx->shape().NumAxes() - 1);
+    const int64_t gates_size = 4 * hidden_size;
+    const T* input_gates_ptr = input_gates->dptr<T>();
+    const T* hidden_gates_ptr = hidden_gates->dptr<T>();
+    const T* cx_ptr = cx->dptr<T>();
+    T* hy_ptr = hy->mut_dptr<T>();
+    T* cy_ptr = cy->mut_dptr<T>();
+    T* workspace_ptr = workspace->mut_dptr<T>();
+
+    // Each row sums its gate pre-activations into the workspace and activates them in place, the
+    // workspace then holds [ig, fg, cg, og] for the backward.
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            const T* input_gates_row = input_gates_ptr + row * gates_size;
+            const T* hidden_gates_row = hidden_gates_ptr + row * gates_size;
+            T* ws = workspace_ptr + row * gates_size;
+            if (input_bias_ptr != nullptr) {
+              for (int64_t i = 0; i < gates_size; ++i) {
+                ws[i] = input_gates_row[i] + hidden_gates_row[i] + input_bias_ptr[i]
+                        + hidden_bias_ptr[i];
+              }
+            } else {
+              for (int64_t i = 0; i < gates_size; ++i) {
+                ws[i] = input_gates_row[i] + hidden_gates_row[i];
+              }
+            }
+            T* ig = ws;
+            T* fg = ws + hidden_size;
+            T* cg = ws + 2 * hidden_size;
+            T* og = ws + 3 * hidden_size;
+            const T* cx_row = cx_ptr + row * hidden_size;
+            T* hy_row = hy_ptr + row * hidden_size;
+            T* cy_row = cy_ptr + row * hidden_size;
+            for (int64_t i = 0; i < hidden_size; ++i) {
+              ig[i] = cpu_math::Sigmoid(ig[i]);
+              fg[i] = cpu_math::Sigmoid(fg[i]);
+              cg[i] = std::tanh(cg[i]);
+              og[i] = cpu_math::Sigmoid(og[i]);
+              const T c = fg[i] * cx_row[i] + ig[i] * cg[i];
+              cy_row[i] = c;
+              hy_row[i] = og[i] * std::tanh(c);
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(gates_size));
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_LSTM_CELL_KERNEL(dtype)                                              \
+  REGISTER_USER_KERNEL("fused_lstm_cell")                                                       \
+      .SetCreateFn<CpuFusedLstmCellKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("cx", 0) == GetDataType<dtype>::value)          \
+                       && (user_op::HobDataType("input_gates", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("hidden_gates", 0) == GetDataType<dtype>::value))
+
+REGISTER_CPU_FUSED_LSTM_CELL_KERNEL(float);
+REGISTER_CPU_FUSED_LSTM_CELL_KERNEL(double);
+
+template<typename T>
+class CpuFusedLstmCellGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedLstmCellGradKernel() = default;
+  ~CpuFusedLstmCellGradKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* grad_hy = ctx->Tensor4ArgNameAndIndex("grad_hy", 0);
+    const user_op::Tensor* grad_cy = ctx->Tensor4ArgNameAndIndex("grad_cy", 0);
+    const user_op::Tensor* cx = ctx->Tensor4ArgNameAndIndex("cx", 0);
+    const user_op::Tensor* cy = ctx->Tensor4ArgNameAndIndex("cy", 0);
+    const user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+    user_op::Tensor* grad_gates = ctx->Tensor4ArgNameAndIndex("grad_gates", 0);
+
+    T* grad_cx_ptr = nullptr;
+    if (ctx->has_output("grad_cx", 0)) {
+      grad_cx_ptr = ctx->Tensor4ArgNameAndIndex("grad_cx", 0)->mut_dptr<T>();
+    }
+    const int64_t batch_size = cx->shape().At(0);
+    const int64_t hidden_size = cx->shape().At(cx->shape().NumAxes() - 1);
+    const int64_t gates_size = 4 * hidden_size;
+    const T* grad_hy_ptr = grad_hy->dptr<T>();
+    const T* grad_cy_ptr = grad_cy->dptr<T>();
+    const T* cx_ptr = cx->dptr<T>();
+    const T* cy_ptr = cy->dptr<T>();
+    const T* workspace_ptr = workspace->dptr<T>();
+    T* grad_gates_ptr = grad_gates->mut_dptr<T>();
+
+    ep::CpuStream* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            const T* ig = workspace_ptr + row * gates_size;
+            const T* fg = ig + hidden_size;
+            const T* cg = ig + 2 * hidden_size;
+            const T* og = ig + 3 * hidden_size;
+            T* gig = grad_gates_ptr + row * gates_size;
+            T* gfg = gig + hidden_size;
+            T* gcg = gig + 2 * hidden_size;
+            T* gog = gig + 3 * hidden_size;
+            const int64_t offset = row * hidden_size;
+            for (int64_t i = 0; i < hidden_size; ++i) {
+              const T go = grad_hy_ptr[offset + i];
+              const T tanh_cy = std::tanh(cy_ptr[offset + i]);
+              const T gcx = go * og[i] * (1 - tanh_cy * tanh_cy) + grad_cy_ptr[offset + i];
+              gig[i] = gcx * cg[i] * (1 - ig[i]) * ig[i];
+              gfg[i] = gcx * cx_ptr[offset + i] * (1 - fg[i]) * fg[i];
+              gcg[i] = gcx * ig[i] * (1 - cg[i] * cg[i]);
+              gog[i] = go * tanh_cy * (1 - og[i]) * og[i];
+              if (grad_cx_ptr != nullptr) { grad_cx_ptr[offset + i] = gcx * fg[i]; }
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(gates_size));
+
+    if (ctx->has_output("grad_bias", 0)) {
+      cpu_math::ColumnSum(cpu_stream, batch_size, gates_size, grad_gates_ptr,
+                          ctx->Tensor4ArgNameAndIndex("grad_bias", 0)->mut_dptr<T>());
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_LSTM_CELL_GRAD_KERNEL(dtype)                                     \
+  REGISTER_USER_KERNEL("fused_lstm_cell_grad")                                              \
+      .SetCreateFn<CpuFusedLstmCellGradKernel<dtype>>()                                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
+                       && (user_op::HobDataType("grad_hy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("grad_cy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("cx", 0) == GetDataType<dtype>::value)      \
+                       && (user_op::HobDataType("cy", 0) == GetDataType<dtype>::value)      \
+                       && (user_op::HobDataType("workspace", 0) == GetDataType<dtype>::value))
+
+REGISTER_CPU_FUSED_LSTM_CELL_GRAD_KERNEL(float);
+REGISTER_CPU_FUSED_LSTM_CELL_GRAD_KERNEL(double);
+
+}  // namespace
+
+}  // namespace oneflow
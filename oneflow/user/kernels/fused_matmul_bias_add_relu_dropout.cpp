@@ -0,0 +1,119 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/cpu_fused_mlp_util.h"
+#include "oneflow/user/kernels/dropout_kernel.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class CpuFusedMatmulBiasAddReluDropoutKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedMatmulBiasAddReluDropoutKernel() = default;
+  ~CpuFusedMatmulBiasAddReluDropoutKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    const auto& generator = CHECK_JUST(one::MakeGenerator(DeviceType::kCPU));
+    return std::make_shared<FusedDropoutKernelState>(generator);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    const int32_t weight_size = ctx->input_size("weights");
+    const int32_t bias_size = ctx->input_size("biases");
+    CHECK_EQ(weight_size, bias_size) << "The number of weight and bias is not equal!. ";
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const bool skip_final_activation = ctx->Attr<bool>("skip_final_activation");
+    const std::vector<float> dropout_rate_list = ctx->Attr<std::vector<float>>("dropout_rate_list");
+
+    auto* fused_dropout_kernel_state = dynamic_cast<FusedDropoutKernelState*>(state);
+    CHECK_NOTNULL(fused_dropout_kernel_state);
+    const auto& generator = fused_dropout_kernel_state->generator();
+    CHECK_NOTNULL(generator);
+    std::shared_ptr<one::CPUGeneratorImpl> cpu_generator =
+        CHECK_JUST(generator->Get<one::CPUGeneratorImpl>());
+    std::mt19937* engine = &cpu_generator->engine();
+
+    auto matmul =
+        cpu_fused_mlp::NewMatmulPrimitive(x->data_type(), ep::primitive::BlasTransposeType::N,
+                                          ep::primitive::BlasTransposeType::T);
+    CHECK(matmul);
+
+    const int64_t m = x->shape().At(0);
+    int64_t k = x->shape().At(1);
+    const T* in_ptr = x->dptr<T>();
+    for (int32_t idx = 0; idx < weight_size; idx++) {
+      const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weights", idx);
+      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("biases", idx);
+      user_op::Tensor* cublas_aux = ctx->Tensor4ArgNameAndIndex("cublas_aux", idx);
+      const int64_t n = weight->shape().At(0);
+      const int64_t aux_words = cublas_aux->shape().At(1);
+      const bool is_last_layer = idx == weight_size - 1;
+      T* y_ptr = is_last_layer ? ctx->Tensor4ArgNameAndIndex("out", 0)->mut_dptr<T>()
+                               : ctx->Tensor4ArgNameAndIndex("hidden", idx)->mut_dptr<T>();
+      int32_t* aux_ptr = cublas_aux->mut_dptr<int32_t>();
+      const float rate = dropout_rate_list.at(idx);
+      float scale = 0.0f;
+      if (rate < 1.0f) { scale = 1.0f / (1.0f - rate); }
+      const bool relu = !is_last_layer || !skip_final_activation;
+
+      // With rate 0 every element is kept, only the relu bits go to the aux.
+      if (relu && rate == 0.0f) {
+        cpu_fused_mlp::DenseForward<T, /*relu=*/true, /*dropout=*/false>(
+            cpu_stream, matmul.get(), m, n, k, aux_words, in_ptr, weight->dptr<T>(),
+            bias->dptr<T>(), rate, scale, engine, y_ptr, aux_ptr);
+      } else if (relu) {
+        cpu_fused_mlp::DenseForward<T, /*relu=*/true, /*dropout=*/true>(
+            cpu_stream, matmul.get(), m, n, k, aux_words, in_ptr, weight->dptr<T>(),
+            bias->dptr<T>(), rate, scale, engine, y_ptr, aux_ptr);
+      } else if (rate == 0.0f) {
+        // It's last layer and dropout_rate is 0.0f, the aux is not used by the backward.
+        cpu_fused_mlp::DenseForward<T, /*relu=*/false, /*dropout=*/false>(
+            cpu_stream, matmul.get(), m, n, k, aux_words, in_ptr, weight->dptr<T>(),
+            bias->dptr<T>(), rate, scale, engine, y_ptr, /*aux=*/nullptr);
+      } else {
+        // skip_final_activation but need dropout.
+        cpu_fused_mlp::DenseForward<T, /*relu=*/false, /*dropout=*/true>(
+            cpu_stream, matmul.get(), m, n, k, aux_words, in_ptr, weight->dptr<T>(),
+            bias->dptr<T>(), rate, scale, engine, y_ptr, aux_ptr);
+      }
+      // Set relu_droput_out as next layer's input.
+      in_ptr = y_ptr;
+      k = n;
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_MATMUL_BIAS_ADD_RELU_DROPOUT_KERNEL(dtype) \
+  REGISTER_USER_KERNEL("fused_matmul_bias_add_relu_dropout")          \
+      .SetCreateFn<CpuFusedMatmulBiasAddReluDropoutKernel<dtype>>()   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_FUSED_MATMUL_BIAS_ADD_RELU_DROPOUT_KERNEL(float)
+REGISTER_CPU_FUSED_MATMUL_BIAS_ADD_RELU_DROPOUT_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
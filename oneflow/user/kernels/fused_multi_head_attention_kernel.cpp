@@ -0,0 +1,399 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// Flash-style attention, a tile of query rows is swept over blocks of keys with an online softmax
+// so the score tile and the key/value block stay in cache, the (Sq, Sk) score matrix is never
+// materialized. The backward recomputes the probabilities from the saved log-sum-exp.
+constexpr int64_t kQueryBlockSize = 32;
+constexpr int64_t kKeyBlockSize = 64;
+
+template<typename T>
+struct AttentionParams {
+  const T* query;
+  const T* key;
+  const T* value;
+  const bool* key_padding_mask;
+  const bool* dropout_mask;
+  int64_t num_heads;
+  int64_t heads_per_batch;
+  int64_t query_seq_len;
+  int64_t key_seq_len;
+  int64_t head_size;
+  int64_t value_head_size;
+  T scale;
+  bool causal;
+  T dropout_scale;
+};
+
+template<typename T>
+AttentionParams<T> MakeAttentionParams(user_op::KernelComputeContext* ctx) {
+  const user_op::Tensor* query = ctx->Tensor4ArgNameAndIndex("query", 0);
+  const user_op::Tensor* key = ctx->Tensor4ArgNameAndIndex("key", 0);
+  const user_op::Tensor* value = ctx->Tensor4ArgNameAndIndex("value", 0);
+  const int64_t num_axes = query->shape().NumAxes();
+  AttentionParams<T> params;
+  params.query = query->dptr<T>();
+  params.key = key->dptr<T>();
+  params.value = value->dptr<T>();
+  params.key_padding_mask = ctx->has_input("key_padding_mask", 0)
+                                ? ctx->Tensor4ArgNameAndIndex("key_padding_mask", 0)->dptr<bool>()
+                                : nullptr;
+  params.dropout_mask = ctx->has_input("dropout_mask", 0)
+                            ? ctx->Tensor4ArgNameAndIndex("dropout_mask", 0)->dptr<bool>()
+                            : nullptr;
+  params.num_heads = query->shape().Count(0, num_axes - 2);
+  params.heads_per_batch = params.num_heads / query->shape().At(0);
+  params.query_seq_len = query->shape().At(num_axes - 2);
+  params.key_seq_len = key->shape().At(num_axes - 2);
+  params.head_size = query->shape().At(num_axes - 1);
+  params.value_head_size = value->shape().At(num_axes - 1);
+  params.scale = static_cast<T>(ctx->Attr<float>("scale"));
+  params.causal = ctx->Attr<bool>("causal");
+  params.dropout_scale = static_cast<T>(ctx->Attr<float>("dropout_scale"));
+  return params;
+}
+
+// The causal mask is aligned to the bottom right, query row i attends to the keys up to
+// i + Sk - Sq, which is the usual convention when the queries are the tail of the keys.
+template<typename T>
+int64_t KeyEnd(const AttentionParams<T>& params, int64_t i) {
+  if (!params.causal) { return params.key_seq_len; }
+  return std::max<int64_t>(
+      std::min<int64_t>(i + params.key_seq_len - params.query_seq_len + 1, params.key_seq_len), 0);
+}
+
+// Scaled scores of query row i against the keys [key_begin, key_end), -inf for the masked keys.
+template<typename T>
+void ComputeScores(const AttentionParams<T>& params, int64_t n, int64_t i, int64_t key_begin,
+                   int64_t key_end, T* scores) {
+  const int64_t head_size = params.head_size;
+  const T* q = params.query + (n * params.query_seq_len + i) * head_size;
+  const T* k = params.key + n * params.key_seq_len * head_size;
+  const bool* padding_mask =
+      params.key_padding_mask == nullptr
+          ? nullptr
+          : params.key_padding_mask + (n / params.heads_per_batch) * params.key_seq_len;
+  const int64_t valid_end = KeyEnd(params, i);
+  for (int64_t j = key_begin; j < key_end; ++j) {
+    if (j >= valid_end || (padding_mask != nullptr && !padding_mask[j])) {
+      scores[j - key_begin] = -std::numeric_limits<T>::infinity();
+      continue;
+    }
+    const T* k_row = k + j * head_size;
+    T sum = 0;
+    for (int64_t d = 0; d < head_size; ++d) { sum += q[d] * k_row[d]; }
+    scores[j - key_begin] = sum * params.scale;
+  }
+}
+
+template<typename T>
+const bool* DropoutMaskRow(const AttentionParams<T>& params, int64_t n, int64_t i) {
+  if (params.dropout_mask == nullptr) { return nullptr; }
+  return params.dropout_mask + (n * params.query_seq_len + i) * params.key_seq_len;
+}
+
+template<typename T>
+void Axpy(int64_t size, T alpha, const T* x, T* y) {
+  for (int64_t d = 0; d < size; ++d) { y[d] += alpha * x[d]; }
+}
+
+template<typename T>
+void AttentionForwardBlock(const AttentionParams<T>& params, int64_t n, int64_t query_begin,
+                           int64_t query_end, T* out, T* softmax_lse, T* acc, T* row_max,
+                           T* row_sum, T* scores) {
+  const int64_t value_head_size = params.value_head_size;
+  const int64_t rows = query_end - query_begin;
+  const T* v = params.value + n * params.key_seq_len * value_head_size;
+  std::fill(acc, acc + rows * value_head_size, static_cast<T>(0));
+  std::fill(row_max, row_max + rows, -std::numeric_limits<T>::infinity());
+  std::fill(row_sum, row_sum + rows, static_cast<T>(0));
+  const int64_t block_key_end = KeyEnd(params, query_end - 1);
+  for (int64_t key_begin = 0; key_begin < block_key_end; key_begin += kKeyBlockSize) {
+    const int64_t key_end = std::min(key_begin + kKeyBlockSize, block_key_end);
+    for (int64_t r = 0; r < rows; ++r) {
+      const int64_t i = query_begin + r;
+      ComputeScores(params, n, i, key_begin, key_end, scores);
+      T block_max = -std::numeric_limits<T>::infinity();
+      for (int64_t j = 0; j < key_end - key_begin; ++j) {
+        block_max = std::max(block_max, scores[j]);
+      }
+      if (block_max == -std::numeric_limits<T>::infinity()) { continue; }
+      T* acc_row = acc + r * value_head_size;
+      const T new_max = std::max(row_max[r], block_max);
+      if (new_max != row_max[r]) {
+        const T correction = std::exp(row_max[r] - new_max);
+        row_sum[r] *= correction;
+        for (int64_t d = 0; d < value_head_size; ++d) { acc_row[d] *= correction; }
+        row_max[r] = new_max;
+      }
+      const bool* keep = DropoutMaskRow(params, n, i);
+      for (int64_t j = key_begin; j < key_end; ++j) {
+        const T p = std::exp(scores[j - key_begin] - new_max);
+        row_sum[r] += p;
+        if (keep != nullptr) {
+          if (!keep[j]) { continue; }
+          Axpy(value_head_size, p * params.dropout_scale, v + j * value_head_size, acc_row);
+        } else {
+          Axpy(value_head_size, p, v + j * value_head_size, acc_row);
+        }
+      }
+    }
+  }
+  for (int64_t r = 0; r < rows; ++r) {
+    const int64_t i = query_begin + r;
+    T* out_row = out + (n * params.query_seq_len + i) * value_head_size;
+    const T* acc_row = acc + r * value_head_size;
+    if (row_sum[r] == 0) {
+      // All the keys are masked, the output is zero rather than NaN.
+      std::fill(out_row, out_row + value_head_size, static_cast<T>(0));
+      softmax_lse[n * params.query_seq_len + i] = -std::numeric_limits<T>::infinity();
+    } else {
+      const T inv_sum = static_cast<T>(1) / row_sum[r];
+      for (int64_t d = 0; d < value_head_size; ++d) { out_row[d] = acc_row[d] * inv_sum; }
+      softmax_lse[n * params.query_seq_len + i] = row_max[r] + std::log(row_sum[r]);
+    }
+  }
+}
+
+// For query row i and the keys [key_begin, key_end) computes the dropped probabilities, which
+// scale the output grad into the value grad, and the score grads, both zero for masked keys.
+template<typename T>
+void ComputeGradRow(const AttentionParams<T>& params, int64_t n, int64_t i, int64_t key_begin,
+                    int64_t key_end, T lse, T delta, const T* out_grad_row, T* probs,
+                    T* score_grads) {
+  const int64_t value_head_size = params.value_head_size;
+  const T* v = params.value + n * params.key_seq_len * value_head_size;
+  const bool* keep = DropoutMaskRow(params, n, i);
+  ComputeScores(params, n, i, key_begin, key_end, probs);
+  for (int64_t j = key_begin; j < key_end; ++j) {
+    const int64_t c = j - key_begin;
+    if (probs[c] == -std::numeric_limits<T>::infinity()) {
+      probs[c] = 0;
+      score_grads[c] = 0;
+      continue;
+    }
+    const T p = std::exp(probs[c] - lse);
+    T prob_grad = 0;
+    if (keep == nullptr || keep[j]) {
+      const T* v_row = v + j * value_head_size;
+      for (int64_t d = 0; d < value_head_size; ++d) { prob_grad += out_grad_row[d] * v_row[d]; }
+    }
+    if (keep != nullptr) {
+      prob_grad *= params.dropout_scale;
+      probs[c] = keep[j] ? p * params.dropout_scale : static_cast<T>(0);
+    } else {
+      probs[c] = p;
+    }
+    score_grads[c] = p * (prob_grad - delta) * params.scale;
+  }
+}
+
+template<typename T>
+class FusedMultiHeadAttentionCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedMultiHeadAttentionCpuKernel() = default;
+  ~FusedMultiHeadAttentionCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* softmax_lse = ctx->Tensor4ArgNameAndIndex("softmax_lse", 0);
+    const AttentionParams<T> params = MakeAttentionParams<T>(ctx);
+    if (params.num_heads == 0 || params.query_seq_len == 0) { return; }
+    const int64_t num_query_blocks = (params.query_seq_len + kQueryBlockSize - 1) / kQueryBlockSize;
+    T* out_ptr = out->mut_dptr<T>();
+    T* softmax_lse_ptr = softmax_lse->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, params.num_heads * num_query_blocks,
+        [&](int64_t begin, int64_t end) {
+          std::vector<T> acc(kQueryBlockSize * params.value_head_size);
+          std::vector<T> row_max(kQueryBlockSize);
+          std::vector<T> row_sum(kQueryBlockSize);
+          std::vector<T> scores(kKeyBlockSize);
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t n = task / num_query_blocks;
+            const int64_t query_begin = (task % num_query_blocks) * kQueryBlockSize;
+            const int64_t query_end = std::min(query_begin + kQueryBlockSize, params.query_seq_len);
+            AttentionForwardBlock(params, n, query_begin, query_end, out_ptr, softmax_lse_ptr,
+                                  acc.data(), row_max.data(), row_sum.data(), scores.data());
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedMultiHeadAttentionGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedMultiHeadAttentionGradCpuKernel() = default;
+  ~FusedMultiHeadAttentionGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const user_op::Tensor* softmax_lse = ctx->Tensor4ArgNameAndIndex("softmax_lse", 0);
+    const user_op::Tensor* out_grad = ctx->Tensor4ArgNameAndIndex("out_grad", 0);
+    user_op::Tensor* query_grad = ctx->Tensor4ArgNameAndIndex("query_grad", 0);
+    user_op::Tensor* key_grad = ctx->Tensor4ArgNameAndIndex("key_grad", 0);
+    user_op::Tensor* value_grad = ctx->Tensor4ArgNameAndIndex("value_grad", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const AttentionParams<T> params = MakeAttentionParams<T>(ctx);
+    const int64_t num_heads = params.num_heads;
+    const int64_t query_seq_len = params.query_seq_len;
+    const int64_t key_seq_len = params.key_seq_len;
+    const int64_t head_size = params.head_size;
+    const int64_t value_head_size = params.value_head_size;
+    const T* out_ptr = out->dptr<T>();
+    const T* lse_ptr = softmax_lse->dptr<T>();
+    const T* out_grad_ptr = out_grad->dptr<T>();
+    T* query_grad_ptr = query_grad->mut_dptr<T>();
+    T* key_grad_ptr = key_grad->mut_dptr<T>();
+    T* value_grad_ptr = value_grad->mut_dptr<T>();
+    // delta_i = rowsum(out_grad * out) = sum_j p_ij * d(p_ij), shared by all the key blocks.
+    T* delta = tmp_buffer->mut_dptr<T>();
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const int64_t num_rows = num_heads * query_seq_len;
+    cpu_stream->ParallelFor(
+        0, num_rows,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            const T* out_row = out_ptr + row * value_head_size;
+            const T* out_grad_row = out_grad_ptr + row * value_head_size;
+            T sum = 0;
+            for (int64_t d = 0; d < value_head_size; ++d) { sum += out_row[d] * out_grad_row[d]; }
+            delta[row] = sum;
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(value_head_size));
+
+    // The key and value grads, each task owns a block of keys and sweeps the query rows.
+    const int64_t num_key_blocks = (key_seq_len + kKeyBlockSize - 1) / kKeyBlockSize;
+    cpu_stream->ParallelFor(
+        0, num_heads * num_key_blocks,
+        [&](int64_t begin, int64_t end) {
+          std::vector<T> key_acc(kKeyBlockSize * head_size);
+          std::vector<T> value_acc(kKeyBlockSize * value_head_size);
+          std::vector<T> probs(kKeyBlockSize);
+          std::vector<T> score_grads(kKeyBlockSize);
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t n = task / num_key_blocks;
+            const int64_t key_begin = (task % num_key_blocks) * kKeyBlockSize;
+            const int64_t key_end = std::min(key_begin + kKeyBlockSize, key_seq_len);
+            const int64_t cols = key_end - key_begin;
+            std::fill(key_acc.begin(), key_acc.end(), static_cast<T>(0));
+            std::fill(value_acc.begin(), value_acc.end(), static_cast<T>(0));
+            const int64_t query_begin =
+                params.causal ? std::max<int64_t>(key_begin - (key_seq_len - query_seq_len), 0)
+                              : 0;
+            for (int64_t i = query_begin; i < query_seq_len; ++i) {
+              const int64_t row = n * query_seq_len + i;
+              const T* out_grad_row = out_grad_ptr + row * value_head_size;
+              ComputeGradRow(params, n, i, key_begin, key_end, lse_ptr[row], delta[row],
+                             out_grad_row, probs.data(), score_grads.data());
+              const T* q_row = params.query + row * head_size;
+              for (int64_t c = 0; c < cols; ++c) {
+                if (probs[c] != 0) {
+                  Axpy(value_head_size, probs[c], out_grad_row,
+                       value_acc.data() + c * value_head_size);
+                }
+                if (score_grads[c] != 0) {
+                  Axpy(head_size, score_grads[c], q_row, key_acc.data() + c * head_size);
+                }
+              }
+            }
+            std::copy(key_acc.begin(), key_acc.begin() + cols * head_size,
+                      key_grad_ptr + (n * key_seq_len + key_begin) * head_size);
+            std::copy(value_acc.begin(), value_acc.begin() + cols * value_head_size,
+                      value_grad_ptr + (n * key_seq_len + key_begin) * value_head_size);
+          }
+        },
+        1);
+
+    // The query grads, each task owns a tile of query rows and sweeps the key blocks.
+    const int64_t num_query_blocks = (query_seq_len + kQueryBlockSize - 1) / kQueryBlockSize;
+    cpu_stream->ParallelFor(
+        0, num_heads * num_query_blocks,
+        [&](int64_t begin, int64_t end) {
+          std::vector<T> probs(kKeyBlockSize);
+          std::vector<T> score_grads(kKeyBlockSize);
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t n = task / num_query_blocks;
+            const int64_t query_begin = (task % num_query_blocks) * kQueryBlockSize;
+            const int64_t query_end = std::min(query_begin + kQueryBlockSize, query_seq_len);
+            T* query_grad_block = query_grad_ptr + (n * query_seq_len + query_begin) * head_size;
+            std::fill(query_grad_block, query_grad_block + (query_end - query_begin) * head_size,
+                      static_cast<T>(0));
+            const int64_t block_key_end = KeyEnd(params, query_end - 1);
+            const T* k = params.key + n * key_seq_len * head_size;
+            for (int64_t key_begin = 0; key_begin < block_key_end; key_begin += kKeyBlockSize) {
+              const int64_t key_end = std::min(key_begin + kKeyBlockSize, block_key_end);
+              for (int64_t i = query_begin; i < query_end; ++i) {
+                const int64_t row = n * query_seq_len + i;
+                ComputeGradRow(params, n, i, key_begin, key_end, lse_ptr[row], delta[row],
+                               out_grad_ptr + row * value_head_size, probs.data(),
+                               score_grads.data());
+                T* query_grad_row = query_grad_ptr + row * head_size;
+                for (int64_t j = key_begin; j < key_end; ++j) {
+                  const T score_grad = score_grads[j - key_begin];
+                  if (score_grad != 0) {
+                    Axpy(head_size, score_grad, k + j * head_size, query_grad_row);
+                  }
+                }
+              }
+            }
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_FUSED_MULTI_HEAD_ATTENTION_CPU_KERNEL(dtype)         \
+  REGISTER_USER_KERNEL("fused_multi_head_attention")                  \
+      .SetCreateFn<FusedMultiHeadAttentionCpuKernel<dtype>>()         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_MULTI_HEAD_ATTENTION_CPU_KERNEL(float)
+REGISTER_FUSED_MULTI_HEAD_ATTENTION_CPU_KERNEL(double)
+#undef REGISTER_FUSED_MULTI_HEAD_ATTENTION_CPU_KERNEL
+
+#define REGISTER_FUSED_MULTI_HEAD_ATTENTION_GRAD_CPU_KERNEL(dtype)                              \
+  REGISTER_USER_KERNEL("fused_multi_head_attention_grad")                                       \
+      .SetCreateFn<FusedMultiHeadAttentionGradCpuKernel<dtype>>()                               \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("query_grad", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                             \
+        const Shape& softmax_lse_shape = ctx->InputShape("softmax_lse", 0);                     \
+        return softmax_lse_shape.elem_cnt() * sizeof(dtype);                                    \
+      });
+
+REGISTER_FUSED_MULTI_HEAD_ATTENTION_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_MULTI_HEAD_ATTENTION_GRAD_CPU_KERNEL(double)
+#undef REGISTER_FUSED_MULTI_HEAD_ATTENTION_GRAD_CPU_KERNEL
+
+}  // namespace oneflow
@@ -0,0 +1,77 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/cpu_fused_mlp_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class CpuFusedReluDropoutGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedReluDropoutGradKernel() = default;
+  ~CpuFusedReluDropoutGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* mask = ctx->Tensor4ArgNameAndIndex("mask", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const T scale = static_cast<T>(ctx->Attr<float>("scale"));
+
+    constexpr int64_t kBits = cpu_fused_mlp::kAuxBitsPerWord;
+    const int64_t rows = dy->shape().At(0);
+    const int64_t cols = dy->shape().At(1);
+    const int64_t aux_words = mask->shape().At(1);
+    const T* dy_ptr = dy->dptr<T>();
+    const int32_t* mask_ptr = mask->dptr<int32_t>();
+    T* dx_ptr = dx->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, rows,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            for (int64_t col_begin = 0; col_begin < cols; col_begin += kBits) {
+              const uint32_t bits =
+                  static_cast<uint32_t>(mask_ptr[row * aux_words + col_begin / kBits]);
+              const int64_t col_end = std::min(col_begin + kBits, cols);
+              for (int64_t col = col_begin; col < col_end; ++col) {
+                const int64_t offset = row * cols + col;
+                dx_ptr[offset] = ((bits >> (col - col_begin)) & 1U) != 0 ? dy_ptr[offset] * scale
+                                                                         : static_cast<T>(0);
+              }
+            }
+          }
+        },
+        ep::CpuStream::ParallelForRowGrain(cols));
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_RELU_DROPOUT_GRAD_KERNEL(dtype)            \
+  REGISTER_USER_KERNEL("fused_relu_dropout_grad")                     \
+      .SetCreateFn<CpuFusedReluDropoutGradKernel<dtype>>()            \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_FUSED_RELU_DROPOUT_GRAD_KERNEL(float)
+REGISTER_CPU_FUSED_RELU_DROPOUT_GRAD_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
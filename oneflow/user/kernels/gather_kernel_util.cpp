@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/gather_kernel_util.h"
+#include "oneflow/user/kernels/cpu_gather_util.h"
 
 namespace oneflow {
 
@@ -76,19 +77,17 @@ void GatherKernelUtilImpl<DeviceType::kCPU, T, K>::Forward(ep::Stream* stream, c
   const int64_t outer_dim_size = flat_in_shape.At(0);
   const int64_t gather_dim_size = flat_in_shape.At(1);
   const int64_t inner_dim_size = flat_in_shape.At(2);
-  FOR_RANGE(int64_t, outer_idx, 0, outer_dim_size) {
-    FOR_RANGE(int64_t, i, 0, num_indices) {
-      CHECK_GE(indices[i], 0);
-      const int64_t idx = indices[i] - offset;
-      T* to = out + outer_idx * num_indices * inner_dim_size + i * inner_dim_size;
-      if (idx >= 0 && idx < gather_dim_size) {
-        const T* from = in + outer_idx * gather_dim_size * inner_dim_size + idx * inner_dim_size;
-        std::copy(from, from + inner_dim_size, to);
-      } else {
-        std::memset(reinterpret_cast<void*>(to), 0, inner_dim_size * sizeof(T));
-      }
-    }
-  }
+  FOR_RANGE(int64_t, i, 0, num_indices) { CHECK_GE(indices[i], 0); }
+  // rows of out are [outer_idx, i], indices out of [offset, offset + gather_dim_size) give zeros
+  cpu_gather::GatherRows<T>(
+      stream->As<ep::CpuStream>(), outer_dim_size * num_indices, inner_dim_size,
+      [&](int64_t row) -> const T* {
+        const int64_t outer_idx = row / num_indices;
+        const int64_t idx = indices[row % num_indices] - offset;
+        if (idx < 0 || idx >= gather_dim_size) { return nullptr; }
+        return in + (outer_idx * gather_dim_size + idx) * inner_dim_size;
+      },
+      out);
 }
 
 #define INITIATE_GATHER_KERNEL_UTIL_CPU_IMPL(in_type_pair, index_type_pair)              \
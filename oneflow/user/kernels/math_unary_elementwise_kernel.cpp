@@ -15,9 +15,53 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/math_unary_elementwise_func.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
 
 namespace oneflow {
 
+namespace {
+
+// The float forwards computed over whole arrays by the ep vectorized_math functions.
+template<template<typename> class UnaryFunctor, typename T>
+struct VectorizedMathUnaryFunctor {
+  static constexpr bool value = false;
+};
+
+#define SPECIALIZATION_VECTORIZED_MATH_UNARY_FUNCTOR(func_prefix)  \
+  template<>                                                       \
+  struct VectorizedMathUnaryFunctor<func_prefix##Functor, float> { \
+    static constexpr bool value = true;                            \
+    static void Forward(const float* x, float* y, int64_t n) {     \
+      ep::primitive::vectorized_math::func_prefix(x, y, n);        \
+    }                                                              \
+  };
+
+SPECIALIZATION_VECTORIZED_MATH_UNARY_FUNCTOR(Cos)
+SPECIALIZATION_VECTORIZED_MATH_UNARY_FUNCTOR(Erf)
+SPECIALIZATION_VECTORIZED_MATH_UNARY_FUNCTOR(Exp)
+SPECIALIZATION_VECTORIZED_MATH_UNARY_FUNCTOR(Log)
+SPECIALIZATION_VECTORIZED_MATH_UNARY_FUNCTOR(Sigmoid)
+SPECIALIZATION_VECTORIZED_MATH_UNARY_FUNCTOR(Sin)
+
+#undef SPECIALIZATION_VECTORIZED_MATH_UNARY_FUNCTOR
+
+template<template<typename> class UnaryFunctor, typename T>
+void MathUnaryElementwiseForward(ep::Stream* stream, const T* x, T* y, int64_t n,
+                                 std::false_type) {
+  for (int32_t i = 0; i < n; ++i) { y[i] = UnaryFunctor<T>::Forward(x[i]); }
+}
+
+template<template<typename> class UnaryFunctor, typename T>
+void MathUnaryElementwiseForward(ep::Stream* stream, const T* x, T* y, int64_t n,
+                                 std::true_type) {
+  stream->As<ep::CpuStream>()->ParallelFor(0, n, [x, y](int64_t begin, int64_t end) {
+    VectorizedMathUnaryFunctor<UnaryFunctor, T>::Forward(x + begin, y + begin, end - begin);
+  });
+}
+
+}  // namespace
+
 template<template<typename> class UnaryFunctor, typename T>
 class MathUnaryElementwiseCpuKernel final : public user_op::OpKernel {
  public:
@@ -32,7 +76,9 @@ class MathUnaryElementwiseCpuKernel final : public user_op::OpKernel {
     T* y = tensor_y->mut_dptr<T>();
     int64_t n = tensor_x->shape().elem_cnt();
     CHECK_LE(n, GetMaxVal<int32_t>() / 2);
-    for (int32_t i = 0; i < n; ++i) { y[i] = UnaryFunctor<T>::Forward(x[i]); }
+    MathUnaryElementwiseForward<UnaryFunctor, T>(
+        ctx->stream(), x, y, n,
+        std::integral_constant<bool, VectorizedMathUnaryFunctor<UnaryFunctor, T>::value>());
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/memcpy.h"
 #include "oneflow/core/ep/include/primitive/matmul.h"
 #include "oneflow/core/ep/include/primitive/batch_matmul.h"
+#include "oneflow/user/kernels/cpu_packed_weight_util.h"
 
 namespace oneflow {
 
@@ -114,15 +115,129 @@ auto BatchMatmulPrimitiveExists() {
   });
 }
 
-class MatmulKernel final : public user_op::OpKernel, public user_op::CudaGraphSupport {
+auto PackedWeightMatmulSupported() {
+  return hob::make_custom("PackedWeightMatmulSupported", [](const user_op::KernelRegContext& ctx) {
+#ifdef WITH_ONEDNN
+    return ctx.device_type() == DeviceType::kCPU
+           && ctx.TensorDesc4ArgNameAndIndex("out", 0)->data_type() == DataType::kFloat;
+#else
+    return false;
+#endif  // WITH_ONEDNN
+  });
+}
+
+#ifdef WITH_ONEDNN
+
+dnnl::memory::desc OneDnnMatrixDesc(int64_t rows, int64_t cols, bool transpose) {
+  const dnnl::memory::dims strides =
+      transpose ? dnnl::memory::dims{1, rows} : dnnl::memory::dims{cols, 1};
+  return dnnl::memory::desc({rows, cols}, dnnl::memory::data_type::f32, strides);
+}
+
+// c = alpha * op(a) * op(b) + beta * c, with `b` as the weight to be packed
+dnnl::primitive NewOneDnnPackedWeightMatmul(dnnl::engine* onednn_engine, int64_t m, int64_t n,
+                                            int64_t k, bool transpose_a, bool transpose_b,
+                                            float alpha, float beta, dnnl::memory::desc* weight_md,
+                                            dnnl::memory::desc* packed_weight_md) {
+  const dnnl::memory::desc a_md = OneDnnMatrixDesc(m, k, transpose_a);
+  const dnnl::memory::desc c_md = OneDnnMatrixDesc(m, n, false);
+  const dnnl::memory::desc any_weight_md({k, n}, dnnl::memory::data_type::f32,
+                                         dnnl::memory::format_tag::any);
+  *weight_md = OneDnnMatrixDesc(k, n, transpose_b);
+  dnnl::primitive_attr attr;
+  if (alpha != 1) { attr.set_output_scales(0, {alpha}); }
+  if (beta != 0) {
+    dnnl::post_ops post_ops;
+    post_ops.append_sum(beta);
+    attr.set_post_ops(post_ops);
+  }
+  dnnl::matmul::primitive_desc matmul_pd(dnnl::matmul::desc(a_md, any_weight_md, c_md), attr,
+                                         *onednn_engine);
+  *packed_weight_md = matmul_pd.weights_desc();
+  return dnnl::matmul(matmul_pd);
+}
+
+class PackedWeightMatmulKernelCache final : public user_op::OpKernelCache {
+ public:
+  PackedWeightMatmulKernelCache() = default;
+  ~PackedWeightMatmulKernelCache() override = default;
+
+  void Launch(ep::Stream* stream, size_t m, size_t n, size_t k, bool transpose_a, bool transpose_b,
+              double alpha, double beta, const void* a, const void* b, void* c) const {
+    int64_t alpha_bits = 0;
+    int64_t beta_bits = 0;
+    std::memcpy(&alpha_bits, &alpha, sizeof(alpha));
+    std::memcpy(&beta_bits, &beta, sizeof(beta));
+    const std::vector<int64_t> key{static_cast<int64_t>(m), static_cast<int64_t>(n),
+                                   static_cast<int64_t>(k), transpose_a, transpose_b, alpha_bits,
+                                   beta_bits};
+    packed_weight_cache_.Launch(
+        stream, key, b,
+        [&](dnnl::engine* onednn_engine, dnnl::memory::desc* weight_md,
+            dnnl::memory::desc* packed_weight_md) {
+          return NewOneDnnPackedWeightMatmul(onednn_engine, m, n, k, transpose_a, transpose_b,
+                                             alpha, beta, weight_md, packed_weight_md);
+        },
+        [&](dnnl::engine* onednn_engine) {
+          return std::unordered_map<int, dnnl::memory>{
+              {DNNL_ARG_SRC, dnnl::memory(OneDnnMatrixDesc(m, k, transpose_a), *onednn_engine,
+                                          const_cast<void*>(a))},
+              {DNNL_ARG_DST, dnnl::memory(OneDnnMatrixDesc(m, n, false), *onednn_engine, c)}};
+        });
+  }
+
+ private:
+  mutable OneDnnPackedWeightCache packed_weight_cache_;
+};
+
+#endif  // WITH_ONEDNN
+
+// Launches c = alpha * op(a) * op(b) + beta * c through the packed-weight cache if there is one,
+// returns false if the caller should fall back to the matmul primitive.
+bool TryLaunchPackedWeightMatmul(const user_op::OpKernelCache* cache, ep::Stream* stream,
+                                 size_t m, size_t n, size_t k, bool transpose_a, bool transpose_b,
+                                 double alpha, double beta, const void* a, const void* b,
+                                 void* c) {
+#ifdef WITH_ONEDNN
+  if (cache != nullptr && CpuPackedWeightCacheEnabled()) {
+    const auto* packed_weight_cache = dynamic_cast<const PackedWeightMatmulKernelCache*>(cache);
+    CHECK_NOTNULL(packed_weight_cache);
+    packed_weight_cache->Launch(stream, m, n, k, transpose_a, transpose_b, alpha, beta, a, b, c);
+    return true;
+  }
+#endif  // WITH_ONEDNN
+  return false;
+}
+
+// Kernel whose weight operand `b` is packed once and reused across calls, see
+// ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE.
+template<typename Kernel>
+class PackedWeightMatmulKernel final : public Kernel {
+ public:
+  PackedWeightMatmulKernel() = default;
+  ~PackedWeightMatmulKernel() override = default;
+
+  void InitOpKernelCacheWithFlags(
+      user_op::KernelCacheContext* ctx, int8_t flag,
+      std::shared_ptr<user_op::OpKernelCache>* cache_ptr) const override {
+#ifdef WITH_ONEDNN
+    // NOTE: the cache validates the problem size and the weight address on every launch, so it is
+    // created only once and kept across shape changes.
+    if (*cache_ptr == nullptr) { *cache_ptr = std::make_shared<PackedWeightMatmulKernelCache>(); }
+#endif  // WITH_ONEDNN
+  }
+};
+
+class MatmulKernel : public user_op::OpKernel, public user_op::CudaGraphSupport {
  public:
   MatmulKernel() = default;
-  ~MatmulKernel() = default;
+  ~MatmulKernel() override = default;
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState*,
+               const user_op::OpKernelCache* cache) const override {
     const auto trans_a = GetBlasTransposeType(ctx, "transpose_a");
     const auto trans_b = GetBlasTransposeType(ctx, "transpose_b");
     const user_op::Tensor* a = ctx->Tensor4ArgNameAndIndex("a", 0);
@@ -148,6 +263,12 @@ class MatmulKernel final : public user_op::OpKernel, public user_op::CudaGraphSu
                      add_to_output->shape().elem_cnt() * GetSizeOfDataType(data_type));
       beta = 1.0;
     }
+    if (TryLaunchPackedWeightMatmul(cache, ctx->stream(), m, n, k,
+                                    trans_a == ep::primitive::BlasTransposeType::T,
+                                    trans_b == ep::primitive::BlasTransposeType::T, alpha, beta,
+                                    a->dptr(), b->dptr(), out->mut_dptr())) {
+      return;
+    }
     auto matmul = NewMatmulPrimitive(ctx);
     CHECK(matmul);
     matmul->Launch(ctx->stream(), m, n, k, alpha, a->dptr(), b->dptr(), beta, out->mut_dptr());
@@ -156,7 +277,20 @@ class MatmulKernel final : public user_op::OpKernel, public user_op::CudaGraphSu
 
 REGISTER_USER_KERNEL("matmul")
     .SetCreateFn<MatmulKernel>()
-    .SetIsMatchedHob(MemcpyPrimitiveExists() && MatmulPrimitiveExists())
+    .SetIsMatchedHob(MemcpyPrimitiveExists() && MatmulPrimitiveExists()
+                     && !PackedWeightMatmulSupported())
+    .SetInplaceProposalFn([](const user_op::InferContext& ctx,
+                             const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {
+      if (ctx.has_input("_add_to_output", 0)) {
+        OF_RETURN_IF_ERROR(AddInplaceArgPairFn("out", 0, "_add_to_output", 0, true));
+      }
+      return Maybe<void>::Ok();
+    });
+
+REGISTER_USER_KERNEL("matmul")
+    .SetCreateFn<PackedWeightMatmulKernel<MatmulKernel>>()
+    .SetIsMatchedHob(MemcpyPrimitiveExists() && MatmulPrimitiveExists()
+                     && PackedWeightMatmulSupported())
     .SetInplaceProposalFn([](const user_op::InferContext& ctx,
                              const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {
       if (ctx.has_input("_add_to_output", 0)) {
@@ -229,15 +363,16 @@ REGISTER_USER_KERNEL("batch_matmul")
     });
 
 // TODO(liujuncheng): fully support
-class BroadcastMatmulKernel final : public user_op::OpKernel, public user_op::CudaGraphSupport {
+class BroadcastMatmulKernel : public user_op::OpKernel, public user_op::CudaGraphSupport {
  public:
   BroadcastMatmulKernel() = default;
-  ~BroadcastMatmulKernel() = default;
+  ~BroadcastMatmulKernel() override = default;
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState*,
+               const user_op::OpKernelCache* cache) const override {
     double alpha = ctx->Attr<double>("alpha");
     bool transpose_a = ctx->Attr<bool>("transpose_a");
     bool transpose_b = ctx->Attr<bool>("transpose_b");
@@ -271,6 +406,10 @@ class BroadcastMatmulKernel final : public user_op::OpKernel, public user_op::Cu
       n = b->shape().At(0);
       CHECK_EQ(k, b->shape().At(1));
     }
+    if (TryLaunchPackedWeightMatmul(cache, ctx->stream(), m, n, k, transpose_a, transpose_b, alpha,
+                                    beta, a->dptr(), b->dptr(), out->mut_dptr())) {
+      return;
+    }
     auto matmul = NewMatmulPrimitive(ctx);
     CHECK(matmul);
     matmul->Launch(ctx->stream(), m, n, k, alpha, a->dptr(), b->dptr(), beta, out->mut_dptr());
@@ -279,7 +418,20 @@ class BroadcastMatmulKernel final : public user_op::OpKernel, public user_op::Cu
 
 REGISTER_USER_KERNEL("broadcast_matmul")
     .SetCreateFn<BroadcastMatmulKernel>()
-    .SetIsMatchedHob(MemcpyPrimitiveExists() && MatmulPrimitiveExists())
+    .SetIsMatchedHob(MemcpyPrimitiveExists() && MatmulPrimitiveExists()
+                     && !PackedWeightMatmulSupported())
+    .SetInplaceProposalFn([](const user_op::InferContext& ctx,
+                             const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {
+      if (ctx.has_input("_add_to_output", 0)) {
+        OF_RETURN_IF_ERROR(AddInplaceArgPairFn("out", 0, "_add_to_output", 0, true));
+      }
+      return Maybe<void>::Ok();
+    });
+
+REGISTER_USER_KERNEL("broadcast_matmul")
+    .SetCreateFn<PackedWeightMatmulKernel<BroadcastMatmulKernel>>()
+    .SetIsMatchedHob(MemcpyPrimitiveExists() && MatmulPrimitiveExists()
+                     && PackedWeightMatmulSupported())
     .SetInplaceProposalFn([](const user_op::InferContext& ctx,
                              const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {
       if (ctx.has_input("_add_to_output", 0)) {
@@ -0,0 +1,131 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int kBlockSize = sizeof(int64_t) * 8;
+
+template<typename T>
+T CeilDiv(T a, T b) {
+  return (a + b - 1) / b;
+}
+
+// Sets bit j of the mask when the IoU of box against the j-th box of the block, stored in the
+// x0, y0, x1, y1 planes, is over the threshold. The plane layout lets the IoU loop vectorize.
+template<typename T>
+int64_t SuppressionBits(const T* box, const T (&block)[4][kBlockSize], int start, int size,
+                        float iou_threshold) {
+  const T area = (box[2] - box[0]) * (box[3] - box[1]);
+  bool suppressed[kBlockSize] = {};
+  for (int j = start; j < size; ++j) {
+    const T inter_w = std::max<T>(std::min(box[2], block[2][j]) - std::max(box[0], block[0][j]), 0);
+    const T inter_h = std::max<T>(std::min(box[3], block[3][j]) - std::max(box[1], block[1][j]), 0);
+    const T inter = inter_w * inter_h;
+    const T block_area = (block[2][j] - block[0][j]) * (block[3][j] - block[1][j]);
+    suppressed[j] = inter / (area + block_area - inter) > iou_threshold;
+  }
+  int64_t bits = 0;
+  for (int j = start; j < size; ++j) {
+    if (suppressed[j]) { bits |= static_cast<int64_t>(1) << j; }
+  }
+  return bits;
+}
+
+template<typename T>
+class NmsCpuKernel final : public user_op::OpKernel {
+ public:
+  NmsCpuKernel() = default;
+  ~NmsCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* boxes_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
+    user_op::Tensor* keep_blob = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_blob = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const T* boxes = boxes_blob->dptr<T>();
+    int8_t* keep = keep_blob->mut_dptr<int8_t>();
+    int64_t* suppression_mask = tmp_blob->mut_dptr<int64_t>();
+
+    const int num_boxes = boxes_blob->shape().At(0);
+    int num_keep = ctx->Attr<int>("keep_n");
+    if (num_keep <= 0 || num_keep > num_boxes) { num_keep = num_boxes; }
+    const int num_blocks = CeilDiv<int>(num_boxes, kBlockSize);
+    const float iou_threshold = ctx->Attr<float>("iou_threshold");
+    std::memset(keep, 0, num_boxes * sizeof(int8_t));
+    if (num_boxes == 0) { return; }
+
+    // Same bitmask matrix as the CUDA kernel, bit j of suppression_mask[i * num_blocks + col] is
+    // set when box i suppresses box col * kBlockSize + j. Only the blocks from the diagonal on are
+    // computed and read by the scan, the threads own disjoint row blocks.
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, num_blocks,
+        [&](int64_t begin, int64_t end) {
+          T block[4][kBlockSize];
+          for (int64_t row = begin; row < end; ++row) {
+            const int row_size = std::min<int>(num_boxes - row * kBlockSize, kBlockSize);
+            for (int64_t col = row; col < num_blocks; ++col) {
+              const int col_size = std::min<int>(num_boxes - col * kBlockSize, kBlockSize);
+              const T* col_boxes = boxes + col * kBlockSize * 4;
+              for (int j = 0; j < col_size; ++j) {
+                for (int k = 0; k < 4; ++k) { block[k][j] = col_boxes[j * 4 + k]; }
+              }
+              for (int i = 0; i < row_size; ++i) {
+                const int64_t box_idx = row * kBlockSize + i;
+                const int start = (row == col) ? i + 1 : 0;
+                suppression_mask[box_idx * num_blocks + col] =
+                    SuppressionBits(boxes + box_idx * 4, block, start, col_size, iou_threshold);
+              }
+            }
+          }
+        },
+        1);
+
+    std::vector<int64_t> removed(num_blocks, 0);
+    for (int i = 0; i < num_boxes && num_keep > 0; ++i) {
+      if (removed[i / kBlockSize] & (static_cast<int64_t>(1) << (i % kBlockSize))) { continue; }
+      keep[i] = 1;
+      num_keep -= 1;
+      const int64_t* mask = suppression_mask + static_cast<int64_t>(i) * num_blocks;
+      for (int col = i / kBlockSize; col < num_blocks; ++col) { removed[col] |= mask[col]; }
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_NMS_CPU_KERNEL(dtype)                                                  \
+  REGISTER_USER_KERNEL("nms")                                                           \
+      .SetCreateFn<NmsCpuKernel<dtype>>()                                               \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("out", 0) == DataType::kInt8)           \
+                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                               \
+        Shape* in_shape = ctx->Shape4ArgNameAndIndex("in", 0);                          \
+        int64_t num_boxes = in_shape->At(0);                                            \
+        int64_t blocks = CeilDiv<int64_t>(num_boxes, kBlockSize);                       \
+        return num_boxes * blocks * sizeof(int64_t);                                    \
+      });
+
+REGISTER_NMS_CPU_KERNEL(float)
+REGISTER_NMS_CPU_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,289 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+const T* OptionalScalarInputPtr(user_op::KernelComputeContext* ctx, const std::string& arg_name) {
+  if (!ctx->has_input(arg_name, 0)) { return nullptr; }
+  const user_op::Tensor* tensor = ctx->Tensor4ArgNameAndIndex(arg_name, 0);
+  CHECK_EQ(tensor->data_type(), GetDataType<T>::value);
+  CHECK_EQ(tensor->shape().elem_cnt(), 1);
+  return tensor->dptr<T>();
+}
+
+template<typename T>
+T GetUpdateScale(double scale, const T* scale_by_ptr, const T* down_scale_by_ptr) {
+  T scale_val = static_cast<T>(scale);
+  if (scale_by_ptr != nullptr) { scale_val *= *scale_by_ptr; }
+  if (down_scale_by_ptr != nullptr) { scale_val /= *down_scale_by_ptr; }
+  return scale_val;
+}
+
+// Every unique id owns a line [model | state_0 | state_1 ...] of line_size values, each part having
+// embedding_size values. The lines are copied into updated_unique_embeddings and updated in place
+// one block of lines per task, update_fn(model_diff, model) updating the model element and the
+// elements of its states embedding_size, 2 * embedding_size ... after it.
+template<typename T, typename G, typename IDX, typename UpdateFn>
+void UpdateEmbeddingLines(user_op::KernelComputeContext* ctx, int64_t line_size,
+                          int64_t embedding_size, const UpdateFn& update_fn) {
+  const user_op::Tensor* num_unique_ids = ctx->Tensor4ArgNameAndIndex("num_unique_ids", 0);
+  const user_op::Tensor* unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0);
+  const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+  user_op::Tensor* updated_unique_embeddings =
+      ctx->Tensor4ArgNameAndIndex("updated_unique_embeddings", 0);
+  const int64_t* skip_if_ptr = OptionalScalarInputPtr<int64_t>(ctx, "skip_if");
+  const bool skip = (skip_if_ptr != nullptr && *skip_if_ptr != 0);
+  const int64_t num_lines = *reinterpret_cast<const IDX*>(num_unique_ids->dptr());
+  CHECK_LE(num_lines, unique_embeddings->shape().At(0));
+  const G* model_diff = embedding_grad->dptr<G>();
+  const T* unique_values = unique_embeddings->dptr<T>();
+  T* updated_unique_values = updated_unique_embeddings->mut_dptr<T>();
+  ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+      0, num_lines,
+      [&](int64_t line_begin, int64_t line_end) {
+        std::copy(unique_values + line_begin * line_size, unique_values + line_end * line_size,
+                  updated_unique_values + line_begin * line_size);
+        if (skip) { return; }
+        for (int64_t line = line_begin; line < line_end; ++line) {
+          const G* line_diff = model_diff + line * embedding_size;
+          T* line_model = updated_unique_values + line * line_size;
+          for (int64_t col = 0; col < embedding_size; ++col) {
+            update_fn(line_diff + col, line_model + col);
+          }
+        }
+      },
+      ep::CpuStream::ParallelForRowGrain(line_size));
+}
+
+template<typename T, typename G, typename IDX>
+class SgdEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  SgdEmbeddingUpdateKernel() = default;
+  ~SgdEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    CHECK_EQ(unique_embeddings->shape().NumAxes(), 2);
+    CHECK_EQ(embedding_grad->shape().NumAxes(), 2);
+    const int64_t line_size = unique_embeddings->shape().At(1);
+    const int64_t embedding_size = embedding_grad->shape().At(1);
+    CHECK_EQ(line_size, embedding_size);
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    const T scale = GetUpdateScale<T>(ctx->Attr<double>("scale"),
+                                      OptionalScalarInputPtr<T>(ctx, "scale_by_tensor"),
+                                      OptionalScalarInputPtr<T>(ctx, "down_scale_by_tensor"));
+    const float learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+    UpdateEmbeddingLines<T, G, IDX>(
+        ctx, line_size, embedding_size, [&](const G* model_diff, T* model) {
+          SGDUpdateFunctor<T, G>()(model_diff, model, scale, l1, l2, weight_decay, learning_rate);
+        });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename G, typename IDX>
+class MomentumEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  MomentumEmbeddingUpdateKernel() = default;
+  ~MomentumEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    CHECK_EQ(unique_embeddings->shape().NumAxes(), 2);
+    CHECK_EQ(embedding_grad->shape().NumAxes(), 2);
+    const int64_t line_size = unique_embeddings->shape().At(1);
+    const int64_t embedding_size = embedding_grad->shape().At(1);
+    CHECK_EQ(line_size, embedding_size * 2);
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    const float beta = ctx->Attr<float>("beta");
+    const T scale = GetUpdateScale<T>(ctx->Attr<double>("scale"),
+                                      OptionalScalarInputPtr<T>(ctx, "scale_by_tensor"),
+                                      OptionalScalarInputPtr<T>(ctx, "down_scale_by_tensor"));
+    const float learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+    UpdateEmbeddingLines<T, G, IDX>(
+        ctx, line_size, embedding_size, [&](const G* model_diff, T* model) {
+          MomentumUpdateFunctor<T, G>()(model_diff, model, model + embedding_size, scale, l1, l2,
+                                        beta, weight_decay, learning_rate);
+        });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename G, typename IDX>
+class AdamEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  AdamEmbeddingUpdateKernel() = default;
+  ~AdamEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    CHECK_EQ(unique_embeddings->shape().NumAxes(), 2);
+    CHECK_EQ(embedding_grad->shape().NumAxes(), 2);
+    const int64_t line_size = unique_embeddings->shape().At(1);
+    const int64_t embedding_size = embedding_grad->shape().At(1);
+    CHECK_EQ(line_size, embedding_size * 3);
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    const float beta1 = ctx->Attr<float>("beta1");
+    const float beta2 = ctx->Attr<float>("beta2");
+    const float epsilon = ctx->Attr<float>("epsilon");
+    const T scale = GetUpdateScale<T>(ctx->Attr<double>("scale"),
+                                      OptionalScalarInputPtr<T>(ctx, "scale_by_tensor"),
+                                      OptionalScalarInputPtr<T>(ctx, "down_scale_by_tensor"));
+    const float learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+    const float* bias_correction1_ptr = OptionalScalarInputPtr<float>(ctx, "bias_correction1");
+    const float* bias_correction2_ptr = OptionalScalarInputPtr<float>(ctx, "bias_correction2");
+    const float bias_correction1 = bias_correction1_ptr != nullptr ? *bias_correction1_ptr : 1.0;
+    const float bias_correction2 = bias_correction2_ptr != nullptr ? *bias_correction2_ptr : 1.0;
+    UpdateEmbeddingLines<T, G, IDX>(
+        ctx, line_size, embedding_size, [&](const G* model_diff, T* model) {
+          AdamUpdateFunctor<T, G>()(model_diff, model, model + embedding_size,
+                                    model + 2 * embedding_size, nullptr, scale, l1, l2, beta1,
+                                    beta2, epsilon, weight_decay, false, bias_correction1,
+                                    bias_correction2, learning_rate);
+        });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename G, typename IDX>
+class AdagradEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  AdagradEmbeddingUpdateKernel() = default;
+  ~AdagradEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    CHECK_EQ(unique_embeddings->shape().NumAxes(), 2);
+    CHECK_EQ(embedding_grad->shape().NumAxes(), 2);
+    const int64_t line_size = unique_embeddings->shape().At(1);
+    const int64_t embedding_size = embedding_grad->shape().At(1);
+    CHECK_EQ(line_size, embedding_size * 2);
+    const float l1 = ctx->Attr<float>("l1");
+    const float l2 = ctx->Attr<float>("l2");
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    const float lr_decay = ctx->Attr<float>("lr_decay");
+    const float epsilon = ctx->Attr<float>("epsilon");
+    const T scale = GetUpdateScale<T>(ctx->Attr<double>("scale"),
+                                      OptionalScalarInputPtr<T>(ctx, "scale_by_tensor"),
+                                      OptionalScalarInputPtr<T>(ctx, "down_scale_by_tensor"));
+    const int64_t train_step = *ctx->Tensor4ArgNameAndIndex("train_step", 0)->dptr<int64_t>();
+    const float learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>()
+                                / (1 + train_step * lr_decay);
+    UpdateEmbeddingLines<T, G, IDX>(
+        ctx, line_size, embedding_size, [&](const G* model_diff, T* model) {
+          AdagradUpdateFunctor<T, G>()(model_diff, model, model + embedding_size, scale, l1, l2,
+                                       epsilon, weight_decay, learning_rate);
+        });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename G, typename IDX>
+class FtrlEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  FtrlEmbeddingUpdateKernel() = default;
+  ~FtrlEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    CHECK_EQ(unique_embeddings->shape().NumAxes(), 2)
+        << "The NumAxes of unique_embedding should be equal to 2. ";
+    CHECK_EQ(embedding_grad->shape().NumAxes(), 2)
+        << "The NumAxes of embedding_grad should be equal to 2. ";
+    const int64_t line_size = unique_embeddings->shape().At(1);
+    const int64_t embedding_size = embedding_grad->shape().At(1);
+    CHECK_EQ(line_size, embedding_size * 3)
+        << "The line_size should be equal to 3 x embedding_size. ";
+    const float weight_decay = ctx->Attr<float>("weight_decay");
+    CHECK_EQ(weight_decay, static_cast<float>(0.0))
+        << "Currently not support for setting weight decay. ";
+    const float lr_power = ctx->Attr<float>("lr_power");
+    const float lambda1 = ctx->Attr<float>("lambda1");
+    const float lambda2 = ctx->Attr<float>("lambda2");
+    const float beta = ctx->Attr<float>("beta");
+    const T scale = GetUpdateScale<T>(ctx->Attr<double>("scale"), nullptr,
+                                      OptionalScalarInputPtr<T>(ctx, "down_scale_by_tensor"));
+    const float learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+    UpdateEmbeddingLines<T, G, IDX>(
+        ctx, line_size, embedding_size, [&](const G* model_diff, T* model) {
+          FtrlUpdateFunctor<T, G>()(model_diff, model, model + embedding_size,
+                                    model + 2 * embedding_size, scale, 0.0, 0.0, lr_power, lambda1,
+                                    lambda2, beta, weight_decay, learning_rate);
+        });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define IDX_DATA_TYPE_SEQ                           \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_EMBEDDING_UPDATE_KERNEL(op_type_name, kernel, t_dtype_pair, g_type_pair, \
+                                             idx_dtype_pair)                                  \
+  REGISTER_USER_KERNEL(op_type_name)                                                          \
+      .SetCreateFn<kernel<OF_PP_PAIR_FIRST(t_dtype_pair), OF_PP_PAIR_FIRST(g_type_pair),      \
+                          OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                                \
+      .SetIsMatchedHob(                                                                       \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                      \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)) \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(g_type_pair))    \
+          && (user_op::HobDataType("unique_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)));
+
+#define REGISTER_CPU_EMBEDDING_UPDATE_KERNELS(t_dtype_pair, g_type_pair, idx_dtype_pair)           \
+  REGISTER_CPU_EMBEDDING_UPDATE_KERNEL("sgd_embedding_update", SgdEmbeddingUpdateKernel,           \
+                                       t_dtype_pair, g_type_pair, idx_dtype_pair)                  \
+  REGISTER_CPU_EMBEDDING_UPDATE_KERNEL("momentum_embedding_update", MomentumEmbeddingUpdateKernel, \
+                                       t_dtype_pair, g_type_pair, idx_dtype_pair)                  \
+  REGISTER_CPU_EMBEDDING_UPDATE_KERNEL("adam_embedding_update", AdamEmbeddingUpdateKernel,         \
+                                       t_dtype_pair, g_type_pair, idx_dtype_pair)                  \
+  REGISTER_CPU_EMBEDDING_UPDATE_KERNEL("adagrad_embedding_update", AdagradEmbeddingUpdateKernel,   \
+                                       t_dtype_pair, g_type_pair, idx_dtype_pair)                  \
+  REGISTER_CPU_EMBEDDING_UPDATE_KERNEL("ftrl_embedding_update", FtrlEmbeddingUpdateKernel,         \
+                                       t_dtype_pair, g_type_pair, idx_dtype_pair)
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_UPDATE_KERNELS, FLOATING_DATA_TYPE_SEQ,
+                                 FLOATING_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,277 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// The four neighbours of one sampling point and their bilinear weights, the weights are zero for
+// the points outside of the feature map.
+template<typename T>
+struct BilinearWeights {
+  int64_t q11;
+  int64_t q21;
+  int64_t q12;
+  int64_t q22;
+  T w11;
+  T w21;
+  T w12;
+  T w22;
+};
+
+template<typename T>
+BilinearWeights<T> ComputeBilinearWeights(const int64_t height, const int64_t width, T y, T x) {
+  BilinearWeights<T> weights{};
+  if (y < -1.0 || y > height || x < -1.0 || x > width) { return weights; }
+
+  if (y <= 0) { y = 0; }
+  if (x <= 0) { x = 0; }
+  int64_t y_low = static_cast<int64_t>(y);
+  int64_t x_low = static_cast<int64_t>(x);
+  int64_t y_high = 0;
+  int64_t x_high = 0;
+
+  if (y_low >= height - 1) {
+    y_low = height - 1;
+    y_high = y_low;
+    y = static_cast<T>(y_low);
+  } else {
+    y_high = y_low + 1;
+  }
+
+  if (x_low >= width - 1) {
+    x_low = width - 1;
+    x_high = x_low;
+    x = static_cast<T>(x_low);
+  } else {
+    x_high = x_low + 1;
+  }
+
+  const T ly = y - y_low;
+  const T lx = x - x_low;
+  const T hy = 1.f - ly;
+  const T hx = 1.f - lx;
+  weights.q11 = y_low * width + x_low;
+  weights.q21 = y_low * width + x_high;
+  weights.q12 = y_high * width + x_low;
+  weights.q22 = y_high * width + x_high;
+  weights.w11 = hy * hx;
+  weights.w21 = hy * lx;
+  weights.w12 = ly * hx;
+  weights.w22 = ly * lx;
+  return weights;
+}
+
+struct RoiAlignParams {
+  int64_t channel_num;
+  int64_t height;
+  int64_t width;
+  int64_t pooled_height;
+  int64_t pooled_width;
+  float spatial_scale;
+  int32_t sampling_ratio;
+  bool aligned;
+};
+
+// Precomputes the bilinear weights of all the sampling points of a roi, which are shared by all
+// the channels. The count points of bin (h, w) start at (h * pooled_width + w) * count, the bin
+// averages divide by divisor. Returns the image index of the roi.
+template<typename T>
+int64_t PrecomputeRoiWeights(const RoiAlignParams& params, const T* roi,
+                             std::vector<BilinearWeights<T>>* weights, int64_t* count,
+                             T* divisor) {
+  const int64_t n = static_cast<int64_t>(roi[0]);
+  const T spatial_scale = params.spatial_scale;
+  const T align_offset = params.aligned ? static_cast<T>(0.5) : static_cast<T>(0.f);
+  const T roi_start_w = roi[1] * spatial_scale - align_offset;
+  const T roi_start_h = roi[2] * spatial_scale - align_offset;
+  const T roi_end_w = roi[3] * spatial_scale - align_offset;
+  const T roi_end_h = roi[4] * spatial_scale - align_offset;
+  T roi_height = roi_end_h - roi_start_h;
+  T roi_width = roi_end_w - roi_start_w;
+  // aligned == false is for compatibility. the argument "aligned" doesn't have the semantic of
+  // determining minimum roi size
+  if (params.aligned == false) {
+    roi_height = std::max(roi_height, static_cast<T>(1.0));
+    roi_width = std::max(roi_width, static_cast<T>(1.0));
+  }
+  const T bin_height = static_cast<T>(roi_height) / static_cast<T>(params.pooled_height);
+  const T bin_width = static_cast<T>(roi_width) / static_cast<T>(params.pooled_width);
+  const int32_t bin_grid_height = (params.sampling_ratio > 0)
+                                      ? params.sampling_ratio
+                                      : std::ceil(roi_height / params.pooled_height);
+  const int32_t bin_grid_width = (params.sampling_ratio > 0)
+                                     ? params.sampling_ratio
+                                     : std::ceil(roi_width / params.pooled_width);
+  *count = std::max(bin_grid_height, 0) * std::max(bin_grid_width, 0);
+  *divisor = std::max(bin_grid_height * bin_grid_width, 1);
+  weights->resize(params.pooled_height * params.pooled_width * *count);
+  auto* it = weights->data();
+  FOR_RANGE(int64_t, h, 0, params.pooled_height) {
+    FOR_RANGE(int64_t, w, 0, params.pooled_width) {
+      FOR_RANGE(int64_t, grid_i, 0, bin_grid_height) {
+        // + .5f for center position
+        const T y = roi_start_h + h * bin_height
+                    + static_cast<T>(grid_i + 0.5f) * bin_height / static_cast<T>(bin_grid_height);
+        FOR_RANGE(int64_t, grid_j, 0, bin_grid_width) {
+          const T x = roi_start_w + w * bin_width
+                      + static_cast<T>(grid_j + 0.5f) * bin_width / static_cast<T>(bin_grid_width);
+          *it++ = ComputeBilinearWeights(params.height, params.width, y, x);
+        }
+      }
+    }
+  }
+  return n;
+}
+
+RoiAlignParams GetRoiAlignParams(user_op::KernelComputeContext* ctx, const ShapeView& x_shape) {
+  RoiAlignParams params{};
+  params.channel_num = x_shape.At(1);
+  params.height = x_shape.At(2);
+  params.width = x_shape.At(3);
+  params.pooled_height = ctx->Attr<int32_t>("pooled_h");
+  params.pooled_width = ctx->Attr<int32_t>("pooled_w");
+  params.spatial_scale = ctx->Attr<float>("spatial_scale");
+  params.sampling_ratio = ctx->Attr<int32_t>("sampling_ratio");
+  params.aligned = ctx->Attr<bool>("aligned");
+  return params;
+}
+
+template<typename T>
+class RoIAlignCpuKernel final : public user_op::OpKernel {
+ public:
+  RoIAlignCpuKernel() = default;
+  ~RoIAlignCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x_blob = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* rois_blob = ctx->Tensor4ArgNameAndIndex("rois", 0);
+    if (rois_blob->shape().elem_cnt() == 0) { return; }
+    user_op::Tensor* y_blob = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const RoiAlignParams params = GetRoiAlignParams(ctx, x_blob->shape());
+    const int64_t num_rois = rois_blob->shape().At(0);
+    const int64_t pooled_area = params.pooled_height * params.pooled_width;
+    const int64_t channel_area = params.height * params.width;
+    const T* x_ptr = x_blob->dptr<T>();
+    const T* rois_ptr = rois_blob->dptr<T>();
+    T* y_ptr = y_blob->mut_dptr<T>();
+
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, num_rois,
+        [&](int64_t begin, int64_t end) {
+          std::vector<BilinearWeights<T>> weights;
+          for (int64_t r = begin; r < end; ++r) {
+            int64_t count = 0;
+            T divisor = 1;
+            const int64_t n =
+                PrecomputeRoiWeights(params, rois_ptr + r * 5, &weights, &count, &divisor);
+            FOR_RANGE(int64_t, c, 0, params.channel_num) {
+              const T* channel_ptr = x_ptr + (n * params.channel_num + c) * channel_area;
+              T* out_ptr = y_ptr + (r * params.channel_num + c) * pooled_area;
+              const BilinearWeights<T>* it = weights.data();
+              FOR_RANGE(int64_t, bin, 0, pooled_area) {
+                T out_val = 0;
+                FOR_RANGE(int64_t, i, 0, count) {
+                  out_val += it->w11 * channel_ptr[it->q11] + it->w21 * channel_ptr[it->q21]
+                             + it->w12 * channel_ptr[it->q12] + it->w22 * channel_ptr[it->q22];
+                  ++it;
+                }
+                out_ptr[bin] = out_val / divisor;
+              }
+            }
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class RoIAlignGradCpuKernel final : public user_op::OpKernel {
+ public:
+  RoIAlignGradCpuKernel() = default;
+  ~RoIAlignGradCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* dx_blob = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    if (dx_blob == nullptr) { return; }
+    std::memset(dx_blob->mut_dptr<T>(), 0, dx_blob->shape().elem_cnt() * sizeof(T));
+    const user_op::Tensor* dy_blob = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* rois_blob = ctx->Tensor4ArgNameAndIndex("rois", 0);
+    if (dy_blob->shape().elem_cnt() == 0) { return; }
+    const RoiAlignParams params = GetRoiAlignParams(ctx, dx_blob->shape());
+    const int64_t num_rois = rois_blob->shape().At(0);
+    const int64_t pooled_area = params.pooled_height * params.pooled_width;
+    const int64_t channel_area = params.height * params.width;
+    const T* dy_ptr = dy_blob->dptr<T>();
+    const T* rois_ptr = rois_blob->dptr<T>();
+    T* dx_ptr = dx_blob->mut_dptr<T>();
+
+    // The rois of an image overlap in dx, so the threads own disjoint channels instead of rois
+    // and each computes the weights of every roi once for its channels.
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, params.channel_num,
+        [&](int64_t begin, int64_t end) {
+          std::vector<BilinearWeights<T>> weights;
+          FOR_RANGE(int64_t, r, 0, num_rois) {
+            int64_t count = 0;
+            T divisor = 1;
+            const int64_t n =
+                PrecomputeRoiWeights(params, rois_ptr + r * 5, &weights, &count, &divisor);
+            for (int64_t c = begin; c < end; ++c) {
+              T* channel_ptr = dx_ptr + (n * params.channel_num + c) * channel_area;
+              const T* out_diff_ptr = dy_ptr + (r * params.channel_num + c) * pooled_area;
+              const BilinearWeights<T>* it = weights.data();
+              FOR_RANGE(int64_t, bin, 0, pooled_area) {
+                const T bin_diff_avg = out_diff_ptr[bin] / divisor;
+                FOR_RANGE(int64_t, i, 0, count) {
+                  channel_ptr[it->q11] += bin_diff_avg * it->w11;
+                  channel_ptr[it->q21] += bin_diff_avg * it->w21;
+                  channel_ptr[it->q12] += bin_diff_avg * it->w12;
+                  channel_ptr[it->q22] += bin_diff_avg * it->w22;
+                  ++it;
+                }
+              }
+            }
+          }
+        },
+        1);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_ROI_ALIGN_CPU_KERNEL(dtype)                                            \
+  REGISTER_USER_KERNEL("roi_align")                                                     \
+      .SetCreateFn<RoIAlignCpuKernel<dtype>>()                                          \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value)); \
+  REGISTER_USER_KERNEL("roi_align_grad")                                                \
+      .SetCreateFn<RoIAlignGradCpuKernel<dtype>>()                                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+
+REGISTER_ROI_ALIGN_CPU_KERNEL(float)
+REGISTER_ROI_ALIGN_CPU_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
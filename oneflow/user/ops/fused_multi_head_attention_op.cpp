@@ -0,0 +1,249 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+// query: (..., Sq, D), key: (..., Sk, D), value: (..., Sk, Dv), the leading dims are shared.
+// key_padding_mask: (batch, Sk) where batch is the first dim of query, dropout_mask: (..., Sq, Sk).
+Maybe<void> CheckAttentionInputs(user_op::InferContext* ctx) {
+  const user_op::TensorDesc& query = ctx->InputTensorDesc("query", 0);
+  const user_op::TensorDesc& key = ctx->InputTensorDesc("key", 0);
+  const user_op::TensorDesc& value = ctx->InputTensorDesc("value", 0);
+  const int64_t num_axes = query.shape().NumAxes();
+  CHECK_GE_OR_RETURN(num_axes, 3);
+  CHECK_EQ_OR_RETURN(key.shape().NumAxes(), num_axes);
+  CHECK_EQ_OR_RETURN(value.shape().NumAxes(), num_axes);
+  FOR_RANGE(int64_t, i, 0, num_axes - 2) {
+    CHECK_EQ_OR_RETURN(key.shape().At(i), query.shape().At(i));
+    CHECK_EQ_OR_RETURN(value.shape().At(i), query.shape().At(i));
+  }
+  const int64_t query_seq_len = query.shape().At(num_axes - 2);
+  const int64_t key_seq_len = key.shape().At(num_axes - 2);
+  CHECK_EQ_OR_RETURN(key.shape().At(num_axes - 1), query.shape().At(num_axes - 1));
+  CHECK_EQ_OR_RETURN(value.shape().At(num_axes - 2), key_seq_len);
+  if (ctx->has_input("key_padding_mask", 0)) {
+    const Shape& mask_shape = ctx->InputShape("key_padding_mask", 0);
+    CHECK_EQ_OR_RETURN(mask_shape.NumAxes(), 2);
+    CHECK_EQ_OR_RETURN(mask_shape.At(0), query.shape().At(0));
+    CHECK_EQ_OR_RETURN(mask_shape.At(1), key_seq_len);
+  }
+  if (ctx->has_input("dropout_mask", 0)) {
+    const Shape& mask_shape = ctx->InputShape("dropout_mask", 0);
+    CHECK_EQ_OR_RETURN(mask_shape.NumAxes(), num_axes);
+    FOR_RANGE(int64_t, i, 0, num_axes - 2) {
+      CHECK_EQ_OR_RETURN(mask_shape.At(i), query.shape().At(i));
+    }
+    CHECK_EQ_OR_RETURN(mask_shape.At(num_axes - 2), query_seq_len);
+    CHECK_EQ_OR_RETURN(mask_shape.At(num_axes - 1), key_seq_len);
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckAttentionDataTypes(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("query", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("key", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("value", 0), data_type);
+  if (ctx->has_input("key_padding_mask", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("key_padding_mask", 0), DataType::kBool);
+  }
+  if (ctx->has_input("dropout_mask", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("dropout_mask", 0), DataType::kBool);
+  }
+  return Maybe<void>::Ok();
+}
+
+Shape AttentionOutShape(const Shape& query_shape, const Shape& value_shape) {
+  Shape out_shape = query_shape;
+  out_shape.Set(out_shape.NumAxes() - 1, value_shape.At(value_shape.NumAxes() - 1));
+  return out_shape;
+}
+
+Shape SoftmaxLseShape(const Shape& query_shape) {
+  DimVector dim_vec(query_shape.dim_vec().begin(), query_shape.dim_vec().end() - 1);
+  return Shape(dim_vec);
+}
+
+}  // namespace
+
+/*static*/ auto FusedMultiHeadAttentionOp::InferLogicalTensorDesc(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  JUST(CheckAttentionInputs(ctx));
+  const user_op::TensorDesc& query = ctx->InputTensorDesc("query", 0);
+  const user_op::TensorDesc& value = ctx->InputTensorDesc("value", 0);
+  *ctx->OutputShape("out", 0) = AttentionOutShape(query.shape(), value.shape());
+  *ctx->OutputIsDynamic("out", 0) = query.is_dynamic();
+  *ctx->OutputShape("softmax_lse", 0) = SoftmaxLseShape(query.shape());
+  *ctx->OutputIsDynamic("softmax_lse", 0) = query.is_dynamic();
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedMultiHeadAttentionOp::InferPhysicalTensorDesc(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  return FusedMultiHeadAttentionOp::InferLogicalTensorDesc(ctx);
+}
+/*static*/ auto FusedMultiHeadAttentionOp::InferDataType(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  JUST(CheckAttentionDataTypes(ctx));
+  *ctx->OutputDType("out", 0) = ctx->InputDType("query", 0);
+  *ctx->OutputDType("softmax_lse", 0) = ctx->InputDType("query", 0);
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedMultiHeadAttentionOp::ModifyInputArg(
+    const user_op::GetInputArgModifier& GetInputArgModifierFn,
+    const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
+  if (conf.has_input("key_padding_mask", 0)) {
+    user_op::InputArgModifier* mask_modifier = GetInputArgModifierFn("key_padding_mask", 0);
+    CHECK_OR_RETURN(mask_modifier != nullptr);
+    mask_modifier->set_requires_grad(false);
+  }
+  if (conf.has_input("dropout_mask", 0)) {
+    user_op::InputArgModifier* dropout_mask_modifier = GetInputArgModifierFn("dropout_mask", 0);
+    CHECK_OR_RETURN(dropout_mask_modifier != nullptr);
+    dropout_mask_modifier->set_requires_grad(false);
+  }
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedMultiHeadAttentionOp::GetSbp(user_op::SbpContext* ctx) -> Maybe<void> {
+  const user_op::TensorDesc& query = ctx->LogicalTensorDesc4InputArgNameAndIndex("query", 0);
+  const bool has_key_padding_mask = ctx->user_op_conf().has_input("key_padding_mask", 0);
+  const bool has_dropout_mask = ctx->user_op_conf().has_input("dropout_mask", 0);
+  FOR_RANGE(int64_t, axis, 0, query.shape().NumAxes() - 2) {
+    auto builder = ctx->NewBuilder()
+                       .Split(user_op::OpArg("query", 0), axis)
+                       .Split(user_op::OpArg("key", 0), axis)
+                       .Split(user_op::OpArg("value", 0), axis)
+                       .Split(user_op::OpArg("out", 0), axis)
+                       .Split(user_op::OpArg("softmax_lse", 0), axis);
+    if (has_key_padding_mask) {
+      // The padding mask only has the batch axis, it is broadcast when splitting the heads.
+      if (axis == 0) {
+        builder.Split(user_op::OpArg("key_padding_mask", 0), 0);
+      } else {
+        builder.Broadcast(user_op::OpArg("key_padding_mask", 0));
+      }
+    }
+    if (has_dropout_mask) { builder.Split(user_op::OpArg("dropout_mask", 0), axis); }
+    builder.Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+/*static*/ auto FusedMultiHeadAttentionGradOp::InferLogicalTensorDesc(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  JUST(CheckAttentionInputs(ctx));
+  const user_op::TensorDesc& query = ctx->InputTensorDesc("query", 0);
+  const user_op::TensorDesc& key = ctx->InputTensorDesc("key", 0);
+  const user_op::TensorDesc& value = ctx->InputTensorDesc("value", 0);
+  const Shape out_shape = AttentionOutShape(query.shape(), value.shape());
+  CHECK_EQ_OR_RETURN(ctx->InputShape("out", 0), out_shape);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("out_grad", 0), out_shape);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("softmax_lse", 0), SoftmaxLseShape(query.shape()));
+  *ctx->OutputShape("query_grad", 0) = query.shape();
+  *ctx->OutputIsDynamic("query_grad", 0) = query.is_dynamic();
+  *ctx->OutputShape("key_grad", 0) = key.shape();
+  *ctx->OutputIsDynamic("key_grad", 0) = key.is_dynamic();
+  *ctx->OutputShape("value_grad", 0) = value.shape();
+  *ctx->OutputIsDynamic("value_grad", 0) = value.is_dynamic();
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedMultiHeadAttentionGradOp::InferPhysicalTensorDesc(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  return FusedMultiHeadAttentionGradOp::InferLogicalTensorDesc(ctx);
+}
+/*static*/ auto FusedMultiHeadAttentionGradOp::InferDataType(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  JUST(CheckAttentionDataTypes(ctx));
+  const DataType data_type = ctx->InputDType("query", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("out", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("softmax_lse", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("out_grad", 0), data_type);
+  *ctx->OutputDType("query_grad", 0) = data_type;
+  *ctx->OutputDType("key_grad", 0) = data_type;
+  *ctx->OutputDType("value_grad", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedMultiHeadAttentionGradOp::GetSbp(user_op::SbpContext* ctx) -> Maybe<void> {
+  const user_op::TensorDesc& query = ctx->LogicalTensorDesc4InputArgNameAndIndex("query", 0);
+  const bool has_key_padding_mask = ctx->user_op_conf().has_input("key_padding_mask", 0);
+  const bool has_dropout_mask = ctx->user_op_conf().has_input("dropout_mask", 0);
+  FOR_RANGE(int64_t, axis, 0, query.shape().NumAxes() - 2) {
+    auto builder = ctx->NewBuilder()
+                       .Split(user_op::OpArg("query", 0), axis)
+                       .Split(user_op::OpArg("key", 0), axis)
+                       .Split(user_op::OpArg("value", 0), axis)
+                       .Split(user_op::OpArg("out", 0), axis)
+                       .Split(user_op::OpArg("softmax_lse", 0), axis)
+                       .Split(user_op::OpArg("out_grad", 0), axis)
+                       .Split(user_op::OpArg("query_grad", 0), axis)
+                       .Split(user_op::OpArg("key_grad", 0), axis)
+                       .Split(user_op::OpArg("value_grad", 0), axis);
+    if (has_key_padding_mask) {
+      if (axis == 0) {
+        builder.Split(user_op::OpArg("key_padding_mask", 0), 0);
+      } else {
+        builder.Broadcast(user_op::OpArg("key_padding_mask", 0));
+      }
+    }
+    if (has_dropout_mask) { builder.Split(user_op::OpArg("dropout_mask", 0), axis); }
+    builder.Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+REGISTER_USER_OP_GRAD("fused_multi_head_attention")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               const user_op::AddOpFn& AddOp) -> Maybe<void> {
+      if (op.NeedGenGradTensor4OpInput("query", 0) || op.NeedGenGradTensor4OpInput("key", 0)
+          || op.NeedGenGradTensor4OpInput("value", 0)) {
+        user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad");
+        builder.Op("fused_multi_head_attention_grad")
+            .Input("query", op.input("query", 0))
+            .Input("key", op.input("key", 0))
+            .Input("value", op.input("value", 0))
+            .Input("out", op.output("out", 0))
+            .Input("softmax_lse", op.output("softmax_lse", 0))
+            .Input("out_grad", op.GetGradTensorWithOpOutput("out", 0))
+            .Output("query_grad")
+            .Output("key_grad")
+            .Output("value_grad")
+            .Attr("scale", op.attr<float>("scale"))
+            .Attr("causal", op.attr<bool>("causal"))
+            .Attr("dropout_scale", op.attr<float>("dropout_scale"));
+        if (op.user_op_conf().has_input("key_padding_mask", 0)) {
+          builder.Input("key_padding_mask", op.input("key_padding_mask", 0));
+        }
+        if (op.user_op_conf().has_input("dropout_mask", 0)) {
+          builder.Input("dropout_mask", op.input("dropout_mask", 0));
+        }
+        user_op::UserOpConfWrapper grad_op = builder.Build();
+        if (op.NeedGenGradTensor4OpInput("query", 0)) {
+          op.BindGradTensorWithOpInput(grad_op.output("query_grad", 0), "query", 0);
+        }
+        if (op.NeedGenGradTensor4OpInput("key", 0)) {
+          op.BindGradTensorWithOpInput(grad_op.output("key_grad", 0), "key", 0);
+        }
+        if (op.NeedGenGradTensor4OpInput("value", 0)) {
+          op.BindGradTensorWithOpInput(grad_op.output("value_grad", 0), "value", 0);
+        }
+        AddOp(grad_op);
+      }
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
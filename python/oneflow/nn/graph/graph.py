@@ -732,6 +732,18 @@ class Graph(object):
 
         return a_graph
 
+    @staticmethod
+    def trace(func=None, *, warmup=1, max_cache_size=8):
+        """Trace an eager function or nn.Module into nn.Graph and replay it on later calls.
+
+        Unlike ``to_graph``, the calls are guarded by the signature of their inputs, the graph is
+        compiled once per signature, and the calls it can not serve run eagerly. See
+        :func:`oneflow.nn.graph.trace` for the details.
+        """
+        from oneflow.nn.graph.trace import trace
+
+        return trace(func, warmup=warmup, max_cache_size=max_cache_size)
+
     def _compile(self, *args, **kwargs):
         self.__ensure_input_tensors_contiguous(*args, **kwargs)
         _, eager_outputs = self.build_graph(*args, **kwargs)
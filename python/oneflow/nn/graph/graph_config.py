@@ -46,9 +46,12 @@ class GraphConfig(object):
             return False
         raise NotImplementedError
 
-    def enable_amp(self, mode: bool = True):
+    def enable_amp(self, mode: bool = True, *, dtype=None):
         r"""If set to true, then graph will use mixed precision mode, it means use both float16 and float32 during model training.
 
+        With ``dtype=oneflow.bfloat16`` the ops placed on CPU run in bfloat16 instead, ops placed on
+        CUDA are left untouched.
+
         For example:
 
         .. code-block:: python
@@ -67,10 +70,18 @@ class GraphConfig(object):
 
         Args:
             mode (bool, optional): The default vaule is True.
+            dtype (oneflow.dtype, optional): oneflow.float16 (default) or oneflow.bfloat16.
 
         """
         assert type(mode) is bool
         self.proto.enable_auto_mixed_precision = mode
+        if dtype is not None:
+            import oneflow
+
+            assert dtype in (oneflow.float16, oneflow.bfloat16)
+            self.proto.mixed_precision_data_type = oneflow._oneflow_internal.deprecated.GetProtoDtype4OfDtype(
+                dtype
+            )
 
     def set_zero_redundancy_optimizer_mode(self, mode: str = "distributed_split"):
         raise RuntimeError(
@@ -210,6 +221,36 @@ class GraphConfig(object):
         """
         self.proto.enable_fuse_cast_scale = mode
 
+    def allow_fuse_multi_head_attention(self, mode: bool = True):
+        r"""If set to true, try to fuse the attention pattern on CPU, that is batch_matmul of
+        query and transposed key, optionally scaled, softmax and batch_matmul with value, into
+        a single fused_multi_head_attention op which does not materialize the attention scores.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            def attention(q, k, v):
+                scores = flow.matmul(q, k.transpose(-2, -1)) / 8.0
+                return flow.matmul(flow.softmax(scores, dim=-1), v)
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.m = attention
+                    self.config.allow_fuse_multi_head_attention(True)
+                def build(self, q, k, v):
+                    return self.m(q, k, v)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.enable_fuse_multi_head_attention = mode
+
     def set_gradient_accumulation_steps(self, value):
         r"""Set num of steps to accumulate gradient.
 
@@ -0,0 +1,248 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import functools
+import inspect
+import logging
+from collections import OrderedDict
+
+import oneflow
+from oneflow.framework.tensor import Tensor
+from oneflow.nn.graph.graph import Graph
+from oneflow.nn.module import Module
+from oneflow.support.env_var_util import parse_boolean_from_env
+
+logger = logging.getLogger(__name__)
+
+# Calls with ever-changing signatures would grow the warmup counters without bound.
+_MAX_NUM_WARMUP_SIGNATURES = 1024
+
+
+class _TensorSlot(object):
+    # Placeholder of a tensor argument in the argument template of a signature.
+    __slots__ = ("index",)
+
+    def __init__(self, index):
+        self.index = index
+
+
+class _Unsupported(Exception):
+    pass
+
+
+def _flatten_args(value, tensors):
+    # Returns (template, signature): the template rebuilds the argument with the graph's lazy
+    # tensors, the signature is the hashable guard the compiled graph is cached with.
+    if isinstance(value, Tensor):
+        if value.is_global:
+            raise _Unsupported("global tensor")
+        tensors.append(value)
+        signature = (
+            "tensor",
+            tuple(value.shape),
+            value.dtype,
+            str(value.device),
+            value.requires_grad,
+        )
+        return _TensorSlot(len(tensors) - 1), signature
+    if isinstance(value, (list, tuple)):
+        items = [_flatten_args(item, tensors) for item in value]
+        template = type(value)(item[0] for item in items)
+        return template, (type(value).__name__,) + tuple(item[1] for item in items)
+    if isinstance(value, dict):
+        try:
+            keys = sorted(value.keys())
+        except TypeError:
+            raise _Unsupported("dict with unsortable keys")
+        items = [_flatten_args(value[key], tensors) for key in keys]
+        template = {key: item[0] for key, item in zip(keys, items)}
+        return template, ("dict",) + tuple(zip(keys, (item[1] for item in items)))
+    # Other arguments are baked into the graph as constants, so they must be part of the guard.
+    try:
+        hash(value)
+    except TypeError:
+        raise _Unsupported(f"unhashable argument of type {type(value).__name__}")
+    return value, ("const", type(value), value)
+
+
+def _clone_outputs(value):
+    # nn.Graph reuses its output tensors across calls, the results handed to the caller must not
+    # alias them.
+    if isinstance(value, Tensor):
+        return value.clone()
+    if isinstance(value, (list, tuple)):
+        return type(value)(_clone_outputs(item) for item in value)
+    if isinstance(value, dict):
+        return {key: _clone_outputs(item) for key, item in value.items()}
+    return value
+
+
+def _unflatten_args(template, tensors):
+    if isinstance(template, _TensorSlot):
+        return tensors[template.index]
+    if isinstance(template, (list, tuple)):
+        return type(template)(_unflatten_args(item, tensors) for item in template)
+    if isinstance(template, dict):
+        return {key: _unflatten_args(item, tensors) for key, item in template.items()}
+    return template
+
+
+class _TracedGraph(Graph):
+    def __init__(self, func, module, template):
+        super().__init__()
+        if module is not None:
+            self.module = module
+        else:
+            self._traced_func = func
+        self._args_template = template
+
+    def build(self, *tensors):
+        args, kwargs = _unflatten_args(self._args_template, tensors)
+        if "module" in self._blocks:
+            return self.module(*args, **kwargs)
+        return self._traced_func(*args, **kwargs)
+
+
+class TracedFunction(object):
+    r"""The callable returned by :func:`trace`.
+
+    Every call is guarded by the signature of its arguments: the shape, dtype, device and
+    requires_grad of the tensors, the value of the other arguments, the nesting structure, and
+    the training flag of the traced module. A signature seen more than ``warmup`` times with grad
+    mode disabled is traced into a ``nn.Graph`` and replayed from then on, other calls run
+    eagerly.
+    """
+
+    def __init__(self, func, warmup=1, max_cache_size=8):
+        assert warmup >= 0, f"warmup must be non-negative, but got {warmup}"
+        assert (
+            max_cache_size > 0
+        ), f"max_cache_size must be positive, but got {max_cache_size}"
+        self._func = func
+        self._module = func if isinstance(func, Module) else None
+        self._warmup = warmup
+        self._max_cache_size = max_cache_size
+        # signature -> compiled graph, in least recently used order
+        self._graphs = OrderedDict()
+        self._eager_call_counts = dict()
+        # signatures failed to compile, always run eagerly
+        self._failed_signatures = set()
+        functools.update_wrapper(self, func, updated=())
+
+    @property
+    def num_cached_graphs(self):
+        return len(self._graphs)
+
+    def _graph_disabled(self):
+        if parse_boolean_from_env("ONEFLOW_DISABLE_GRAPH_TRACE", False):
+            return True
+        # The graph is forward only. Besides the arguments and the module parameters, the function
+        # may reach tensors requiring grad through closures, globals or attributes, which can not
+        # be told apart reliably, so every call made with grad mode enabled runs eagerly.
+        return oneflow.is_grad_enabled()
+
+    def _compile(self, signature, template, tensors):
+        graph = _TracedGraph(self._func, self._module, template)
+        try:
+            outputs = _clone_outputs(graph(*tensors))
+        except Exception as e:
+            logger.warning(
+                f"Failed to trace {graph.name} into nn.Graph, fall back to eager: {e}"
+            )
+            self._failed_signatures.add(signature)
+            return None, None
+        if len(self._graphs) >= self._max_cache_size:
+            self._graphs.popitem(last=False)
+        self._graphs[signature] = graph
+        return graph, outputs
+
+    def __call__(self, *args, **kwargs):
+        if self._graph_disabled():
+            return self._func(*args, **kwargs)
+        tensors = []
+        try:
+            template, signature = _flatten_args((args, kwargs), tensors)
+        except _Unsupported:
+            return self._func(*args, **kwargs)
+        if self._module is not None:
+            signature = (self._module.training, signature)
+        if signature in self._failed_signatures:
+            return self._func(*args, **kwargs)
+
+        graph = self._graphs.get(signature)
+        if graph is not None:
+            self._graphs.move_to_end(signature)
+            return _clone_outputs(graph(*tensors))
+
+        count = self._eager_call_counts.get(signature, 0)
+        if count < self._warmup:
+            if len(self._eager_call_counts) >= _MAX_NUM_WARMUP_SIGNATURES:
+                self._eager_call_counts.clear()
+            self._eager_call_counts[signature] = count + 1
+            return self._func(*args, **kwargs)
+        self._eager_call_counts.pop(signature, None)
+        graph, outputs = self._compile(signature, template, tensors)
+        if graph is None:
+            return self._func(*args, **kwargs)
+        return outputs
+
+
+def trace(func=None, *, warmup=1, max_cache_size=8):
+    r"""Trace the eager ops of a function or a ``nn.Module`` into ``nn.Graph`` and replay them.
+
+    The ops run by ``func`` are recorded by the lazy op interpreter for a fixed input signature,
+    compiled with the job passes of ``nn.Graph``, and the compiled graph is replayed by the later
+    calls with the same signature. Calls made with grad mode enabled, with an unseen signature,
+    global tensors, or unhashable non-tensor arguments run eagerly. Set the environment variable
+    ``ONEFLOW_DISABLE_GRAPH_TRACE=1`` to always run eagerly.
+
+    Args:
+        func: the function or ``nn.Module`` to trace.
+        warmup (int): the number of eager calls of a signature before it is traced. Default: 1.
+        max_cache_size (int): the max number of compiled graphs kept, the least recently used
+            one is released when the cache is full. Default: 8.
+
+    Note:
+        The non-tensor arguments are constants of the compiled graph, and the tensors captured by
+        ``func`` are read when the graph is traced. The traced graph is forward only, so only the
+        calls under ``oneflow.no_grad()`` are traced, use a customized ``nn.Graph`` for training.
+        The results are copied out of the graph, they stay valid across calls.
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> @flow.nn.Graph.trace
+        ... def test_func(x):
+        ...     return flow.relu(x) * 2
+        >>> input = flow.tensor((-1, 2), dtype=flow.float32)
+        >>> with flow.no_grad():
+        ...     out = test_func(input)
+        ...     out = test_func(input)
+        >>> out
+        tensor([0., 4.], dtype=oneflow.float32)
+
+    ..
+        Feature Stage of Feature [trace].
+        - Current Stage [Pre-alpha, note that this is an experimental feature and maybe removed without notice.]
+
+    """
+    if func is None:
+        return functools.partial(trace, warmup=warmup, max_cache_size=max_cache_size)
+    assert inspect.isfunction(func) or isinstance(
+        func, Module
+    ), f"nn.Graph.trace only support function or nn.Module, but got {func}."
+    return TracedFunction(func, warmup=warmup, max_cache_size=max_cache_size)
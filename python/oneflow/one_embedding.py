@@ -45,7 +45,10 @@ def _check_initializer(initializer):
 def _check_cache(cache):
     assert isinstance(cache, dict)
     assert cache.__contains__("policy")
-    assert cache["policy"] in ["lru", "full"]
+    assert cache["policy"] in ["lru", "full", "tiny_lfu"]
+    if cache.__contains__("admission_threshold"):
+        assert cache["policy"] == "tiny_lfu"
+        assert cache["admission_threshold"] > 0
     cache_memory_budget_mb = 0
     if cache.__contains__("cache_memory_budget_mb"):
         cache_memory_budget_mb = cache["cache_memory_budget_mb"]
@@ -233,11 +236,12 @@ class Embedding(Module):
                     )
                 )
 
-    def save_snapshot(self, snapshot_name):
+    def save_snapshot(self, snapshot_name, incremental=False):
         """save snapshot
 
         Args:
             snapshot_name (str): the snapshot_name, snapshot will be saved in the snapshots dir under your_configed_persistent_path
+            incremental (bool, optional): only save the rows updated since the last snapshot saved or loaded, which becomes the base of this snapshot and must not be overwritten. Loading this snapshot loads its bases first. Long chains of incremental snapshots are consolidated into a full snapshot in the background. Defaults to False.
     
         For example:
 
@@ -248,8 +252,10 @@ class Embedding(Module):
             >>> embedding.save_snapshot("my_snapshot1")
             >>> # a snapshot named "my_snapshot1" have been saved in the "snapshots" dir under your_configed_persistent_path
             >>> # which can be reload by flow.one_embedding.load_snapshot
+            >>> embedding.save_snapshot("my_snapshot2", incremental=True)
+            >>> # "my_snapshot2" only holds the rows updated after "my_snapshot1" was saved
         """
-        self.handler.SaveSnapshot(snapshot_name)
+        self.handler.SaveSnapshot(snapshot_name, incremental)
 
     def load_snapshot(self, snapshot_name):
         """load snapshot
@@ -25,6 +25,7 @@ __all__ = [
     "profile",
     "record_function",
     "ProfilerActivity",
+    "dump_metrics",
 ]
 
 
@@ -42,3 +43,12 @@ def profiler_start():
 
 def profiler_stop():
     oneflow._oneflow_internal.profiler.ProfilerStop()
+
+
+def dump_metrics():
+    r"""Returns the always-on runtime metrics in the Prometheus text exposition format.
+
+    Set the environment variable ``ONEFLOW_METRICS_EXPORT_FILE`` to also export them to a file
+    every ``ONEFLOW_METRICS_EXPORT_INTERVAL_MS`` milliseconds (10000 by default).
+    """
+    return oneflow._oneflow_internal.profiler.DumpMetrics()
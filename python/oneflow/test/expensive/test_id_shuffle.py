@@ -23,7 +23,7 @@ import oneflow as flow
 from oneflow.test_utils.automated_test_util import *
 
 
-def _test_id_shuffle(test_case, has_table_id, num_tables):
+def _test_id_shuffle(test_case, has_table_id, num_tables, device="cuda"):
     batch_size = 512
     ids = np.random.randint(0, 1000, (batch_size, num_tables), dtype=np.int64)
     if has_table_id:
@@ -32,10 +32,10 @@ def _test_id_shuffle(test_case, has_table_id, num_tables):
         )  # same id must have same table id, so in this case get table_ids from ids
         table_ids_tensor = flow.tensor(
             table_ids.astype(np.int32), requires_grad=False
-        ).to("cuda")
+        ).to(device)
     else:
         table_ids_tensor = None
-    ids_tensor = flow.tensor(ids, requires_grad=False).to("cuda")
+    ids_tensor = flow.tensor(ids, requires_grad=False).to(device)
 
     class TestGraph(flow.nn.Graph):
         def __init__(self):
@@ -117,7 +117,7 @@ def embedding_shuffle_quantize(np_data, np_dtype):
     return np_data
 
 
-def _test_embedding_shuffle(test_case, dtype, enable_quantize):
+def _test_embedding_shuffle(test_case, dtype, enable_quantize, device="cuda"):
     batch_size = 512
     num_tables = 26
     embedding_size = 128
@@ -138,11 +138,11 @@ def _test_embedding_shuffle(test_case, dtype, enable_quantize):
         np_dtype = np.float32
     data = np.random.rand(1000, embedding_size).astype(np_dtype)
 
-    ids_tensor = flow.tensor(ids, requires_grad=False).to("cuda")
+    ids_tensor = flow.tensor(ids, requires_grad=False).to(device)
     table_ids_tensor = flow.tensor(table_ids.astype(np.int32), requires_grad=False).to(
-        "cuda"
+        device
     )
-    data_tensor = flow.tensor(data, requires_grad=False).to("cuda")
+    data_tensor = flow.tensor(data, requires_grad=False).to(device)
 
     class TestGraph(flow.nn.Graph):
         def __init__(self):
@@ -178,7 +178,9 @@ def _test_embedding_shuffle(test_case, dtype, enable_quantize):
     )
 
 
-def _test_embedding_gradient_shuffle(test_case, enable_quantize, fp16, embedding_size):
+def _test_embedding_gradient_shuffle(
+    test_case, enable_quantize, fp16, embedding_size, device="cuda"
+):
     batch_size = 512
     num_tables = 26
     ids = np.random.randint(0, 1000, (batch_size, num_tables), dtype=np.int64)
@@ -201,11 +203,11 @@ def _test_embedding_gradient_shuffle(test_case, enable_quantize, fp16, embedding
     embedding_grad = np.random.uniform(
         low=-1, high=1, size=(batch_size, num_tables, embedding_size)
     ).astype(np.float32)
-    ids_tensor = flow.tensor(ids, requires_grad=False).to("cuda")
+    ids_tensor = flow.tensor(ids, requires_grad=False).to(device)
     table_ids_tensor = flow.tensor(table_ids.astype(np.int32), requires_grad=False).to(
-        "cuda"
+        device
     )
-    embedding_grad_tensor = flow.tensor(embedding_grad, requires_grad=False).to("cuda")
+    embedding_grad_tensor = flow.tensor(embedding_grad, requires_grad=False).to(device)
 
     class TestGraph(flow.nn.Graph):
         def __init__(self):
@@ -295,7 +297,7 @@ def _test_embedding_gradient_shuffle(test_case, enable_quantize, fp16, embedding
     )
 
 
-def _test_unique_key_value(test_case, has_table_id, num_tables):
+def _test_unique_key_value(test_case, has_table_id, num_tables, device="cuda"):
     batch_size = 128
     ids = np.random.randint(0, 1000, (batch_size, num_tables), dtype=np.int64)
     if has_table_id:
@@ -304,10 +306,10 @@ def _test_unique_key_value(test_case, has_table_id, num_tables):
         )  # same id must have same table id, so in this case get table_ids from ids
         table_ids_tensor = flow.tensor(
             table_ids.astype(np.int32), requires_grad=False
-        ).to("cuda")
+        ).to(device)
     else:
         table_ids_tensor = None
-    ids_tensor = flow.tensor(ids, requires_grad=False).to("cuda")
+    ids_tensor = flow.tensor(ids, requires_grad=False).to(device)
 
     class TestGraph(flow.nn.Graph):
         def __init__(self):
@@ -375,5 +377,36 @@ class DataShuffleTestCase(flow.unittest.TestCase):
             _test_unique_key_value(test_case, **kwargs)
 
 
+@flow.unittest.skip_unless_1n1d()
+class DataShuffleCpuTestCase(flow.unittest.TestCase):
+    def test_id_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["has_table_id"] = [True, False]
+        arg_dict["num_tables"] = [1, 26]
+        arg_dict["device"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_id_shuffle(test_case, **kwargs)
+
+    def test_embedding_shuffle(test_case):
+        _test_embedding_shuffle(test_case, flow.float32, False, "cpu")
+
+    def test_embedding_gradient_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["enable_quantize"] = [False]
+        arg_dict["fp16"] = [False]
+        arg_dict["embedding_size"] = [128, 17]
+        arg_dict["device"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_embedding_gradient_shuffle(test_case, **kwargs)
+
+    def test_unique_key_value(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["has_table_id"] = [True, False]
+        arg_dict["num_tables"] = [13, 1]
+        arg_dict["device"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_unique_key_value(test_case, **kwargs)
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -111,6 +111,63 @@ class TestRNN(flow.unittest.TestCase):
             hx = m(input[i], hx)
         return hx
 
+    @autotest(n=5, check_graph=True)
+    def test_lstm_cell_cpu_double(test_case):
+        device = "cpu"
+        batch_size = random(1, 6)
+        time_steps = random(1, 6)
+        input_size = random(1, 6) * 2
+        hidden_size = random(1, 6) * 2
+        m = torch.nn.LSTMCell(
+            input_size=input_size, hidden_size=hidden_size, bias=random().to(bool),
+        )
+        m.to(device).double()
+        input = (
+            random_tensor(ndim=3, dim0=time_steps, dim1=batch_size, dim2=input_size)
+            .to(device)
+            .double()
+        )
+        hx = (
+            random_tensor(ndim=2, dim0=batch_size, dim1=hidden_size)
+            .to(device)
+            .double()
+        )
+        cx = (
+            random_tensor(ndim=2, dim0=batch_size, dim1=hidden_size)
+            .to(device)
+            .double()
+        )
+        for i in range(time_steps.to(int).value()):
+            res = m(input[i], (hx, cx))
+            hx = res[0]
+            cx = res[1]
+        return res[0]
+
+    @autotest(n=5, check_graph=True)
+    def test_gru_cell_cpu_double(test_case):
+        device = "cpu"
+        batch_size = random(1, 6)
+        time_steps = random(1, 6)
+        input_size = random(1, 6) * 2
+        hidden_size = random(1, 6) * 2
+        m = torch.nn.GRUCell(
+            input_size=input_size, hidden_size=hidden_size, bias=random().to(bool)
+        )
+        m.to(device).double()
+        input = (
+            random_tensor(ndim=3, dim0=time_steps, dim1=batch_size, dim2=input_size)
+            .to(device)
+            .double()
+        )
+        hx = (
+            random_tensor(ndim=2, dim0=batch_size, dim1=hidden_size)
+            .to(device)
+            .double()
+        )
+        for i in range(time_steps.to(int).value()):
+            hx = m(input[i], hx)
+        return hx
+
 
 if __name__ == "__main__":
     unittest.main()
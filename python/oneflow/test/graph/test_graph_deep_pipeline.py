@@ -0,0 +1,77 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import time
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class DeepPipelineGraph(flow.nn.Graph):
+    def __init__(self, depth):
+        super().__init__()
+        self.depth = depth
+
+    def build(self, x):
+        # every op is cheap, so the runtime is dominated by the actor message passing
+        for i in range(self.depth):
+            x = x + 1 if i % 2 == 0 else flow.relu(x)
+        return x
+
+
+def _test_deep_pipeline(test_case, device, depth):
+    graph = DeepPipelineGraph(depth)
+    x = flow.zeros(4, 4, dtype=flow.float32, device=device)
+    for _ in range(3):
+        out = graph(x)
+        expected = np.full((4, 4), (depth + 1) // 2, dtype=np.float32)
+        test_case.assertTrue(np.array_equal(out.numpy(), expected))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestDeepPipelineGraph(oneflow.unittest.TestCase):
+    def test_deep_pipeline_cpu(test_case):
+        _test_deep_pipeline(test_case, "cpu", 128)
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_deep_pipeline_cuda(test_case):
+        _test_deep_pipeline(test_case, "cuda", 128)
+
+    # Compare ONEFLOW_THREAD_ENABLE_BATCHED_MESSAGE_DISPATCH=0 and =1:
+    # ONEFLOW_TEST_ACTOR_BENCHMARK=1 python3 test_graph_deep_pipeline.py \
+    #     TestDeepPipelineGraph.test_deep_pipeline_benchmark
+    @unittest.skipUnless(os.getenv("ONEFLOW_TEST_ACTOR_BENCHMARK"), "benchmark only")
+    def test_deep_pipeline_benchmark(test_case):
+        for depth in [64, 256, 1024]:
+            graph = DeepPipelineGraph(depth)
+            x = flow.zeros(1, dtype=flow.float32)
+            graph(x).numpy()
+            num_iters = 100
+            start = time.perf_counter()
+            for _ in range(num_iters):
+                out = graph(x)
+            out.numpy()
+            elapsed = (time.perf_counter() - start) / num_iters
+            print(
+                "depth %5d: %10.3f ms/iter, %8.3f us/op"
+                % (depth, elapsed * 1e3, elapsed * 1e6 / depth)
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
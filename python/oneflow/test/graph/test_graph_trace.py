@@ -0,0 +1,198 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import time
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _mlp_func(x, scale):
+    y = flow.relu(x) * scale
+    return y + flow.sigmoid(x)
+
+
+def _test_trace_function(test_case, device):
+    traced = flow.nn.Graph.trace(_mlp_func)
+    x = flow.randn(4, 8, device=device)
+    expected = _mlp_func(x, 2.0).numpy()
+    with flow.no_grad():
+        # warmup runs eagerly, the second call compiles and the later ones replay
+        for i in range(4):
+            out = traced(x, 2.0)
+            test_case.assertTrue(np.allclose(out.numpy(), expected, 1e-5, 1e-5))
+            test_case.assertEqual(traced.num_cached_graphs, 0 if i == 0 else 1)
+    # calls made with grad mode enabled run eagerly
+    out = traced(x, 2.0)
+    test_case.assertTrue(np.allclose(out.numpy(), expected, 1e-5, 1e-5))
+    test_case.assertEqual(traced.num_cached_graphs, 1)
+
+
+def _test_trace_keeps_results(test_case, device):
+    traced = flow.nn.Graph.trace(_mlp_func, warmup=0)
+    xs = [flow.randn(4, 8, device=device) for _ in range(5)]
+    with flow.no_grad():
+        # the results must not alias the output buffers the graph reuses across calls
+        outs = [traced(x, 2.0) for x in xs]
+    test_case.assertEqual(traced.num_cached_graphs, 1)
+    for x, out in zip(xs, outs):
+        test_case.assertTrue(
+            np.allclose(out.numpy(), _mlp_func(x, 2.0).numpy(), 1e-5, 1e-5)
+        )
+
+
+def _test_trace_captured_tensor(test_case, device):
+    weight = flow.randn(8, device=device, requires_grad=True)
+
+    def func(x):
+        return flow.relu(x) * weight
+
+    traced = flow.nn.Graph.trace(func, warmup=0)
+    x = flow.randn(4, 8, device=device)
+    # the tensor captured by the closure requires grad, autograd must reach it
+    traced(x).sum().backward()
+    test_case.assertTrue(
+        np.allclose(weight.grad.numpy(), flow.relu(x).sum(0).numpy(), 1e-5, 1e-5)
+    )
+    test_case.assertEqual(traced.num_cached_graphs, 0)
+
+
+def _test_trace_signature_mismatch(test_case, device):
+    traced = flow.nn.Graph.trace(_mlp_func, warmup=0)
+    x = flow.randn(4, 8, device=device)
+    with flow.no_grad():
+        test_case.assertTrue(
+            np.allclose(traced(x, 2.0).numpy(), _mlp_func(x, 2.0).numpy(), 1e-5, 1e-5)
+        )
+        test_case.assertEqual(traced.num_cached_graphs, 1)
+        # a new shape, dtype or constant argument is a new signature
+        y = flow.randn(2, 3, device=device)
+        test_case.assertTrue(
+            np.allclose(traced(y, 2.0).numpy(), _mlp_func(y, 2.0).numpy(), 1e-5, 1e-5)
+        )
+        test_case.assertTrue(
+            np.allclose(traced(x, 3.0).numpy(), _mlp_func(x, 3.0).numpy(), 1e-5, 1e-5)
+        )
+        test_case.assertEqual(traced.num_cached_graphs, 3)
+    # inputs requiring grad need autograd and run eagerly
+    z = flow.randn(4, 8, device=device, requires_grad=True)
+    out = traced(z, 2.0)
+    out.sum().backward()
+    test_case.assertTrue(z.grad is not None)
+    test_case.assertEqual(traced.num_cached_graphs, 3)
+
+
+def _test_trace_cache_size(test_case, device):
+    traced = flow.nn.Graph.trace(_mlp_func, warmup=0, max_cache_size=2)
+    for n in range(1, 5):
+        x = flow.randn(n, 4, device=device)
+        with flow.no_grad():
+            out = traced(x, 1.0)
+        test_case.assertTrue(
+            np.allclose(out.numpy(), _mlp_func(x, 1.0).numpy(), 1e-5, 1e-5)
+        )
+    test_case.assertEqual(traced.num_cached_graphs, 2)
+
+
+def _test_trace_module(test_case, device):
+    model = flow.nn.Sequential(
+        flow.nn.Linear(8, 16), flow.nn.ReLU(), flow.nn.Linear(16, 4)
+    ).to(device)
+    model.eval()
+    traced = flow.nn.Graph.trace(model, warmup=0)
+    x = flow.randn(2, 8, device=device)
+    with flow.no_grad():
+        expected = model(x).numpy()
+        for _ in range(3):
+            out = traced(x)
+            test_case.assertTrue(np.allclose(out.numpy(), expected, 1e-4, 1e-4))
+        test_case.assertEqual(traced.num_cached_graphs, 1)
+    # training a module with parameters runs eagerly
+    model.train()
+    out = traced(x)
+    out.sum().backward()
+    test_case.assertTrue(model[0].weight.grad is not None)
+    test_case.assertEqual(traced.num_cached_graphs, 1)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphTrace(oneflow.unittest.TestCase):
+    def test_trace_function_cpu(test_case):
+        _test_trace_function(test_case, "cpu")
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_trace_function_cuda(test_case):
+        _test_trace_function(test_case, "cuda")
+
+    def test_trace_keeps_results(test_case):
+        _test_trace_keeps_results(test_case, "cpu")
+
+    def test_trace_captured_tensor(test_case):
+        _test_trace_captured_tensor(test_case, "cpu")
+
+    def test_trace_signature_mismatch(test_case):
+        _test_trace_signature_mismatch(test_case, "cpu")
+
+    def test_trace_cache_size(test_case):
+        _test_trace_cache_size(test_case, "cpu")
+
+    def test_trace_module_cpu(test_case):
+        _test_trace_module(test_case, "cpu")
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_trace_module_cuda(test_case):
+        _test_trace_module(test_case, "cuda")
+
+    def test_trace_disabled_by_env(test_case):
+        os.environ["ONEFLOW_DISABLE_GRAPH_TRACE"] = "1"
+        try:
+            traced = flow.nn.Graph.trace(_mlp_func, warmup=0)
+            x = flow.randn(4, 8)
+            with flow.no_grad():
+                traced(x, 2.0)
+            test_case.assertEqual(traced.num_cached_graphs, 0)
+        finally:
+            del os.environ["ONEFLOW_DISABLE_GRAPH_TRACE"]
+
+    # Compare eager and traced inference:
+    # ONEFLOW_TEST_TRACE_BENCHMARK=1 python3 test_graph_trace.py \
+    #     TestGraphTrace.test_trace_benchmark
+    @unittest.skipUnless(os.getenv("ONEFLOW_TEST_TRACE_BENCHMARK"), "benchmark only")
+    def test_trace_benchmark(test_case):
+        layers = []
+        for _ in range(16):
+            layers += [flow.nn.Linear(64, 64), flow.nn.ReLU()]
+        model = flow.nn.Sequential(*layers)
+        model.eval()
+        traced = flow.nn.Graph.trace(model)
+        x = flow.randn(8, 64)
+        num_iters = 200
+        with flow.no_grad():
+            for name, fn in [("eager", model), ("traced", traced)]:
+                for _ in range(3):
+                    fn(x).numpy()
+                start = time.perf_counter()
+                for _ in range(num_iters):
+                    out = fn(x)
+                out.numpy()
+                elapsed = (time.perf_counter() - start) / num_iters
+                print("%8s: %10.3f us/iter" % (name, elapsed * 1e6))
+
+
+if __name__ == "__main__":
+    unittest.main()
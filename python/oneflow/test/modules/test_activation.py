@@ -409,6 +409,30 @@ def do_test_softmax(batch_size: int, log_softmax: bool = False):
     return y
 
 
+def _np_softmax(x, log_softmax):
+    shifted = x - x.max(axis=-1, keepdims=True)
+    exp_sum = np.exp(shifted).sum(axis=-1, keepdims=True)
+    if log_softmax:
+        return shifted - np.log(exp_sum)
+    return np.exp(shifted) / exp_sum
+
+
+def _test_softmax_long_rows(test_case, log_softmax):
+    # The CPU kernel walks the rows in blocks of 1024 columns, these rows span several
+    # blocks and some start with -inf blocks, as masked_fill leaves them for left pads.
+    cols = 3000
+    x = np.random.randn(5, cols).astype(np.float32)
+    x[1, :1500] = -np.inf
+    x[2, :1024] = -np.inf
+    x[3, 1024:2048] = -np.inf
+    x[4, ::2] = -np.inf
+    func = flow.nn.functional.log_softmax if log_softmax else flow.nn.functional.softmax
+    y = func(flow.tensor(x, device="cpu"), dim=-1).numpy()
+    test_case.assertFalse(np.isnan(y).any())
+    y_np = _np_softmax(x.astype(np.float64), log_softmax)
+    test_case.assertTrue(np.allclose(y, y_np, rtol=1e-4, atol=1e-6))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestSoftmax(flow.unittest.TestCase):
     @autotest(check_graph=True)
@@ -427,6 +451,9 @@ class TestSoftmax(flow.unittest.TestCase):
     def test_softmax_module_with_batch_size_equal_10240(test_case):
         return do_test_softmax(batch_size=10240, log_softmax=False)
 
+    def test_softmax_cpu_long_rows(test_case):
+        _test_softmax_long_rows(test_case, log_softmax=False)
+
     @profile(torch.nn.functional.softmax)
     def profile_softmax(test_case):
         torch.nn.functional.softmax(torch.ones(1, 128, 28, 28))
@@ -451,6 +478,9 @@ class TestLogSoftmaxModule(flow.unittest.TestCase):
     def test_softmax_module_with_batch_size_equal_10240(test_case):
         return do_test_softmax(batch_size=10240, log_softmax=True)
 
+    def test_logsoftmax_cpu_long_rows(test_case):
+        _test_softmax_long_rows(test_case, log_softmax=True)
+
 
 @flow.unittest.skip_unless_1n1d()
 class TestLogSigmoidModule(flow.unittest.TestCase):
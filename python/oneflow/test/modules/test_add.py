@@ -254,6 +254,17 @@ class TestAddModule(flow.unittest.TestCase):
         z3 = torch.add(s, x3, alpha=alpha)
         return z1, z2, z3
 
+    @profile(torch.add)
+    def profile_add(test_case):
+        x = torch.ones(16, 256, 56, 56)
+        # same shape, scalar, row (bias), column and general broadcast
+        torch.add(x, torch.ones(16, 256, 56, 56))
+        torch.add(x, torch.ones(1))
+        torch.add(x, torch.ones(56))
+        torch.add(x, torch.ones(16, 256, 1, 1))
+        torch.add(x, torch.ones(1, 256, 1, 56))
+        torch.add(torch.ones(4096, 1), torch.ones(1, 4096))
+
 
 if __name__ == "__main__":
     unittest.main()
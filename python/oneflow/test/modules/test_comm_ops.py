@@ -17,6 +17,7 @@ limitations under the License.
 import numpy as np
 import unittest
 import os
+import time
 
 import oneflow as flow
 import oneflow.unittest
@@ -25,6 +26,13 @@ import torch
 import torch.distributed as dist
 
 
+def _restore_env(name, value):
+    if value is None:
+        os.environ.pop(name, None)
+    else:
+        os.environ[name] = value
+
+
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 class TestAllReduce(flow.unittest.TestCase):
     @flow.unittest.skip_unless_1n2d()
@@ -176,6 +184,80 @@ class TestReduceScatter(flow.unittest.TestCase):
         )
 
 
+class TestCpuCollectives(flow.unittest.TestCase):
+    def _to_global(test_case, tensor, src_sbp, dst_sbp):
+        placement = flow.env.all_device_placement("cpu")
+        tensor = tensor.to_global(placement=placement, sbp=src_sbp)
+        return tensor.to_global(placement=placement, sbp=dst_sbp).to_local()
+
+    @flow.unittest.skip_unless_1n4d()
+    def test_cpu_all_reduce_1n4d(test_case):
+        rank = flow.env.get_rank()
+        old_chunk_bytes = os.environ.get("ONEFLOW_CCL_CPU_CHUNK_BYTES")
+        try:
+            # recursive doubling, single chunk ring and many chunk ring
+            for chunk_bytes in ["1048576", "64"]:
+                os.environ["ONEFLOW_CCL_CPU_CHUNK_BYTES"] = chunk_bytes
+                for elem_cnt in [1, 7, 1000, 100003]:
+                    np_arr = np.arange(elem_cnt, dtype=np.float32) % 97
+                    tensor = flow.tensor(np_arr + rank, device="cpu")
+                    out = test_case._to_global(
+                        tensor, flow.sbp.partial_sum, flow.sbp.broadcast
+                    )
+                    test_case.assertTrue(np.array_equal(out.numpy(), np_arr * 4 + 6))
+        finally:
+            _restore_env("ONEFLOW_CCL_CPU_CHUNK_BYTES", old_chunk_bytes)
+
+    @flow.unittest.skip_unless_1n4d()
+    def test_cpu_all_gather_1n4d(test_case):
+        old_chunk_bytes = os.environ.get("ONEFLOW_CCL_CPU_CHUNK_BYTES")
+        os.environ["ONEFLOW_CCL_CPU_CHUNK_BYTES"] = "64"
+        try:
+            rank = flow.env.get_rank()
+            tensor = flow.tensor(np.arange(1001) + rank, device="cpu", dtype=flow.int32)
+            out = test_case._to_global(tensor, flow.sbp.split(0), flow.sbp.broadcast)
+            expected = np.concatenate([np.arange(1001) + i for i in range(4)])
+            test_case.assertTrue(np.array_equal(out.numpy(), expected))
+        finally:
+            _restore_env("ONEFLOW_CCL_CPU_CHUNK_BYTES", old_chunk_bytes)
+
+    @flow.unittest.skip_unless_1n4d()
+    def test_cpu_reduce_scatter_1n4d(test_case):
+        old_chunk_bytes = os.environ.get("ONEFLOW_CCL_CPU_CHUNK_BYTES")
+        os.environ["ONEFLOW_CCL_CPU_CHUNK_BYTES"] = "64"
+        try:
+            rank = flow.env.get_rank()
+            tensor = flow.tensor(np.arange(4004) + rank, device="cpu", dtype=flow.int32)
+            out = test_case._to_global(tensor, flow.sbp.partial_sum, flow.sbp.split(0))
+            expected = np.arange(1001 * rank, 1001 * (rank + 1)) * 4 + 6
+            test_case.assertTrue(np.array_equal(out.numpy(), expected))
+        finally:
+            _restore_env("ONEFLOW_CCL_CPU_CHUNK_BYTES", old_chunk_bytes)
+
+    # ONEFLOW_TEST_CCL_BENCHMARK=1 python3 -m oneflow.distributed.launch \
+    #     --nproc_per_node 4 test_comm_ops.py \
+    #     TestCpuCollectives.test_cpu_all_reduce_benchmark
+    @unittest.skipUnless(os.getenv("ONEFLOW_TEST_CCL_BENCHMARK"), "benchmark only")
+    def test_cpu_all_reduce_benchmark(test_case):
+        for elem_cnt in [1 << 8, 1 << 12, 1 << 16, 1 << 20, 1 << 24]:
+            tensor = flow.ones(elem_cnt, dtype=flow.float32)
+            test_case._to_global(tensor, flow.sbp.partial_sum, flow.sbp.broadcast)
+            num_iters = 10
+            flow.comm.barrier()
+            start = time.perf_counter()
+            for _ in range(num_iters):
+                out = test_case._to_global(
+                    tensor, flow.sbp.partial_sum, flow.sbp.broadcast
+                )
+                out.numpy()
+            elapsed = (time.perf_counter() - start) / num_iters
+            if flow.env.get_rank() == 0:
+                print(
+                    "all_reduce %10d bytes: %10.3f ms, %8.3f GB/s"
+                    % (elem_cnt * 4, elapsed * 1e3, elem_cnt * 4 / elapsed / 1e9)
+                )
+
+
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n2d()
 class TestDocs(flow.unittest.TestCase):
@@ -189,6 +189,16 @@ class TestModule(flow.unittest.TestCase):
         x = random_tensor(4, 2, 3, random(0, 3)).to(device)
         return torch.cat((x,), 0)
 
+    @profile(torch.cat)
+    def profile_cat(test_case):
+        # concats along the outer dim (few long rows) and the inner dim (many short rows)
+        x = torch.ones(64, 512, 1024)
+        torch.cat((x, x), 0)
+        torch.cat((x, x), 1)
+        torch.cat((x, x), 2)
+        y = torch.ones(65536, 16)
+        torch.cat((y, y, y, y), 1)
+
 
 if __name__ == "__main__":
     unittest.main()
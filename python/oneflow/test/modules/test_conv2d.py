@@ -1563,6 +1563,39 @@ def _test_conv2d_large_out_channel(test_case, device):
     test_case.assertTrue(np.allclose(input.grad.numpy(), np_grad, 1e-3, 1e-3))
 
 
+# ConvCpuAlgorithm::kWinogradF4x4K3x3, see ONEFLOW_CPU_CONV_ALGORITHM
+_CPU_CONV_WINOGRAD_F4X4 = 3
+
+
+def _set_env(**values):
+    # sets the env vars, or removes those set to None, and returns their old values
+    old_values = {name: os.environ.get(name) for name in values}
+    for name, value in values.items():
+        if value is None:
+            os.environ.pop(name, None)
+        else:
+            os.environ[name] = value
+    return old_values
+
+
+def _np_conv2d(x, weight, bias, padding):
+    x = np.pad(x, ((0, 0), (0, 0), (padding, padding), (padding, padding)))
+    kernel_h, kernel_w = weight.shape[2:]
+    out_h = x.shape[2] - kernel_h + 1
+    out_w = x.shape[3] - kernel_w + 1
+    out = np.zeros((x.shape[0], weight.shape[0], out_h, out_w))
+    for i in range(kernel_h):
+        for j in range(kernel_w):
+            out += np.einsum(
+                "nchw,fc->nfhw",
+                x[:, :, i : i + out_h, j : j + out_w],
+                weight[:, :, i, j],
+            )
+    if bias is not None:
+        out += bias.reshape(1, -1, 1, 1)
+    return out
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestConv2d(flow.unittest.TestCase):
     def test_conv2d_default_init(test_case):
@@ -1996,6 +2029,61 @@ class TestConv2d(flow.unittest.TestCase):
         )
         os.environ["ONEFLOW_ENABLE_NHWC"] = "0"
 
+    @autotest(n=3)
+    def test_conv2d_cpu_algorithms(test_case):
+        # 1x1 and 3x3 convs go through the direct, Winograd and blocked NCHWc paths
+        kernel_size = random(1, 4).to(int).value() // 2 * 2 + 1
+        stride = random(1, 3).to(int).value()
+        padding = kernel_size // 2
+        m = torch.nn.Conv2d(16, 24, kernel_size, stride=stride, padding=padding)
+        m.train(random())
+        m.to("cpu")
+        x = random_tensor(ndim=4, dim1=16, dim2=random(5, 20), dim3=random(5, 20)).to(
+            "cpu"
+        )
+        return m(x)
+
+    def test_conv2d_cpu_winograd_f4x4(test_case):
+        x = np.random.randn(2, 16, 17, 19)
+        weight = np.random.randn(8, 16, 3, 3)
+        bias = np.random.randn(8)
+        expected = _np_conv2d(x, weight, bias, padding=1)
+        old_env = _set_env(
+            ONEFLOW_CPU_CONV_ALGORITHM=str(_CPU_CONV_WINOGRAD_F4X4),
+            ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE="0",
+        )
+        try:
+            out = flow.nn.functional.conv2d(
+                flow.tensor(x, dtype=flow.float32),
+                flow.tensor(weight, dtype=flow.float32),
+                flow.tensor(bias, dtype=flow.float32),
+                padding=1,
+            ).numpy()
+        finally:
+            _set_env(**old_env)
+        test_case.assertTrue(np.allclose(out, expected, rtol=1e-3, atol=1e-3))
+
+    def test_conv2d_cpu_transformed_weight_cache(test_case):
+        # double, the oneDNN packed weights only take float
+        x = flow.tensor(np.random.randn(1, 16, 9, 9), dtype=flow.float64)
+        # kept alive, a freed weight buffer may be reused at the same address
+        weights = [
+            flow.tensor(np.random.randn(8, 16, 3, 3), dtype=flow.float64)
+            for _ in range(2)
+        ]
+        old_env = _set_env(
+            ONEFLOW_CPU_CONV_ALGORITHM=str(_CPU_CONV_WINOGRAD_F4X4),
+            ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE="1",
+        )
+        try:
+            # another weight buffer is transformed again
+            for weight in weights + weights:
+                out = flow.nn.functional.conv2d(x, weight, padding=1).numpy()
+                expected = _np_conv2d(x.numpy(), weight.numpy(), None, padding=1)
+                test_case.assertTrue(np.allclose(out, expected, rtol=1e-6, atol=1e-6))
+        finally:
+            _set_env(**old_env)
+
     @profile(torch.nn.functional.conv2d)
     def profile_conv2d(test_case):
         input = torch.ones(8, 128, 28, 28)
@@ -2005,6 +2093,12 @@ class TestConv2d(flow.unittest.TestCase):
         torch.nn.functional.conv2d(input, weight, padding=1, stride=2)
         torch.nn.functional.conv2d(input, weight, bias=bias, padding=1)
         torch.nn.functional.conv2d(input, weight, bias=bias, padding=1, stride=2)
+        # batch 1 inference, see ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE
+        torch.nn.functional.conv2d(
+            torch.ones(1, 128, 28, 28), weight, bias=bias, padding=1
+        )
+        # 1x1, see ONEFLOW_CPU_CONV_ENABLE_AUTOTUNE
+        torch.nn.functional.conv2d(input, torch.ones(128, 128, 1, 1), bias=bias)
 
 
 if __name__ == "__main__":
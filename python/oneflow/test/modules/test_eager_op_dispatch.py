@@ -0,0 +1,111 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import time
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _test_repeated_signatures(test_case, device):
+    # alternate between signatures so that every call after the first two hits the
+    # local infer cache of the op
+    for shape in [(2, 3), (4, 5), (2, 3), (4, 5), (2, 3)]:
+        np_x = np.random.randn(*shape).astype(np.float32)
+        x = flow.tensor(np_x, device=device)
+        y = flow.relu(x) + 1
+        test_case.assertEqual(y.shape, flow.Size(shape))
+        test_case.assertEqual(y.dtype, flow.float32)
+        test_case.assertTrue(np.allclose(y.numpy(), np.maximum(np_x, 0) + 1))
+        z = x.to(flow.float64)
+        test_case.assertEqual(z.dtype, flow.float64)
+        test_case.assertTrue(np.allclose(z.numpy(), np_x))
+
+
+def _test_inplace(test_case, device):
+    np_x = np.random.randn(4, 4).astype(np.float32)
+    x = flow.tensor(np_x, device=device)
+    for i in range(3):
+        x.add_(1)
+        test_case.assertTrue(np.allclose(x.numpy(), np_x + i + 1))
+
+
+def _test_non_contiguous(test_case, device):
+    np_x = np.random.randn(3, 4).astype(np.float32)
+    x = flow.tensor(np_x, device=device)
+    for _ in range(2):
+        y = x.transpose(0, 1)
+        test_case.assertFalse(y.is_contiguous())
+        z = y.contiguous()
+        test_case.assertTrue(z.is_contiguous())
+        test_case.assertTrue(np.array_equal(z.numpy(), np_x.T))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerOpDispatch(flow.unittest.TestCase):
+    def test_repeated_signatures(test_case):
+        _test_repeated_signatures(test_case, "cpu")
+        if not os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            _test_repeated_signatures(test_case, "cuda")
+
+    def test_inplace(test_case):
+        _test_inplace(test_case, "cpu")
+
+    def test_non_contiguous(test_case):
+        _test_non_contiguous(test_case, "cpu")
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_device_infer(test_case):
+        for _ in range(3):
+            x = flow.ones(2, 2)
+            y = x.to("cuda")
+            test_case.assertEqual(y.device, flow.device("cuda:0"))
+            z = y.to("cpu")
+            test_case.assertEqual(z.device, flow.device("cpu"))
+            test_case.assertTrue(np.array_equal(z.numpy(), np.ones((2, 2))))
+
+    # Compare ONEFLOW_EAGER_ENABLE_LOCAL_INFER_CACHE=0 and =1:
+    # ONEFLOW_TEST_EAGER_DISPATCH_BENCHMARK=1 python3 test_eager_op_dispatch.py \
+    #     TestEagerOpDispatch.test_dispatch_latency_benchmark
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_EAGER_DISPATCH_BENCHMARK"), "benchmark only"
+    )
+    def test_dispatch_latency_benchmark(test_case):
+        x = flow.ones(4)
+        y = flow.ones(4)
+        cases = [
+            ("relu", lambda: flow.relu(x)),
+            ("add", lambda: flow.add(x, y)),
+            ("mul_scalar", lambda: x * 2),
+            ("reshape", lambda: flow.reshape(x, (2, 2))),
+        ]
+        num_iters = 10000
+        for name, fn in cases:
+            for _ in range(100):
+                fn()
+            flow._oneflow_internal.eager.Sync()
+            start = time.perf_counter()
+            for _ in range(num_iters):
+                fn()
+            flow._oneflow_internal.eager.Sync()
+            elapsed = (time.perf_counter() - start) / num_iters
+            print("%12s: %8.2f us/call" % (name, elapsed * 1e6))
+
+
+if __name__ == "__main__":
+    unittest.main()
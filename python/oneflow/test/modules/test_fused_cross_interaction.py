@@ -150,5 +150,30 @@ class TestFusedCrossFeatureInteraction(flow.unittest.TestCase):
             arg[0](test_case, *arg[1:])
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestFusedCrossFeatureInteractionCpu(flow.unittest.TestCase):
+    def test_fused_cross_feature_interaction_v1(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_fused_cross_feature_interaction_v1]
+        args_dict["batchsize"] = [1, 4, 100]
+        args_dict["in_feature"] = [32, 97]
+        args_dict["dtype"] = [flow.float32, flow.float64]
+        args_dict["device"] = ["cpu"]
+
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+    def test_fused_cross_feature_interaction_v2(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_fused_cross_feature_interaction_v2]
+        args_dict["batchsize"] = [1, 4, 100]
+        args_dict["in_feature"] = [32, 97]
+        args_dict["dtype"] = [flow.float32, flow.float64]
+        args_dict["device"] = ["cpu"]
+
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+
 if __name__ == "__main__":
     unittest.main()
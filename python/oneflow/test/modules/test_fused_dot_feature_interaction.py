@@ -21,6 +21,7 @@ import numpy as np
 import oneflow as flow
 import oneflow.unittest
 import os
+import time
 
 
 def _test_fused_dot_feature_interaction(
@@ -40,8 +41,8 @@ def _test_fused_dot_feature_interaction(
         np_dtype = np.float32
     feature_0_np = np.random.rand(batch_size, embedding_size).astype(np_dtype)
     feature_1_np = np.random.rand(batch_size, 26, embedding_size).astype(np_dtype)
-    feature_0_tensor = flow.tensor(feature_0_np, device="cuda", requires_grad=True)
-    feature_1_tensor = flow.tensor(feature_1_np, device="cuda", requires_grad=True)
+    feature_0_tensor = flow.tensor(feature_0_np, device=device_type, requires_grad=True)
+    feature_1_tensor = flow.tensor(feature_1_np, device=device_type, requires_grad=True)
     if self_interaction:
         offset = 1
     else:
@@ -67,7 +68,7 @@ def _test_fused_dot_feature_interaction(
     if output_padding != 0:
         padding_tensor = flow.tensor(
             np.zeros((batch_size, output_padding)).astype(np_dtype),
-            device="cuda",
+            device=device_type,
             requires_grad=False,
         )
         R = flow.cat([R, padding_tensor], dim=1)
@@ -75,10 +76,10 @@ def _test_fused_dot_feature_interaction(
     loss.backward()
 
     fused_feature_0_tensor = flow.tensor(
-        feature_0_np, device="cuda", requires_grad=True
+        feature_0_np, device=device_type, requires_grad=True
     )
     fused_feature_1_tensor = flow.tensor(
-        feature_1_np, device="cuda", requires_grad=True
+        feature_1_np, device=device_type, requires_grad=True
     )
     if output_concat:
         output_concat_tensor = fused_feature_0_tensor
@@ -131,10 +132,10 @@ def _test_fused_dot_feature_interaction_pooling_sum(
         feature_np = np.random.uniform(-1, 1, (batch_size, dim, embedding_size)).astype(
             np_dtype
         )
-        feature_tensor = flow.tensor(feature_np, device="cuda", requires_grad=True)
+        feature_tensor = flow.tensor(feature_np, device=device_type, requires_grad=True)
         feature_tensor_list.append(feature_tensor)
         fused_feature_tensor = flow.tensor(
-            feature_np, device="cuda", requires_grad=True
+            feature_np, device=device_type, requires_grad=True
         )
         fused_feature_tensor_list.append(fused_feature_tensor)
 
@@ -193,5 +194,61 @@ class FusedDotFeatureInteractionTestCase(flow.unittest.TestCase):
             _test_fused_dot_feature_interaction_pooling_sum(test_case, **kwargs)
 
 
+@flow.unittest.skip_unless_1n1d()
+class FusedDotFeatureInteractionCpuTestCase(flow.unittest.TestCase):
+    def test_fused_dot_feature_interaction(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["embedding_size"] = [128, 15]
+        arg_dict["self_interaction"] = [False, True]
+        arg_dict["output_concat"] = [True, False]
+        arg_dict["output_padding"] = [1, 0]
+        arg_dict["dtype"] = [flow.float32]
+        arg_dict["device_type"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_fused_dot_feature_interaction(test_case, **kwargs)
+
+    def test_fused_dot_feature_interaction_pooling_sum(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["dtype"] = [flow.float32]
+        arg_dict["feature_dims"] = [[39], [1, 10, 3]]
+        arg_dict["embedding_size"] = [16, 11]
+        arg_dict["device_type"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_fused_dot_feature_interaction_pooling_sum(test_case, **kwargs)
+
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_FUSED_DOT_FEATURE_INTERACTION_BENCHMARK"),
+        "benchmark only",
+    )
+    def test_fused_dot_feature_interaction_benchmark(test_case):
+        batch_size = 4096
+        dense = flow.randn(batch_size, 128)
+        sparse = flow.randn(batch_size, 26, 128)
+        li = flow.tensor([i for i in range(27) for j in range(i)])
+        lj = flow.tensor([j for i in range(27) for j in range(i)])
+
+        def unfused():
+            T = flow.cat([dense.reshape(batch_size, 1, 128), sparse], dim=1)
+            Z = flow.matmul(T, T, transpose_b=True)
+            return flow.cat([dense, Z[:, li, lj]], dim=1)
+
+        def fused():
+            return flow._C.fused_dot_feature_interaction(
+                [dense.reshape(batch_size, 1, 128), sparse],
+                output_concat=dense,
+                self_interaction=False,
+                output_padding=1,
+                pooling="none",
+            )
+
+        for name, fn in [("unfused", unfused), ("fused", fused)]:
+            fn().numpy()
+            start = time.perf_counter()
+            for _ in range(10):
+                fn().numpy()
+            elapsed = (time.perf_counter() - start) / 10
+            print(name, elapsed * 1000, "ms", batch_size / elapsed, "samples/s")
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -171,6 +171,62 @@ def _test_fused_matmul_bias_add_relu_dropout(
     )
 
 
+def _test_fused_matmul_bias_add_relu_dropout_with_dropout(
+    test_case, skip_final_activation, rate, dtype, device
+):
+    # One layer, so the mask is visible in the output: the kept elements are not 0. The
+    # backward reads the mask from the aux bits, which have to match the forward mask.
+    batchsize, in_feature, out_feature = 64, 48, 100
+    x = np.random.uniform(low=-1, high=1, size=(batchsize, in_feature))
+    weight = np.random.uniform(low=-1, high=1, size=(out_feature, in_feature))
+    bias = np.random.uniform(low=-1, high=1, size=out_feature)
+    dy = np.random.uniform(low=-1, high=1, size=(batchsize, out_feature))
+
+    fused_x = flow.tensor(x, dtype=dtype, device=device, requires_grad=True)
+    fused_weight = flow.tensor(weight, dtype=dtype, device=device, requires_grad=True)
+    fused_bias = flow.tensor(bias, dtype=dtype, device=device, requires_grad=True)
+    fused_out = flow._C.fused_matmul_bias_add_relu_dropout(
+        fused_x,
+        [fused_weight],
+        [fused_bias],
+        dropout_rate_list=[rate],
+        skip_final_activation=skip_final_activation,
+    )
+    (fused_out * flow.tensor(dy, dtype=dtype, device=device)).sum().backward()
+
+    out = fused_out.numpy()
+    pre_activation = np.matmul(x, weight.T) + bias
+    if not skip_final_activation:
+        pre_activation = np.maximum(pre_activation, 0)
+    scale = 1.0 / (1.0 - rate)
+    mask = out != 0
+    test_case.assertTrue(
+        np.allclose(out, pre_activation * mask * scale, atol=1e-4, rtol=1e-4)
+    )
+    # the dropped share of the elements that would have been non-zero
+    dropped = np.logical_and(pre_activation != 0, np.logical_not(mask))
+    dropped_rate = dropped.sum() / (pre_activation != 0).sum()
+    test_case.assertTrue(abs(dropped_rate - rate) < 0.1)
+
+    naive_x = flow.tensor(x, dtype=dtype, device=device, requires_grad=True)
+    naive_weight = flow.tensor(weight, dtype=dtype, device=device, requires_grad=True)
+    naive_bias = flow.tensor(bias, dtype=dtype, device=device, requires_grad=True)
+    naive_out = _matmul_bias_relu(
+        naive_x, naive_weight, naive_bias, skip_final_activation
+    )
+    naive_out = naive_out * flow.tensor(mask * scale, dtype=dtype, device=device)
+    (naive_out * flow.tensor(dy, dtype=dtype, device=device)).sum().backward()
+
+    for fused, naive in [
+        (fused_x, naive_x),
+        (fused_weight, naive_weight),
+        (fused_bias, naive_bias),
+    ]:
+        test_case.assertTrue(
+            np.allclose(fused.grad.numpy(), naive.grad.numpy(), atol=1e-4, rtol=1e-4)
+        )
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestFusedMatmulBiasAddReluDropout(flow.unittest.TestCase):
     def test_fused_matmul_bias_add_relu_dropout(test_case):
@@ -182,7 +238,18 @@ class TestFusedMatmulBiasAddReluDropout(flow.unittest.TestCase):
         args_dict["out_feature"] = [512, 400, 1024, 1]
         args_dict["skip_final_activation"] = [False]
         args_dict["dtype"] = [flow.float32]
-        args_dict["device"] = ["cuda"]
+        args_dict["device"] = ["cuda", "cpu"]
+
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+    def test_fused_matmul_bias_add_relu_dropout_cpu_dropout(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_func"] = [_test_fused_matmul_bias_add_relu_dropout_with_dropout]
+        args_dict["skip_final_activation"] = [False, True]
+        args_dict["rate"] = [0.3, 0.5]
+        args_dict["dtype"] = [flow.float32]
+        args_dict["device"] = ["cpu"]
 
         for arg in GenArgList(args_dict):
             arg[0](test_case, *arg[1:])
@@ -0,0 +1,208 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import time
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _attention_reference(query, key, value, key_padding_mask, causal, scale):
+    scores = flow.matmul(query, key.transpose(-2, -1)) * scale
+    seq_len_q, seq_len_k = query.shape[-2], key.shape[-2]
+    keep = np.ones((query.shape[0], 1, seq_len_q, seq_len_k), dtype=np.bool)
+    if causal:
+        keep &= np.tril(
+            np.ones((seq_len_q, seq_len_k), dtype=np.bool), k=seq_len_k - seq_len_q
+        )
+    if key_padding_mask is not None:
+        keep &= key_padding_mask.reshape(query.shape[0], 1, 1, seq_len_k)
+    scores = flow.masked_fill(
+        scores, flow.tensor(~keep, device=query.device), float("-inf")
+    )
+    return flow.matmul(flow.softmax(scores, dim=-1), value)
+
+
+def _test_fused_multi_head_attention(
+    test_case,
+    batch_size,
+    num_heads,
+    seq_len_q,
+    seq_len_k,
+    head_size,
+    causal,
+    use_key_padding_mask,
+    dtype,
+):
+    query = np.random.randn(batch_size, num_heads, seq_len_q, head_size)
+    key = np.random.randn(batch_size, num_heads, seq_len_k, head_size)
+    value = np.random.randn(batch_size, num_heads, seq_len_k, head_size)
+    out_grad = np.random.randn(batch_size, num_heads, seq_len_q, head_size)
+    key_padding_mask = np.random.randint(
+        0, 2, size=(batch_size, seq_len_k), dtype=np.bool
+    )
+    # Every query attends to at least one key so the reference softmax stays finite.
+    key_padding_mask[:, 0] = True
+    # The scale attr is a float, keep the float64 reference on the same value.
+    scale = float(np.float32(1.0 / np.sqrt(head_size)))
+
+    def run(fused):
+        q = flow.tensor(query, dtype=dtype, requires_grad=True)
+        k = flow.tensor(key, dtype=dtype, requires_grad=True)
+        v = flow.tensor(value, dtype=dtype, requires_grad=True)
+        mask = key_padding_mask if use_key_padding_mask else None
+        if fused:
+            out = flow._C.fused_multi_head_attention(
+                q,
+                k,
+                v,
+                key_padding_mask=None if mask is None else flow.tensor(mask),
+                causal=causal,
+                scale=scale,
+            )
+        else:
+            out = _attention_reference(q, k, v, mask, causal, scale)
+        out.backward(flow.tensor(out_grad, dtype=dtype))
+        return [t.numpy() for t in (out, q.grad, k.grad, v.grad)]
+
+    tol = 1e-4 if dtype == flow.float32 else 1e-8
+    for fused, origin in zip(run(True), run(False)):
+        test_case.assertTrue(np.allclose(fused, origin, atol=tol, rtol=tol))
+
+
+def _test_fused_multi_head_attention_dropout(test_case):
+    query = flow.randn(2, 4, 40, 16, requires_grad=True)
+    key = flow.randn(2, 4, 70, 16)
+    value = flow.randn(2, 4, 70, 16)
+    scale = 0.25
+    eval_out = flow._C.fused_multi_head_attention(
+        query, key, value, scale=scale, dropout_rate=0.5, training=False
+    )
+    origin_out = _attention_reference(query, key, value, None, False, scale)
+    test_case.assertTrue(
+        np.allclose(eval_out.numpy(), origin_out.numpy(), atol=1e-4, rtol=1e-4)
+    )
+    train_out = flow._C.fused_multi_head_attention(
+        query, key, value, scale=scale, dropout_rate=0.5
+    )
+    test_case.assertFalse(
+        np.allclose(train_out.numpy(), origin_out.numpy(), atol=1e-4, rtol=1e-4)
+    )
+    train_out.sum().backward()
+    test_case.assertTrue(np.isfinite(query.grad.numpy()).all())
+
+
+class AttentionModule(flow.nn.Module):
+    def __init__(self, hidden_size, num_heads):
+        super().__init__()
+        self.num_heads = num_heads
+        self.head_size = hidden_size // num_heads
+        self.qkv = flow.nn.Linear(hidden_size, hidden_size * 3)
+
+    def forward(self, x):
+        batch_size, seq_len, _ = x.shape
+        qkv = self.qkv(x).reshape(
+            batch_size, seq_len, 3, self.num_heads, self.head_size
+        )
+        qkv = qkv.permute(2, 0, 3, 1, 4)
+        query, key, value = qkv[0], qkv[1], qkv[2]
+        scores = flow.matmul(query, key.transpose(-2, -1)) / self.head_size ** 0.5
+        return flow.matmul(flow.softmax(scores, dim=-1), value)
+
+
+class AttentionGraph(flow.nn.Graph):
+    def __init__(self, module):
+        super().__init__()
+        self.m = module
+        self.config.allow_fuse_multi_head_attention(True)
+
+    def build(self, x):
+        return self.m(x)
+
+
+def _test_fuse_multi_head_attention_pass(test_case):
+    module = AttentionModule(64, 4)
+    x = flow.randn(2, 48, 64)
+    graph = AttentionGraph(module)
+    lazy_out = graph(x)
+    eager_out = module(x)
+    test_case.assertTrue(
+        np.allclose(lazy_out.numpy(), eager_out.numpy(), atol=1e-4, rtol=1e-4)
+    )
+    op_type_names = [
+        op.user_conf.op_type_name
+        for op in graph._full_job_proto.net.op
+        if op.HasField("user_conf")
+    ]
+    test_case.assertTrue("fused_multi_head_attention" in op_type_names)
+    test_case.assertFalse("softmax" in op_type_names)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedMultiHeadAttention(flow.unittest.TestCase):
+    def test_fused_multi_head_attention(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_fused_multi_head_attention]
+        args_dict["batch_size"] = [2]
+        args_dict["num_heads"] = [1, 3]
+        args_dict["seq_len_q"] = [1, 33, 100]
+        args_dict["seq_len_k"] = [100, 130]
+        args_dict["head_size"] = [16, 40]
+        args_dict["causal"] = [False, True]
+        args_dict["use_key_padding_mask"] = [False, True]
+        args_dict["dtype"] = [flow.float32, flow.float64]
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+    def test_fused_multi_head_attention_dropout(test_case):
+        _test_fused_multi_head_attention_dropout(test_case)
+
+    def test_fuse_multi_head_attention_pass(test_case):
+        _test_fuse_multi_head_attention_pass(test_case)
+
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_FUSED_MHA_BENCHMARK"), "benchmark only"
+    )
+    def test_fused_multi_head_attention_benchmark(test_case):
+        query = flow.randn(8, 16, 1024, 64)
+        key = flow.randn(8, 16, 1024, 64)
+        value = flow.randn(8, 16, 1024, 64)
+        for name, fn in [
+            (
+                "unfused",
+                lambda: _attention_reference(query, key, value, None, True, 0.125),
+            ),
+            (
+                "fused",
+                lambda: flow._C.fused_multi_head_attention(
+                    query, key, value, causal=True, scale=0.125
+                ),
+            ),
+        ]:
+            fn().numpy()
+            start = time.perf_counter()
+            for _ in range(10):
+                fn().numpy()
+            print(name, (time.perf_counter() - start) / 10 * 1000, "ms")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -24,9 +24,11 @@ from oneflow.test_utils.test_util import GenArgList
 import oneflow as flow
 import oneflow.unittest
 
+test_device = ["cpu"] if os.getenv("ONEFLOW_TEST_CPU_ONLY") else ["cpu", "cuda"]
+
 
 def _test_fused_scale_mask_softmax(
-    test_case, batch_size, num_heads, seq_length, fill_value, scale_value,
+    test_case, batch_size, num_heads, seq_length, fill_value, scale_value, device,
 ):
 
     x = np.random.randn(batch_size, num_heads, seq_length, seq_length)
@@ -34,16 +36,16 @@ def _test_fused_scale_mask_softmax(
         0, 2, size=(batch_size, num_heads, seq_length, seq_length), dtype=np.bool
     )
 
-    fused_x_tensor = flow.tensor(x).to("cuda")
-    fused_mask_tensor = flow.tensor(mask, dtype=flow.bool).to("cuda")
+    fused_x_tensor = flow.tensor(x).to(device)
+    fused_mask_tensor = flow.tensor(mask, dtype=flow.bool).to(device)
     fused_x_tensor.requires_grad = True
 
     fused_out = flow._C.fused_scale_mask_softmax(
         fused_x_tensor, fused_mask_tensor, fill_value=fill_value, scale=scale_value,
     )
 
-    origin_x_tensor = flow.tensor(x).to("cuda")
-    origin_mask_tensor = flow.tensor(mask, dtype=flow.float32).to("cuda")
+    origin_x_tensor = flow.tensor(x).to(device)
+    origin_mask_tensor = flow.tensor(mask, dtype=flow.float32).to(device)
     origin_x_tensor.requires_grad = True
     origin_out = flow.mul(
         origin_x_tensor, origin_mask_tensor
@@ -67,7 +69,6 @@ def _test_fused_scale_mask_softmax(
 
 
 @flow.unittest.skip_unless_1n1d()
-@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test gpu cases")
 class TestFusedScaleMaskSoftmax(flow.unittest.TestCase):
     def test_fused_op(test_case):
         args_dict = OrderedDict()
@@ -77,6 +78,7 @@ class TestFusedScaleMaskSoftmax(flow.unittest.TestCase):
         args_dict["seq_length"] = [16, 32, 64]
         args_dict["fill_value"] = [-10000.0]
         args_dict["scale_value"] = [1.0, 2.0, 4.0]
+        args_dict["device"] = test_device
 
         for arg in GenArgList(args_dict):
             arg[0](test_case, *arg[1:])
@@ -15,6 +15,7 @@ limitations under the License.
 """
 
 import unittest
+import os
 from collections import OrderedDict
 
 import numpy as np
@@ -158,6 +159,34 @@ def _test_linear_backward_with_bias(test_case, device):
     test_case.assertTrue(np.allclose(np_grad, x.grad.numpy(), 0.0001, 0.0001))
 
 
+def _test_linear_with_packed_weight(test_case, device):
+    np_x = np.random.randn(2, 3, 16).astype(np.float32)
+    np_weight = np.random.randn(8, 16).astype(np.float32)
+    np_bias = np.random.randn(8).astype(np.float32)
+    x = flow.tensor(np_x, device=device)
+    linear = flow.nn.Linear(16, 8).to(device)
+    linear.weight = flow.nn.Parameter(flow.tensor(np_weight, device=device))
+    linear.bias = flow.nn.Parameter(flow.tensor(np_bias, device=device))
+    old_env = os.environ.get("ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE")
+    os.environ["ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE"] = "1"
+    try:
+        for _ in range(3):
+            of_out = linear(x)
+            np_out = np.matmul(np_x, np_weight.T) + np_bias
+            test_case.assertTrue(np.allclose(of_out.numpy(), np_out, 1e-4, 1e-4))
+        # a new weight buffer must be packed again
+        np_weight = np.random.randn(8, 16).astype(np.float32)
+        linear.weight = flow.nn.Parameter(flow.tensor(np_weight, device=device))
+        of_out = linear(x[0])
+        np_out = np.matmul(np_x[0], np_weight.T) + np_bias
+        test_case.assertTrue(np.allclose(of_out.numpy(), np_out, 1e-4, 1e-4))
+    finally:
+        if old_env is None:
+            del os.environ["ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE"]
+        else:
+            os.environ["ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE"] = old_env
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestLinear(flow.unittest.TestCase):
     def test_linear_forward(test_case):
@@ -173,6 +202,9 @@ class TestLinear(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_linear_with_packed_weight(test_case):
+        _test_linear_with_packed_weight(test_case, "cpu")
+
     def test_linear_backward(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_linear_backward_with_bias]
@@ -227,6 +259,16 @@ class TestLinear(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    @profile(torch.nn.functional.linear)
+    def profile_linear(test_case):
+        weight = torch.ones(1024, 1024)
+        bias = torch.ones(1024)
+        # small batches are dominated by the per-call weight packing of the BLAS
+        # library, run with ONEFLOW_CPU_ENABLE_PACKED_WEIGHT_CACHE=1 to pack once
+        torch.nn.functional.linear(torch.ones(1, 1024), weight, bias)
+        torch.nn.functional.linear(torch.ones(8, 1024), weight, bias)
+        torch.nn.functional.linear(torch.ones(128, 1024), weight, bias)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -13,6 +13,8 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+import os
+import time
 import unittest
 from collections import OrderedDict
 
@@ -91,10 +93,25 @@ class TestNMS(flow.unittest.TestCase):
     def test_nms(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_nms]
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = (
+            ["cpu"] if os.getenv("ONEFLOW_TEST_CPU_ONLY") else ["cpu", "cuda"]
+        )
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    @unittest.skipUnless(os.getenv("ONEFLOW_TEST_NMS_BENCHMARK"), "benchmark only")
+    def test_nms_benchmark(test_case):
+        # the proposals of one image
+        boxes, scores = create_tensors_with_iou(1000, 0.5)
+        boxes = flow.tensor(boxes, dtype=flow.float32)
+        scores = flow.tensor(scores, dtype=flow.float32)
+        flow.nms(boxes, scores, 0.5).numpy()
+        start = time.perf_counter()
+        for _ in range(10):
+            flow.nms(boxes, scores, 0.5).numpy()
+        elapsed = (time.perf_counter() - start) / 10
+        print("nms", elapsed * 1000, "ms/image")
+
 
 if __name__ == "__main__":
     unittest.main()
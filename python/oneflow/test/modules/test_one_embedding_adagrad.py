@@ -26,9 +26,11 @@ from optimizer_test_util import clip_grad_norm_np
 import oneflow as flow
 from oneflow.nn.parameter import Parameter
 
+test_device = ["cpu"] if os.getenv("ONEFLOW_TEST_CPU_ONLY") else ["cpu", "cuda"]
+
 
 def compare_with_numpy_adagrad(
-    test_case, weight_decay, lr_decay, scale, learning_rate, train_iters,
+    test_case, weight_decay, lr_decay, scale, learning_rate, train_iters, device,
 ):
 
     num_rows = 500
@@ -50,14 +52,14 @@ def compare_with_numpy_adagrad(
 
     def adagrad_by_oneflow():
         unique_embeddings_tensor = flow.tensor(init_value, requires_grad=False).to(
-            "cuda"
+            device
         )
         lr_tensor = flow.tensor(
             np.array(learning_rate).reshape(1,).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
         down_scale_by_tensor = flow.tensor(
             np.array(down_scale_by).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
 
         def train_one_iter(
             num_valid, unique_embeddings, embedding_grad, skip_if, train_step
@@ -79,13 +81,13 @@ def compare_with_numpy_adagrad(
         for i in range(1, train_iters):
             num_valid_tensor = flow.tensor(
                 np.array(num_valid_seq[i]).reshape(1,).astype(np.int32)
-            ).to("cuda")
-            grad_tensor = flow.tensor(random_grad_seq[i]).to("cuda")
+            ).to(device)
+            grad_tensor = flow.tensor(random_grad_seq[i]).to(device)
             skip_if_tensor = flow.tensor(
                 np.array(skip_if_seq[i]).reshape(1,).astype(np.int64)
-            ).to("cuda")
+            ).to(device)
             step_tensor = flow.tensor(np.array(i).reshape(1,).astype(np.int64)).to(
-                "cuda"
+                device
             )
             updated_tensor = train_one_iter(
                 num_valid_tensor,
@@ -138,7 +140,6 @@ def compare_with_numpy_adagrad(
     )
 
 
-@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class TestOptimizers(flow.unittest.TestCase):
     def test_one_embedding_adagrad(test_case):
@@ -148,6 +149,7 @@ class TestOptimizers(flow.unittest.TestCase):
         arg_dict["scale"] = [1, 0.1]
         arg_dict["learning_rate"] = [0.3, 1.5]
         arg_dict["train_iters"] = [10]
+        arg_dict["device"] = test_device
         for arg in GenArgDict(arg_dict):
             compare_with_numpy_adagrad(test_case, **arg)
 
@@ -26,6 +26,8 @@ from optimizer_test_util import clip_grad_norm_np
 import oneflow as flow
 from oneflow.nn.parameter import Parameter
 
+test_device = ["cpu"] if os.getenv("ONEFLOW_TEST_CPU_ONLY") else ["cpu", "cuda"]
+
 
 def compare_with_numpy_adam(
     test_case,
@@ -36,6 +38,7 @@ def compare_with_numpy_adam(
     do_bias_correction,
     beta1,
     beta2,
+    device,
 ):
 
     num_rows = 500
@@ -57,14 +60,14 @@ def compare_with_numpy_adam(
 
     def adam_by_oneflow():
         unique_embeddings_tensor = flow.tensor(init_value, requires_grad=False).to(
-            "cuda"
+            device
         )
         lr_tensor = flow.tensor(
             np.array(learning_rate).reshape(1,).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
         down_scale_by_tensor = flow.tensor(
             np.array(down_scale_by).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
 
         def train_one_iter(
             num_valid,
@@ -94,20 +97,20 @@ def compare_with_numpy_adam(
         for i in range(1, train_iters):
             num_valid_tensor = flow.tensor(
                 np.array(num_valid_seq[i]).reshape(1,).astype(np.int32)
-            ).to("cuda")
-            grad_tensor = flow.tensor(random_grad_seq[i]).to("cuda")
+            ).to(device)
+            grad_tensor = flow.tensor(random_grad_seq[i]).to(device)
             skip_if_tensor = flow.tensor(
                 np.array(skip_if_seq[i]).reshape(1,).astype(np.int64)
-            ).to("cuda")
+            ).to(device)
             if do_bias_correction:
                 bias_correction1 = 1.0 - np.power(beta1, i)
                 bias_correction2 = 1.0 - np.power(beta2, i)
                 bias_correction1_tensor = flow.tensor(
                     np.array(bias_correction1).reshape(1,).astype(np.float32)
-                ).to("cuda")
+                ).to(device)
                 bias_correction2_tensor = flow.tensor(
                     np.array(bias_correction2).reshape(1,).astype(np.float32)
-                ).to("cuda")
+                ).to(device)
             else:
                 bias_correction1_tensor = None
                 bias_correction2_tensor = None
@@ -180,7 +183,6 @@ def compare_with_numpy_adam(
     )
 
 
-@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class TestOptimizers(flow.unittest.TestCase):
     def test_one_embedding_adam(test_case):
@@ -193,6 +195,7 @@ class TestOptimizers(flow.unittest.TestCase):
         arg_dict["beta1"] = [0.9, 0.8]
         arg_dict["beta2"] = [0.9, 0.8]
 
+        arg_dict["device"] = test_device
         for arg in GenArgDict(arg_dict):
             compare_with_numpy_adam(test_case, **arg)
 
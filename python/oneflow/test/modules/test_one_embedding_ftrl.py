@@ -25,6 +25,8 @@ from optimizer_test_util import clip_grad_norm_np
 import oneflow as flow
 from oneflow.nn.parameter import Parameter
 
+test_device = ["cpu"] if os.getenv("ONEFLOW_TEST_CPU_ONLY") else ["cpu", "cuda"]
+
 
 def compare_with_numpy_ftrl(
     test_case,
@@ -36,6 +38,7 @@ def compare_with_numpy_ftrl(
     scale,
     learning_rate,
     train_iters,
+    device,
 ):
     num_rows = 500
     embedding_size = 128
@@ -54,14 +57,14 @@ def compare_with_numpy_ftrl(
 
     def ftrl_by_oneflow():
         unique_embeddings_tensor = flow.tensor(init_value, requires_grad=False).to(
-            "cuda"
+            device
         )
         lr_tensor = flow.tensor(
             np.array(learning_rate).reshape(1,).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
         down_scale_by_tensor = flow.tensor(
             np.array(down_scale_by).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
 
         def train_one_iter(num_valid, unique_embeddings, embedding_grad, skip_if):
             return flow._C.one_embedding_ftrl_update(
@@ -82,11 +85,11 @@ def compare_with_numpy_ftrl(
         for i in range(1, train_iters):
             num_valid_tensor = flow.tensor(
                 np.array(num_valid_seq[i]).reshape(1,).astype(np.int32)
-            ).to("cuda")
-            grad_tensor = flow.tensor(random_grad_seq[i]).to("cuda")
+            ).to(device)
+            grad_tensor = flow.tensor(random_grad_seq[i]).to(device)
             skip_if_tensor = flow.tensor(
                 np.array(skip_if_seq[i]).reshape(1,).astype(np.int64)
-            ).to("cuda")
+            ).to(device)
 
             updated_tensor = train_one_iter(
                 num_valid_tensor, unique_embeddings_tensor, grad_tensor, skip_if_tensor,
@@ -151,7 +154,6 @@ def compare_with_numpy_ftrl(
     )
 
 
-@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class TestOptimizers(flow.unittest.TestCase):
     def test_ftrl(test_case):
@@ -166,6 +168,7 @@ class TestOptimizers(flow.unittest.TestCase):
         arg_dict["scale"] = [1, 0.1]
         arg_dict["learning_rate"] = [0.3, 1.5]
         arg_dict["train_iters"] = [10]
+        arg_dict["device"] = test_device
         for arg in GenArgDict(arg_dict):
             compare_with_numpy_ftrl(test_case, **arg)
 
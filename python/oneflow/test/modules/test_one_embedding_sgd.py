@@ -26,9 +26,11 @@ from optimizer_test_util import clip_grad_norm_np
 import oneflow as flow
 from oneflow.nn.parameter import Parameter
 
+test_device = ["cpu"] if os.getenv("ONEFLOW_TEST_CPU_ONLY") else ["cpu", "cuda"]
+
 
 def compare_with_numpy_sgd(
-    test_case, momentum, weight_decay, scale, learning_rate, train_iters,
+    test_case, momentum, weight_decay, scale, learning_rate, train_iters, device,
 ):
 
     num_rows = 500
@@ -49,14 +51,14 @@ def compare_with_numpy_sgd(
 
     def sgd_by_oneflow():
         unique_embeddings_tensor = flow.tensor(init_value, requires_grad=False).to(
-            "cuda"
+            device
         )
         lr_tensor = flow.tensor(
             np.array(learning_rate).reshape(1,).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
         down_scale_by_tensor = flow.tensor(
             np.array(down_scale_by).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
 
         def train_one_iter(num_valid, unique_embeddings, embedding_grad, skip_if):
             return flow._C.one_embedding_sgd_update(
@@ -74,11 +76,11 @@ def compare_with_numpy_sgd(
         for i in range(train_iters):
             num_valid_tensor = flow.tensor(
                 np.array(num_valid_seq[i]).reshape(1,).astype(np.int32)
-            ).to("cuda")
-            grad_tensor = flow.tensor(random_grad_seq[i]).to("cuda")
+            ).to(device)
+            grad_tensor = flow.tensor(random_grad_seq[i]).to(device)
             skip_if_tensor = flow.tensor(
                 np.array(skip_if_seq[i]).reshape(1,).astype(np.int64)
-            ).to("cuda")
+            ).to(device)
             updated_tensor = train_one_iter(
                 num_valid_tensor, unique_embeddings_tensor, grad_tensor, skip_if_tensor
             )
@@ -129,7 +131,6 @@ def compare_with_numpy_sgd(
         )
 
 
-@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class TestOptimizers(flow.unittest.TestCase):
     def test_one_embedding_sgd(test_case):
@@ -139,6 +140,7 @@ class TestOptimizers(flow.unittest.TestCase):
         arg_dict["scale"] = [1, 0.1]
         arg_dict["learning_rate"] = [1, 0.9]
         arg_dict["train_iters"] = [10]
+        arg_dict["device"] = test_device
         for arg in GenArgDict(arg_dict):
             compare_with_numpy_sgd(test_case, **arg)
 
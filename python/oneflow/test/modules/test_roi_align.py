@@ -13,6 +13,8 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+import os
+import time
 import unittest
 from collections import OrderedDict
 
@@ -530,10 +532,39 @@ class TestRoIAlign(flow.unittest.TestCase):
     def test_roi_align(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_roi_align, _test_roi_align_backward]
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = (
+            ["cpu"] if os.getenv("ONEFLOW_TEST_CPU_ONLY") else ["cpu", "cuda"]
+        )
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_ROI_ALIGN_BENCHMARK"), "benchmark only"
+    )
+    def test_roi_align_benchmark(test_case):
+        # the 1000 proposals of one image on a stride 4 feature map
+        input = flow.randn(1, 256, 200, 272, requires_grad=True)
+        xy = np.random.uniform(0, 800, size=(1000, 2))
+        wh = np.random.uniform(16, 256, size=(1000, 2))
+        rois = flow.tensor(
+            np.hstack((np.zeros((1000, 1)), xy, xy + wh)), dtype=flow.float32
+        )
+        for name, backward in [("forward", False), ("forward and backward", True)]:
+
+            def run():
+                out = flow.roi_align(input, rois, 0.25, 7, 7, 2, True)
+                if backward:
+                    out.sum().backward()
+                    return input.grad.numpy()
+                return out.numpy()
+
+            run()
+            start = time.perf_counter()
+            for _ in range(10):
+                run()
+            elapsed = (time.perf_counter() - start) / 10
+            print("roi_align", name, elapsed * 1000, "ms/image")
+
 
 if __name__ == "__main__":
     unittest.main()
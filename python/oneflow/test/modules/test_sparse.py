@@ -205,6 +205,14 @@ class TestEmbedding(flow.unittest.TestCase):
         y = embedding(indices)
         return y
 
+    @profile(torch.nn.functional.embedding)
+    def profile_embedding(test_case):
+        # vocab sizes of NLP and recommendation models
+        weight = torch.ones(200000, 128, requires_grad=True)
+        torch.nn.functional.embedding(torch.ones(64, 512, dtype=torch.int64), weight)
+        weight = torch.ones(1000000, 16, requires_grad=True)
+        torch.nn.functional.embedding(torch.ones(16384, 26, dtype=torch.int64), weight)
+
 
 if __name__ == "__main__":
     unittest.main()
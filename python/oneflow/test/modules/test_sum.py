@@ -14,6 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
+import ast
+import os
+import subprocess
+import sys
 import unittest
 from collections import OrderedDict
 
@@ -99,6 +103,44 @@ class TestSumModule(flow.unittest.TestCase):
         y = torch.sum(x)
         return y
 
+    def test_sum_cpu_kahan(test_case):
+        # The option is read once per process, so the sums run in a child process started
+        # with it. Every contiguous run starts with one 1.0 per summation lane followed by
+        # values below half an ulp of 1.0, which a plain float32 summation drops.
+        script = """
+import numpy as np
+import oneflow as flow
+
+x = np.full((2, 3, 65536), 1e-8, dtype=np.float32)
+x[:, :, :8] = 1.0
+x = flow.tensor(x)
+outs = [x.sum(), x.reshape(6, 65536).sum(dim=1), x.sum(dim=(0, 2))]
+print(repr([out.numpy().tolist() for out in outs]))
+"""
+        env = dict(os.environ, ONEFLOW_CPU_REDUCE_SUM_USE_KAHAN="1")
+        output = subprocess.check_output([sys.executable, "-c", script], env=env)
+        outs = ast.literal_eval(output.decode().strip().splitlines()[-1])
+        np_x = np.full((2, 3, 65536), 1e-8, dtype=np.float32)
+        np_x[:, :, :8] = 1.0
+        np_outs = [
+            np_x.sum(dtype=np.float64),
+            np_x.reshape(6, 65536).sum(axis=1, dtype=np.float64),
+            np_x.sum(axis=(0, 2), dtype=np.float64),
+        ]
+        naive_sum = np.cumsum(np_x[0, 0], dtype=np.float32)[-1]
+        test_case.assertFalse(np.allclose(naive_sum, np_outs[1][0], 1e-6, 0))
+        for out, np_out in zip(outs, np_outs):
+            test_case.assertTrue(np.allclose(out, np_out, 1e-6, 0))
+
+    @profile(torch.sum)
+    def profile_sum(test_case):
+        x = torch.ones(256, 1024, 64)
+        # scalar, row, column and the middle axis of a cube
+        torch.sum(x)
+        torch.sum(x, dim=2)
+        torch.sum(x, dim=(0, 1))
+        torch.sum(x, dim=(0, 2))
+
 
 if __name__ == "__main__":
     unittest.main()
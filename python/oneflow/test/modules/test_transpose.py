@@ -129,6 +129,14 @@ class TestTranspose(flow.unittest.TestCase):
         y = torch.transpose(x, dim0=random(1, 3).to(int), dim1=random(1, 3).to(int))
         return y
 
+    @profile(torch.transpose)
+    def profile_transpose(test_case):
+        # matrix, batched matrix and attention-style head transposes
+        torch.transpose(torch.ones(4096, 4096), 0, 1)
+        torch.transpose(torch.ones(64, 512, 512), 1, 2)
+        torch.transpose(torch.ones(32, 128, 12, 64), 1, 2)
+        torch.transpose(torch.ones(32, 12, 128, 64), 2, 3)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,45 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import re
+import unittest
+import oneflow.unittest
+import oneflow as flow
+
+
+def _metric_value(text, name):
+    match = re.search(r"^%s (\d+)$" % re.escape(name), text, re.MULTILINE)
+    return int(match.group(1)) if match else 0
+
+
+class TestMetrics(flow.unittest.TestCase):
+    def test_vm_metrics(test_case):
+        before = _metric_value(
+            flow.profiler.dump_metrics(), "oneflow_vm_instructions_total"
+        )
+        x = flow.ones(4, 4)
+        for _ in range(10):
+            x = x + 1
+        x.numpy()
+        text = flow.profiler.dump_metrics()
+        test_case.assertGreaterEqual(
+            _metric_value(text, "oneflow_vm_instructions_total") - before, 10
+        )
+        test_case.assertIn("# TYPE oneflow_vm_instruction_latency_ns histogram", text)
+        test_case.assertIn('oneflow_vm_instruction_latency_ns_bucket{le="+Inf"}', text)
+
+
+if __name__ == "__main__":
+    unittest.main()